@@ -16,6 +16,7 @@
 
 #include "svrApi.h"
 #include "svrApplication.h"
+#include "svrMemory.h"
 #include "svrProfile.h"
 #include "svrUtil.h"
 
@@ -311,6 +312,8 @@ void CommandCallback(android_app* pApp, int32_t cmd)
         // Try to reduce your memory use.
     case APP_CMD_LOW_MEMORY:
         LOGI("APP_CMD_LOW_MEMORY");
+        pFrmApp->OnLowMemory();
+        SvrLogMemoryStats();
         break;
 
         // Command from main thread: the app's activity has been started.
@@ -456,6 +459,7 @@ void android_main(android_app *pAppState)
         {
             // Must have received a pause, stop Svr
             svrEndVr();
+            SvrLogMemoryStats();
             gSvrInitialized = false;
         }
 
@@ -463,6 +467,8 @@ void android_main(android_app *pAppState)
         if (gContextCreated && !gIsPaused)
         {
             SvrApplicationContext& appContext = pApp->GetApplicationContext();
+
+            svrUpdateConfig();
         
             pApp->Update();
             pApp->Render();
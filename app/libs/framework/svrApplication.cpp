@@ -56,6 +56,11 @@ void SvrApplication::Shutdown()
 
 }
 
+void SvrApplication::OnLowMemory()
+{
+
+}
+
 SvrApplicationContext& SvrApplication::GetApplicationContext()
 {
     return mAppContext;
@@ -78,6 +78,9 @@ namespace Svr
         virtual void Update();
         virtual void Render() = 0;
 
+        // The system is running low on memory, release whatever can be rebuilt
+        virtual void OnLowMemory();
+
 
         SvrInput& GetInput();
         SvrApplicationContext& GetApplicationContext();
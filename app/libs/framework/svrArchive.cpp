@@ -0,0 +1,258 @@
+//=============================================================================
+// FILE: svrArchive.cpp
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "svrArchive.h"
+#include "svrUtil.h"
+
+namespace Svr
+{
+
+static SvrArchive   gMountedArchives[SVR_MAX_MOUNTED_ARCHIVES];
+static int          gNumMountedArchives = 0;
+
+//-----------------------------------------------------------------------------
+SvrArchive::SvrArchive()
+//-----------------------------------------------------------------------------
+    : mpMapping(NULL)
+    , mMappingSize(0)
+    , mpHeader(NULL)
+    , mpEntries(NULL)
+    , mpNames(NULL)
+{
+}
+
+//-----------------------------------------------------------------------------
+SvrArchive::~SvrArchive()
+//-----------------------------------------------------------------------------
+{
+    Close();
+}
+
+//-----------------------------------------------------------------------------
+bool SvrArchive::Open(const char* pFilePath)
+//-----------------------------------------------------------------------------
+{
+    Close();
+
+    int fd = open(pFilePath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        LOGE("SvrArchive: Unable to open %s", pFilePath);
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || (size_t)fileStat.st_size < sizeof(SvrArchiveHeader))
+    {
+        LOGE("SvrArchive: %s is too small to be an archive", pFilePath);
+        close(fd);
+        return false;
+    }
+
+    void* pMapping = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (pMapping == MAP_FAILED)
+    {
+        LOGE("SvrArchive: Unable to map %s", pFilePath);
+        return false;
+    }
+
+    mpMapping = pMapping;
+    mMappingSize = fileStat.st_size;
+    mpHeader = (const SvrArchiveHeader*)pMapping;
+    mpEntries = (const SvrArchiveEntry*)(mpHeader + 1);
+
+    if (!Validate())
+    {
+        LOGE("SvrArchive: %s is not a valid archive", pFilePath);
+        Close();
+        return false;
+    }
+    mpNames = (const char*)pMapping + mpHeader->namesOffset;
+
+    // Lookups jump around the payloads, only the table of contents is worth reading ahead
+    madvise(mpMapping, mMappingSize, MADV_RANDOM);
+    madvise(mpMapping, (size_t)(mpHeader->namesOffset + mpHeader->namesSize), MADV_WILLNEED);
+
+    LOGI("SvrArchive: Opened %s, %u entries, %zu bytes", pFilePath, mpHeader->numEntries, mMappingSize);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+void SvrArchive::Close()
+//-----------------------------------------------------------------------------
+{
+    if (mpMapping != NULL)
+    {
+        munmap(mpMapping, mMappingSize);
+    }
+
+    mpMapping = NULL;
+    mMappingSize = 0;
+    mpHeader = NULL;
+    mpEntries = NULL;
+    mpNames = NULL;
+}
+
+//-----------------------------------------------------------------------------
+bool SvrArchive::Validate() const
+//-----------------------------------------------------------------------------
+{
+    if (mpHeader->magic != SVR_ARCHIVE_MAGIC || mpHeader->version != SVR_ARCHIVE_VERSION)
+    {
+        return false;
+    }
+
+    // Sizes are compared against what is left past their offset, a sum of two
+    // 64 bit fields from the file could wrap
+    uint64_t mappingSize = mMappingSize;
+    uint64_t tocEnd = sizeof(SvrArchiveHeader) + (uint64_t)mpHeader->numEntries * sizeof(SvrArchiveEntry);
+    if (tocEnd > mappingSize || mpHeader->namesOffset < tocEnd ||
+        mpHeader->namesSize > mappingSize || mpHeader->namesOffset > mappingSize - mpHeader->namesSize)
+    {
+        return false;
+    }
+
+    // Checked once here so lookups can trust the table
+    for (uint32_t i = 0; i < mpHeader->numEntries; i++)
+    {
+        const SvrArchiveEntry& entry = mpEntries[i];
+        if (entry.size > mappingSize || entry.dataOffset > mappingSize - entry.size ||
+            (uint64_t)entry.nameOffset + entry.nameLength >= mpHeader->namesSize)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+bool SvrArchive::Find(const char* pName, SvrArchiveSpan* pSpan, bool prefetch) const
+//-----------------------------------------------------------------------------
+{
+    if (mpHeader == NULL)
+    {
+        return false;
+    }
+
+    uint32_t length = strlen(pName);
+    uint32_t hash = SvrArchiveHash(pName, length);
+
+    // First entry with this hash, then walk the (rare) collisions
+    uint32_t first = 0;
+    uint32_t count = mpHeader->numEntries;
+    while (count > 0)
+    {
+        uint32_t step = count / 2;
+        if (mpEntries[first + step].nameHash < hash)
+        {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else
+        {
+            count = step;
+        }
+    }
+
+    for (uint32_t i = first; i < mpHeader->numEntries && mpEntries[i].nameHash == hash; i++)
+    {
+        const SvrArchiveEntry& entry = mpEntries[i];
+        if (entry.nameLength == length && memcmp(mpNames + entry.nameOffset, pName, length) == 0)
+        {
+            pSpan->pData = (const char*)mpMapping + entry.dataOffset;
+            pSpan->size = (size_t)entry.size;
+            if (prefetch)
+            {
+                Prefetch(*pSpan);
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+void SvrArchive::Prefetch(const SvrArchiveSpan& span) const
+//-----------------------------------------------------------------------------
+{
+    if (span.size == 0)
+    {
+        return;
+    }
+
+    // madvise wants a page aligned start
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)span.pData & ~(uintptr_t)(pageSize - 1);
+    uintptr_t end = (uintptr_t)span.pData + span.size;
+    madvise((void*)start, end - start, MADV_WILLNEED);
+}
+
+//-----------------------------------------------------------------------------
+const char* SvrArchive::GetEntryName(unsigned int index) const
+//-----------------------------------------------------------------------------
+{
+    if (mpHeader == NULL || index >= mpHeader->numEntries)
+    {
+        return NULL;
+    }
+    return mpNames + mpEntries[index].nameOffset;
+}
+
+//-----------------------------------------------------------------------------
+bool SvrMountArchive(const char* pFilePath)
+//-----------------------------------------------------------------------------
+{
+    if (gNumMountedArchives >= SVR_MAX_MOUNTED_ARCHIVES)
+    {
+        LOGE("SvrMountArchive: Too many archives mounted, ignoring %s", pFilePath);
+        return false;
+    }
+
+    if (!gMountedArchives[gNumMountedArchives].Open(pFilePath))
+    {
+        return false;
+    }
+
+    gNumMountedArchives++;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+void SvrUnmountArchives()
+//-----------------------------------------------------------------------------
+{
+    for (int i = 0; i < gNumMountedArchives; i++)
+    {
+        gMountedArchives[i].Close();
+    }
+    gNumMountedArchives = 0;
+}
+
+//-----------------------------------------------------------------------------
+bool SvrFindAsset(const char* pName, SvrArchiveSpan* pSpan, bool prefetch)
+//-----------------------------------------------------------------------------
+{
+    for (int i = gNumMountedArchives - 1; i >= 0; i--)
+    {
+        if (gMountedArchives[i].Find(pName, pSpan, prefetch))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+}   // namespace Svr
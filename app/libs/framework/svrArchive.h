@@ -0,0 +1,66 @@
+//=============================================================================
+// FILE: svrArchive.h
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#pragma once
+
+#include <stddef.h>
+
+#include "svrArchiveFormat.h"
+
+#define SVR_MAX_MOUNTED_ARCHIVES    8
+
+namespace Svr
+{
+    // Read only view of an archive entry.  Points straight into the mapping and stays
+    // valid until the archive is closed.
+    struct SvrArchiveSpan
+    {
+        const void* pData;
+        size_t      size;
+    };
+
+    // Packed asset archive mapped into memory.  Opening costs one mmap; lookups are a
+    // binary search of the table of contents and never copy data, pages are faulted
+    // in from the file cache as they are first touched.
+    class SvrArchive
+    {
+    public:
+        SvrArchive();
+        ~SvrArchive();
+
+        bool    Open(const char* pFilePath);
+        void    Close();
+        bool    IsOpen() const { return mpMapping != NULL; }
+
+        // With prefetch set the span's pages are requested with MADV_WILLNEED so the
+        // kernel can start reading ahead of the first access
+        bool    Find(const char* pName, SvrArchiveSpan* pSpan, bool prefetch = false) const;
+        void    Prefetch(const SvrArchiveSpan& span) const;
+
+        unsigned int        GetEntryCount() const { return (mpHeader) ? mpHeader->numEntries : 0; }
+        const char*         GetEntryName(unsigned int index) const;
+
+    private:
+        SvrArchive(const SvrArchive&);
+        SvrArchive& operator=(const SvrArchive&);
+
+        bool    Validate() const;
+
+        void*                       mpMapping;
+        size_t                      mMappingSize;
+        const SvrArchiveHeader*     mpHeader;
+        const SvrArchiveEntry*      mpEntries;
+        const char*                 mpNames;
+    };
+
+    // Process wide file system over mounted archives.  Later mounts take precedence, so
+    // a patch archive can override entries of the base one.  Mount and unmount from the
+    // main thread while nothing is loading, lookups may come from any thread.
+    bool    SvrMountArchive(const char* pFilePath);
+    void    SvrUnmountArchives();
+    bool    SvrFindAsset(const char* pName, SvrArchiveSpan* pSpan, bool prefetch = false);
+}
@@ -0,0 +1,61 @@
+//=============================================================================
+// FILE: svrArchiveFormat.h
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#pragma once
+
+#include <stdint.h>
+
+// On disk layout of a packed asset archive, shared by the runtime (svrArchive) and
+// the offline packer (tools/svrpack).  All fields are little endian.
+//
+//  SvrArchiveHeader
+//  SvrArchiveEntry[numEntries]     sorted by (nameHash, name)
+//  names                           entry names, each NUL terminated
+//  payloads                        each starting on a dataAlignment boundary
+//
+// Entry names are relative paths with '/' separators, matched case sensitively.
+
+#define SVR_ARCHIVE_MAGIC           0x41525653      // "SVRA"
+#define SVR_ARCHIVE_VERSION         1
+#define SVR_ARCHIVE_DEFAULT_ALIGN   64
+
+namespace Svr
+{
+    struct SvrArchiveHeader
+    {
+        uint32_t    magic;
+        uint32_t    version;
+        uint32_t    numEntries;
+        uint32_t    dataAlignment;
+        uint64_t    namesOffset;
+        uint64_t    namesSize;
+    };
+
+    struct SvrArchiveEntry
+    {
+        uint64_t    dataOffset;
+        uint64_t    size;
+        uint32_t    nameHash;
+        uint32_t    nameOffset;     // From namesOffset
+        uint32_t    nameLength;     // Without the terminator
+        uint32_t    flags;          // Reserved, 0
+    };
+
+    typedef int SVR_ARCHIVE_HEADER_SIZE_ASSERT[sizeof(SvrArchiveHeader) == 32];
+    typedef int SVR_ARCHIVE_ENTRY_SIZE_ASSERT[sizeof(SvrArchiveEntry) == 32];
+
+    // FNV-1a over the name bytes
+    inline uint32_t SvrArchiveHash(const char* pName, uint32_t length)
+    {
+        uint32_t hash = 2166136261u;
+        for (uint32_t i = 0; i < length; i++)
+        {
+            hash = (hash ^ (unsigned char)pName[i]) * 16777619u;
+        }
+        return hash;
+    }
+}
@@ -0,0 +1,1090 @@
+//=============================================================================
+// FILE: svrBvh.cpp
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "svrBvh.h"
+#include "svrJobs.h"
+#include "svrSimd.h"
+#include "svrUtil.h"
+
+// Below this depth splits are by surface area, past it by primitive count, which
+// bounds the depth at about 48 + log2(primitives)
+#define BVH_MAX_SAH_DEPTH   48
+
+// Three siblings waiting per level of a four wide tree of bounded depth
+#define BVH_STACK_SIZE      256
+
+#define BVH_LEAF_BIT        0x80000000u
+#define BVH_EMPTY_CHILD     BVH_LEAF_BIT
+#define BVH_NO_NODE         0xffffffffu
+
+namespace Svr
+{
+
+// Binary tree made by the build, collapsed afterwards
+struct BuildNode
+{
+    glm::vec3   boxMin;
+    glm::vec3   boxMax;
+    uint32_t    left;       // BVH_NO_NODE for leaves
+    uint32_t    right;
+    uint32_t    first;      // Range of the subtree in the references
+    uint32_t    count;
+};
+
+// A subtree left for the job pool, built into its own nodes and grafted on after
+struct BuildTask
+{
+    uint32_t                node;
+    uint32_t                begin;
+    uint32_t                end;
+    uint32_t                depth;
+    std::vector<BuildNode>  nodes;
+};
+
+struct BuildJob
+{
+    const glm::vec3*        pPrimMin;
+    const glm::vec3*        pPrimMax;
+    const glm::vec3*        pCenters;   // Twice the box centers
+    uint32_t*               pRefs;
+    BuildTask*              pTasks;
+};
+
+struct Bin
+{
+    glm::vec3   boxMin;
+    glm::vec3   boxMax;
+    uint32_t    count;
+};
+
+//-----------------------------------------------------------------------------
+static inline float L_HalfArea(const glm::vec3& boxMin, const glm::vec3& boxMax)
+//-----------------------------------------------------------------------------
+{
+    glm::vec3 size = boxMax - boxMin;
+    return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+//-----------------------------------------------------------------------------
+static inline uint32_t L_LeafChild(uint32_t first, uint32_t count)
+//-----------------------------------------------------------------------------
+{
+    return BVH_LEAF_BIT | (first << 4) | count;
+}
+
+//-----------------------------------------------------------------------------
+static inline int L_BinIndex(float center, float centerMin, float scale)
+//-----------------------------------------------------------------------------
+{
+    int bin = (int)((center - centerMin) * scale);
+    return (bin < SVR_BVH_BINS - 1) ? bin : SVR_BVH_BINS - 1;
+}
+
+//-----------------------------------------------------------------------------
+static bool L_CompareTasks(const BuildTask& a, const BuildTask& b)
+//-----------------------------------------------------------------------------
+{
+    // Largest first, so the last jobs on the pool are short ones
+    return (a.end - a.begin) > (b.end - b.begin);
+}
+
+struct CenterLess
+{
+    const glm::vec3*    pCenters;
+    int                 axis;
+
+    bool operator()(uint32_t a, uint32_t b) const { return pCenters[a][axis] < pCenters[b][axis]; }
+};
+
+struct BinLess
+{
+    const glm::vec3*    pCenters;
+    int                 axis;
+    float               centerMin;
+    float               scale;
+    int                 split;
+
+    bool operator()(uint32_t ref) const { return L_BinIndex(pCenters[ref][axis], centerMin, scale) <= split; }
+};
+
+//-----------------------------------------------------------------------------
+static uint32_t L_SplitRange(const BuildJob& job, uint32_t begin, uint32_t end, uint32_t depth,
+                             const glm::vec3& centerMin, const glm::vec3& centerMax)
+//-----------------------------------------------------------------------------
+{
+    glm::vec3 extent = centerMax - centerMin;
+
+    if (depth < BVH_MAX_SAH_DEPTH)
+    {
+        Bin bins[3][SVR_BVH_BINS];
+        glm::vec3 scale;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            scale[axis] = (extent[axis] > 0.0f) ? SVR_BVH_BINS / extent[axis] : 0.0f;
+            for (int b = 0; b < SVR_BVH_BINS; b++)
+            {
+                bins[axis][b].boxMin = glm::vec3(FLT_MAX);
+                bins[axis][b].boxMax = glm::vec3(-FLT_MAX);
+                bins[axis][b].count = 0;
+            }
+        }
+
+        for (uint32_t i = begin; i < end; i++)
+        {
+            uint32_t ref = job.pRefs[i];
+            const glm::vec3& center = job.pCenters[ref];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                Bin& bin = bins[axis][L_BinIndex(center[axis], centerMin[axis], scale[axis])];
+                bin.boxMin = glm::min(bin.boxMin, job.pPrimMin[ref]);
+                bin.boxMax = glm::max(bin.boxMax, job.pPrimMax[ref]);
+                bin.count++;
+            }
+        }
+
+        // Cost of splitting after bin b is area * count of both sides, the area of the
+        // parent and the traversal cost are the same for every candidate
+        float bestCost = FLT_MAX;
+        int bestAxis = -1;
+        int bestSplit = 0;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (extent[axis] <= 0.0f)
+            {
+                continue;
+            }
+
+            float rightCost[SVR_BVH_BINS];
+            glm::vec3 boxMin(FLT_MAX);
+            glm::vec3 boxMax(-FLT_MAX);
+            uint32_t count = 0;
+            for (int b = SVR_BVH_BINS - 1; b > 0; b--)
+            {
+                const Bin& bin = bins[axis][b];
+                boxMin = glm::min(boxMin, bin.boxMin);
+                boxMax = glm::max(boxMax, bin.boxMax);
+                count += bin.count;
+                rightCost[b] = (count > 0) ? L_HalfArea(boxMin, boxMax) * count : 0.0f;
+            }
+
+            boxMin = glm::vec3(FLT_MAX);
+            boxMax = glm::vec3(-FLT_MAX);
+            count = 0;
+            for (int b = 0; b < SVR_BVH_BINS - 1; b++)
+            {
+                const Bin& bin = bins[axis][b];
+                boxMin = glm::min(boxMin, bin.boxMin);
+                boxMax = glm::max(boxMax, bin.boxMax);
+                count += bin.count;
+                if (count == 0 || count == end - begin)
+                {
+                    continue;
+                }
+
+                float cost = L_HalfArea(boxMin, boxMax) * count + rightCost[b + 1];
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = b;
+                }
+            }
+        }
+
+        if (bestAxis >= 0)
+        {
+            BinLess less = { job.pCenters, bestAxis, centerMin[bestAxis], scale[bestAxis], bestSplit };
+            uint32_t* pMid = std::partition(job.pRefs + begin, job.pRefs + end, less);
+            uint32_t mid = (uint32_t)(pMid - job.pRefs);
+            if (mid > begin && mid < end)
+            {
+                return mid;
+            }
+        }
+    }
+
+    // Centers all in one bin, or too deep: halves by count along the longest axis
+    int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+    uint32_t mid = (begin + end) / 2;
+    CenterLess less = { job.pCenters, axis };
+    std::nth_element(job.pRefs + begin, job.pRefs + mid, job.pRefs + end, less);
+    return mid;
+}
+
+//-----------------------------------------------------------------------------
+static void L_BuildRange(const BuildJob& job, std::vector<BuildNode>& nodes, uint32_t root,
+                         uint32_t begin, uint32_t end, uint32_t depth, std::vector<BuildTask>* pDeferred)
+//-----------------------------------------------------------------------------
+{
+    struct Entry
+    {
+        uint32_t    node;
+        uint32_t    begin;
+        uint32_t    end;
+        uint32_t    depth;
+    };
+
+    std::vector<Entry> stack;
+    Entry first = { root, begin, end, depth };
+    stack.push_back(first);
+
+    while (!stack.empty())
+    {
+        Entry entry = stack.back();
+        stack.pop_back();
+
+        glm::vec3 boxMin(FLT_MAX);
+        glm::vec3 boxMax(-FLT_MAX);
+        glm::vec3 centerMin(FLT_MAX);
+        glm::vec3 centerMax(-FLT_MAX);
+        for (uint32_t i = entry.begin; i < entry.end; i++)
+        {
+            uint32_t ref = job.pRefs[i];
+            boxMin = glm::min(boxMin, job.pPrimMin[ref]);
+            boxMax = glm::max(boxMax, job.pPrimMax[ref]);
+            centerMin = glm::min(centerMin, job.pCenters[ref]);
+            centerMax = glm::max(centerMax, job.pCenters[ref]);
+        }
+
+        BuildNode& node = nodes[entry.node];
+        node.boxMin = boxMin;
+        node.boxMax = boxMax;
+        node.left = BVH_NO_NODE;
+        node.right = BVH_NO_NODE;
+        node.first = entry.begin;
+        node.count = entry.end - entry.begin;
+
+        if (node.count <= SVR_BVH_MAX_LEAF_SIZE)
+        {
+            continue;
+        }
+
+        if (pDeferred != NULL && node.count <= SVR_BVH_TASK_SIZE)
+        {
+            BuildTask task;
+            task.node = entry.node;
+            task.begin = entry.begin;
+            task.end = entry.end;
+            task.depth = entry.depth;
+            pDeferred->push_back(task);
+            continue;
+        }
+
+        uint32_t mid = L_SplitRange(job, entry.begin, entry.end, entry.depth, centerMin, centerMax);
+
+        uint32_t left = (uint32_t)nodes.size();
+        nodes[entry.node].left = left;
+        nodes[entry.node].right = left + 1;
+        nodes.resize(left + 2);
+
+        Entry rightEntry = { left + 1, mid, entry.end, entry.depth + 1 };
+        Entry leftEntry = { left, entry.begin, mid, entry.depth + 1 };
+        stack.push_back(rightEntry);
+        stack.push_back(leftEntry);
+    }
+}
+
+//-----------------------------------------------------------------------------
+static void L_BuildTasks(void* pContext, int begin, int end)
+//-----------------------------------------------------------------------------
+{
+    const BuildJob& job = *(const BuildJob*)pContext;
+    for (int t = begin; t < end; t++)
+    {
+        BuildTask& task = job.pTasks[t];
+        task.nodes.reserve(2 * (task.end - task.begin) / SVR_BVH_MAX_LEAF_SIZE + 1);
+        task.nodes.resize(1);
+        L_BuildRange(job, task.nodes, 0, task.begin, task.end, task.depth, NULL);
+    }
+}
+
+//-----------------------------------------------------------------------------
+static int L_CollapseNodes(const std::vector<BuildNode>& build, uint32_t binary, uint32_t* pKids)
+//-----------------------------------------------------------------------------
+{
+    // Opens the inner child of largest area until there are four children, the biggest
+    // boxes are the ones most worth testing side by side
+    const BuildNode& node = build[binary];
+    if (node.left == BVH_NO_NODE)
+    {
+        pKids[0] = binary;
+        return 1;
+    }
+
+    int numKids = 0;
+    pKids[numKids++] = node.left;
+    pKids[numKids++] = node.right;
+    while (numKids < 4)
+    {
+        int best = -1;
+        float bestArea = -1.0f;
+        for (int k = 0; k < numKids; k++)
+        {
+            const BuildNode& kid = build[pKids[k]];
+            float area = L_HalfArea(kid.boxMin, kid.boxMax);
+            if (kid.left != BVH_NO_NODE && area > bestArea)
+            {
+                best = k;
+                bestArea = area;
+            }
+        }
+        if (best < 0)
+        {
+            break;
+        }
+
+        const BuildNode& open = build[pKids[best]];
+        pKids[best] = open.left;
+        pKids[numKids++] = open.right;
+    }
+    return numKids;
+}
+
+//-----------------------------------------------------------------------------
+SvrBvh::SvrBvh()
+//-----------------------------------------------------------------------------
+{
+}
+
+//-----------------------------------------------------------------------------
+void SvrBvh::SetTriangles(const void* pVertices, int vertexStride)
+//-----------------------------------------------------------------------------
+{
+    const unsigned char* pBase = (const unsigned char*)pVertices;
+    size_t numTriangles = mIndices.size() / 3;
+
+    mPrimMin.resize(numTriangles);
+    mPrimMax.resize(numTriangles);
+    mTriangles.resize(numTriangles);
+    for (size_t i = 0; i < numTriangles; i++)
+    {
+        const float* p0 = (const float*)(pBase + (size_t)mIndices[3 * i + 0] * vertexStride);
+        const float* p1 = (const float*)(pBase + (size_t)mIndices[3 * i + 1] * vertexStride);
+        const float* p2 = (const float*)(pBase + (size_t)mIndices[3 * i + 2] * vertexStride);
+        glm::vec3 v0(p0[0], p0[1], p0[2]);
+        glm::vec3 v1(p1[0], p1[1], p1[2]);
+        glm::vec3 v2(p2[0], p2[1], p2[2]);
+
+        mPrimMin[i] = glm::min(glm::min(v0, v1), v2);
+        mPrimMax[i] = glm::max(glm::max(v0, v1), v2);
+        mTriangles[i].v0 = v0;
+        mTriangles[i].edge1 = v1 - v0;
+        mTriangles[i].edge2 = v2 - v0;
+    }
+}
+
+//-----------------------------------------------------------------------------
+void SvrBvh::BuildTriangles(const void* pVertices, int vertexStride, const uint32_t* pIndices, int numIndices,
+                            bool parallel)
+//-----------------------------------------------------------------------------
+{
+    mIndices.assign(pIndices, pIndices + (numIndices / 3) * 3);
+    SetTriangles(pVertices, vertexStride);
+    Build(parallel);
+}
+
+//-----------------------------------------------------------------------------
+void SvrBvh::BuildBoxes(const glm::vec3* pBoxMin, const glm::vec3* pBoxMax, int numBoxes, bool parallel)
+//-----------------------------------------------------------------------------
+{
+    mIndices.clear();
+    mTriangles.clear();
+    mPrimMin.assign(pBoxMin, pBoxMin + numBoxes);
+    mPrimMax.assign(pBoxMax, pBoxMax + numBoxes);
+    Build(parallel);
+}
+
+//-----------------------------------------------------------------------------
+void SvrBvh::BuildScene(const SvrCullScene& scene, bool parallel)
+//-----------------------------------------------------------------------------
+{
+    int numObjects = scene.GetObjectCount();
+
+    mIndices.clear();
+    mTriangles.clear();
+    mPrimMin.resize(numObjects);
+    mPrimMax.resize(numObjects);
+    for (int i = 0; i < numObjects; i++)
+    {
+        scene.GetBounds(i, mPrimMin[i], mPrimMax[i]);
+    }
+    Build(parallel);
+}
+
+//-----------------------------------------------------------------------------
+void SvrBvh::Build(bool parallel)
+//-----------------------------------------------------------------------------
+{
+    uint32_t numPrims = (uint32_t)mPrimMin.size();
+    mNodes.clear();
+    mPrimitives.clear();
+    if (numPrims == 0)
+    {
+        return;
+    }
+    if (numPrims >= (1u << 27))
+    {
+        LOGE("SvrBvh: %u primitives is more than a tree can hold", numPrims);
+        mPrimMin.clear();
+        mPrimMax.clear();
+        mTriangles.clear();
+        mIndices.clear();
+        return;
+    }
+
+    std::vector<glm::vec3> centers(numPrims);
+    mPrimitives.resize(numPrims);
+    for (uint32_t i = 0; i < numPrims; i++)
+    {
+        centers[i] = mPrimMin[i] + mPrimMax[i];
+        mPrimitives[i] = i;
+    }
+
+    BuildJob job;
+    job.pPrimMin = &mPrimMin[0];
+    job.pPrimMax = &mPrimMax[0];
+    job.pCenters = &centers[0];
+    job.pRefs = &mPrimitives[0];
+    job.pTasks = NULL;
+
+    // The top of the tree splits on this thread, subtrees of up to SVR_BVH_TASK_SIZE
+    // primitives are left as tasks, each building into its own nodes on the pool
+    std::vector<BuildNode> build;
+    build.reserve(2 * numPrims / SVR_BVH_MAX_LEAF_SIZE + 1);
+    build.resize(1);
+
+    std::vector<BuildTask> tasks;
+    bool deferTasks = parallel && numPrims > SVR_BVH_TASK_SIZE;
+    L_BuildRange(job, build, 0, 0, numPrims, 0, deferTasks ? &tasks : NULL);
+
+    if (!tasks.empty())
+    {
+        std::sort(tasks.begin(), tasks.end(), L_CompareTasks);
+        job.pTasks = &tasks[0];
+        SvrParallelFor((int)tasks.size(), 1, L_BuildTasks, &job);
+
+        // Task node 0 takes the place of the node the task was made for, the rest are
+        // appended with their links moved along
+        for (size_t t = 0; t < tasks.size(); t++)
+        {
+            const BuildTask& task = tasks[t];
+            uint32_t offset = (uint32_t)build.size() - 1;
+            for (size_t n = 0; n < task.nodes.size(); n++)
+            {
+                BuildNode node = task.nodes[n];
+                if (node.left != BVH_NO_NODE)
+                {
+                    node.left += offset;
+                    node.right += offset;
+                }
+
+                if (n == 0)
+                {
+                    build[task.node] = node;
+                }
+                else
+                {
+                    build.push_back(node);
+                }
+            }
+        }
+    }
+
+    // Collapse to four children per node.  Nodes are made when they come off the stack,
+    // so every parent comes before its children and Refit can run backwards.
+    struct Entry
+    {
+        uint32_t    binary;
+        uint32_t    parent;
+        int         slot;
+    };
+
+    std::vector<Entry> stack;
+    mNodes.reserve(build.size() / 2 + 1);
+
+    Entry root = { 0, BVH_NO_NODE, 0 };
+    stack.push_back(root);
+    while (!stack.empty())
+    {
+        Entry entry = stack.back();
+        stack.pop_back();
+
+        uint32_t index = (uint32_t)mNodes.size();
+        mNodes.resize(index + 1);
+        if (entry.parent != BVH_NO_NODE)
+        {
+            mNodes[entry.parent].children[entry.slot] = index;
+        }
+
+        Node& node = mNodes[index];
+        for (int c = 0; c < 4; c++)
+        {
+            node.minX[c] = node.minY[c] = node.minZ[c] = FLT_MAX;
+            node.maxX[c] = node.maxY[c] = node.maxZ[c] = -FLT_MAX;
+            node.children[c] = BVH_EMPTY_CHILD;
+        }
+        node.firstPrimitive = build[entry.binary].first;
+        node.numPrimitives = build[entry.binary].count;
+
+        uint32_t kids[4];
+        int numKids = L_CollapseNodes(build, entry.binary, kids);
+        for (int c = numKids - 1; c >= 0; c--)
+        {
+            const BuildNode& kid = build[kids[c]];
+            node.minX[c] = kid.boxMin.x;
+            node.minY[c] = kid.boxMin.y;
+            node.minZ[c] = kid.boxMin.z;
+            node.maxX[c] = kid.boxMax.x;
+            node.maxY[c] = kid.boxMax.y;
+            node.maxZ[c] = kid.boxMax.z;
+
+            if (kid.left == BVH_NO_NODE)
+            {
+                node.children[c] = L_LeafChild(kid.first, kid.count);
+            }
+            else
+            {
+                Entry child = { kids[c], index, c };
+                stack.push_back(child);
+            }
+        }
+    }
+
+    // Primitive data follows the leaves, so a leaf reads one contiguous run
+    std::vector<glm::vec3> primMin(numPrims);
+    std::vector<glm::vec3> primMax(numPrims);
+    for (uint32_t i = 0; i < numPrims; i++)
+    {
+        primMin[i] = mPrimMin[mPrimitives[i]];
+        primMax[i] = mPrimMax[mPrimitives[i]];
+    }
+    mPrimMin.swap(primMin);
+    mPrimMax.swap(primMax);
+
+    if (!mTriangles.empty())
+    {
+        std::vector<Triangle> triangles(numPrims);
+        std::vector<uint32_t> indices(numPrims * 3);
+        for (uint32_t i = 0; i < numPrims; i++)
+        {
+            uint32_t prim = mPrimitives[i];
+            triangles[i] = mTriangles[prim];
+            indices[3 * i + 0] = mIndices[3 * prim + 0];
+            indices[3 * i + 1] = mIndices[3 * prim + 1];
+            indices[3 * i + 2] = mIndices[3 * prim + 2];
+        }
+        mTriangles.swap(triangles);
+        mIndices.swap(indices);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void SvrBvh::RefitTriangles(const void* pVertices, int vertexStride)
+//-----------------------------------------------------------------------------
+{
+    SetTriangles(pVertices, vertexStride);
+    Refit();
+}
+
+//-----------------------------------------------------------------------------
+void SvrBvh::RefitBoxes(const glm::vec3* pBoxMin, const glm::vec3* pBoxMax)
+//-----------------------------------------------------------------------------
+{
+    for (size_t i = 0; i < mPrimitives.size(); i++)
+    {
+        mPrimMin[i] = pBoxMin[mPrimitives[i]];
+        mPrimMax[i] = pBoxMax[mPrimitives[i]];
+    }
+    Refit();
+}
+
+//-----------------------------------------------------------------------------
+void SvrBvh::RefitScene(const SvrCullScene& scene)
+//-----------------------------------------------------------------------------
+{
+    for (size_t i = 0; i < mPrimitives.size(); i++)
+    {
+        scene.GetBounds(mPrimitives[i], mPrimMin[i], mPrimMax[i]);
+    }
+    Refit();
+}
+
+//-----------------------------------------------------------------------------
+void SvrBvh::Refit()
+//-----------------------------------------------------------------------------
+{
+    // Children come after their parents, backwards every child is done first
+    for (size_t n = mNodes.size(); n-- > 0; )
+    {
+        Node& node = mNodes[n];
+        for (int c = 0; c < 4; c++)
+        {
+            uint32_t child = node.children[c];
+            if (child == BVH_EMPTY_CHILD)
+            {
+                continue;
+            }
+
+            glm::vec3 boxMin(FLT_MAX);
+            glm::vec3 boxMax(-FLT_MAX);
+            if (child & BVH_LEAF_BIT)
+            {
+                uint32_t first = (child & ~BVH_LEAF_BIT) >> 4;
+                uint32_t count = child & 0xf;
+                for (uint32_t i = first; i < first + count; i++)
+                {
+                    boxMin = glm::min(boxMin, mPrimMin[i]);
+                    boxMax = glm::max(boxMax, mPrimMax[i]);
+                }
+            }
+            else
+            {
+                const Node& kid = mNodes[child];
+                boxMin = glm::vec3(SvrMinLane4(SvrLoad4(kid.minX)), SvrMinLane4(SvrLoad4(kid.minY)), SvrMinLane4(SvrLoad4(kid.minZ)));
+                boxMax = glm::vec3(SvrMaxLane4(SvrLoad4(kid.maxX)), SvrMaxLane4(SvrLoad4(kid.maxY)), SvrMaxLane4(SvrLoad4(kid.maxZ)));
+            }
+
+            node.minX[c] = boxMin.x;
+            node.minY[c] = boxMin.y;
+            node.minZ[c] = boxMin.z;
+            node.maxX[c] = boxMax.x;
+            node.maxY[c] = boxMax.y;
+            node.maxZ[c] = boxMax.z;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void SvrBvh::Destroy()
+//-----------------------------------------------------------------------------
+{
+    std::vector<Node>().swap(mNodes);
+    std::vector<uint32_t>().swap(mPrimitives);
+    std::vector<glm::vec3>().swap(mPrimMin);
+    std::vector<glm::vec3>().swap(mPrimMax);
+    std::vector<Triangle>().swap(mTriangles);
+    std::vector<uint32_t>().swap(mIndices);
+}
+
+//-----------------------------------------------------------------------------
+bool SvrBvh::GetBounds(glm::vec3& boxMin, glm::vec3& boxMax) const
+//-----------------------------------------------------------------------------
+{
+    if (mNodes.empty())
+    {
+        return false;
+    }
+
+    const Node& root = mNodes[0];
+    boxMin = glm::vec3(SvrMinLane4(SvrLoad4(root.minX)), SvrMinLane4(SvrLoad4(root.minY)), SvrMinLane4(SvrLoad4(root.minZ)));
+    boxMax = glm::vec3(SvrMaxLane4(SvrLoad4(root.maxX)), SvrMaxLane4(SvrLoad4(root.maxY)), SvrMaxLane4(SvrLoad4(root.maxZ)));
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+static inline bool L_RayBox(const SvrRay& ray, const glm::vec3& invDirection, const glm::vec3& boxMin,
+                            const glm::vec3& boxMax, float maxDistance, float& outDistance)
+//-----------------------------------------------------------------------------
+{
+    glm::vec3 t0 = (boxMin - ray.origin) * invDirection;
+    glm::vec3 t1 = (boxMax - ray.origin) * invDirection;
+    glm::vec3 tNear = glm::min(t0, t1);
+    glm::vec3 tFar = glm::max(t0, t1);
+
+    float enter = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0f));
+    float exit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, maxDistance));
+    outDistance = enter;
+    return enter <= exit;
+}
+
+//-----------------------------------------------------------------------------
+bool SvrBvh::IntersectLeaf(uint32_t first, uint32_t count, const SvrRay& ray, const glm::vec3& invDirection,
+                           SvrRayHit& hit, SvrBvhRayFn pfnIntersect, void* pUser) const
+//-----------------------------------------------------------------------------
+{
+    bool found = false;
+    for (uint32_t i = first; i < first + count; i++)
+    {
+        if (!mTriangles.empty())
+        {
+            // Moller and Trumbore, "Fast, Minimum Storage Ray/Triangle Intersection"
+            const Triangle& triangle = mTriangles[i];
+            glm::vec3 p = glm::cross(ray.direction, triangle.edge2);
+            float det = glm::dot(triangle.edge1, p);
+            if (det == 0.0f)
+            {
+                continue;
+            }
+
+            float invDet = 1.0f / det;
+            glm::vec3 s = ray.origin - triangle.v0;
+            float u = glm::dot(s, p) * invDet;
+            if (u < 0.0f || u > 1.0f)
+            {
+                continue;
+            }
+
+            glm::vec3 q = glm::cross(s, triangle.edge1);
+            float v = glm::dot(ray.direction, q) * invDet;
+            if (v < 0.0f || u + v > 1.0f)
+            {
+                continue;
+            }
+
+            float t = glm::dot(triangle.edge2, q) * invDet;
+            if (t >= 0.0f && t < hit.distance)
+            {
+                hit.distance = t;
+                hit.primitive = mPrimitives[i];
+                hit.u = u;
+                hit.v = v;
+                found = true;
+            }
+        }
+        else if (pfnIntersect != NULL)
+        {
+            found |= pfnIntersect(pUser, mPrimitives[i], ray, hit);
+        }
+        else
+        {
+            float t;
+            if (L_RayBox(ray, invDirection, mPrimMin[i], mPrimMax[i], hit.distance, t) && t < hit.distance)
+            {
+                hit.distance = t;
+                hit.primitive = mPrimitives[i];
+                hit.u = 0.0f;
+                hit.v = 0.0f;
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+//-----------------------------------------------------------------------------
+bool SvrBvh::IntersectRay(const SvrRay& ray, SvrRayHit& outHit, SvrBvhRayFn pfnIntersect, void* pUser) const
+//-----------------------------------------------------------------------------
+{
+    if (mNodes.empty())
+    {
+        return false;
+    }
+
+    SvrRayHit hit;
+    hit.distance = ray.maxDistance;
+    hit.primitive = BVH_NO_NODE;
+    hit.u = 0.0f;
+    hit.v = 0.0f;
+    bool found = false;
+
+    // Zero components become tiny, slabs along them are then all or nothing without
+    // the 0 * infinity of an exact reciprocal
+    glm::vec3 invDirection;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        float d = ray.direction[axis];
+        if (fabsf(d) < 1.0e-20f)
+        {
+            d = (d < 0.0f) ? -1.0e-20f : 1.0e-20f;
+        }
+        invDirection[axis] = 1.0f / d;
+    }
+
+    const SvrFloat4 originX = SvrSplat4(ray.origin.x);
+    const SvrFloat4 originY = SvrSplat4(ray.origin.y);
+    const SvrFloat4 originZ = SvrSplat4(ray.origin.z);
+    const SvrFloat4 invX = SvrSplat4(invDirection.x);
+    const SvrFloat4 invY = SvrSplat4(invDirection.y);
+    const SvrFloat4 invZ = SvrSplat4(invDirection.z);
+    const SvrFloat4 zero = SvrSplat4(0.0f);
+    const bool negX = invDirection.x < 0.0f;
+    const bool negY = invDirection.y < 0.0f;
+    const bool negZ = invDirection.z < 0.0f;
+
+    struct Entry
+    {
+        uint32_t    child;
+        float       distance;
+    };
+
+    Entry stack[BVH_STACK_SIZE];
+    int numEntries = 0;
+    stack[numEntries].child = 0;
+    stack[numEntries].distance = 0.0f;
+    numEntries++;
+
+    while (numEntries > 0)
+    {
+        const Entry entry = stack[--numEntries];
+        if (entry.distance > hit.distance)
+        {
+            continue;
+        }
+
+        if (entry.child & BVH_LEAF_BIT)
+        {
+            found |= IntersectLeaf((entry.child & ~BVH_LEAF_BIT) >> 4, entry.child & 0xf, ray, invDirection,
+                                   hit, pfnIntersect, pUser);
+            continue;
+        }
+
+        // Four slab tests at once, the near plane per axis follows the direction's sign
+        const Node& node = mNodes[entry.child];
+        SvrFloat4 nearX = SvrMul4(SvrSub4(SvrLoad4(negX ? node.maxX : node.minX), originX), invX);
+        SvrFloat4 nearY = SvrMul4(SvrSub4(SvrLoad4(negY ? node.maxY : node.minY), originY), invY);
+        SvrFloat4 nearZ = SvrMul4(SvrSub4(SvrLoad4(negZ ? node.maxZ : node.minZ), originZ), invZ);
+        SvrFloat4 farX = SvrMul4(SvrSub4(SvrLoad4(negX ? node.minX : node.maxX), originX), invX);
+        SvrFloat4 farY = SvrMul4(SvrSub4(SvrLoad4(negY ? node.minY : node.maxY), originY), invY);
+        SvrFloat4 farZ = SvrMul4(SvrSub4(SvrLoad4(negZ ? node.minZ : node.maxZ), originZ), invZ);
+
+        SvrFloat4 enter = SvrMax4(SvrMax4(nearX, nearY), SvrMax4(nearZ, zero));
+        SvrFloat4 exit = SvrMin4(SvrMin4(farX, farY), SvrMin4(farZ, SvrSplat4(hit.distance)));
+        unsigned int mask = ~SvrMaskBits4(SvrGreater4(enter, exit)) & 0xf;
+        if (mask == 0)
+        {
+            continue;
+        }
+
+        float distances[4];
+        SvrStore4(distances, enter);
+
+        // Pushed farthest first so the nearest child is visited next
+        Entry hits[4];
+        int numHits = 0;
+        while (mask != 0)
+        {
+            int c = __builtin_ctz(mask);
+            mask &= mask - 1;
+
+            Entry kid = { node.children[c], distances[c] };
+            int k = numHits++;
+            while (k > 0 && hits[k - 1].distance < kid.distance)
+            {
+                hits[k] = hits[k - 1];
+                k--;
+            }
+            hits[k] = kid;
+        }
+
+        for (int k = 0; k < numHits; k++)
+        {
+            stack[numEntries++] = hits[k];
+        }
+    }
+
+    if (found)
+    {
+        outHit = hit;
+    }
+    return found;
+}
+
+//-----------------------------------------------------------------------------
+int SvrBvh::QuerySphere(const glm::vec3& center, float radius, uint32_t* pOut, int maxOut) const
+//-----------------------------------------------------------------------------
+{
+    if (mNodes.empty())
+    {
+        return 0;
+    }
+
+    const SvrFloat4 centerX = SvrSplat4(center.x);
+    const SvrFloat4 centerY = SvrSplat4(center.y);
+    const SvrFloat4 centerZ = SvrSplat4(center.z);
+    const SvrFloat4 radiusSq = SvrSplat4(radius * radius);
+    const SvrFloat4 zero = SvrSplat4(0.0f);
+
+    uint32_t stack[BVH_STACK_SIZE];
+    int numEntries = 0;
+    stack[numEntries++] = 0;
+
+    int numFound = 0;
+    while (numEntries > 0)
+    {
+        uint32_t child = stack[--numEntries];
+        if (child & BVH_LEAF_BIT)
+        {
+            uint32_t first = (child & ~BVH_LEAF_BIT) >> 4;
+            uint32_t count = child & 0xf;
+            for (uint32_t i = first; i < first + count; i++)
+            {
+                glm::vec3 d = glm::max(glm::max(mPrimMin[i] - center, center - mPrimMax[i]), glm::vec3(0.0f));
+                if (glm::dot(d, d) <= radius * radius)
+                {
+                    if (numFound < maxOut)
+                    {
+                        pOut[numFound] = mPrimitives[i];
+                    }
+                    numFound++;
+                }
+            }
+            continue;
+        }
+
+        // Squared distance from the center to each box, per axis how far it is outside
+        const Node& node = mNodes[child];
+        SvrFloat4 dx = SvrMax4(SvrMax4(SvrSub4(SvrLoad4(node.minX), centerX), SvrSub4(centerX, SvrLoad4(node.maxX))), zero);
+        SvrFloat4 dy = SvrMax4(SvrMax4(SvrSub4(SvrLoad4(node.minY), centerY), SvrSub4(centerY, SvrLoad4(node.maxY))), zero);
+        SvrFloat4 dz = SvrMax4(SvrMax4(SvrSub4(SvrLoad4(node.minZ), centerZ), SvrSub4(centerZ, SvrLoad4(node.maxZ))), zero);
+        SvrFloat4 distanceSq = SvrAdd4(SvrAdd4(SvrMul4(dx, dx), SvrMul4(dy, dy)), SvrMul4(dz, dz));
+
+        unsigned int mask = ~SvrMaskBits4(SvrGreater4(distanceSq, radiusSq)) & 0xf;
+        while (mask != 0)
+        {
+            int c = __builtin_ctz(mask);
+            mask &= mask - 1;
+            if (node.children[c] != BVH_EMPTY_CHILD)
+            {
+                stack[numEntries++] = node.children[c];
+            }
+        }
+    }
+
+    return numFound;
+}
+
+//-----------------------------------------------------------------------------
+int SvrBvh::QueryFrustum(const SvrFrustum& frustum, uint32_t* pOut, int maxOut) const
+//-----------------------------------------------------------------------------
+{
+    if (mNodes.empty())
+    {
+        return 0;
+    }
+
+    SvrFloat4 planes[kNumFrustumPlanes][7];
+    for (int p = 0; p < kNumFrustumPlanes; p++)
+    {
+        const glm::vec4& plane = frustum.planes[p];
+        planes[p][0] = SvrSplat4(plane.x);
+        planes[p][1] = SvrSplat4(plane.y);
+        planes[p][2] = SvrSplat4(plane.z);
+        planes[p][3] = SvrSplat4(plane.w);
+        planes[p][4] = SvrSplat4(fabsf(plane.x));
+        planes[p][5] = SvrSplat4(fabsf(plane.y));
+        planes[p][6] = SvrSplat4(fabsf(plane.z));
+    }
+    const SvrFloat4 zero = SvrSplat4(0.0f);
+    const SvrFloat4 half = SvrSplat4(0.5f);
+
+    uint32_t stack[BVH_STACK_SIZE];
+    int numEntries = 0;
+    stack[numEntries++] = 0;
+
+    int numFound = 0;
+    while (numEntries > 0)
+    {
+        uint32_t child = stack[--numEntries];
+        if (child & BVH_LEAF_BIT)
+        {
+            uint32_t first = (child & ~BVH_LEAF_BIT) >> 4;
+            uint32_t count = child & 0xf;
+            for (uint32_t i = first; i < first + count; i++)
+            {
+                glm::vec3 center = (mPrimMin[i] + mPrimMax[i]) * 0.5f;
+                glm::vec3 extent = (mPrimMax[i] - mPrimMin[i]) * 0.5f;
+                bool outside = false;
+                for (int p = 0; p < kNumFrustumPlanes && !outside; p++)
+                {
+                    const glm::vec4& plane = frustum.planes[p];
+                    float d = glm::dot(glm::vec3(plane), center) + plane.w;
+                    outside = (d + glm::dot(glm::abs(glm::vec3(plane)), extent) < 0.0f);
+                }
+                if (!outside)
+                {
+                    if (numFound < maxOut)
+                    {
+                        pOut[numFound] = mPrimitives[i];
+                    }
+                    numFound++;
+                }
+            }
+            continue;
+        }
+
+        // Per plane a box is outside when its nearest corner is, and crosses it when its
+        // farthest corner is
+        const Node& node = mNodes[child];
+        SvrFloat4 minX = SvrLoad4(node.minX);
+        SvrFloat4 minY = SvrLoad4(node.minY);
+        SvrFloat4 minZ = SvrLoad4(node.minZ);
+        SvrFloat4 maxX = SvrLoad4(node.maxX);
+        SvrFloat4 maxY = SvrLoad4(node.maxY);
+        SvrFloat4 maxZ = SvrLoad4(node.maxZ);
+        SvrFloat4 cx = SvrMul4(SvrAdd4(minX, maxX), half);
+        SvrFloat4 cy = SvrMul4(SvrAdd4(minY, maxY), half);
+        SvrFloat4 cz = SvrMul4(SvrAdd4(minZ, maxZ), half);
+        SvrFloat4 ex = SvrMul4(SvrSub4(maxX, minX), half);
+        SvrFloat4 ey = SvrMul4(SvrSub4(maxY, minY), half);
+        SvrFloat4 ez = SvrMul4(SvrSub4(maxZ, minZ), half);
+
+        SvrFloat4 outside = SvrGreater4(zero, zero);
+        SvrFloat4 crossing = outside;
+        for (int p = 0; p < kNumFrustumPlanes; p++)
+        {
+            const SvrFloat4* plane = planes[p];
+            SvrFloat4 d = SvrAdd4(SvrAdd4(SvrMul4(plane[0], cx), SvrMul4(plane[1], cy)),
+                                  SvrAdd4(SvrMul4(plane[2], cz), plane[3]));
+            SvrFloat4 r = SvrAdd4(SvrAdd4(SvrMul4(plane[4], ex), SvrMul4(plane[5], ey)), SvrMul4(plane[6], ez));
+            outside = SvrOr4(outside, SvrGreater4(zero, SvrAdd4(d, r)));
+            crossing = SvrOr4(crossing, SvrGreater4(zero, SvrSub4(d, r)));
+        }
+
+        // Empty children have inverted boxes, which the planes do not reliably reject
+        unsigned int valid = 0;
+        for (int c = 0; c < 4; c++)
+        {
+            valid |= (node.children[c] != BVH_EMPTY_CHILD) ? (1 << c) : 0;
+        }
+        unsigned int visible = valid & ~SvrMaskBits4(outside);
+        unsigned int inside = visible & ~SvrMaskBits4(crossing);
+
+        while (visible != 0)
+        {
+            int c = __builtin_ctz(visible);
+            visible &= visible - 1;
+
+            uint32_t kid = node.children[c];
+            if (!(inside & (1 << c)))
+            {
+                stack[numEntries++] = kid;
+                continue;
+            }
+
+            // Wholly inside, every primitive below is in without further tests
+            uint32_t first;
+            uint32_t count;
+            if (kid & BVH_LEAF_BIT)
+            {
+                first = (kid & ~BVH_LEAF_BIT) >> 4;
+                count = kid & 0xf;
+            }
+            else
+            {
+                first = mNodes[kid].firstPrimitive;
+                count = mNodes[kid].numPrimitives;
+            }
+
+            if (numFound < maxOut)
+            {
+                int numCopy = (maxOut - numFound < (int)count) ? maxOut - numFound : (int)count;
+                memcpy(pOut + numFound, &mPrimitives[first], numCopy * sizeof(uint32_t));
+            }
+            numFound += count;
+        }
+    }
+
+    return numFound;
+}
+
+}
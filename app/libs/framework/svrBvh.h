@@ -0,0 +1,145 @@
+//=============================================================================
+// FILE: svrBvh.h
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "svrCulling.h"
+
+// Split candidates per axis when building
+#define SVR_BVH_BINS            16
+
+// Most primitives in a leaf, at most 15
+#define SVR_BVH_MAX_LEAF_SIZE   4
+
+// Subtrees with fewer primitives than this are built as one job
+#define SVR_BVH_TASK_SIZE       4096
+
+namespace Svr
+{
+    // Points at origin + t * direction for t in [0, maxDistance].  The direction does
+    // not need to be normalized, distances are then in units of its length.
+    struct SvrRay
+    {
+        glm::vec3   origin;
+        glm::vec3   direction;
+        float       maxDistance;
+    };
+
+    struct SvrRayHit
+    {
+        float       distance;
+        uint32_t    primitive;
+        float       u;          // Barycentrics of the hit on triangles, the point is
+        float       v;          // v0 * (1 - u - v) + v1 * u + v2 * v
+    };
+
+    // Exact test of one box primitive, called for the boxes the ray reaches.  Updates
+    // hit and returns true when the primitive is hit nearer than hit.distance.
+    typedef bool (*SvrBvhRayFn)(void* pUser, uint32_t primitive, const SvrRay& ray, SvrRayHit& hit);
+
+    // Bounding volume hierarchy over the triangles of a mesh or over boxes, such as the
+    // instances of a scene, for ray picking and sphere and frustum queries.
+    //
+    // The build bins primitive centers along each axis and takes the split of lowest
+    // surface area cost (Wald, "On fast Construction of SAH-based Bounding Volume
+    // Hierarchies"), handing subtrees below SVR_BVH_TASK_SIZE to the job pool.  The
+    // binary tree is then collapsed to four children per node, stored structure of
+    // arrays, so traversal tests the four child boxes at once with SSE2 or NEON.
+    //
+    // Moving geometry keeps its tree with Refit, which only recomputes the bounds.  The
+    // tree gets looser as primitives move away from where they were built, rebuild once
+    // the motion is large (a different pose, objects that crossed the room).
+    //
+    // Picking against many meshes is two levels: a box tree over the instances, whose
+    // SvrBvhRayFn moves the ray into the instance's model space and intersects that
+    // mesh's triangle tree.  Moved with the inverse model matrix and left unnormalized,
+    // the ray keeps the same distances in both spaces.
+    //
+    // Queries are const and can run on several threads at once.
+    class SvrBvh
+    {
+    public:
+        SvrBvh();
+
+        // Positions are 3 floats at the start of each vertex, primitive i is the triangle
+        // of indices 3i to 3i + 2
+        void    BuildTriangles(const void* pVertices, int vertexStride, const uint32_t* pIndices, int numIndices,
+                               bool parallel = true);
+        void    BuildBoxes(const glm::vec3* pBoxMin, const glm::vec3* pBoxMax, int numBoxes, bool parallel = true);
+
+        // Primitive i is object i of the scene, rebuild after objects are added or removed
+        void    BuildScene(const SvrCullScene& scene, bool parallel = true);
+
+        // New positions or bounds for the same primitives the tree was built with
+        void    RefitTriangles(const void* pVertices, int vertexStride);
+        void    RefitBoxes(const glm::vec3* pBoxMin, const glm::vec3* pBoxMax);
+        void    RefitScene(const SvrCullScene& scene);
+
+        void    Destroy();
+
+        // Nearest hit up to ray.maxDistance.  Triangles are two sided.  Box trees hit the
+        // boxes themselves unless pfnIntersect is given.
+        bool    IntersectRay(const SvrRay& ray, SvrRayHit& outHit, SvrBvhRayFn pfnIntersect = NULL, void* pUser = NULL) const;
+
+        // Primitives whose bounds overlap the sphere, or are at least partly inside the
+        // frustum.  Returns how many were found, only the first maxOut are written.
+        int     QuerySphere(const glm::vec3& center, float radius, uint32_t* pOut, int maxOut) const;
+        int     QueryFrustum(const SvrFrustum& frustum, uint32_t* pOut, int maxOut) const;
+
+        int     GetPrimitiveCount() const { return (int)mPrimitives.size(); }
+        int     GetNodeCount() const { return (int)mNodes.size(); }
+        bool    GetBounds(glm::vec3& boxMin, glm::vec3& boxMax) const;
+
+    private:
+        // Four child boxes.  A child is a node index, or a leaf when the top bit is set,
+        // holding primitives first to first + count in leaf order as (first << 4) | count.
+        // Unused children are empty leaves with inverted boxes no query can reach.
+        struct Node
+        {
+            float       minX[4];
+            float       minY[4];
+            float       minZ[4];
+            float       maxX[4];
+            float       maxY[4];
+            float       maxZ[4];
+            uint32_t    children[4];
+
+            // Every subtree covers a contiguous run of primitives in leaf order
+            uint32_t    firstPrimitive;
+            uint32_t    numPrimitives;
+        };
+
+        // First vertex and the two edges from it
+        struct Triangle
+        {
+            glm::vec3   v0;
+            glm::vec3   edge1;
+            glm::vec3   edge2;
+        };
+
+        void    Build(bool parallel);
+        void    Refit();
+        void    SetTriangles(const void* pVertices, int vertexStride);
+        bool    IntersectLeaf(uint32_t first, uint32_t count, const SvrRay& ray, const glm::vec3& invDirection,
+                              SvrRayHit& hit, SvrBvhRayFn pfnIntersect, void* pUser) const;
+
+        std::vector<Node>       mNodes;         // Root first, parents before children
+
+        // In leaf order
+        std::vector<uint32_t>   mPrimitives;    // Original primitive index
+        std::vector<glm::vec3>  mPrimMin;
+        std::vector<glm::vec3>  mPrimMax;
+        std::vector<Triangle>   mTriangles;     // Triangle trees only
+        std::vector<uint32_t>   mIndices;       // Three per triangle, for refits
+    };
+}
@@ -8,23 +8,137 @@
 
 #include "svrUtil.h"
 #include "svrConfig.h"
+#include "svrMemory.h"
 
-static Map<VariableBase>* sVariableMap;
+// Variables register from static constructors, so the registry is created on first use
+// and only holds plain pointers.  Lookups go through an open addressed index keyed on
+// the case folded name hash that is kept at most half full.
+struct VariableRegistry {
+	VariableBase**	variables;
+	int				count;
+	int				capacity;
 
-static Map<VariableBase>* VariableMap()
+	struct Slot {
+		unsigned int	hash;
+		int				index;		// Index into variables + 1, 0 marks an empty slot
+	};
+
+	Slot*			slots;
+	unsigned int	slotMask;
+	bool			finalized;
+};
+
+static VariableRegistry* sVariableRegistry;
+
+static VariableRegistry* Registry()
+{
+	if (!sVariableRegistry) sVariableRegistry = (VariableRegistry*)calloc(1, sizeof(VariableRegistry));
+	return sVariableRegistry;
+}
+
+static void InsertSlot(VariableRegistry* registry, int index)
 {
-	if (!sVariableMap) sVariableMap = new Map<VariableBase>();
-	return sVariableMap;
+	unsigned int hash = registry->variables[index]->GetHash();
+	unsigned int slot = hash & registry->slotMask;
+	while (registry->slots[slot].index != 0) {
+		slot = (slot + 1) & registry->slotMask;
+	}
+
+	registry->slots[slot].hash = hash;
+	registry->slots[slot].index = index + 1;
+}
+
+static void RebuildSlots(VariableRegistry* registry, unsigned int slotCount)
+{
+	free(registry->slots);
+	registry->slots = (VariableRegistry::Slot*)calloc(slotCount, sizeof(VariableRegistry::Slot));
+	registry->slotMask = slotCount - 1;
+
+	for (int a = 0; a < registry->count; a++) {
+		InsertSlot(registry, a);
+	}
 }
 
 VariableBase* GetVariable(const char* name)
 {
-	return VariableMap()->Find(name);
+	VariableRegistry* registry = Registry();
+	if (!registry->slots) return NULL;
+
+	unsigned int hash = HashTextCaseless(name);
+	unsigned int slot = hash & registry->slotMask;
+	for (;;) {
+		const VariableRegistry::Slot& s = registry->slots[slot];
+		if (s.index == 0) return NULL;
+
+		if (s.hash == hash) {
+			VariableBase* variable = registry->variables[s.index - 1];
+			if (CompareTextCaseless(variable->GetName(), name)) return variable;
+		}
+
+		slot = (slot + 1) & registry->slotMask;
+	}
 }
 
 bool AddVariable(VariableBase* variable)
 {
-	return VariableMap()->Insert(variable);
+	if (GetVariable(variable->GetName())) return false;
+
+	VariableRegistry* registry = Registry();
+	if (registry->count == registry->capacity) {
+		registry->capacity = (registry->capacity) ? registry->capacity * 2 : 256;
+		registry->variables = (VariableBase**)realloc(registry->variables, registry->capacity * sizeof(VariableBase*));
+	}
+
+	registry->variables[registry->count++] = variable;
+	registry->finalized = false;
+
+	unsigned int slotCount = registry->slotMask + 1;
+	if (!registry->slots || (unsigned int)registry->count * 2 > slotCount) {
+		RebuildSlots(registry, (registry->slots) ? slotCount * 2 : 512);
+	}
+	else {
+		InsertSlot(registry, registry->count - 1);
+	}
+
+	return true;
+}
+
+static int CompareVariableNames(const void* a, const void* b)
+{
+	const char* s1 = (*static_cast<VariableBase* const*>(a))->GetName();
+	const char* s2 = (*static_cast<VariableBase* const*>(b))->GetName();
+	if (CompareTextLessThan(s1, s2)) return -1;
+	return CompareTextLessThan(s2, s1) ? 1 : 0;
+}
+
+void FinalizeVariables()
+{
+	// Sorted by name so WriteVariableFile output is stable, the index is rebuilt
+	// tight to the count so far.  Variables of libraries loaded later still register
+	// afterwards: AddVariable appends and indexes them and clears finalized, so the
+	// next call sorts them in.
+	VariableRegistry* registry = Registry();
+	if (registry->finalized) return;
+
+	qsort(registry->variables, registry->count, sizeof(VariableBase*), CompareVariableNames);
+
+	unsigned int slotCount = 16;
+	while (slotCount < (unsigned int)registry->count * 2) slotCount <<= 1;
+	RebuildSlots(registry, slotCount);
+
+	registry->finalized = true;
+}
+
+bool SetVariableCallback(const char* name, VariableChangedCallback callback, void* userData)
+{
+	VariableBase* variable = GetVariable(name);
+	if (!variable) {
+		LOGE("Unable to set change callback, undefined variable -- %s", name);
+		return false;
+	}
+
+	variable->SetChangedCallback(callback, userData);
+	return true;
 }
 
 static int GetWhitespaceLength(const char* text)
@@ -219,15 +333,16 @@ void LoadVariableFile(const char* filename)
 	int size = ftell(fp);
 	fseek(fp, 0, SEEK_SET);
 
-	char* buf = new char[size + 1];
+	Svr::SvrLinearArena& scratch = Svr::SvrGetThreadArena();
+	Svr::SvrArenaScope scope(scratch);
+
+	char* buf = scratch.AllocArray<char>(size + 1);
 	fread(buf, 1, size, fp);
 	buf[size] = 0;
 
 	fclose(fp);
 
     LoadVariableBuffer(buf);
-
-	delete[] buf;
 }
 
 void WriteVariableFile(const char* filename)
@@ -238,8 +353,11 @@ void WriteVariableFile(const char* filename)
 		return;
 	}
 
-	VariableBase* variable = VariableMap()->First();
-	while (variable) {
+	FinalizeVariables();
+
+	VariableRegistry* registry = Registry();
+	for (int a = 0; a < registry->count; a++) {
+		VariableBase* variable = registry->variables[a];
 		if (!(variable->GetFlags() & kVariableNonpersistent)) {
 			char value[kMaxVariableValueLength];
 			variable->GetValue(value, kMaxVariableValueLength);
@@ -247,7 +365,7 @@ void WriteVariableFile(const char* filename)
 			sprintf(buffer, "%s = %s\n", variable->GetName(), value);
 			fwrite(buffer, 1, strlen(buffer), fp);
 		}
-
-		variable = variable->Next();
 	}
+
+	fclose(fp);
 }
\ No newline at end of file
@@ -33,6 +33,21 @@ inline bool CompareTextCaseless(const char* s1, const char* s2)
 	return true;
 }
 
+// FNV-1a over the ASCII lower-cased text, so names that compare equal with
+// CompareTextCaseless always hash equal
+inline unsigned int HashTextCaseless(const char* text)
+{
+	unsigned int hash = 2166136261U;
+	for (;;) {
+		unsigned long x = *reinterpret_cast<const unsigned char*>(text++);
+		if (x == 0) break;
+		if (x - 65 < 26UL) x += 32;
+		hash = (hash ^ (unsigned int)x) * 16777619U;
+	}
+
+	return hash;
+}
+
 inline bool CompareTextLessThan(const char* s1, const char* s2)
 {
 	for (int a = 0;; a++) {
@@ -386,19 +401,37 @@ enum {
 	kMaxVariableValueLength = 255
 };
 
-class VariableBase : public MapElement<VariableBase> {
+class VariableBase;
+
+// Called on the thread that loaded the new value, after it has been published
+typedef void (*VariableChangedCallback)(VariableBase* variable, void* userData);
+
+class VariableBase {
 private:
-	unsigned long mFlags;
-	char          mName[kMaxVariableNameLength];
+	unsigned long           mFlags;
+	unsigned int            mHash;
+	VariableChangedCallback mCallback;
+	void*                   mCallbackData;
+	char                    mName[kMaxVariableNameLength];
 protected:
 	VariableBase(const char* name, unsigned long flags = 0)
 	{
 		mFlags = flags;
+		mHash = HashTextCaseless(name);
+		mCallback = 0;
+		mCallbackData = 0;
 		strncpy(mName, name, kMaxVariableNameLength);
 	}
 	virtual ~VariableBase() {}
+
+	void NotifyChanged()
+	{
+		VariableChangedCallback callback = __atomic_load_n(&mCallback, __ATOMIC_ACQUIRE);
+		if (callback) callback(this, mCallbackData);
+	}
 public:
-	typedef ConstCharPtr KeyType;
+	// Registered variables are allocated back to back during static init
+	SVR_SLAB_ALLOCATED
 
 	unsigned long GetFlags() const
 	{
@@ -410,9 +443,9 @@ public:
 		mFlags = flags;
 	}
 
-	KeyType GetKey() const
+	unsigned int GetHash() const
 	{
-		return mName;
+		return mHash;
 	}
 
 	const char* GetName() const
@@ -420,6 +453,12 @@ public:
 		return mName;
 	}
 
+	void SetChangedCallback(VariableChangedCallback callback, void* userData)
+	{
+		mCallbackData = userData;
+		__atomic_store_n(&mCallback, callback, __ATOMIC_RELEASE);
+	}
+
 	virtual void SetValue(const char* const text) = 0;
 	virtual void GetValue(char* text, long max) = 0;
 };
@@ -536,9 +575,18 @@ public:
 
 	virtual ~Variable() {}
 
+	// Values are parsed into a local and published with a single atomic store, so
+	// readers on other threads never observe a partially written value
 	virtual void SetValue(const char* const text)
 	{
-		ReadFromText(mPtr, text);
+		Type value;
+		__atomic_load(mPtr, &value, __ATOMIC_RELAXED);
+		ReadFromText(&value, text);
+
+		if (memcmp(&value, mPtr, sizeof(Type)) != 0) {
+			__atomic_store(mPtr, &value, __ATOMIC_RELEASE);
+			NotifyChanged();
+		}
 	}
 
 	virtual void GetValue(char* text, long max)
@@ -549,6 +597,8 @@ public:
 
 extern VariableBase* GetVariable(const char* name);
 extern bool AddVariable(VariableBase* variable);
+extern void FinalizeVariables();
+extern bool SetVariableCallback(const char* name, VariableChangedCallback callback, void* userData);
 
 template <typename Type>
 Type RegisterVariable(const char* name, Type* ptr, Type init, unsigned long flags)
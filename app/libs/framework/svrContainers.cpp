@@ -116,27 +116,38 @@ MapBase::~MapBase()
 
 MapElementBase* MapBase::operator [](long index) const
 {
-	int i = 0;
-	MapElementBase* element = First();
+	MapElementBase* element = mRootNode;
 	while (element) {
-		if (i == index) return element;
-		element = element->Next();
-		i++;
+		long leftSize = SubtreeSize(element->mLeftSubnode);
+		if (index < leftSize) {
+			element = element->mLeftSubnode;
+		}
+		else if (index == leftSize) {
+			return element;
+		}
+		else {
+			index -= leftSize + 1;
+			element = element->mRightSubnode;
+		}
 	}
 
 	return 0;
 }
 
-long MapBase::GetElementCount() const
+long MapBase::GetIndex(const MapElementBase* element) const
 {
-	int count = 0;
-	const MapElementBase* element = First();
-	while (element) {
-		count++;
-		element = element->Next();
+	if (element->mOwningMap != this) return -1;
+
+	long index = SubtreeSize(element->mLeftSubnode);
+	for (;;) {
+		const MapElementBase* super = element->mSuperNode;
+		if (!super) break;
+
+		if (super->mRightSubnode == element) index += SubtreeSize(super->mLeftSubnode) + 1;
+		element = super;
 	}
 
-	return long(count);
+	return index;
 }
 
 MapElementBase* MapBase::RotateLeft(MapElementBase* node)
@@ -162,6 +173,9 @@ MapElementBase* MapBase::RotateLeft(MapElementBase* node)
 	node->mSuperNode = right;
 	node->mBalance = -(--right->mBalance);
 
+	right->mSubtreeSize = node->mSubtreeSize;
+	UpdateSubtreeSize(node);
+
 	return right;
 }
 
@@ -188,6 +202,9 @@ MapElementBase* MapBase::RotateRight(MapElementBase* node)
 	node->mSuperNode = left;
 	node->mBalance = -(++left->mBalance);
 
+	left->mSubtreeSize = node->mSubtreeSize;
+	UpdateSubtreeSize(node);
+
 	return left;
 }
 
@@ -225,6 +242,10 @@ MapElementBase* MapBase::ZigZagLeft(MapElementBase* node)
 	right->mBalance = -MinZero(b);
 	top->mBalance = 0;
 
+	top->mSubtreeSize = node->mSubtreeSize;
+	UpdateSubtreeSize(node);
+	UpdateSubtreeSize(right);
+
 	return top;
 }
 
@@ -262,6 +283,10 @@ MapElementBase* MapBase::ZigZagRight(MapElementBase* node)
 	left->mBalance = -MaxZero(b);
 	top->mBalance = 0;
 
+	top->mSubtreeSize = node->mSubtreeSize;
+	UpdateSubtreeSize(node);
+	UpdateSubtreeSize(left);
+
 	return top;
 }
 
@@ -272,6 +297,7 @@ void MapBase::SetRootNode(MapElementBase* node)
 
 	node->mOwningMap = this;
 	node->mBalance = 0;
+	node->mSubtreeSize = 1;
 
 	mRootNode = node;
 }
@@ -285,6 +311,12 @@ void MapBase::InsertLeftSubnode(MapElementBase* node, MapElementBase* subnode)
 	subnode->mSuperNode = node;
 	subnode->mOwningMap = this;
 	subnode->mBalance = 0;
+	subnode->mSubtreeSize = 1;
+
+	// Sizes along the whole path change even though rebalancing may stop early
+	for (MapElementBase* element = node; element; element = element->mSuperNode) {
+		element->mSubtreeSize++;
+	}
 
 	long b = node->mBalance - 1;
 	node->mBalance = b;
@@ -336,6 +368,12 @@ void MapBase::InsertRightSubnode(MapElementBase* node, MapElementBase* subnode)
 	subnode->mSuperNode = node;
 	subnode->mOwningMap = this;
 	subnode->mBalance = 0;
+	subnode->mSubtreeSize = 1;
+
+	// Sizes along the whole path change even though rebalancing may stop early
+	for (MapElementBase* element = node; element; element = element->mSuperNode) {
+		element->mSubtreeSize++;
+	}
 
 	long b = node->mBalance + 1;
 	node->mBalance = b;
@@ -383,6 +421,10 @@ void MapBase::RemoveBranchNode(MapElementBase* node, MapElementBase* subnode)
 	MapElementBase* super = node->mSuperNode;
 	if (subnode) subnode->mSuperNode = super;
 
+	for (MapElementBase* element = super; element; element = element->mSuperNode) {
+		element->mSubtreeSize--;
+	}
+
 	if (super) {
 		long	db;
 
@@ -462,6 +504,7 @@ void MapBase::RemoveNode(MapElementBase* node)
 		top->mRightSubnode = right;
 
 		top->mBalance = node->mBalance;
+		top->mSubtreeSize = node->mSubtreeSize;
 	}
 	else {
 		RemoveBranchNode(node, (left) ? left : right);
@@ -473,6 +516,50 @@ void MapBase::RemoveNode(MapElementBase* node)
 	node->mOwningMap = 0;
 }
 
+MapElementBase* MapBase::BuildSubtree(const void* elements, SortedElementAccessor accessor, long first, long count, long* height)
+{
+	if (count <= 0) {
+		*height = 0;
+		return 0;
+	}
+
+	// The left half takes the extra element, so the left subtree is never the shorter one
+	long leftCount = count >> 1;
+	MapElementBase* node = accessor(elements, first + leftCount);
+
+	long leftHeight;
+	long rightHeight;
+	MapElementBase* left = BuildSubtree(elements, accessor, first, leftCount, &leftHeight);
+	MapElementBase* right = BuildSubtree(elements, accessor, first + leftCount + 1, count - leftCount - 1, &rightHeight);
+
+	node->mLeftSubnode = left;
+	node->mRightSubnode = right;
+	if (left) left->mSuperNode = node;
+	if (right) right->mSuperNode = node;
+
+	node->mOwningMap = this;
+	node->mBalance = rightHeight - leftHeight;
+	node->mSubtreeSize = count;
+
+	*height = ((leftHeight > rightHeight) ? leftHeight : rightHeight) + 1;
+	return node;
+}
+
+void MapBase::BuildFromSorted(const void* elements, long count, SortedElementAccessor accessor)
+{
+	RemoveAll();
+
+	for (long a = 0; a < count; a++) {
+		MapElementBase* element = accessor(elements, a);
+		MapBase* map = element->mOwningMap;
+		if (map) map->RemoveNode(element);
+	}
+
+	long height;
+	mRootNode = BuildSubtree(elements, accessor, 0, count, &height);
+	if (mRootNode) mRootNode->mSuperNode = 0;
+}
+
 void MapBase::RemoveAll()
 {
 	if (mRootNode) {
@@ -7,6 +7,8 @@
 #ifndef _SVR_API_CONTAINERS_H_
 #define _SVR_API_CONTAINERS_H_
 
+#include "svrSlab.h"
+
 struct MapBase;
 struct MapElementBase;
 template <class>
@@ -26,6 +28,7 @@ private:
 
 	MapBase*			mOwningMap;
 	long				mBalance;
+	long				mSubtreeSize;		// Number of elements in the subtree rooted here, including this one
 
 	MapElementBase* First();
 	MapElementBase* Last();
@@ -39,6 +42,7 @@ protected:
 		mLeftSubnode = 0;
 		mRightSubnode = 0;
 		mOwningMap = 0;
+		mSubtreeSize = 0;
 	}
 
 	virtual ~MapElementBase();
@@ -61,11 +65,16 @@ protected:
 	MapElementBase* Previous() const;
 	MapElementBase* Next() const;
 public:
+	// Elements created with new are packed into slabs so tree walks stay in cache
+	SVR_SLAB_ALLOCATED
+
 	virtual void Detach();
 };
 
 struct MapBase {
 	friend struct MapElementBase;
+protected:
+	typedef MapElementBase* (*SortedElementAccessor)(const void* elements, long index);
 private:
 	MapElementBase*		mRootNode;
 
@@ -75,6 +84,18 @@ private:
 	MapElementBase*	ZigZagRight(MapElementBase* node);
 
 	void RemoveBranchNode(MapElementBase* node, MapElementBase* subnode);
+
+	static long SubtreeSize(const MapElementBase* node)
+	{
+		return (node) ? node->mSubtreeSize : 0;
+	}
+
+	static void UpdateSubtreeSize(MapElementBase* node)
+	{
+		node->mSubtreeSize = SubtreeSize(node->mLeftSubnode) + SubtreeSize(node->mRightSubnode) + 1;
+	}
+
+	MapElementBase* BuildSubtree(const void* elements, SortedElementAccessor accessor, long first, long count, long* height);
 protected:
 	MapBase()
 	{
@@ -84,6 +105,7 @@ protected:
 	~MapBase();
 
 	MapElementBase* operator [](long index) const;
+	long GetIndex(const MapElementBase* element) const;
 
 	MapElementBase* GetRootNode() const
 	{
@@ -111,13 +133,17 @@ protected:
 	void InsertRightSubnode(MapElementBase* node, MapElementBase* subnode);
 
 	void RemoveNode(MapElementBase* node);
+	void BuildFromSorted(const void* elements, long count, SortedElementAccessor accessor);
 public:
 	bool Empty() const
 	{
 		return !mRootNode;
 	}
 
-	long GetElementCount() const;
+	long GetElementCount() const
+	{
+		return SubtreeSize(mRootNode);
+	}
 
 	void RemoveAll();
 	void Purge();
@@ -156,6 +182,11 @@ public:
 
 template <class DataType>
 struct Map : public MapBase {
+private:
+	static MapElementBase* GetSortedElement(const void* elements, long index)
+	{
+		return static_cast<MapElement<DataType>*>(static_cast<DataType* const*>(elements)[index]);
+	}
 public:
 	typedef typename DataType::KeyType KeyType;
 
@@ -166,6 +197,12 @@ public:
 		return static_cast<DataType*>(static_cast<MapElement<DataType>*>(MapBase::operator [](index)));
 	}
 
+	// Position of the element in key order, or -1 if it is not a member of this map
+	long GetIndex(const MapElement<DataType>* element) const
+	{
+		return MapBase::GetIndex(element);
+	}
+
 	DataType* First() const
 	{
 		return static_cast<DataType*>(static_cast<MapElement<DataType>*>(MapBase::First()));
@@ -195,7 +232,19 @@ public:
 	void Insert(DataType* element, const MapReservation* reservation);
 	bool Reserve(const KeyType& key, MapReservation* reservation);
 
+	// Replaces the contents of the map with elements that are already sorted by
+	// strictly increasing key, in linear time
+	void BuildFromSorted(DataType* const* elements, long count)
+	{
+		MapBase::BuildFromSorted(elements, count, &GetSortedElement);
+	}
+
 	DataType* Find(const KeyType& key) const;
+
+	// First element with a key not less than / greater than the given key.  Iterate a
+	// range with Next() from LowerBound(low) until reaching UpperBound(high).
+	DataType* LowerBound(const KeyType& key) const;
+	DataType* UpperBound(const KeyType& key) const;
 };
 
 template <class DataType>
@@ -302,6 +351,44 @@ DataType* Map<DataType>::Find(const KeyType& key) const
 	return (node);
 }
 
+template <class DataType>
+DataType* Map<DataType>::LowerBound(const KeyType& key) const
+{
+	DataType* result = 0;
+	DataType* node = GetRootNode();
+	while (node) {
+		const KeyType& nodeKey = node->GetKey();
+		if (key > nodeKey) {
+			node = node->GetRightSubnode();
+		}
+		else {
+			result = node;
+			node = node->GetLeftSubnode();
+		}
+	}
+
+	return (result);
+}
+
+template <class DataType>
+DataType* Map<DataType>::UpperBound(const KeyType& key) const
+{
+	DataType* result = 0;
+	DataType* node = GetRootNode();
+	while (node) {
+		const KeyType& nodeKey = node->GetKey();
+		if (key < nodeKey) {
+			result = node;
+			node = node->GetLeftSubnode();
+		}
+		else {
+			node = node->GetRightSubnode();
+		}
+	}
+
+	return (result);
+}
+
 
 template<typename T, unsigned int SIZE>
 class PooledRing
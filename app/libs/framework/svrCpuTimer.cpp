@@ -6,6 +6,8 @@
 //
 //=============================================================================
 
+#include <string.h>
+
 #include "svrCpuTimer.h"
 
 namespace Svr
@@ -50,7 +52,7 @@ namespace Svr
     void SvrBufferedCpuTimer::Reset()
     {
         mTimer.Reset();
-        memset(&mpTimeBuffer[0], 0, mBufferSize * sizeof(double));
+        memset(&mpTimeBuffer[0], 0, mBufferSize * sizeof(float));
         mInsertIndex = 0;
     }
 
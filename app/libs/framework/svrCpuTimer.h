@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <time.h>
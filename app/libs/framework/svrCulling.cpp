@@ -0,0 +1,387 @@
+//=============================================================================
+// FILE: svrCulling.cpp
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "svrCulling.h"
+#include "svrJobs.h"
+#include "svrMemory.h"
+
+namespace Svr
+{
+
+//-----------------------------------------------------------------------------
+void SvrExtractFrustum(const glm::mat4& viewProjection, SvrFrustum& outFrustum)
+//-----------------------------------------------------------------------------
+{
+    // Rows of the matrix, glm stores columns
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++)
+    {
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+
+    outFrustum.planes[kPlaneLeft] = rows[3] + rows[0];
+    outFrustum.planes[kPlaneRight] = rows[3] - rows[0];
+    outFrustum.planes[kPlaneBottom] = rows[3] + rows[1];
+    outFrustum.planes[kPlaneTop] = rows[3] - rows[1];
+    outFrustum.planes[kPlaneNear] = rows[3] + rows[2];
+    outFrustum.planes[kPlaneFar] = rows[3] - rows[2];
+
+    for (int i = 0; i < kNumFrustumPlanes; i++)
+    {
+        outFrustum.planes[i] /= glm::length(glm::vec3(outFrustum.planes[i]));
+    }
+}
+
+//-----------------------------------------------------------------------------
+void SvrGetStereoCullFrustum(const glm::mat4& leftEyeView, const glm::mat4& rightEyeView,
+                             const glm::mat4& projection, SvrFrustum& outFrustum)
+//-----------------------------------------------------------------------------
+{
+    // Matching planes of the two eyes are parallel, the one further out bounds both
+    SvrFrustum rightFrustum;
+    SvrExtractFrustum(projection * leftEyeView, outFrustum);
+    SvrExtractFrustum(projection * rightEyeView, rightFrustum);
+    for (int i = 0; i < kNumFrustumPlanes; i++)
+    {
+        if (rightFrustum.planes[i].w > outFrustum.planes[i].w)
+        {
+            outFrustum.planes[i] = rightFrustum.planes[i];
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+SvrCullScene::SvrCullScene()
+//-----------------------------------------------------------------------------
+    : mNumObjects(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+void SvrCullScene::Reserve(int numObjects)
+//-----------------------------------------------------------------------------
+{
+    size_t padded = (numObjects + 3) & ~3;
+    std::vector<float>* arrays[] = { &mCenterX, &mCenterY, &mCenterZ, &mRadius, &mExtentX, &mExtentY, &mExtentZ };
+    for (int i = 0; i < (int)(sizeof(arrays) / sizeof(arrays[0])); i++)
+    {
+        arrays[i]->reserve(padded);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void SvrCullScene::Grow(int numObjects)
+//-----------------------------------------------------------------------------
+{
+    size_t padded = (numObjects + 3) & ~3;
+    if (padded <= mCenterX.size())
+    {
+        return;
+    }
+
+    std::vector<float>* arrays[] = { &mCenterX, &mCenterY, &mCenterZ, &mRadius, &mExtentX, &mExtentY, &mExtentZ };
+    for (int i = 0; i < (int)(sizeof(arrays) / sizeof(arrays[0])); i++)
+    {
+        arrays[i]->resize(padded, 0.0f);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void SvrCullScene::Clear()
+//-----------------------------------------------------------------------------
+{
+    std::vector<float>* arrays[] = { &mCenterX, &mCenterY, &mCenterZ, &mRadius, &mExtentX, &mExtentY, &mExtentZ };
+    for (int i = 0; i < (int)(sizeof(arrays) / sizeof(arrays[0])); i++)
+    {
+        arrays[i]->clear();
+    }
+    mNumObjects = 0;
+}
+
+//-----------------------------------------------------------------------------
+int SvrCullScene::AddObject(const glm::vec3& boxMin, const glm::vec3& boxMax, float radius)
+//-----------------------------------------------------------------------------
+{
+    Grow(mNumObjects + 1);
+    SetBounds(mNumObjects, boxMin, boxMax, radius);
+    return mNumObjects++;
+}
+
+//-----------------------------------------------------------------------------
+int SvrCullScene::AddObject(const glm::mat4& modelMatrix, const glm::vec3& localMin, const glm::vec3& localMax)
+//-----------------------------------------------------------------------------
+{
+    Grow(mNumObjects + 1);
+    SetBounds(mNumObjects, modelMatrix, localMin, localMax);
+    return mNumObjects++;
+}
+
+//-----------------------------------------------------------------------------
+int SvrCullScene::RemoveObject(int index)
+//-----------------------------------------------------------------------------
+{
+    int last = --mNumObjects;
+    std::vector<float>* arrays[] = { &mCenterX, &mCenterY, &mCenterZ, &mRadius, &mExtentX, &mExtentY, &mExtentZ };
+    for (int i = 0; i < (int)(sizeof(arrays) / sizeof(arrays[0])); i++)
+    {
+        std::vector<float>& values = *arrays[i];
+        values[index] = values[last];
+        values[last] = 0.0f;
+    }
+    return (index != last) ? index : -1;
+}
+
+//-----------------------------------------------------------------------------
+void SvrCullScene::SetBounds(int index, const glm::vec3& boxMin, const glm::vec3& boxMax, float radius)
+//-----------------------------------------------------------------------------
+{
+    glm::vec3 center = (boxMin + boxMax) * 0.5f;
+    glm::vec3 extent = (boxMax - boxMin) * 0.5f;
+
+    mCenterX[index] = center.x;
+    mCenterY[index] = center.y;
+    mCenterZ[index] = center.z;
+    mRadius[index] = radius;
+    mExtentX[index] = extent.x;
+    mExtentY[index] = extent.y;
+    mExtentZ[index] = extent.z;
+}
+
+//-----------------------------------------------------------------------------
+void SvrCullScene::SetBounds(int index, const glm::mat4& modelMatrix, const glm::vec3& localMin, const glm::vec3& localMax)
+//-----------------------------------------------------------------------------
+{
+    glm::vec3 localCenter = (localMin + localMax) * 0.5f;
+    glm::vec3 localExtent = (localMax - localMin) * 0.5f;
+
+    glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(localCenter, 1.0f));
+    glm::vec3 extent;
+    for (int i = 0; i < 3; i++)
+    {
+        extent[i] = fabsf(modelMatrix[0][i]) * localExtent.x +
+                    fabsf(modelMatrix[1][i]) * localExtent.y +
+                    fabsf(modelMatrix[2][i]) * localExtent.z;
+    }
+
+    float scale = glm::max(glm::length(glm::vec3(modelMatrix[0])),
+                           glm::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+
+    SetBounds(index, center - extent, center + extent, glm::length(localExtent) * scale);
+}
+
+struct CullJob
+{
+    const float*    pCenterX;
+    const float*    pCenterY;
+    const float*    pCenterZ;
+    const float*    pRadius;
+    const float*    pExtentX;
+    const float*    pExtentY;
+    const float*    pExtentZ;
+
+    // Plane normal, distance and the normal's absolute values, which project the box
+    // extents onto the normal
+    float           planes[kNumFrustumPlanes][7];
+
+    uint32_t*       pVisible;
+    int*            pCounts;
+};
+
+//-----------------------------------------------------------------------------
+static int L_CullRange(const CullJob& job, int begin, int end)
+//-----------------------------------------------------------------------------
+{
+    // Every object is visible unless its sphere or its box is entirely behind a plane.
+    // Per plane the nearer of the two is tested, d + min(radius, box radius) < 0.
+    uint32_t* pOut = job.pVisible + begin;
+    int numVisible = 0;
+
+#if defined(__SSE2__)
+    __m128 planes[kNumFrustumPlanes][7];
+    for (int p = 0; p < kNumFrustumPlanes; p++)
+    {
+        for (int c = 0; c < 7; c++)
+        {
+            planes[p][c] = _mm_set1_ps(job.planes[p][c]);
+        }
+    }
+    const __m128 zero = _mm_setzero_ps();
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+    float32x4_t planes[kNumFrustumPlanes][7];
+    for (int p = 0; p < kNumFrustumPlanes; p++)
+    {
+        for (int c = 0; c < 7; c++)
+        {
+            planes[p][c] = vdupq_n_f32(job.planes[p][c]);
+        }
+    }
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    static const uint32_t laneBits[4] = { 1, 2, 4, 8 };
+    const uint32x4_t bits = vld1q_u32(laneBits);
+#endif
+
+    for (int i = begin; i < end; i += 4)
+    {
+        unsigned int mask;
+
+#if defined(__SSE2__)
+        __m128 cx = _mm_loadu_ps(job.pCenterX + i);
+        __m128 cy = _mm_loadu_ps(job.pCenterY + i);
+        __m128 cz = _mm_loadu_ps(job.pCenterZ + i);
+        __m128 radius = _mm_loadu_ps(job.pRadius + i);
+        __m128 ex = _mm_loadu_ps(job.pExtentX + i);
+        __m128 ey = _mm_loadu_ps(job.pExtentY + i);
+        __m128 ez = _mm_loadu_ps(job.pExtentZ + i);
+
+        __m128 outside = zero;
+        for (int p = 0; p < kNumFrustumPlanes; p++)
+        {
+            const __m128* plane = planes[p];
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane[0], cx), _mm_mul_ps(plane[1], cy)),
+                                  _mm_add_ps(_mm_mul_ps(plane[2], cz), plane[3]));
+            __m128 boxRadius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane[4], ex), _mm_mul_ps(plane[5], ey)),
+                                          _mm_mul_ps(plane[6], ez));
+            __m128 r = _mm_min_ps(radius, boxRadius);
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(d, r), zero));
+        }
+        mask = ~_mm_movemask_ps(outside) & 0xf;
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+        float32x4_t cx = vld1q_f32(job.pCenterX + i);
+        float32x4_t cy = vld1q_f32(job.pCenterY + i);
+        float32x4_t cz = vld1q_f32(job.pCenterZ + i);
+        float32x4_t radius = vld1q_f32(job.pRadius + i);
+        float32x4_t ex = vld1q_f32(job.pExtentX + i);
+        float32x4_t ey = vld1q_f32(job.pExtentY + i);
+        float32x4_t ez = vld1q_f32(job.pExtentZ + i);
+
+        uint32x4_t outside = vdupq_n_u32(0);
+        for (int p = 0; p < kNumFrustumPlanes; p++)
+        {
+            const float32x4_t* plane = planes[p];
+            float32x4_t d = vmlaq_f32(vmlaq_f32(vmlaq_f32(plane[3], plane[0], cx), plane[1], cy), plane[2], cz);
+            float32x4_t boxRadius = vmlaq_f32(vmlaq_f32(vmulq_f32(plane[4], ex), plane[5], ey), plane[6], ez);
+            float32x4_t r = vminq_f32(radius, boxRadius);
+            outside = vorrq_u32(outside, vcltq_f32(vaddq_f32(d, r), zero));
+        }
+
+        // No movemask on NEON: one bit per lane, then a horizontal add
+        uint32x4_t laneMask = vandq_u32(outside, bits);
+        uint32x2_t sum = vadd_u32(vget_low_u32(laneMask), vget_high_u32(laneMask));
+        mask = ~vget_lane_u32(vpadd_u32(sum, sum), 0) & 0xf;
+#else
+        mask = 0;
+        for (int lane = 0; lane < 4; lane++)
+        {
+            int k = i + lane;
+            bool outside = false;
+            for (int p = 0; p < kNumFrustumPlanes; p++)
+            {
+                const float* plane = job.planes[p];
+                float d = plane[0] * job.pCenterX[k] + plane[1] * job.pCenterY[k] + plane[2] * job.pCenterZ[k] + plane[3];
+                float boxRadius = plane[4] * job.pExtentX[k] + plane[5] * job.pExtentY[k] + plane[6] * job.pExtentZ[k];
+                float r = (job.pRadius[k] < boxRadius) ? job.pRadius[k] : boxRadius;
+                outside |= (d + r < 0.0f);
+            }
+            mask |= outside ? 0 : (1 << lane);
+        }
+#endif
+
+        if (end - i >= 4)
+        {
+            // Every lane's index is written, only visible ones advance
+            for (int lane = 0; lane < 4; lane++)
+            {
+                pOut[numVisible] = i + lane;
+                numVisible += (mask >> lane) & 1;
+            }
+        }
+        else
+        {
+            mask &= (1 << (end - i)) - 1;
+            while (mask != 0)
+            {
+                pOut[numVisible++] = i + __builtin_ctz(mask);
+                mask &= mask - 1;
+            }
+        }
+    }
+
+    return numVisible;
+}
+
+//-----------------------------------------------------------------------------
+static void L_CullChunks(void* pContext, int begin, int end)
+//-----------------------------------------------------------------------------
+{
+    const CullJob& job = *(const CullJob*)pContext;
+    job.pCounts[begin / SVR_CULL_CHUNK_SIZE] = L_CullRange(job, begin, end);
+}
+
+//-----------------------------------------------------------------------------
+int SvrCullScene::Cull(const SvrFrustum& frustum, uint32_t* pVisible, bool parallel) const
+//-----------------------------------------------------------------------------
+{
+    if (mNumObjects == 0)
+    {
+        return 0;
+    }
+
+    CullJob job;
+    job.pCenterX = &mCenterX[0];
+    job.pCenterY = &mCenterY[0];
+    job.pCenterZ = &mCenterZ[0];
+    job.pRadius = &mRadius[0];
+    job.pExtentX = &mExtentX[0];
+    job.pExtentY = &mExtentY[0];
+    job.pExtentZ = &mExtentZ[0];
+    for (int p = 0; p < kNumFrustumPlanes; p++)
+    {
+        const glm::vec4& plane = frustum.planes[p];
+        job.planes[p][0] = plane.x;
+        job.planes[p][1] = plane.y;
+        job.planes[p][2] = plane.z;
+        job.planes[p][3] = plane.w;
+        job.planes[p][4] = fabsf(plane.x);
+        job.planes[p][5] = fabsf(plane.y);
+        job.planes[p][6] = fabsf(plane.z);
+    }
+    job.pVisible = pVisible;
+    job.pCounts = NULL;
+
+    int numChunks = (mNumObjects + SVR_CULL_CHUNK_SIZE - 1) / SVR_CULL_CHUNK_SIZE;
+    if (!parallel || numChunks == 1)
+    {
+        return L_CullRange(job, 0, mNumObjects);
+    }
+
+    // Each chunk writes its indices at the start of its own range, squeezed together after
+    SvrLinearArena& arena = SvrGetThreadArena();
+    SvrArenaScope scope(arena);
+    job.pCounts = arena.AllocArray<int>(numChunks);
+    memset(job.pCounts, 0, numChunks * sizeof(int));
+
+    SvrParallelFor(mNumObjects, SVR_CULL_CHUNK_SIZE, L_CullChunks, &job);
+
+    int numVisible = job.pCounts[0];
+    for (int c = 1; c < numChunks; c++)
+    {
+        memmove(pVisible + numVisible, pVisible + c * SVR_CULL_CHUNK_SIZE, job.pCounts[c] * sizeof(uint32_t));
+        numVisible += job.pCounts[c];
+    }
+    return numVisible;
+}
+
+}
@@ -0,0 +1,111 @@
+//=============================================================================
+// FILE: svrCulling.h
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Objects per job when culling in parallel, a multiple of the SIMD width
+#define SVR_CULL_CHUNK_SIZE     4096
+
+namespace Svr
+{
+    enum SvrFrustumPlane
+    {
+        kPlaneLeft = 0,
+        kPlaneRight,
+        kPlaneBottom,
+        kPlaneTop,
+        kPlaneNear,
+        kPlaneFar,
+        kNumFrustumPlanes
+    };
+
+    // World space planes (xyz normal, w distance) facing inwards and normalized, a point
+    // p is inside a plane when dot(plane.xyz, p) + plane.w >= 0
+    struct SvrFrustum
+    {
+        glm::vec4   planes[kNumFrustumPlanes];
+    };
+
+    // Planes of clip space for a projection * view matrix (Gribb and Hartmann, "Fast
+    // Extraction of Viewing Frustum Planes from the World-View-Projection Matrix")
+    void    SvrExtractFrustum(const glm::mat4& viewProjection, SvrFrustum& outFrustum);
+
+    // One frustum holding both eyes, so a scene is culled once rather than per eye.  The
+    // eyes of SvrGetEyeViewMatrices share orientation and projection and sit apart along
+    // their x axis, so their top, bottom, near and far planes coincide and the outer side
+    // planes of the two eyes close the union.  Past ipd / (tan left + tan right) in front
+    // of the eyes (3cm for a 90 degree field of view, inside any near plane) nothing
+    // outside both eyes is kept.
+    void    SvrGetStereoCullFrustum(const glm::mat4& leftEyeView, const glm::mat4& rightEyeView,
+                                    const glm::mat4& projection, SvrFrustum& outFrustum);
+
+    // World space bounds of the objects of a scene, kept structure of arrays so the
+    // culling kernel tests four objects at a time with SSE2 or NEON.  Each object has an
+    // axis aligned box and a bounding sphere around the box center, it is culled when
+    // either is fully outside a plane: the box is tight for axis aligned objects, the
+    // sphere for rotated ones.  Objects are dense: removal moves the last object into
+    // the hole.
+    class SvrCullScene
+    {
+    public:
+        SvrCullScene();
+
+        void    Reserve(int numObjects);
+        void    Clear();
+
+        // Returns the new object's index
+        int     AddObject(const glm::vec3& boxMin, const glm::vec3& boxMax, float radius);
+        int     AddObject(const glm::mat4& modelMatrix, const glm::vec3& localMin, const glm::vec3& localMax);
+
+        // Returns the index of the object that moved into index, -1 when it was the last one
+        int     RemoveObject(int index);
+
+        // radius is that of a sphere around the box center holding the object, at most
+        // half the box diagonal
+        void    SetBounds(int index, const glm::vec3& boxMin, const glm::vec3& boxMax, float radius);
+
+        // Bounds of a local box moved by modelMatrix: the box grows to hold the rotated
+        // one (Arvo, "Transforming Axis-Aligned Bounding Boxes"), the sphere only scales
+        void    SetBounds(int index, const glm::mat4& modelMatrix, const glm::vec3& localMin, const glm::vec3& localMax);
+
+        // Writes the indices of the objects at least partly inside the frustum to
+        // pVisible, in ascending order, and returns their count.  pVisible must hold
+        // GetObjectCount() indices.  Parallel culling splits the scene into chunks of
+        // SVR_CULL_CHUNK_SIZE on the job pool.
+        int     Cull(const SvrFrustum& frustum, uint32_t* pVisible, bool parallel = false) const;
+
+        int     GetObjectCount() const { return mNumObjects; }
+
+        void    GetBounds(int index, glm::vec3& boxMin, glm::vec3& boxMax) const
+        {
+            glm::vec3 center(mCenterX[index], mCenterY[index], mCenterZ[index]);
+            glm::vec3 extent(mExtentX[index], mExtentY[index], mExtentZ[index]);
+            boxMin = center - extent;
+            boxMax = center + extent;
+        }
+
+    private:
+        void    Grow(int numObjects);
+
+        int                 mNumObjects;
+
+        // Padded to a multiple of four with empty objects, so the kernel never reads past the end
+        std::vector<float>  mCenterX;
+        std::vector<float>  mCenterY;
+        std::vector<float>  mCenterZ;
+        std::vector<float>  mRadius;
+        std::vector<float>  mExtentX;       // Box half sizes around the center
+        std::vector<float>  mExtentY;
+        std::vector<float>  mExtentZ;
+    };
+}
@@ -5,13 +5,24 @@
 //                              All Rights Reserved.
 //
 //=============================================================================
+#include <fcntl.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <GLES3/gl3.h>
 
-#include "tiny_obj_loader.h"
 #include <vector>
 #include <string>
 
+#include "svrArchive.h"
 #include "svrGeometry.h"
+#include "svrMemory.h"
+#include "svrMeshFormat.h"
+#include "svrMeshOptimizer.h"
+#include "svrObjImport.h"
 #include "svrShader.h"
 #include "svrUtil.h"
 
@@ -24,14 +35,33 @@ SvrGeometry::SvrGeometry()
     , mVaoId(0)
     , mVertexCount(0)
     , mIndexCount(0)
+    , mIndexType(GL_UNSIGNED_INT)
+    , mIndexOffset(0)
+    , mOwnsBuffers(false)
+    , mBoundsMin(0.0f)
+    , mBoundsMax(0.0f)
+    , mPositionScale(1.0f)
+    , mPositionBias(0.0f)
+    , mNumLods(1)
+    , mLod(0)
+    , mInstanceDivisor(0)
 {
-
+    memset(mLods, 0, sizeof(mLods));
 }
 
 void SvrGeometry::Initialize(SvrProgramAttribute* pAttribs, int nAttribs,
                              unsigned int* pIndices, int nIndices,
                              const void* pVertexData, int bufferSize, int nVertices)
 {
+    Initialize(pAttribs, nAttribs, pIndices, GL_UNSIGNED_INT, nIndices, pVertexData, bufferSize, nVertices);
+}
+
+void SvrGeometry::Initialize(SvrProgramAttribute* pAttribs, int nAttribs,
+                             const void* pIndices, unsigned int indexType, int nIndices,
+                             const void* pVertexData, int bufferSize, int nVertices)
+{
+    int indexSize = (indexType == GL_UNSIGNED_SHORT) ? sizeof(unsigned short) : sizeof(unsigned int);
+
     //Create the VBO
     GL(glGenBuffers( 1, &mVbId));
     GL(glBindBuffer( GL_ARRAY_BUFFER, mVbId ));
@@ -41,7 +71,7 @@ void SvrGeometry::Initialize(SvrProgramAttribute* pAttribs, int nAttribs,
     //Create the Index Buffer
 	GL(glGenBuffers( 1, &mIbId));
 	GL(glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, mIbId ));
-	GL(glBufferData( GL_ELEMENT_ARRAY_BUFFER, nIndices * sizeof(unsigned int), pIndices, GL_STATIC_DRAW));
+	GL(glBufferData( GL_ELEMENT_ARRAY_BUFFER, nIndices * indexSize, pIndices, GL_STATIC_DRAW));
 	GL(glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0));
 
     //Create the VAO
@@ -56,7 +86,7 @@ void SvrGeometry::Initialize(SvrProgramAttribute* pAttribs, int nAttribs,
         GL(glEnableVertexAttribArray( pAttribs[i].index ));
 		GL(glVertexAttribPointer(pAttribs[i].index, pAttribs[i].size,
 			pAttribs[i].type, pAttribs[i].normalized,
-			pAttribs[i].stride, (void*)pAttribs[i].offset));
+			pAttribs[i].stride, (const void*)(uintptr_t)pAttribs[i].offset));
 	}
 
 	GL(glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, mIbId ));
@@ -65,102 +95,471 @@ void SvrGeometry::Initialize(SvrProgramAttribute* pAttribs, int nAttribs,
 
     mVertexCount = nVertices;
     mIndexCount = nIndices;
+    mIndexType = indexType;
+    mIndexOffset = 0;
+    mLods[0].firstIndex = 0;
+    mLods[0].numIndices = nIndices;
+    mLods[0].error = 0.0f;
+    mNumLods = 1;
+    mLod = 0;
+    mOwnsBuffers = true;
+    mInstanceDivisor = 0;
+}
+
+void SvrGeometry::InitializeShared(const SvrGeometry& owner, int firstIndex, int nIndices)
+{
+    int indexSize = (owner.mIndexType == GL_UNSIGNED_SHORT) ? sizeof(unsigned short) : sizeof(unsigned int);
+
+    // The owner itself just narrows down to its own range
+    if (&owner != this)
+    {
+        mVbId = owner.mVbId;
+        mIbId = owner.mIbId;
+        mVaoId = owner.mVaoId;
+        mVertexCount = owner.mVertexCount;
+        mIndexType = owner.mIndexType;
+        mPositionScale = owner.mPositionScale;
+        mPositionBias = owner.mPositionBias;
+        mOwnsBuffers = false;
+        mInstanceDivisor = 0;
+    }
+    mIndexCount = nIndices;
+    mIndexOffset = (size_t)firstIndex * indexSize;
+    mLods[0].firstIndex = firstIndex;
+    mLods[0].numIndices = nIndices;
+    mLods[0].error = 0.0f;
+    mNumLods = 1;
+    mLod = 0;
+}
+
+void SvrGeometry::SetLod(int lod)
+{
+    int indexSize = (mIndexType == GL_UNSIGNED_SHORT) ? sizeof(unsigned short) : sizeof(unsigned int);
+
+    mLod = glm::clamp(lod, 0, mNumLods - 1);
+    mIndexCount = mLods[mLod].numIndices;
+    mIndexOffset = (size_t)mLods[mLod].firstIndex * indexSize;
+}
+
+void SvrGeometry::SetLods(const SvrMeshLod* pLods, int numLods)
+{
+    mNumLods = glm::clamp(numLods, 1, SVR_MESH_MAX_LODS);
+    memcpy(mLods, pLods, mNumLods * sizeof(SvrMeshLod));
+    SetLod(0);
+}
+
+int SvrGeometry::UpdateLod(const glm::mat4& modelMatrix, const glm::vec3& eyePosition, float projectionScale, float maxErrorPixels)
+{
+    if (mNumLods == 1)
+    {
+        return 0;
+    }
+
+    // Errors are in object units, so scale them up by the largest axis of the transform
+    float scale = glm::max(glm::length(glm::vec3(modelMatrix[0])),
+                  glm::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+    glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(0.5f * (mBoundsMin + mBoundsMax), 1.0f));
+    float radius = 0.5f * glm::length(mBoundsMax - mBoundsMin) * scale;
+    float distance = glm::length(center - eyePosition) - radius;
+    if (distance <= 0.0f)
+    {
+        SetLod(0);
+        return 0;
+    }
+
+    float pixelsPerUnit = projectionScale * scale / distance;
+    int lod = mLod;
+    while (lod > 0 && mLods[lod].error * pixelsPerUnit > maxErrorPixels)
+    {
+        lod--;
+    }
+    while (lod + 1 < mNumLods && mLods[lod + 1].error * pixelsPerUnit < maxErrorPixels * (1.0f - SVR_LOD_HYSTERESIS))
+    {
+        lod++;
+    }
+
+    SetLod(lod);
+    return lod;
+}
+
+float SvrGeometry::GetLodProjectionScale(int eyeBufferHeight, float fovYDeg)
+{
+    return 0.5f * eyeBufferHeight / tanf(0.5f * glm::radians(fovYDeg));
 }
 
 void SvrGeometry::Destroy()
 {
-    GL(glDeleteBuffers( 1, &mIbId ));
-	GL(glDeleteBuffers( 1, &mVbId ));
+    // Sub-meshes only borrow the buffers of the first geometry
+    if (mOwnsBuffers)
+    {
+        GL(glDeleteVertexArrays( 1, &mVaoId ));
+        GL(glDeleteBuffers( 1, &mIbId ));
+        GL(glDeleteBuffers( 1, &mVbId ));
+    }
+    mVaoId = 0;
+    mIbId = 0;
+    mVbId = 0;
+    mOwnsBuffers = false;
+    mInstanceDivisor = 0;
+}
+
+void SvrGeometry::EnableInstanceArrays(int divisor)
+{
+    if (mInstanceDivisor == divisor)
+    {
+        return;
+    }
+
+    // A mat4 attribute takes four consecutive locations
+    for (int i = 0; i < 4; i++)
+    {
+        if (mInstanceDivisor == 0)
+        {
+            GL(glEnableVertexAttribArray( kInstanceModel + i ));
+        }
+        GL(glVertexAttribDivisor( kInstanceModel + i, divisor ));
+    }
+    if (mInstanceDivisor == 0)
+    {
+        GL(glEnableVertexAttribArray( kInstanceColor ));
+    }
+    GL(glVertexAttribDivisor( kInstanceColor, divisor ));
+    mInstanceDivisor = divisor;
 }
 
 void SvrGeometry::Submit()
 {
     GL( glBindVertexArray( mVaoId ) );
-    GL( glDrawElements(GL_TRIANGLES, mIndexCount, GL_UNSIGNED_INT, NULL) );
+    GL( glDrawElements(GL_TRIANGLES, mIndexCount, mIndexType, (const void*)mIndexOffset) );
     GL( glBindVertexArray( 0 ) );
 }
 
-void SvrGeometry::CreateFromObjFile(const char* pObjFilePath, SvrGeometry** pOutGeometry, int& outNumGeometry)
+// Text is parsed and shapes are built on the job pool, only the uploads happen here
+static void CreateFromObjData(const char* pText, size_t size, SvrGeometry** pOutGeometry, int& outNumGeometry, int maxLods)
 {
-    std::vector<tinyobj::shape_t>       shapes;
-    std::vector<tinyobj::material_t>    materials;
-    std::string err = tinyobj::LoadObj(shapes, materials, pObjFilePath, NULL);
-    if (!err.empty())
+    *pOutGeometry = NULL;
+    outNumGeometry = 0;
+
+    SvrObjData obj;
+    if (!SvrParseObj(pText, size, obj))
+    {
+        return;
+    }
+
+    std::vector<SvrObjShape> shapes;
+    SvrBuildObjShapes(obj, shapes, true, maxLods);
+    if (shapes.empty())
     {
-        LOGE("CreateFromObjFile : %s", err.c_str());
-        *pOutGeometry = NULL;
-        outNumGeometry = 0;
         return;
     }
 
     SvrProgramAttribute attribs[3];
+    int nAttribs = 3;
+    int vertexSize = 8 * sizeof(float);
+
+    attribs[0].index = kPosition;
+    attribs[0].size = 3;
+    attribs[0].type = GL_FLOAT;
+    attribs[0].normalized = false;
+    attribs[0].stride = vertexSize;
+    attribs[0].offset = 0;
+
+    attribs[1].index = kNormal;
+    attribs[1].size = 3;
+    attribs[1].type = GL_FLOAT;
+    attribs[1].normalized = false;
+    attribs[1].stride = vertexSize;
+    attribs[1].offset = 3 * sizeof(float);
+
+    attribs[2].index = kTexcoord0;
+    attribs[2].size = 2;
+    attribs[2].type = GL_FLOAT;
+    attribs[2].normalized = false;
+    attribs[2].stride = vertexSize;
+    attribs[2].offset = 6 * sizeof(float);
 
     *pOutGeometry = new SvrGeometry[shapes.size()];
-    LOGV("Found %d shapes", shapes.size());
+    LOGV("Found %d shapes", (int)shapes.size());
 
     for (size_t i = 0; i < shapes.size(); i++)
     {
-        int vertexSize = 0;
-        int nAttribs = 0;
-       
-        if (shapes[i].mesh.positions.size() == 0 ||
-            shapes[i].mesh.normals.size() == 0)
+        const SvrObjShape& shape = shapes[i];
+        int nVertices = (int)(shape.vertices.size() / 8);
+        size_t nIndices = shape.indices.size();
+
+        SvrLinearArena& scratch = SvrGetThreadArena();
+        SvrArenaScope scope(scratch);
+
+        // Half the index fetch when the shape is small enough, 0xFFFF stays free for primitive restart
+        const void* pIndices = &shape.indices[0];
+        unsigned int indexType = GL_UNSIGNED_INT;
+        if (nVertices <= 0xFFFF)
         {
-            LOGE("OBJ must contain at least positions and normals");
-            *pOutGeometry = NULL;
-            outNumGeometry = 0;
-            return;
+            unsigned short* pShortIndices = scratch.AllocArray<unsigned short>(nIndices);
+            for (size_t j = 0; j < nIndices; j++)
+            {
+                pShortIndices[j] = (unsigned short)shape.indices[j];
+            }
+            pIndices = pShortIndices;
+            indexType = GL_UNSIGNED_SHORT;
         }
 
-        nAttribs = 3;
-        vertexSize = 8 * sizeof(float);
-
-        attribs[0].index = kPosition;
-        attribs[0].size = 3;
-        attribs[0].type = GL_FLOAT;
-        attribs[0].normalized = false;
-        attribs[0].stride = vertexSize;
-        attribs[0].offset = 0;
-
-        attribs[1].index = kNormal;
-        attribs[1].size = 3;
-        attribs[1].type = GL_FLOAT;
-        attribs[1].normalized = false;
-        attribs[1].stride = vertexSize;
-        attribs[1].offset = 3 * sizeof(float);
-
-		attribs[2].index = kTexcoord0;
-		attribs[2].size = 2;
-		attribs[2].type = GL_FLOAT;
-		attribs[2].normalized = false;
-		attribs[2].stride = vertexSize;
-		attribs[2].offset = 6 * sizeof(float);
-
-        float* pVbData = new float[vertexSize * shapes[i].mesh.positions.size()];
-        int vbIndex = 0;
-        for (size_t j = 0; j < shapes[i].mesh.positions.size() / 3; j++)
+        (*pOutGeometry)[i].Initialize(&attribs[0], nAttribs,
+            pIndices, indexType, nIndices,
+            (const void*)&shape.vertices[0], vertexSize * nVertices, nVertices);
+        (*pOutGeometry)[i].SetBounds(glm::vec3(shape.boundsMin[0], shape.boundsMin[1], shape.boundsMin[2]),
+                                     glm::vec3(shape.boundsMax[0], shape.boundsMax[1], shape.boundsMax[2]));
+        (*pOutGeometry)[i].SetLods(shape.lods, shape.numLods);
+
+        LOGV("OBJ shape %d initialized, idx count:%d, vertex count:%d, ACMR %.3f, %d levels down to %d triangles", (int)i,
+             shape.lods[0].numIndices, nVertices, SvrAnalyzeVertexCache(&shape.indices[0], shape.lods[0].numIndices, nVertices).acmr,
+             shape.numLods, shape.lods[shape.numLods - 1].numIndices / 3);
+    }
+
+    outNumGeometry = shapes.size();
+}
+
+void SvrGeometry::CreateFromObjFile(const char* pObjFilePath, SvrGeometry** pOutGeometry, int& outNumGeometry, int maxLods)
+{
+    *pOutGeometry = NULL;
+    outNumGeometry = 0;
+
+    int fd = open(pObjFilePath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        LOGE("CreateFromObjFile : Unable to open %s", pObjFilePath);
+        return;
+    }
+
+    struct stat fileStat;
+    void* pMapping = MAP_FAILED;
+    if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+    {
+        pMapping = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (pMapping == MAP_FAILED)
+    {
+        LOGE("CreateFromObjFile : Unable to map %s", pObjFilePath);
+        return;
+    }
+
+    // Chunks are parsed concurrently, so the whole file is wanted at once
+    madvise(pMapping, fileStat.st_size, MADV_WILLNEED);
+
+    CreateFromObjData((const char*)pMapping, fileStat.st_size, pOutGeometry, outNumGeometry, maxLods);
+    if (outNumGeometry == 0)
+    {
+        LOGE("CreateFromObjFile : %s could not be parsed", pObjFilePath);
+    }
+
+    munmap(pMapping, fileStat.st_size);
+}
+
+void SvrGeometry::CreateFromObjAsset(const char* pObjName, SvrGeometry** pOutGeometry, int& outNumGeometry, int maxLods)
+{
+    *pOutGeometry = NULL;
+    outNumGeometry = 0;
+
+    SvrArchiveSpan span;
+    if (!SvrFindAsset(pObjName, &span, true))
+    {
+        LOGE("CreateFromObjAsset : %s not found in mounted archives", pObjName);
+        return;
+    }
+
+    CreateFromObjData((const char*)span.pData, span.size, pOutGeometry, outNumGeometry, maxLods);
+    if (outNumGeometry == 0)
+    {
+        LOGE("CreateFromObjAsset : %s could not be parsed", pObjName);
+    }
+}
+
+// Version 1 headers stop short of the dequantization fields, version 2 of the level count
+static uint32_t GetMeshHeaderSize(const SvrMeshHeader* pHeader)
+{
+    switch (pHeader->version)
+    {
+    case 1:     return SVR_MESH_HEADER_SIZE_V1;
+    case 2:     return SVR_MESH_HEADER_SIZE_V2;
+    default:    return sizeof(SvrMeshHeader);
+    }
+}
+
+static uint32_t GetMeshLodCount(const SvrMeshHeader* pHeader)
+{
+    return (pHeader->version >= 3) ? pHeader->numLods : 1;
+}
+
+// Everything the loader relies on, checked once against the size of the data
+static bool ValidateMesh(const void* pData, size_t size)
+{
+    const SvrMeshHeader* pHeader = (const SvrMeshHeader*)pData;
+    if (size < SVR_MESH_HEADER_SIZE_V1 || pHeader->magic != SVR_MESH_MAGIC ||
+        pHeader->version < 1 || pHeader->version > SVR_MESH_VERSION || size < GetMeshHeaderSize(pHeader))
+    {
+        return false;
+    }
+
+    if (pHeader->numAttributes == 0 || pHeader->numAttributes > SVR_MESH_MAX_ATTRIBUTES || pHeader->numSubMeshes == 0 ||
+        GetMeshLodCount(pHeader) == 0 || GetMeshLodCount(pHeader) > SVR_MESH_MAX_LODS ||
+        (pHeader->indexType != GL_UNSIGNED_SHORT && pHeader->indexType != GL_UNSIGNED_INT))
+    {
+        return false;
+    }
+
+    uint64_t numLodEntries = (pHeader->version >= 3) ? (uint64_t)pHeader->numSubMeshes * pHeader->numLods : 0;
+    uint64_t tablesEnd = GetMeshHeaderSize(pHeader) + pHeader->numAttributes * sizeof(SvrMeshAttribute) +
+                         (uint64_t)pHeader->numSubMeshes * sizeof(SvrMeshSubMesh) + numLodEntries * sizeof(SvrMeshLod);
+    uint64_t indexSize = (pHeader->indexType == GL_UNSIGNED_SHORT) ? sizeof(unsigned short) : sizeof(unsigned int);
+    if (tablesEnd > size ||
+        pHeader->vertexDataSize != (uint64_t)pHeader->numVertices * pHeader->vertexStride ||
+        pHeader->vertexDataOffset < tablesEnd || pHeader->vertexDataOffset + pHeader->vertexDataSize > size ||
+        pHeader->indexDataSize != pHeader->numIndices * indexSize ||
+        pHeader->indexDataOffset < tablesEnd || pHeader->indexDataOffset + pHeader->indexDataSize > size)
+    {
+        return false;
+    }
+
+    const SvrMeshAttribute* pAttributes = (const SvrMeshAttribute*)((const unsigned char*)pData + GetMeshHeaderSize(pHeader));
+    for (uint32_t i = 0; i < pHeader->numAttributes; i++)
+    {
+        if (pAttributes[i].size < 1 || pAttributes[i].size > 4 || pAttributes[i].offset >= pHeader->vertexStride)
         {
-            pVbData[vbIndex++] = shapes[i].mesh.positions[3 * j + 0];
-            pVbData[vbIndex++] = shapes[i].mesh.positions[3 * j + 1];
-            pVbData[vbIndex++] = shapes[i].mesh.positions[3 * j + 2];
+            return false;
+        }
+    }
 
-            pVbData[vbIndex++] = shapes[i].mesh.normals[3 * j + 0];
-            pVbData[vbIndex++] = shapes[i].mesh.normals[3 * j + 1];
-            pVbData[vbIndex++] = shapes[i].mesh.normals[3 * j + 2];
+    const SvrMeshSubMesh* pSubMeshes = (const SvrMeshSubMesh*)(pAttributes + pHeader->numAttributes);
+    for (uint32_t i = 0; i < pHeader->numSubMeshes; i++)
+    {
+        if ((uint64_t)pSubMeshes[i].firstIndex + pSubMeshes[i].numIndices > pHeader->numIndices)
+        {
+            return false;
+        }
+    }
 
-			pVbData[vbIndex++] = shapes[i].mesh.texcoords[2 * j + 0];
-			pVbData[vbIndex++] = shapes[i].mesh.texcoords[2 * j + 1];
+    const SvrMeshLod* pLods = (const SvrMeshLod*)(pSubMeshes + pHeader->numSubMeshes);
+    for (uint64_t i = 0; i < numLodEntries; i++)
+    {
+        if ((uint64_t)pLods[i].firstIndex + pLods[i].numIndices > pHeader->numIndices)
+        {
+            return false;
         }
-      
-        pOutGeometry[i]->Initialize(&attribs[0], nAttribs,
-            &shapes[i].mesh.indices[0], shapes[i].mesh.indices.size(),
-            (const void*)pVbData, vertexSize * shapes[i].mesh.positions.size(), shapes[i].mesh.positions.size());
+    }
+
+    return true;
+}
+
+void SvrGeometry::CreateFromMeshData(const void* pData, size_t size, SvrGeometry** pOutGeometry, int& outNumGeometry)
+{
+    *pOutGeometry = NULL;
+    outNumGeometry = 0;
 
-        LOGV("OBJ Geom Initialized, idx count:%d, pos count:%d", shapes[i].mesh.indices.size(), shapes[i].mesh.positions.size());
-        delete[] pVbData;
+    if (!ValidateMesh(pData, size))
+    {
+        LOGE("CreateFromMeshData : Not a valid version 1 to %d mesh", SVR_MESH_VERSION);
+        return;
     }
 
-    outNumGeometry = shapes.size();
+    const SvrMeshHeader* pHeader = (const SvrMeshHeader*)pData;
+    const SvrMeshAttribute* pMeshAttributes = (const SvrMeshAttribute*)((const unsigned char*)pData + GetMeshHeaderSize(pHeader));
+    const SvrMeshSubMesh* pSubMeshes = (const SvrMeshSubMesh*)(pMeshAttributes + pHeader->numAttributes);
+    const SvrMeshLod* pLods = (const SvrMeshLod*)(pSubMeshes + pHeader->numSubMeshes);
+    uint32_t numLods = GetMeshLodCount(pHeader);
+
+    SvrProgramAttribute attribs[SVR_MESH_MAX_ATTRIBUTES];
+    for (uint32_t i = 0; i < pHeader->numAttributes; i++)
+    {
+        attribs[i].index = pMeshAttributes[i].location;
+        attribs[i].size = pMeshAttributes[i].size;
+        attribs[i].type = pMeshAttributes[i].type;
+        attribs[i].normalized = pMeshAttributes[i].normalized != 0;
+        attribs[i].stride = pHeader->vertexStride;
+        attribs[i].offset = pMeshAttributes[i].offset;
+    }
+
+    // Both payloads are used as they are, GL copies them straight out of the mapping
+    const unsigned char* pBytes = (const unsigned char*)pData;
+    SvrGeometry* pGeometry = new SvrGeometry[pHeader->numSubMeshes];
+    pGeometry[0].Initialize(attribs, pHeader->numAttributes,
+        pBytes + pHeader->indexDataOffset, pHeader->indexType, pHeader->numIndices,
+        pBytes + pHeader->vertexDataOffset, (int)pHeader->vertexDataSize, pHeader->numVertices);
+    if (pHeader->version >= 2)
+    {
+        pGeometry[0].mPositionScale = glm::vec3(pHeader->positionScale[0], pHeader->positionScale[1], pHeader->positionScale[2]);
+        pGeometry[0].mPositionBias = glm::vec3(pHeader->positionBias[0], pHeader->positionBias[1], pHeader->positionBias[2]);
+    }
+
+    for (uint32_t i = 0; i < pHeader->numSubMeshes; i++)
+    {
+        const SvrMeshSubMesh& subMesh = pSubMeshes[i];
+        pGeometry[i].InitializeShared(pGeometry[0], subMesh.firstIndex, subMesh.numIndices);
+        pGeometry[i].SetBounds(glm::vec3(subMesh.boundsMin[0], subMesh.boundsMin[1], subMesh.boundsMin[2]),
+                               glm::vec3(subMesh.boundsMax[0], subMesh.boundsMax[1], subMesh.boundsMax[2]));
+        if (numLods > 1)
+        {
+            pGeometry[i].SetLods(pLods + i * numLods, numLods);
+        }
+    }
+
+    LOGV("Mesh Initialized, %d sub-meshes, %d levels, idx count:%d, vtx count:%d", pHeader->numSubMeshes, numLods,
+         pHeader->numIndices, pHeader->numVertices);
+
+    *pOutGeometry = pGeometry;
+    outNumGeometry = pHeader->numSubMeshes;
+}
+
+void SvrGeometry::CreateFromMeshFile(const char* pMeshFilePath, SvrGeometry** pOutGeometry, int& outNumGeometry)
+{
+    *pOutGeometry = NULL;
+    outNumGeometry = 0;
+
+    int fd = open(pMeshFilePath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        LOGE("CreateFromMeshFile : Unable to open %s", pMeshFilePath);
+        return;
+    }
+
+    struct stat fileStat;
+    void* pMapping = MAP_FAILED;
+    if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+    {
+        pMapping = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (pMapping == MAP_FAILED)
+    {
+        LOGE("CreateFromMeshFile : Unable to map %s", pMeshFilePath);
+        return;
+    }
+
+    // Read front to back exactly once by glBufferData
+    madvise(pMapping, fileStat.st_size, MADV_SEQUENTIAL);
+
+    CreateFromMeshData(pMapping, fileStat.st_size, pOutGeometry, outNumGeometry);
+    if (outNumGeometry == 0)
+    {
+        LOGE("CreateFromMeshFile : %s could not be loaded", pMeshFilePath);
+    }
+
+    munmap(pMapping, fileStat.st_size);
+}
+
+void SvrGeometry::CreateFromMeshAsset(const char* pMeshName, SvrGeometry** pOutGeometry, int& outNumGeometry)
+{
+    *pOutGeometry = NULL;
+    outNumGeometry = 0;
+
+    SvrArchiveSpan span;
+    if (!SvrFindAsset(pMeshName, &span, true))
+    {
+        LOGE("CreateFromMeshAsset : %s not found in mounted archives", pMeshName);
+        return;
+    }
+
+    CreateFromMeshData(span.pData, span.size, pOutGeometry, outNumGeometry);
 }
 
 }
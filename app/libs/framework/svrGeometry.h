@@ -7,10 +7,38 @@
 //=============================================================================
 #pragma once
 
+#include <stddef.h>
+
+#include <glm/glm.hpp>
+
+#include "svrMeshFormat.h"
+
 #define MAX_ATTRIBUTES 8
 
+// UpdateLod keeps simplification error below this many eye buffer pixels, and only
+// moves to a coarser level once that level's error is this fraction below the limit
+#define SVR_LOD_ERROR_PIXELS    1.0f
+#define SVR_LOD_HYSTERESIS      0.25f
+
+// Vertex shader side of quantized meshes (svrMeshFormat.h).  Positions go through
+// SvrDequantizePosition, octahedral normals through SvrDecodeNormal; the uniforms
+// come from SvrGeometry::GetPositionScale/GetPositionBias.  Harmless for float meshes.
+#define SVR_MESH_GLSL_DECODE                                                        \
+    "uniform vec3 uPositionScale;\n"                                                \
+    "uniform vec3 uPositionBias;\n"                                                 \
+    "vec3 SvrDequantizePosition(vec3 p) { return p * uPositionScale + uPositionBias; }\n" \
+    "vec3 SvrDecodeNormal(vec2 e)\n"                                                \
+    "{\n"                                                                           \
+    "    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));\n"                            \
+    "    float t = max(-n.z, 0.0);\n"                                               \
+    "    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);\n"                 \
+    "    return normalize(n);\n"                                                    \
+    "}\n"
+
 namespace Svr
 {
+    // Arguments of glVertexAttribPointer.  Packed layouts use the GL type directly, e.g.
+    // GL_HALF_FLOAT, or GL_SHORT / GL_UNSIGNED_SHORT with normalized set.
     struct SvrProgramAttribute
     {
         unsigned int    index;
@@ -30,17 +58,84 @@ namespace Svr
                         unsigned int* pIndices, int nIndices,
                         const void* pVertexData, int bufferSize, int nVertices);
 
+        // indexType is GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+        void Initialize(SvrProgramAttribute* pAttribs, int nAttribs,
+                        const void* pIndices, unsigned int indexType, int nIndices,
+                        const void* pVertexData, int bufferSize, int nVertices);
+
         void Destroy();
         void Submit();
 
-        static void CreateFromObjFile(const char* pObjFilePath, SvrGeometry** pOutGeometry, int& outNumGeometry);
+        const glm::vec3& GetBoundsMin() const { return mBoundsMin; }
+        const glm::vec3& GetBoundsMax() const { return mBoundsMax; }
+        void SetBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax) { mBoundsMin = boundsMin; mBoundsMax = boundsMax; }
+
+        // Dequantization of stored positions, for the uniforms of SVR_MESH_GLSL_DECODE
+        const glm::vec3& GetPositionScale() const { return mPositionScale; }
+        const glm::vec3& GetPositionBias() const { return mPositionBias; }
+        unsigned int GetIndexType() const { return mIndexType; }
+        unsigned int GetVaoId() const { return mVaoId; }
+
+        // Levels of detail (svrMeshSimplify.h), Submit draws the current one.  Ranges
+        // index this geometry's index buffer, level 0 is full detail.
+        int GetLodCount() const { return mNumLods; }
+        int GetLod() const { return mLod; }
+        const SvrMeshLod& GetLodInfo(int lod) const { return mLods[lod]; }
+        void SetLod(int lod);
+        void SetLods(const SvrMeshLod* pLods, int numLods);
+
+        // Enables the per instance attributes of queued draws (svrRenderQueue.h) on the
+        // vertex array, which must be bound, advancing once every divisor instances.
+        // Only calls changing the divisor do any work.
+        void EnableInstanceArrays(int divisor = 1);
+
+        // Makes current the coarsest level whose error, projected from the bounds
+        // nearest eyePosition (between the eyes), stays within maxErrorPixels.  A finer
+        // level is only left once the coarser one is SVR_LOD_HYSTERESIS below the limit,
+        // so objects near a switching distance do not pop back and forth.  Returns the level.
+        int UpdateLod(const glm::mat4& modelMatrix, const glm::vec3& eyePosition, float projectionScale,
+                      float maxErrorPixels = SVR_LOD_ERROR_PIXELS);
+
+        // Pixels per unit at distance 1 for UpdateLod, from the eye buffer height and field of view
+        static float GetLodProjectionScale(int eyeBufferHeight, float fovYDeg);
+
+        // One geometry per object, group or material change.  Parsing and optimization run
+        // on the job pool (svrObjImport.h), the calling thread only does the uploads and so
+        // must own the GL context.  Materials are not read, faces without normals get
+        // generated ones.  maxLods above 1 also simplifies every shape into levels of
+        // detail, which costs far more than the parse; shipped meshes should get their
+        // levels from svrmesh instead.
+        static void CreateFromObjFile(const char* pObjFilePath, SvrGeometry** pOutGeometry, int& outNumGeometry, int maxLods = 1);
+
+        // Same as CreateFromObjFile for an OBJ in a mounted archive
+        static void CreateFromObjAsset(const char* pObjName, SvrGeometry** pOutGeometry, int& outNumGeometry, int maxLods = 1);
+
+        // Compiled meshes (svrMeshFormat.h, built offline by tools/svrmesh) skip parsing
+        // altogether, the file is mapped and its payloads go straight to glBufferData.
+        // There is one geometry per sub-mesh, all sharing the buffers of the first one.
+        static void CreateFromMeshFile(const char* pMeshFilePath, SvrGeometry** pOutGeometry, int& outNumGeometry);
+        static void CreateFromMeshAsset(const char* pMeshName, SvrGeometry** pOutGeometry, int& outNumGeometry);
+        static void CreateFromMeshData(const void* pData, size_t size, SvrGeometry** pOutGeometry, int& outNumGeometry);
 
     private:
+        void InitializeShared(const SvrGeometry& owner, int firstIndex, int nIndices);
+
         unsigned int    mVbId;
         unsigned int    mIbId;
         unsigned int    mVaoId;
         int             mVertexCount;
         int             mIndexCount;
+        unsigned int    mIndexType;
+        size_t          mIndexOffset;       // Bytes into the index buffer
+        bool            mOwnsBuffers;
+        glm::vec3       mBoundsMin;
+        glm::vec3       mBoundsMax;
+        glm::vec3       mPositionScale;
+        glm::vec3       mPositionBias;
+        SvrMeshLod      mLods[SVR_MESH_MAX_LODS];
+        int             mNumLods;
+        int             mLod;
+        int             mInstanceDivisor;   // 0 until the instance arrays are enabled
     };
 
 }
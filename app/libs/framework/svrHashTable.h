@@ -1,5 +1,5 @@
 //=============================================================================
-// FILE: svrContainers.h
+// FILE: svrHashTable.h
 //
 //                  Copyright (c) 2015 QUALCOMM Technologies Inc.
 //                              All Rights Reserved.
@@ -8,10 +8,18 @@
 
 #pragma once
 
+#include <new>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 namespace Svr
 {
 
@@ -27,6 +35,11 @@ inline unsigned int DjB2Hash(const char *str)
     return hash;
 }
 
+// Flat open addressing table.  Slots live in one contiguous allocation next to a
+// byte of control data per slot: kEmpty or the low 7 bits of the slot's hash.
+// Lookups compare a whole group of control bytes at once and only touch slots
+// whose control byte matches.  Keys are used as-is, string keys are reduced to a
+// _Key with hashFn once per call.
 template <class _Key, class _Data, _Key (*hashFn)(const char*)>
 class HashTable
 {
@@ -35,67 +48,117 @@ private:
 	{
 		_Key	key;
 		_Data	data;
-		Entry*	pNext;
 	};
 
+	enum
+	{
+		kEmpty = 0x80,
+#if defined(__SSE2__)
+		kGroupWidth = 16,
+#else
+		kGroupWidth = 8,
+#endif
+		kMinCapacity = kGroupWidth
+	};
+
+	// Set of slots within a group, in slot order
+	struct GroupMask
+	{
+		uint64_t	bits;
+
+		bool Any() const
+		{
+			return bits != 0;
+		}
+
+		unsigned int Next()
+		{
+#if defined(__SSE2__)
+			unsigned int index = __builtin_ctzll(bits);
+#else
+			unsigned int index = __builtin_ctzll(bits) >> 3;
+#endif
+			bits &= bits - 1;
+			return index;
+		}
+	};
+
+	static GroupMask Match(const unsigned char* group, unsigned char value)
+	{
+		GroupMask result;
+#if defined(__SSE2__)
+		__m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+		result.bits = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)value)));
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+		uint8x8_t eq = vceq_u8(vld1_u8(group), vdup_n_u8(value));
+		result.bits = vget_lane_u64(vreinterpret_u64_u8(eq), 0) & 0x8080808080808080ull;
+#else
+		// Classic has-zero-byte trick.  It can flag a byte just above a real match,
+		// which only costs an extra key compare.
+		uint64_t ctrl;
+		memcpy(&ctrl, group, sizeof(ctrl));
+		uint64_t x = ctrl ^ (0x0101010101010101ull * value);
+		result.bits = (x - 0x0101010101010101ull) & ~x & 0x8080808080808080ull;
+#endif
+		return result;
+	}
+
+	static GroupMask MatchEmpty(const unsigned char* group)
+	{
+#if defined(__SSE2__) || defined(__ARM_NEON__) || defined(__ARM_NEON)
+		return Match(group, kEmpty);
+#else
+		// Full slots never have the high bit set
+		GroupMask result;
+		memcpy(&result.bits, group, sizeof(result.bits));
+		result.bits &= 0x8080808080808080ull;
+		return result;
+#endif
+	}
+
+	static uint32_t HashKey(_Key key)
+	{
+		// Keys are often already hashes, but the low bits pick the slot so mix anyway
+		return (uint32_t)(((uint64_t)key * 0x9E3779B97F4A7C15ull) >> 32);
+	}
+
 public:
 	class Iterator
 	{
 	friend class HashTable;
-		Iterator()
-			: mRow(0)
-			, mpCurrent(NULL)
-		{}
-
 		Iterator(HashTable& source)
 			: msource(source)
 			, mRow(0)
-			, mpCurrent(NULL)
 		{}
 
+	public:
 		_Data& Current()
 		{
-			return mpCurrent->data;
+			return msource.mslots[mRow].data;
 		}
 
 		void Next()
 		{
-			if(mpCurrent->pNext != NULL)
-			{
-				mpCurrent = mpCurrent->pNext;
-			}
-			else
-			{
-				while(mRow < msource.mcapacity && msource.mtable[++mRow] == NULL);
-
-
-				if( mRow == msource.mcapacity )
-				{
-					mpCurrent = NULL;
-				}
-				else
-				{
-					mpCurrent = msource.mtable[mRow];
-				}
-			}
+			while (++mRow < msource.mcapacity && msource.mcontrol[mRow] == kEmpty);
 		}
 
 		bool End()
 		{
-			return (mRow == msource.mcapacity) && (mpCurrent == NULL);
+			return mRow >= msource.mcapacity;
 		}
 
 	private:
 		HashTable&	msource;
 
 		unsigned int	mRow;
-		Entry*	mpCurrent;
 	};
 
 public:
 	HashTable()
-		: mtable(NULL)
+		: mslots(NULL)
+		, mcontrol(NULL)
 		, mcapacity(0)
+		, mcount(0)
 	{};
 
 	~HashTable()
@@ -105,110 +168,166 @@ public:
 
 	void Destroy()
 	{
-		for(unsigned int i=0; i < mcapacity; i++)
-		{
-			Entry* pEntry = mtable[i];
-			while(pEntry)
-			{
-				Entry* pCurrent = pEntry;
-				pEntry = pEntry->pNext;
-				delete pCurrent;
-			}
-			mtable[i] = 0;
-		}
-		if(mcapacity > 0)
+		for (unsigned int i = 0; i < mcapacity; i++)
 		{
-			delete [] mtable;
-			mtable = NULL;
-			mcapacity = 0;
+			if (mcontrol[i] != kEmpty)
+				mslots[i].~Entry();
 		}
+
+		free(mslots);
+		mslots = NULL;
+		mcontrol = NULL;
+		mcapacity = 0;
+		mcount = 0;
 	}
 
+	// Sizes the table so that at least capacity entries fit without a resize.
+	// Optional, the table grows on demand.
 	void Init(unsigned int capacity)
 	{
-		mcapacity = capacity;
-		mtable = new Entry*[capacity];
+		unsigned int slots = kMinCapacity;
+		while (slots - slots / 8 < capacity)
+			slots <<= 1;
 
-		for(unsigned int i=0; i < mcapacity; i++)
-			mtable[i] = NULL;
+		if (slots > mcapacity)
+			Rehash(slots);
 	}
 
-	void Insert(_Key key, _Data& data)
+	unsigned int GetCount() const
 	{
-		unsigned int index = key % mcapacity;
+		return mcount;
+	}
 
-		if(mtable[index] == NULL)
+	// Inserting an existing key replaces its data
+	void Insert(_Key key, const _Data& data)
+	{
+		Entry* pEntry = FindEntry(key);
+		if (pEntry != NULL)
 		{
-			Entry* pEntry = new Entry;
-			mtable[index] = pEntry;
-			pEntry->key = key;
 			pEntry->data = data;
-			pEntry->pNext = NULL;
-		}
-		else
-		{
-			Entry* pEntry = mtable[index];
-			while(pEntry->pNext != NULL)
-				pEntry = pEntry->pNext;
-			Entry* pNextEntry = new Entry;
-			pNextEntry->key = key;
-			pNextEntry->data = data;
-			pNextEntry->pNext = NULL;
-			pEntry->pNext = pNextEntry;
+			return;
 		}
+
+		if (mcount + 1 > mcapacity - mcapacity / 8)
+			Rehash(mcapacity ? mcapacity * 2 : (unsigned int)kMinCapacity);
+
+		uint32_t hash = HashKey(key);
+		unsigned int index = FindEmptySlot(hash);
+		new (&mslots[index]) Entry();
+		mslots[index].key = key;
+		mslots[index].data = data;
+		SetControl(index, hash & 0x7F);
+		mcount++;
 	}
 
-	void Insert(const char* key, _Data& data)
+	void Insert(const char* key, const _Data& data)
 	{
-		_Key hashVal = hashFn(key);
-		return Insert( hashVal, data );
+		Insert(hashFn(key), data);
 	}
 
 	bool Find(_Key key, _Data* result)
 	{
-		unsigned int index = key % mcapacity;
+		Entry* pEntry = FindEntry(key);
+		if (pEntry == NULL)
+			return false;
 
-		Entry* pEntry = mtable[index];
-		while(pEntry != NULL)
-		{
-			if(pEntry->key == key)
-			{
-				*result = pEntry->data;
-				return true;
-			}
-			pEntry = pEntry->pNext;
-		}
-		return false;
+		*result = pEntry->data;
+		return true;
 	}
 
 	bool Find(const char* key, _Data* result)
 	{
-		_Key hashVal = hashFn(key);
-		return Find(hashVal, result);
+		return Find(hashFn(key), result);
 	}
 
 	Iterator GetIterator()
 	{
 		Iterator res(*this);
+		if (mcapacity > 0 && mcontrol[0] == kEmpty)
+			res.Next();
+		return res;
+	}
 
-		unsigned int i =0;
+private:
+	Entry* FindEntry(_Key key)
+	{
+		if (mcount == 0)
+			return NULL;
 
-		while(i < mcapacity)
+		uint32_t hash = HashKey(key);
+		unsigned int mask = mcapacity - 1;
+		unsigned int pos = (hash >> 7) & mask;
+		for (unsigned int probe = 1; ; probe++)
 		{
-			if(mtable[i] != NULL)
+			const unsigned char* group = &mcontrol[pos];
+			GroupMask match = Match(group, hash & 0x7F);
+			while (match.Any())
 			{
-				res.mpCurrent = mtable[i];
-				break;
+				unsigned int index = (pos + match.Next()) & mask;
+				if (mslots[index].key == key)
+					return &mslots[index];
 			}
-			i++;
+
+			if (MatchEmpty(group).Any())
+				return NULL;
+
+			pos = (pos + kGroupWidth * probe) & mask;
 		}
-		res.mRow = i;
-		return res;
 	}
 
-public:
-	Entry**	mtable;
-	unsigned int 	mcapacity;
+	unsigned int FindEmptySlot(uint32_t hash)
+	{
+		unsigned int mask = mcapacity - 1;
+		unsigned int pos = (hash >> 7) & mask;
+		for (unsigned int probe = 1; ; probe++)
+		{
+			GroupMask empty = MatchEmpty(&mcontrol[pos]);
+			if (empty.Any())
+				return (pos + empty.Next()) & mask;
+
+			pos = (pos + kGroupWidth * probe) & mask;
+		}
+	}
+
+	void SetControl(unsigned int index, unsigned char value)
+	{
+		// The first group is mirrored past the end so group loads never wrap
+		mcontrol[index] = value;
+		if (index < kGroupWidth)
+			mcontrol[mcapacity + index] = value;
+	}
+
+	void Rehash(unsigned int newCapacity)
+	{
+		Entry* oldSlots = mslots;
+		unsigned char* oldControl = mcontrol;
+		unsigned int oldCapacity = mcapacity;
+
+		// One allocation: slots first for alignment, then the control bytes
+		mslots = (Entry*)malloc(newCapacity * sizeof(Entry) + newCapacity + kGroupWidth);
+		mcontrol = reinterpret_cast<unsigned char*>(mslots + newCapacity);
+		memset(mcontrol, kEmpty, newCapacity + kGroupWidth);
+		mcapacity = newCapacity;
+
+		for (unsigned int i = 0; i < oldCapacity; i++)
+		{
+			if (oldControl[i] == kEmpty)
+				continue;
+
+			uint32_t hash = HashKey(oldSlots[i].key);
+			unsigned int index = FindEmptySlot(hash);
+			new (&mslots[index]) Entry(oldSlots[i]);
+			SetControl(index, hash & 0x7F);
+			oldSlots[i].~Entry();
+		}
+
+		free(oldSlots);
+	}
+
+	Entry*			mslots;
+	unsigned char*	mcontrol;
+	unsigned int	mcapacity;
+	unsigned int	mcount;
 };
 
 }
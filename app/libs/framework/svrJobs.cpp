@@ -0,0 +1,244 @@
+//=============================================================================
+// FILE: svrJobs.cpp
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#include <pthread.h>
+#include <unistd.h>
+
+#include <atomic>
+
+#include "svrJobs.h"
+
+namespace Svr
+{
+
+struct SvrJobPool
+{
+    pthread_mutex_t     lock;
+    pthread_cond_t      wake;           // Workers wait here for a new loop
+    pthread_cond_t      done;           // Submitters wait here for chunks and workers to finish
+
+    pthread_t           threads[SVR_JOBS_MAX_THREADS];
+    int                 numThreads;
+    bool                started;
+    bool                shutdown;
+
+    // Current loop, written under lock while no worker is active
+    pthread_mutex_t     submitLock;     // Held for the whole loop, try-locked by submitters
+    unsigned int        generation;
+    int                 numActive;      // Workers inside RunChunks
+    SvrJobFunc          pFunc;
+    void*               pContext;
+    int                 count;
+    int                 grain;
+    int                 numChunks;
+    std::atomic<int>    nextChunk;
+    std::atomic<int>    chunksDone;
+};
+
+static SvrJobPool gJobPool =
+{
+    PTHREAD_MUTEX_INITIALIZER,
+    PTHREAD_COND_INITIALIZER,
+    PTHREAD_COND_INITIALIZER,
+    {},
+    0,
+    false,
+    false,
+    PTHREAD_MUTEX_INITIALIZER,
+    0,
+    0,
+    NULL,
+    NULL,
+    0,
+    0,
+    0,
+    {},
+    {},
+};
+
+//-----------------------------------------------------------------------------
+static void L_RunChunks(SvrJobPool& pool)
+//-----------------------------------------------------------------------------
+{
+    while (true)
+    {
+        int chunk = pool.nextChunk.fetch_add(1, std::memory_order_relaxed);
+        if (chunk >= pool.numChunks)
+        {
+            break;
+        }
+
+        int begin = chunk * pool.grain;
+        int end = (begin + pool.grain < pool.count) ? begin + pool.grain : pool.count;
+        pool.pFunc(pool.pContext, begin, end);
+
+        if (pool.chunksDone.fetch_add(1, std::memory_order_acq_rel) + 1 == pool.numChunks)
+        {
+            pthread_mutex_lock(&pool.lock);
+            pthread_cond_broadcast(&pool.done);
+            pthread_mutex_unlock(&pool.lock);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+static void* L_WorkerMain(void* pArg)
+//-----------------------------------------------------------------------------
+{
+    SvrJobPool& pool = *(SvrJobPool*)pArg;
+    unsigned int seenGeneration = 0;
+
+    pthread_mutex_lock(&pool.lock);
+    while (true)
+    {
+        while (!pool.shutdown && pool.generation == seenGeneration)
+        {
+            pthread_cond_wait(&pool.wake, &pool.lock);
+        }
+        if (pool.shutdown)
+        {
+            break;
+        }
+        seenGeneration = pool.generation;
+        pool.numActive++;
+        pthread_mutex_unlock(&pool.lock);
+
+        L_RunChunks(pool);
+
+        pthread_mutex_lock(&pool.lock);
+        if (--pool.numActive == 0)
+        {
+            pthread_cond_broadcast(&pool.done);
+        }
+    }
+    pthread_mutex_unlock(&pool.lock);
+    return NULL;
+}
+
+//-----------------------------------------------------------------------------
+static void L_StartPool(SvrJobPool& pool)
+//-----------------------------------------------------------------------------
+{
+    // Caller holds submitLock
+    if (pool.started)
+    {
+        return;
+    }
+    pool.started = true;
+    pool.shutdown = false;
+    pool.numActive = 0;
+
+    long numCores = sysconf(_SC_NPROCESSORS_ONLN);
+    int numThreads = (numCores > 1) ? (int)numCores - 1 : 0;
+    if (numThreads > SVR_JOBS_MAX_THREADS)
+    {
+        numThreads = SVR_JOBS_MAX_THREADS;
+    }
+
+    pool.numThreads = 0;
+    for (int i = 0; i < numThreads; i++)
+    {
+        if (pthread_create(&pool.threads[i], NULL, L_WorkerMain, &pool) != 0)
+        {
+            break;
+        }
+        pool.numThreads++;
+    }
+}
+
+//-----------------------------------------------------------------------------
+void SvrParallelFor(int count, int grain, SvrJobFunc pFunc, void* pContext)
+//-----------------------------------------------------------------------------
+{
+    if (count <= 0)
+    {
+        return;
+    }
+    if (grain < 1)
+    {
+        grain = 1;
+    }
+
+    SvrJobPool& pool = gJobPool;
+    if (count <= grain || pthread_mutex_trylock(&pool.submitLock) != 0)
+    {
+        // Single chunk, or the pool is busy with another loop
+        pFunc(pContext, 0, count);
+        return;
+    }
+
+    L_StartPool(pool);
+    if (pool.numThreads == 0)
+    {
+        pthread_mutex_unlock(&pool.submitLock);
+        pFunc(pContext, 0, count);
+        return;
+    }
+
+    pthread_mutex_lock(&pool.lock);
+
+    // Workers that woke late for the previous loop still hold its counters
+    while (pool.numActive > 0)
+    {
+        pthread_cond_wait(&pool.done, &pool.lock);
+    }
+
+    pool.pFunc = pFunc;
+    pool.pContext = pContext;
+    pool.count = count;
+    pool.grain = grain;
+    pool.numChunks = (count + grain - 1) / grain;
+    pool.nextChunk.store(0, std::memory_order_relaxed);
+    pool.chunksDone.store(0, std::memory_order_relaxed);
+    pool.generation++;
+    pthread_cond_broadcast(&pool.wake);
+    pthread_mutex_unlock(&pool.lock);
+
+    L_RunChunks(pool);
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.chunksDone.load(std::memory_order_acquire) < pool.numChunks)
+    {
+        pthread_cond_wait(&pool.done, &pool.lock);
+    }
+    pthread_mutex_unlock(&pool.lock);
+
+    pthread_mutex_unlock(&pool.submitLock);
+}
+
+//-----------------------------------------------------------------------------
+int SvrGetJobThreadCount()
+//-----------------------------------------------------------------------------
+{
+    return gJobPool.numThreads + 1;
+}
+
+//-----------------------------------------------------------------------------
+void SvrShutdownJobs()
+//-----------------------------------------------------------------------------
+{
+    SvrJobPool& pool = gJobPool;
+
+    pthread_mutex_lock(&pool.submitLock);
+    if (pool.started)
+    {
+        pthread_mutex_lock(&pool.lock);
+        pool.shutdown = true;
+        pthread_cond_broadcast(&pool.wake);
+        pthread_mutex_unlock(&pool.lock);
+
+        for (int i = 0; i < pool.numThreads; i++)
+        {
+            pthread_join(pool.threads[i], NULL);
+        }
+        pool.numThreads = 0;
+        pool.started = false;
+    }
+    pthread_mutex_unlock(&pool.submitLock);
+}
+
+}   // namespace Svr
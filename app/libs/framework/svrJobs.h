@@ -0,0 +1,27 @@
+//=============================================================================
+// FILE: svrJobs.h
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#pragma once
+
+// Worker threads beyond the calling one, the pool never uses more than this
+#define SVR_JOBS_MAX_THREADS    4
+
+namespace Svr
+{
+    // Processes items [begin, end) of a parallel loop
+    typedef void (*SvrJobFunc)(void* pContext, int begin, int end);
+
+    // Splits [0, count) into chunks of grain items and runs them on a shared pool of
+    // worker threads, the calling thread takes chunks as well.  Returns once every
+    // chunk has run.  The pool is started on first use.  Only one loop runs on the
+    // pool at a time, a call made while it is busy runs on the calling thread alone,
+    // so loops can be issued from any thread (including from inside a job).
+    void    SvrParallelFor(int count, int grain, SvrJobFunc pFunc, void* pContext);
+
+    int     SvrGetJobThreadCount();
+    void    SvrShutdownJobs();
+}
@@ -6,7 +6,16 @@
 //
 //=============================================================================
 
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "svrArchive.h"
 #include "svrKtxLoader.h"
+#include "svrMemory.h"
 #include "svrUtil.h"
 
 #ifndef MAX
@@ -44,8 +53,18 @@ static void L_SwapEndian32(uint32* pData32, uint32 nCount)
 KtxTexture::KtxTexture()
 //-----------------------------------------------------------------------------
 {
-    m_pData                 = NULL;
+    memset(&m_header, 0, sizeof(m_header));
+    memset(&m_textureInfo, 0, sizeof(m_textureInfo));
+    m_glStorageFormat       = 0;
+    m_glUploadFormat        = 0;
+    m_bSwizzle              = false;
+    m_bGenerateMips         = false;
+    m_bSwap                 = false;
+    m_nNumLevels            = 0;
     m_nDataSize             = 0;
+    m_pGeneratedData        = NULL;
+    m_pStreamBuffer         = NULL;
+    m_nStreamBufferSize     = 0;
     m_nStreamBufferIndex    = 0;
 }
 
@@ -53,9 +72,7 @@ KtxTexture::KtxTexture()
 KtxTexture::~KtxTexture()
 //-----------------------------------------------------------------------------
 {
-    if(m_pData != NULL)
-        delete [] m_pData;
-    m_pData = NULL;
+    FreeGeneratedLevels();
 }
 
 //-----------------------------------------------------------------------------
@@ -148,8 +165,8 @@ TKTXErrorCode KtxTexture::ParseHeader(TKTXHeader* pHeader, TKTXTextureInfo* pTex
     }
 
     // Check texture dimensions. KTX files can store 8 types of textures:
-    // 1D, 2D, 3D, cube, and array variants of these. There is currently
-    // no GL extension that would accept 3D array or cube array textures. 
+    // 1D, 2D, 3D, cube, and array variants of these. There is no GL API
+    // that accepts 3D array textures. 
     if ((pHeader->pixelWidth == 0) ||
         (pHeader->pixelDepth > 0 && pHeader->pixelHeight == 0))
     {
@@ -206,32 +223,33 @@ TKTXErrorCode KtxTexture::ParseHeader(TKTXHeader* pHeader, TKTXTextureInfo* pTex
         }
         else if (pTextureInfo->glTarget == GL_TEXTURE_2D)
         {
-            pTextureInfo->glTarget = GL_TEXTURE_2D_ARRAY_EXT;
+            pTextureInfo->glTarget = GL_TEXTURE_2D_ARRAY;
+        }
+        else if (pTextureInfo->glTarget == GL_TEXTURE_CUBE_MAP)
+        {
+            pTextureInfo->glTarget = GL_TEXTURE_CUBE_MAP_ARRAY_EXT;
         }
         else
         {
-            // No API for 3D and cube arrays yet 
-            LOGE("    KTX is either 3D or cube array.  No support yet.");
+            // No API for 3D arrays
+            LOGE("    KTX is a 3D array.  Not supported.");
             return KTX_UNSUPPORTED_TEXTURE_TYPE;
         }
 
         pTextureInfo->nTextureDimensions++;
     }
 
-    // reject 3D texture if unsupported 
-    if (pTextureInfo->nTextureDimensions == 3)
-    {
-        LOGE("    KTX is 3D texture.  No support yet.");
-        return KTX_UNSUPPORTED_TEXTURE_TYPE;
-    }
-
-    // Check number of mipmap levels 
+    // Check number of mipmap levels.  Zero asks for the chain to be generated
+    // from the base level after upload.
+    nMaxMipDimension = MAX(MAX(pHeader->pixelWidth, pHeader->pixelHeight), pHeader->pixelDepth);
+    m_bGenerateMips = false;
     if (pHeader->numberOfMipmapLevels == 0)
     {
         pHeader->numberOfMipmapLevels = 1;
+        m_bGenerateMips = !pTextureInfo->bCompressed;
     }
-    nMaxMipDimension = MAX(MAX(pHeader->pixelWidth, pHeader->pixelHeight), pHeader->pixelDepth);
-    if (nMaxMipDimension < ((uint32)1 << (pHeader->numberOfMipmapLevels - 1)))
+    if (pHeader->numberOfMipmapLevels > KTX_MAX_MIP_LEVELS ||
+        nMaxMipDimension < ((uint32)1 << (pHeader->numberOfMipmapLevels - 1)))
     {
         // Can't have more mip levels than 1 + log2(max(width, height, depth)) 
         LOGE("    KTX has more mip levels that expected (%d): %d", nMaxMipDimension, ((uint32)1 << (pHeader->numberOfMipmapLevels - 1)));
@@ -250,41 +268,413 @@ TKTXErrorCode KtxTexture::ParseHeader(TKTXHeader* pHeader, TKTXTextureInfo* pTex
     return KTX_SUCCESS;
 }
 
+
+// GLES3 has no sized luminance or alpha formats.  They are stored in the red
+// (and green) channel and swizzled back, returns false for any other format.
 //-----------------------------------------------------------------------------
-TKTXErrorCode KtxTexture::ParseBuffer(void* pBuffer, unsigned int nBufferSize, GLuint* pTexture, GLenum* pTarget, TKTXHeader* pOutHeader)
+static bool L_GetLegacyLayout(GLenum baseFormat, GLenum* pUploadFormat, GLint* pSwizzle)
 //-----------------------------------------------------------------------------
 {
-    TKTXHeader      tHeader;
-    TKTXTextureInfo textureInfo;
-    GLuint          nTextureId;
+    switch (baseFormat)
+    {
+    case GL_LUMINANCE:
+        *pUploadFormat = GL_RED;
+        pSwizzle[0] = GL_RED;   pSwizzle[1] = GL_RED;   pSwizzle[2] = GL_RED;   pSwizzle[3] = GL_ONE;
+        return true;
+    case GL_ALPHA:
+        *pUploadFormat = GL_RED;
+        pSwizzle[0] = GL_ZERO;  pSwizzle[1] = GL_ZERO;  pSwizzle[2] = GL_ZERO;  pSwizzle[3] = GL_RED;
+        return true;
+    case GL_LUMINANCE_ALPHA:
+        *pUploadFormat = GL_RG;
+        pSwizzle[0] = GL_RED;   pSwizzle[1] = GL_RED;   pSwizzle[2] = GL_RED;   pSwizzle[3] = GL_GREEN;
+        return true;
+    }
+    return false;
+}
 
-    // Clear out any GL Errors
-    GLenum error = GL_INVALID_ENUM;
-    while(error != GL_NO_ERROR)
-        error = glGetError();
+// glTexStorage needs a sized internal format, older KTX files often carry the
+// unsized GLES2 style format instead
+//-----------------------------------------------------------------------------
+static GLenum L_GetSizedFormat(const TKTXHeader* pHeader, bool32 bCompressed)
+//-----------------------------------------------------------------------------
+{
+    // Sized luminance formats (GL_LUMINANCE8 and so on) are not valid for storage either
+    GLenum nUploadFormat = 0;
+    GLint swizzle[4];
+    bool bLegacy = !bCompressed && L_GetLegacyLayout(pHeader->glBaseInternalFormat, &nUploadFormat, swizzle);
+    if (bCompressed || (!bLegacy && pHeader->glInternalFormat != pHeader->glBaseInternalFormat))
+    {
+        return pHeader->glInternalFormat;
+    }
 
-    if(!pOutHeader) pOutHeader = &tHeader;
+    switch (bLegacy ? nUploadFormat : pHeader->glInternalFormat)
+    {
+    case GL_RGBA:
+        switch (pHeader->glType)
+        {
+        case GL_UNSIGNED_BYTE:          return GL_RGBA8;
+        case GL_UNSIGNED_SHORT_4_4_4_4: return GL_RGBA4;
+        case GL_UNSIGNED_SHORT_5_5_5_1: return GL_RGB5_A1;
+        case GL_HALF_FLOAT:             return GL_RGBA16F;
+        case GL_FLOAT:                  return GL_RGBA32F;
+        }
+        break;
+    case GL_RGB:
+        switch (pHeader->glType)
+        {
+        case GL_UNSIGNED_BYTE:          return GL_RGB8;
+        case GL_UNSIGNED_SHORT_5_6_5:   return GL_RGB565;
+        case GL_HALF_FLOAT:             return GL_RGB16F;
+        case GL_FLOAT:                  return GL_RGB32F;
+        }
+        break;
+    case GL_RG:
+        switch (pHeader->glType)
+        {
+        case GL_UNSIGNED_BYTE:          return GL_RG8;
+        case GL_HALF_FLOAT:             return GL_RG16F;
+        case GL_FLOAT:                  return GL_RG32F;
+        }
+        break;
+    case GL_RED:
+        switch (pHeader->glType)
+        {
+        case GL_UNSIGNED_BYTE:          return GL_R8;
+        case GL_HALF_FLOAT:             return GL_R16F;
+        case GL_FLOAT:                  return GL_R32F;
+        }
+        break;
+    }
 
-    m_pStreamBuffer     = (unsigned char*)pBuffer;
-    m_nStreamBufferSize = nBufferSize;
-    m_nStreamBufferIndex = 0;
+    return 0;
+}
 
-    LOGI("    KTX Stream initialization: %d bytes.", m_nStreamBufferSize);
+//-----------------------------------------------------------------------------
+static TKTXErrorCode L_CheckGlError()
+//-----------------------------------------------------------------------------
+{
+    GLenum error = glGetError();
+    if (error == GL_NO_ERROR)
+    {
+        return KTX_SUCCESS;
+    }
 
+    switch(error)
+    {
+    case GL_INVALID_ENUM:       // 0x0500
+        LOGE("Error (GL_INVALID_ENUM) creating texture");
+        break;
+    case GL_INVALID_VALUE:      // 0x0501
+        LOGE("Error (GL_INVALID_VALUE) creating texture");
+        break;
+    case GL_INVALID_OPERATION:  // 0x0502
+        LOGE("Error (GL_INVALID_OPERATION) creating texture");
+        break;
+    case GL_OUT_OF_MEMORY:      // 0x0505
+        LOGE("Error (GL_OUT_OF_MEMORY) creating texture");
+        break;
+    default:
+        LOGE("Error (0x%X) creating texture", error);
+        break;
+    }
+    return KTX_GL_ERROR;
+}
 
-    if (pTarget == NULL || pTexture == NULL)
+//-----------------------------------------------------------------------------
+TKTXErrorCode KtxTexture::ParseLevels()
+//-----------------------------------------------------------------------------
+{
+    bool   bCubeFaces = (m_header.numberOfFaces == 6 && m_header.numberOfArrayElements == 0);
+    uint32 nLayers    = MAX(1, m_header.numberOfArrayElements) * m_header.numberOfFaces;
+
+    // Sizes come straight from the file, so add them up where they cannot wrap
+    uint64 nDataSize = 0;
+    m_nDataSize = 0;
+    for (uint32 nMipLevel = 0; nMipLevel < m_nNumLevels; nMipLevel++)
+    {
+        TKTXLevel& level = m_levels[nMipLevel];
+        uint32     nImageSize;
+
+        if (StreamRead(&nImageSize, sizeof(uint32)) != sizeof(uint32))
+        {
+            return KTX_UNEXPECTED_END_OF_STREAM;
+        }
+        if (m_bSwap)
+        {
+            L_SwapEndian32(&nImageSize, 1);
+        }
+
+        // A cube map stores each face with its own padding, everything else
+        // stores the level (all layers) as one image
+        uint64 nFaceStride = ((uint64)nImageSize + 3) & ~(uint64)3;
+        uint64 nLevelSize  = bCubeFaces ? nFaceStride * 6 : nFaceStride;
+        uint64 nRequired   = nLevelSize - (nFaceStride - nImageSize);
+        uint32 nRemaining  = m_nStreamBufferSize - m_nStreamBufferIndex;
+        if (nRequired > nRemaining || nLevelSize > UINT32_MAX)
+        {
+            LOGE("    Stream has %u bytes left, mip %u needs %llu", nRemaining, nMipLevel, (unsigned long long)nLevelSize);
+            return KTX_UNEXPECTED_END_OF_STREAM;
+        }
+
+        level.pData       = &m_pStreamBuffer[m_nStreamBufferIndex];
+        level.nImageSize  = nImageSize;
+        level.nFaceStride = (uint32)nFaceStride;
+        level.nWidth      = MAX(1, m_header.pixelWidth  >> nMipLevel);
+        level.nHeight     = MAX(1, m_header.pixelHeight >> nMipLevel);
+        level.nDepth      = (m_textureInfo.glTarget == GL_TEXTURE_3D) ? MAX(1, m_header.pixelDepth >> nMipLevel) : nLayers;
+
+        // Some writers leave the padding off the last level
+        m_nStreamBufferIndex += (nLevelSize < nRemaining) ? (uint32)nLevelSize : nRemaining;
+
+        nDataSize += bCubeFaces ? (uint64)nImageSize * 6 : nImageSize;
+    }
+
+    if (nDataSize > UINT32_MAX)
     {
+        LOGE("    KTX levels add up to %llu bytes", (unsigned long long)nDataSize);
         return KTX_INVALID_VALUE;
     }
+    m_nDataSize = (uint32)nDataSize;
+
+    return KTX_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+TKTXErrorCode KtxTexture::Parse(const void* pBuffer, uint32 nBufferSize, TKTXHeader* pOutHeader)
+//-----------------------------------------------------------------------------
+{
+    FreeGeneratedLevels();
+
+    m_pStreamBuffer      = (uint8*)pBuffer;
+    m_nStreamBufferSize  = nBufferSize;
+    m_nStreamBufferIndex = 0;
+    m_nNumLevels         = 0;
+    m_nDataSize          = 0;
 
-    TKTXErrorCode nErrorCode = ParseHeader(pOutHeader, &textureInfo);
+    LOGI("    KTX Stream initialization: %d bytes.", m_nStreamBufferSize);
+
+    TKTXErrorCode nErrorCode = ParseHeader(&m_header, &m_textureInfo);
     if (nErrorCode != KTX_SUCCESS)
     {
         LOGI("    Texture header parsing failed: %d", nErrorCode);
         return nErrorCode;
     }
 
-    LOGI("    Texture is (%d x %d)", pOutHeader->pixelWidth, pOutHeader->pixelHeight);
+    if (pOutHeader)
+    {
+        *pOutHeader = m_header;
+    }
+
+    LOGI("    Texture is (%d x %d x %d), %d layers, %d faces, %d mip levels", m_header.pixelWidth, m_header.pixelHeight,
+         m_header.pixelDepth, m_header.numberOfArrayElements, m_header.numberOfFaces, m_header.numberOfMipmapLevels);
+
+    m_bSwap = (m_header.endianness == KTX_ENDIAN_REF_REV);
+    m_glStorageFormat = L_GetSizedFormat(&m_header, m_textureInfo.bCompressed);
+    if (m_glStorageFormat == 0)
+    {
+        LOGE("    No sized format for internal format 0x%X, type 0x%X", m_header.glInternalFormat, m_header.glType);
+        return KTX_UNSUPPORTED_TEXTURE_TYPE;
+    }
+
+    m_glUploadFormat = m_header.glFormat;
+    m_bSwizzle = !m_textureInfo.bCompressed && L_GetLegacyLayout(m_header.glBaseInternalFormat, &m_glUploadFormat, m_glSwizzle);
+
+    m_nNumLevels = m_header.numberOfMipmapLevels;
+    nErrorCode = ParseLevels();
+    if (nErrorCode != KTX_SUCCESS)
+    {
+        m_nNumLevels = 0;
+        m_nDataSize = 0;
+    }
+    return nErrorCode;
+}
+
+//-----------------------------------------------------------------------------
+bool KtxTexture::GenerateMips(SvrMipFilter filter)
+//-----------------------------------------------------------------------------
+{
+    if (!m_bGenerateMips || m_nNumLevels != 1 || m_textureInfo.glTarget != GL_TEXTURE_2D || m_textureInfo.bCompressed)
+    {
+        return false;
+    }
+
+    // Byte swapped files would need a swapped copy of the base first, not worth it
+    SvrMipFormat format;
+    if ((m_bSwap && m_header.glTypeSize != 1) || !SvrGetMipFormat(m_header.glInternalFormat, m_header.glType, &format))
+    {
+        LOGI("    KTX format 0x%X, type 0x%X left to glGenerateMipmap", m_header.glInternalFormat, m_header.glType);
+        return false;
+    }
+
+    // KTX rows are padded to 4 bytes, the same as the generated ones
+    TKTXLevel& base = m_levels[0];
+    uint32 nRowPitch = SvrGetMipRowPitch(format, base.nWidth);
+    if (base.nImageSize < nRowPitch * base.nHeight)
+    {
+        LOGE("    KTX base level is %d bytes, expected %d", base.nImageSize, nRowPitch * base.nHeight);
+        return false;
+    }
+
+    uint32 nNumLevels = SvrGetMipLevelCount(base.nWidth, base.nHeight);
+    if (nNumLevels > KTX_MAX_MIP_LEVELS)
+    {
+        return false;
+    }
+
+    size_t nChainSize = SvrGetMipChainSize(format, base.nWidth, base.nHeight, nNumLevels);
+    m_pGeneratedData = malloc(nChainSize);
+    if (m_pGeneratedData == NULL)
+    {
+        LOGE("    Unable to allocate %d bytes for generated mip levels", (int)nChainSize);
+        return false;
+    }
+
+    SvrMipImage baseImage;
+    baseImage.pData = (void*)base.pData;
+    baseImage.width = base.nWidth;
+    baseImage.height = base.nHeight;
+    baseImage.rowPitch = nRowPitch;
+
+    SvrMipImage levels[KTX_MAX_MIP_LEVELS];
+    SvrGenerateMipChain(format, filter, baseImage, nNumLevels, m_pGeneratedData, levels);
+
+    for (uint32 nMipLevel = 1; nMipLevel < nNumLevels; nMipLevel++)
+    {
+        const SvrMipImage& image = levels[nMipLevel - 1];
+        TKTXLevel& level = m_levels[nMipLevel];
+        level.pData       = (const uint8*)image.pData;
+        level.nImageSize  = image.rowPitch * image.height;
+        level.nFaceStride = level.nImageSize;
+        level.nWidth      = image.width;
+        level.nHeight     = image.height;
+        level.nDepth      = 1;
+    }
+
+    m_nNumLevels = nNumLevels;
+    m_nDataSize += (uint32)nChainSize;
+    m_header.numberOfMipmapLevels = nNumLevels;
+    m_bGenerateMips = false;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+void KtxTexture::FreeGeneratedLevels()
+//-----------------------------------------------------------------------------
+{
+    if (m_pGeneratedData == NULL)
+    {
+        return;
+    }
+
+    free(m_pGeneratedData);
+    m_pGeneratedData = NULL;
+
+    // Back to the parsed base level alone
+    m_nNumLevels = 1;
+    m_nDataSize = m_levels[0].nImageSize;
+    m_header.numberOfMipmapLevels = 1;
+    m_bGenerateMips = true;
+}
+
+//-----------------------------------------------------------------------------
+bool KtxTexture::GetImageView(uint32 nLevel, uint32 nLayer, uint32 nFace, TKTXImageView* pView)
+//-----------------------------------------------------------------------------
+{
+    uint32 nLayers = MAX(1, m_header.numberOfArrayElements);
+    if (nLevel >= m_nNumLevels || nLayer >= nLayers || nFace >= m_header.numberOfFaces)
+    {
+        return false;
+    }
+
+    const TKTXLevel& level = m_levels[nLevel];
+    pView->nWidth  = level.nWidth;
+    pView->nHeight = level.nHeight;
+    pView->nDepth  = 1;
+
+    if (m_textureInfo.glTarget == GL_TEXTURE_3D)
+    {
+        pView->pData  = level.pData;
+        pView->nSize  = level.nImageSize;
+        pView->nDepth = level.nDepth;
+    }
+    else if (m_header.numberOfArrayElements == 0)
+    {
+        pView->pData = level.pData + nFace * level.nFaceStride;
+        pView->nSize = level.nImageSize;
+    }
+    else
+    {
+        // Array levels are layer major with the faces of each layer together
+        uint32 nImages = nLayers * m_header.numberOfFaces;
+        pView->nSize = level.nImageSize / nImages;
+        pView->pData = level.pData + (nLayer * m_header.numberOfFaces + nFace) * pView->nSize;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+uint32 KtxTexture::GetLevelUploadSize(uint32 nLevel)
+//-----------------------------------------------------------------------------
+{
+    // The last face need not be padded, copying its padding could read past the file
+    const TKTXLevel& level = m_levels[nLevel];
+    return (m_textureInfo.glTarget == GL_TEXTURE_CUBE_MAP) ? level.nFaceStride * 5 + level.nImageSize : level.nImageSize;
+}
+
+//-----------------------------------------------------------------------------
+void KtxTexture::CopyLevel(uint32 nLevel, void* pDest)
+//-----------------------------------------------------------------------------
+{
+    uint32 nSize = GetLevelUploadSize(nLevel);
+    memcpy(pDest, m_levels[nLevel].pData, nSize);
+
+    if (!m_bSwap || m_header.glTypeSize == 1)
+    {
+        return;
+    }
+
+    if (m_header.glTypeSize == 2)
+    {
+        L_SwapEndian16((uint16*)pDest, nSize / 2);
+    }
+    else
+    {
+        L_SwapEndian32((uint32*)pDest, nSize / 4);
+    }
+}
+
+//-----------------------------------------------------------------------------
+const uint8* KtxTexture::StageLevel(uint32 nLevel)
+//-----------------------------------------------------------------------------
+{
+    if (!m_bSwap || m_header.glTypeSize == 1)
+    {
+        return m_levels[nLevel].pData;
+    }
+
+    // Source data is read only (and usually mapped), byte swap a copy
+    uint8* pStaged = SvrGetThreadArena().AllocArray<uint8>(GetLevelUploadSize(nLevel));
+    CopyLevel(nLevel, pStaged);
+    return pStaged;
+}
+
+//-----------------------------------------------------------------------------
+TKTXErrorCode KtxTexture::AllocateStorage(GLuint* pTexture, GLenum* pTarget, uint32 nBaseLevel)
+//-----------------------------------------------------------------------------
+{
+    GLuint nTextureId;
+
+    if (pTarget == NULL || pTexture == NULL || nBaseLevel >= m_nNumLevels)
+    {
+        return KTX_INVALID_VALUE;
+    }
+
+    // Clear out any GL Errors
+    GLenum error = GL_INVALID_ENUM;
+    while(error != GL_NO_ERROR)
+        error = glGetError();
 
     if (*pTexture)
     {
@@ -294,151 +684,145 @@ TKTXErrorCode KtxTexture::ParseBuffer(void* pBuffer, unsigned int nBufferSize, G
     {
         glGenTextures(1, &nTextureId);
     }
-    glBindTexture(textureInfo.glTarget, nTextureId);
 
-    if (textureInfo.glTarget == GL_TEXTURE_CUBE_MAP)
+    GLenum target = m_textureInfo.glTarget;
+    glBindTexture(target, nTextureId);
+
+    // Storage for the whole chain is allocated once and is immutable, each level
+    // is then copied straight out of the source buffer
+    const TKTXLevel& base = m_levels[nBaseLevel];
+    GLsizei nStorageLevels = m_nNumLevels - nBaseLevel;
+    if (m_bGenerateMips)
     {
-        textureInfo.glTarget = GL_TEXTURE_CUBE_MAP_POSITIVE_X;
+        uint32 nMaxMipDimension = MAX(MAX(base.nWidth, base.nHeight), (target == GL_TEXTURE_3D) ? base.nDepth : 1);
+        nStorageLevels = 1;
+        while ((nMaxMipDimension >> nStorageLevels) > 0)
+        {
+            nStorageLevels++;
+        }
     }
 
-    LOGI("    Texture has %d mip levels", pOutHeader->numberOfMipmapLevels);
-    for (uint32 nMipLevel = 0; nMipLevel < pOutHeader->numberOfMipmapLevels; nMipLevel++)
+    if (target == GL_TEXTURE_2D || target == GL_TEXTURE_CUBE_MAP)
     {
-        uint32  nFaceLodSize;
-        uint32  nFaceLodSizeRounded;
+        glTexStorage2D(target, nStorageLevels, m_glStorageFormat, base.nWidth, base.nHeight);
+    }
+    else
+    {
+        glTexStorage3D(target, nStorageLevels, m_glStorageFormat, base.nWidth, base.nHeight, base.nDepth);
+    }
 
-        GLsizei nWidth  = MAX(1, pOutHeader->pixelWidth  >> nMipLevel);
-        GLsizei nHeight = MAX(1, pOutHeader->pixelHeight >> nMipLevel);
-        GLsizei nDepth  = MAX(1, pOutHeader->pixelDepth  >> nMipLevel);
-        
-        LOGI("       Mip %d: (%d x %d)", nMipLevel, nWidth, nHeight);
+    if (m_bSwizzle)
+    {
+        glTexParameteri(target, GL_TEXTURE_SWIZZLE_R, m_glSwizzle[0]);
+        glTexParameteri(target, GL_TEXTURE_SWIZZLE_G, m_glSwizzle[1]);
+        glTexParameteri(target, GL_TEXTURE_SWIZZLE_B, m_glSwizzle[2]);
+        glTexParameteri(target, GL_TEXTURE_SWIZZLE_A, m_glSwizzle[3]);
+    }
 
-        if (StreamRead(&nFaceLodSize, sizeof(uint32)) != sizeof(uint32))
-        {
-            return KTX_UNEXPECTED_END_OF_STREAM;
-        }
-        if (pOutHeader->endianness == KTX_ENDIAN_REF_REV)
+    TKTXErrorCode nErrorCode = L_CheckGlError();
+    if (nErrorCode != KTX_SUCCESS)
+    {
+        if (*pTexture == 0)
         {
-            L_SwapEndian32(&nFaceLodSize, 1);
+            glDeleteTextures(1, &nTextureId);
         }
-        nFaceLodSizeRounded = (nFaceLodSize + 3) & ~(uint32)3;
-        if (!m_pData)
+        return nErrorCode;
+    }
+
+    *pTarget  = target;
+    *pTexture = nTextureId;
+
+    return KTX_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+TKTXErrorCode KtxTexture::UploadLevel(uint32 nLevel, const void* pLevelData, uint32 nBaseLevel)
+//-----------------------------------------------------------------------------
+{
+    if (nLevel >= m_nNumLevels || nLevel < nBaseLevel)
+    {
+        return KTX_INVALID_VALUE;
+    }
+
+    const TKTXLevel& level = m_levels[nLevel];
+    GLint nMipLevel = nLevel - nBaseLevel;
+    const uint8* pData = (const uint8*)pLevelData;
+    GLenum target = m_textureInfo.glTarget;
+
+    if (target == GL_TEXTURE_2D)
+    {
+        if (m_textureInfo.bCompressed)
         {
-            // allocate memory sufficient for the first nMipLevel 
-            m_pData = new uint8[nFaceLodSizeRounded];
-            m_nDataSize = nFaceLodSizeRounded;
+            glCompressedTexSubImage2D(target, nMipLevel, 0, 0, level.nWidth, level.nHeight,
+                m_header.glInternalFormat, level.nImageSize, pData);
         }
-        else if (m_nDataSize < nFaceLodSizeRounded)
+        else
         {
-            // subsequent levels cannot be larger than the first nMipLevel 
-            return KTX_INVALID_VALUE;
+            glTexSubImage2D(target, nMipLevel, 0, 0, level.nWidth, level.nHeight,
+                m_glUploadFormat, m_header.glType, pData);
         }
-
-        for (uint32 nFace=0; nFace<pOutHeader->numberOfFaces; nFace++)
+    }
+    else if (target == GL_TEXTURE_CUBE_MAP)
+    {
+        for (uint32 nFace = 0; nFace < 6; nFace++)
         {
-            if (StreamRead(m_pData, nFaceLodSizeRounded) != nFaceLodSizeRounded)
+            const uint8* pFaceData = pData + nFace * level.nFaceStride;
+            if (m_textureInfo.bCompressed)
             {
-                return KTX_UNEXPECTED_END_OF_STREAM;
+                glCompressedTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + nFace, nMipLevel, 0, 0, level.nWidth, level.nHeight,
+                    m_header.glInternalFormat, level.nImageSize, pFaceData);
             }
-
-            // Perform endianness conversion on texture m_pData 
-            if (pOutHeader->endianness == KTX_ENDIAN_REF_REV && pOutHeader->glTypeSize == 2)
-            {
-                L_SwapEndian16((uint16*)m_pData, nFaceLodSize / 2);
-            }
-            else if (pOutHeader->endianness == KTX_ENDIAN_REF_REV && pOutHeader->glTypeSize == 4)
+            else
             {
-                L_SwapEndian32((uint32*)m_pData, nFaceLodSize / 4);
+                glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + nFace, nMipLevel, 0, 0, level.nWidth, level.nHeight,
+                    m_glUploadFormat, m_header.glType, pFaceData);
             }
+        }
+    }
+    else
+    {
+        // 3D, 2D array and cube map array levels are one contiguous image
+        if (m_textureInfo.bCompressed)
+        {
+            glCompressedTexSubImage3D(target, nMipLevel, 0, 0, 0, level.nWidth, level.nHeight, level.nDepth,
+                m_header.glInternalFormat, level.nImageSize, pData);
+        }
+        else
+        {
+            glTexSubImage3D(target, nMipLevel, 0, 0, 0, level.nWidth, level.nHeight, level.nDepth,
+                m_glUploadFormat, m_header.glType, pData);
+        }
+    }
 
-            if (textureInfo.nTextureDimensions == 1)
-            {
-                if (textureInfo.bCompressed)
-                {
-                    //glCompressedTexImage1D not supported in OpenGLES 2.0
-                    return KTX_UNSUPPORTED_TEXTURE_TYPE;
-                }
-                else
-                {
-                    //glTexImage1D not supported in OpenGLES 2.0
-                    return KTX_UNSUPPORTED_TEXTURE_TYPE;
-                }
-            }
-            else if (textureInfo.nTextureDimensions == 2)
-            {
-                if (pOutHeader->numberOfArrayElements)
-                {
-                    nHeight = pOutHeader->numberOfArrayElements;
-                }
-                if (textureInfo.bCompressed)
-                {
-                    glCompressedTexImage2D(textureInfo.glTarget + nFace, nMipLevel, 
-                        pOutHeader->glInternalFormat, nWidth, nHeight, 0,
-                        nFaceLodSize, m_pData);
-                }
-                else
-                {
-                    glTexImage2D(textureInfo.glTarget + nFace, nMipLevel, 
-                        pOutHeader->glBaseInternalFormat, nWidth, nHeight, 0, 
-                        pOutHeader->glFormat, pOutHeader->glType, m_pData);
-                }
-            }
-            else if (textureInfo.nTextureDimensions == 3)
-            {
-                if (pOutHeader->numberOfArrayElements)
-                {
-                    nDepth = pOutHeader->numberOfArrayElements;
-                }
-                if (textureInfo.bCompressed)
-                {
-                    //glCompressedTexImage3D not supported in OpenGLES 2.0
-                    return KTX_UNSUPPORTED_TEXTURE_TYPE;
-                }
-                else
-                {
-                    //glTexImage3D not supported in OpenGLES 2.0
-                    return KTX_UNSUPPORTED_TEXTURE_TYPE;
-                }
-            }
+    return L_CheckGlError();
+}
 
-            GLenum error = glGetError();
-            if (error != GL_NO_ERROR)
-            {
-                switch(error)
-                {
-                case GL_NO_ERROR:           // 0
-                    LOGE("Error (GL_NO_ERROR) creating texture");
-                    break;
-                case GL_INVALID_ENUM:       // 0x0500
-                    LOGE("Error (GL_INVALID_ENUM) creating texture");
-                    break;
-                case GL_INVALID_VALUE:      // 0x0501
-                    LOGE("Error (GL_INVALID_VALUE) creating texture");
-                    break;
-                case GL_INVALID_OPERATION:  // 0x0502
-                    LOGE("Error (GL_INVALID_OPERATION) creating texture");
-                    break;
-                //case GL_STACK_OVERFLOW:     // 0x0503
-                //    LOGE("Error (GL_STACK_OVERFLOW) creating texture");
-                //    break;
-                //case GL_STACK_UNDERFLOW:    // 0x0504
-                //    LOGE("Error (GL_STACK_UNDERFLOW) creating texture");
-                //    break;
-                case GL_OUT_OF_MEMORY:      // 0x0505
-                    LOGE("Error (GL_OUT_OF_MEMORY) creating texture");
-                    break;
-
-                default:
-                    LOGE("Error (0x%X) creating texture", error);
-                    break;
-                }
-                return KTX_GL_ERROR;
-            }
+//-----------------------------------------------------------------------------
+TKTXErrorCode KtxTexture::Upload(GLuint* pTexture, GLenum* pTarget)
+//-----------------------------------------------------------------------------
+{
+    TKTXErrorCode nErrorCode = AllocateStorage(pTexture, pTarget);
+    if (nErrorCode != KTX_SUCCESS)
+    {
+        return nErrorCode;
+    }
+
+    for (uint32 nMipLevel = 0; nMipLevel < m_nNumLevels; nMipLevel++)
+    {
+        // Swapped copies only live until the level has been handed to GL
+        SvrArenaScope scope(SvrGetThreadArena());
+
+        nErrorCode = UploadLevel(nMipLevel, StageLevel(nMipLevel));
+        if (nErrorCode != KTX_SUCCESS)
+        {
+            return nErrorCode;
         }
     }
 
-    *pTarget  = textureInfo.glTarget;
-    *pTexture = nTextureId;
+    if (m_bGenerateMips)
+    {
+        glGenerateMipmap(*pTarget);
+    }
 
     return KTX_SUCCESS;
 }
@@ -450,11 +834,23 @@ TKTXErrorCode KtxTexture::LoadKtxFromBuffer(void* pBuffer, unsigned int nBufferS
     GLint           nPreviousUnpackAlignment = 4;
     TKTXErrorCode   nErrorCode = KTX_SUCCESS;
 
+    if (pTarget == NULL || pTexture == NULL)
+    {
+        return KTX_INVALID_VALUE;
+    }
+
+    nErrorCode = Parse(pBuffer, nBufferSize, pOutHeader);
+    if (nErrorCode != KTX_SUCCESS)
+    {
+        return nErrorCode;
+    }
+    GenerateMips();
+
     // KTX files require an unpack alignment of 4 
     glGetIntegerv(GL_UNPACK_ALIGNMENT, &nPreviousUnpackAlignment);
     glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
-    nErrorCode = ParseBuffer(pBuffer, nBufferSize, pTexture, pTarget, pOutHeader);
+    nErrorCode = Upload(pTexture, pTarget);
 
     // restore previous GL state 
     glPixelStorei(GL_UNPACK_ALIGNMENT, nPreviousUnpackAlignment);
@@ -462,5 +858,56 @@ TKTXErrorCode KtxTexture::LoadKtxFromBuffer(void* pBuffer, unsigned int nBufferS
     return nErrorCode;
 }
 
-}   // End namespace Svr
+//-----------------------------------------------------------------------------
+TKTXErrorCode KtxTexture::LoadKtxFromFile(const char* pFileName, GLuint* pTexture, GLenum* pTarget, TKTXHeader* pOutHeader)
+//-----------------------------------------------------------------------------
+{
+    int fd = open(pFileName, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        LOGE("Unable to open KTX file: %s", pFileName);
+        return KTX_FILE_OPEN_FAILED;
+    }
 
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+    {
+        LOGE("Unable to stat KTX file: %s", pFileName);
+        close(fd);
+        return KTX_FILE_OPEN_FAILED;
+    }
+
+    // Levels are uploaded straight from the mapping, the only copy is the one GL makes
+    void* pMapping = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (pMapping == MAP_FAILED)
+    {
+        LOGE("Unable to map KTX file: %s", pFileName);
+        return KTX_FILE_OPEN_FAILED;
+    }
+    madvise(pMapping, fileStat.st_size, MADV_SEQUENTIAL);
+
+    LOGI("Loading KTX file: %s", pFileName);
+    TKTXErrorCode nErrorCode = LoadKtxFromBuffer(pMapping, (uint32)fileStat.st_size, pTexture, pTarget, pOutHeader);
+
+    munmap(pMapping, fileStat.st_size);
+    return nErrorCode;
+}
+
+//-----------------------------------------------------------------------------
+TKTXErrorCode KtxTexture::LoadKtxFromAsset(const char* pName, GLuint* pTexture, GLenum* pTarget, TKTXHeader* pOutHeader)
+//-----------------------------------------------------------------------------
+{
+    // Whole payload is read front to back, have the kernel start on it right away
+    SvrArchiveSpan span;
+    if (!SvrFindAsset(pName, &span, true))
+    {
+        LOGE("KTX asset not found in mounted archives: %s", pName);
+        return KTX_FILE_OPEN_FAILED;
+    }
+
+    LOGI("Loading KTX asset: %s", pName);
+    return LoadKtxFromBuffer((void*)span.pData, (uint32)span.size, pTexture, pTarget, pOutHeader);
+}
+
+}   // End namespace Svr
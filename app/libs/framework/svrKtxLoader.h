@@ -14,6 +14,8 @@
 
 #include <GLES3/gl3.h>
 
+#include "svrMipGen.h"
+
 #define KTX_IDENTIFIER_REF  { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A }
 #define KTX_ENDIAN_REF      (0x04030201)
 #define KTX_ENDIAN_REF_REV  (0x01020304)
@@ -29,6 +31,11 @@
     #define GL_TEXTURE_1D_ARRAY_EXT          0x8C18
     #define GL_TEXTURE_2D_ARRAY_EXT          0x8C1A
 #endif
+#ifndef GL_TEXTURE_CUBE_MAP_ARRAY_EXT
+    #define GL_TEXTURE_CUBE_MAP_ARRAY_EXT    0x9009
+#endif
+
+#define KTX_MAX_MIP_LEVELS  16
 
 // Based on values from <stdint.h>
 typedef char        int8;       // This should really be "int8_t"
@@ -52,6 +59,7 @@ namespace Svr
 	    KTX_INVALID_VALUE,
 	    KTX_UNSUPPORTED_TEXTURE_TYPE,
 	    KTX_GL_ERROR,
+        KTX_FILE_OPEN_FAILED,
     } TKTXErrorCode;
 
     //KTX header as defined by Khronos
@@ -83,6 +91,28 @@ namespace Svr
 	    bool32  bCompressed;
     } TKTXTextureInfo;
 
+    // Location of one mip level inside the source buffer
+    typedef struct
+    {
+        const uint8*    pData;
+        uint32          nImageSize;     // Bytes per face for cube maps, otherwise the whole level
+        uint32          nFaceStride;    // Image size padded to 4 bytes
+        uint32          nWidth;
+        uint32          nHeight;
+        uint32          nDepth;         // Slices of a 3D level, array layers (times 6 for cube arrays) otherwise
+    } TKTXLevel;
+
+    // One image of the texture: a single face of a single layer of a level, or a
+    // whole level of a 3D texture
+    typedef struct
+    {
+        const uint8*    pData;
+        uint32          nSize;
+        uint32          nWidth;
+        uint32          nHeight;
+        uint32          nDepth;
+    } TKTXImageView;
+
     class KtxTexture
     {
         //constructors
@@ -93,23 +123,67 @@ namespace Svr
         //methods
     public:
         TKTXErrorCode   LoadKtxFromBuffer(void* pBuffer, uint32 nBufferSize, GLuint* texture, GLenum* target, TKTXHeader* pOutHeader = 0);
-
+        TKTXErrorCode   LoadKtxFromFile(const char* pFileName, GLuint* texture, GLenum* target, TKTXHeader* pOutHeader = 0);
+        TKTXErrorCode   LoadKtxFromAsset(const char* pName, GLuint* texture, GLenum* target, TKTXHeader* pOutHeader = 0);
+
+        // Parse only indexes the buffer, image data is not copied and the buffer must
+        // stay valid until Upload has been called.  Parse does not touch GL and can run
+        // on any thread, Upload needs a current context.  An existing texture passed to
+        // Upload must not have storage allocated yet.
+        TKTXErrorCode   Parse(const void* pBuffer, uint32 nBufferSize, TKTXHeader* pOutHeader = 0);
+        TKTXErrorCode   Upload(GLuint* texture, GLenum* target);
+
+        // Upload split up for streaming: AllocateStorage once, then UploadLevel for each
+        // level in any order while the texture is bound.  pData may be an offset into a
+        // bound pixel unpack buffer filled by CopyLevel.  With nBaseLevel set the levels
+        // above it are left out and nBaseLevel becomes level 0 of the GL texture.
+        TKTXErrorCode   AllocateStorage(GLuint* texture, GLenum* target, uint32 nBaseLevel = 0);
+        TKTXErrorCode   UploadLevel(uint32 nLevel, const void* pData, uint32 nBaseLevel = 0);
+        uint32          GetLevelUploadSize(uint32 nLevel);
+        void            CopyLevel(uint32 nLevel, void* pDest);
+        bool            NeedsMipGeneration() { return m_bGenerateMips; }
+
+        // Builds the chain a file without mip levels asks for on the CPU, after Parse and
+        // on any thread.  The generated levels then upload (and stream) like stored ones
+        // instead of leaving glGenerateMipmap to the render thread.  Only uncompressed 2D
+        // textures are handled, false leaves the texture to glGenerateMipmap.
+        bool            GenerateMips(SvrMipFilter filter = kMipFilterBox);
+        void            FreeGeneratedLevels();
+
+        uint32          GetNumLevels() { return m_nNumLevels; }
+        const TKTXLevel& GetLevel(uint32 nLevel) { return m_levels[nLevel]; }
+        bool            GetImageView(uint32 nLevel, uint32 nLayer, uint32 nFace, TKTXImageView* pView);
+
+        // Bytes of image data across all levels, faces and layers
         uint32          GetDataSize() { return m_nDataSize; }
-        uint8 *         GetData() { return m_pData; }
 
     private:
-        TKTXErrorCode   ParseBuffer(void* pBuffer, unsigned int nBufferSize, GLuint* pTexture, GLenum* pTarget, TKTXHeader* pOutHeader = 0);
         TKTXErrorCode   ParseHeader(TKTXHeader* pHeader, TKTXTextureInfo* pTextureInfo);
+        TKTXErrorCode   ParseLevels();
+        const uint8*    StageLevel(uint32 nLevel);
         uint32          StreamRead(void* pData, unsigned int nSize);
         uint32          StreamSkip(unsigned int nSize);
 
         //attributes
     private:
-        uint8*  m_pData;
-        uint32  m_nDataSize;
-        uint8*  m_pStreamBuffer;
-        uint32  m_nStreamBufferSize;
-        uint32  m_nStreamBufferIndex;
+        TKTXHeader      m_header;
+        TKTXTextureInfo m_textureInfo;
+        GLenum          m_glStorageFormat;
+        GLenum          m_glUploadFormat;   // glFormat, or red/green for luminance and alpha
+        GLint           m_glSwizzle[4];
+        bool            m_bSwizzle;
+        bool            m_bGenerateMips;
+        bool            m_bSwap;
+
+        TKTXLevel       m_levels[KTX_MAX_MIP_LEVELS];
+        uint32          m_nNumLevels;
+        uint32          m_nDataSize;
+
+        void*           m_pGeneratedData;
+
+        uint8*          m_pStreamBuffer;
+        uint32          m_nStreamBufferSize;
+        uint32          m_nStreamBufferIndex;
     };
 
 }   // Svr Namespace
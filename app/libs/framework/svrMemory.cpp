@@ -0,0 +1,271 @@
+//=============================================================================
+// FILE: svrMemory.cpp
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "svrMemory.h"
+#include "svrUtil.h"
+
+#define MAX_TRACKED_ARENAS  32
+
+namespace Svr
+{
+
+static SvrLinearArena*  gTrackedArenas[MAX_TRACKED_ARENAS];
+static int              gNumTrackedArenas = 0;
+static pthread_mutex_t  gTrackedArenaLock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_key_t    gThreadArenaKey;
+static pthread_once_t   gThreadArenaOnce = PTHREAD_ONCE_INIT;
+
+//-----------------------------------------------------------------------------
+static inline size_t AlignUp(size_t value, size_t alignment)
+//-----------------------------------------------------------------------------
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+//-----------------------------------------------------------------------------
+static void TrackArena(SvrLinearArena* pArena)
+//-----------------------------------------------------------------------------
+{
+    pthread_mutex_lock(&gTrackedArenaLock);
+    if (gNumTrackedArenas < MAX_TRACKED_ARENAS)
+    {
+        gTrackedArenas[gNumTrackedArenas++] = pArena;
+    }
+    pthread_mutex_unlock(&gTrackedArenaLock);
+}
+
+//-----------------------------------------------------------------------------
+static void UntrackArena(SvrLinearArena* pArena)
+//-----------------------------------------------------------------------------
+{
+    pthread_mutex_lock(&gTrackedArenaLock);
+    for (int i = 0; i < gNumTrackedArenas; i++)
+    {
+        if (gTrackedArenas[i] == pArena)
+        {
+            gTrackedArenas[i] = gTrackedArenas[--gNumTrackedArenas];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&gTrackedArenaLock);
+}
+
+//-----------------------------------------------------------------------------
+SvrLinearArena::SvrLinearArena()
+//-----------------------------------------------------------------------------
+    : mName(NULL)
+    , mBase(NULL)
+    , mCapacity(0)
+    , mUsed(0)
+    , mHighWater(0)
+    , mOverflow(NULL)
+    , mOverflowLive(0)
+    , mOverflowTotal(0)
+    , mOverflowBytes(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+SvrLinearArena::~SvrLinearArena()
+//-----------------------------------------------------------------------------
+{
+    Destroy();
+}
+
+//-----------------------------------------------------------------------------
+bool SvrLinearArena::Initialize(const char* pName, size_t capacity)
+//-----------------------------------------------------------------------------
+{
+    Destroy();
+
+    // Reserve without committing, untouched pages never count against the app
+    void* pBase = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (pBase == MAP_FAILED)
+    {
+        LOGE("SvrLinearArena: Unable to reserve %zu bytes for %s arena", capacity, pName);
+        return false;
+    }
+
+    mName = pName;
+    mBase = (unsigned char*)pBase;
+    mCapacity = capacity;
+    mUsed = 0;
+    mHighWater = 0;
+
+    TrackArena(this);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+void SvrLinearArena::Destroy()
+//-----------------------------------------------------------------------------
+{
+    Reset();
+    if (mBase == NULL)
+    {
+        return;
+    }
+
+    UntrackArena(this);
+    munmap(mBase, mCapacity);
+
+    mBase = NULL;
+    mCapacity = 0;
+    mHighWater = 0;
+    mOverflowTotal = 0;
+}
+
+//-----------------------------------------------------------------------------
+void* SvrLinearArena::Alloc(size_t size, size_t alignment)
+//-----------------------------------------------------------------------------
+{
+    size_t offset = AlignUp(mUsed, alignment);
+    if (offset + size > mCapacity)
+    {
+        return AllocOverflow(size, alignment);
+    }
+
+    mUsed = offset + size;
+    if (mUsed > mHighWater)
+    {
+        mHighWater = mUsed;
+    }
+
+    return mBase + offset;
+}
+
+//-----------------------------------------------------------------------------
+void* SvrLinearArena::AllocOverflow(size_t size, size_t alignment)
+//-----------------------------------------------------------------------------
+{
+    Overflow* pBlock = (Overflow*)malloc(sizeof(Overflow) + size + alignment);
+    if (pBlock == NULL)
+    {
+        LOGE("SvrLinearArena: %s arena out of memory allocating %zu bytes", mName, size);
+        return NULL;
+    }
+
+    if (mOverflowTotal == 0)
+    {
+        LOGW("SvrLinearArena: %s arena exhausted (%zu of %zu bytes used), spilling %zu bytes to the heap",
+             mName ? mName : "Uninitialized", mUsed, mCapacity, size);
+    }
+
+    pBlock->pNext = mOverflow;
+    pBlock->size = size;
+    mOverflow = pBlock;
+    mOverflowLive++;
+    mOverflowTotal++;
+    mOverflowBytes += size;
+
+    uintptr_t data = AlignUp((uintptr_t)pBlock + sizeof(Overflow), alignment);
+    return (void*)data;
+}
+
+//-----------------------------------------------------------------------------
+SvrArenaMarker SvrLinearArena::GetMarker() const
+//-----------------------------------------------------------------------------
+{
+    SvrArenaMarker marker;
+    marker.offset = mUsed;
+    marker.overflowCount = mOverflowLive;
+    return marker;
+}
+
+//-----------------------------------------------------------------------------
+void SvrLinearArena::FreeToMarker(const SvrArenaMarker& marker)
+//-----------------------------------------------------------------------------
+{
+    // Spills are pushed on the front of the list, so the newest ones come off first
+    while (mOverflowLive > marker.overflowCount)
+    {
+        Overflow* pBlock = mOverflow;
+        mOverflow = pBlock->pNext;
+        mOverflowBytes -= pBlock->size;
+        mOverflowLive--;
+        free(pBlock);
+    }
+
+    mUsed = marker.offset;
+}
+
+//-----------------------------------------------------------------------------
+void SvrLinearArena::Reset()
+//-----------------------------------------------------------------------------
+{
+    SvrArenaMarker start;
+    start.offset = 0;
+    start.overflowCount = 0;
+    FreeToMarker(start);
+}
+
+//-----------------------------------------------------------------------------
+void SvrLinearArena::GetStats(SvrArenaStats* pStats) const
+//-----------------------------------------------------------------------------
+{
+    pStats->name = mName;
+    pStats->capacity = mCapacity;
+    pStats->used = mUsed;
+    pStats->highWater = mHighWater;
+    pStats->overflowBytes = mOverflowBytes;
+    pStats->overflowCount = mOverflowTotal;
+}
+
+//-----------------------------------------------------------------------------
+static void DestroyThreadArena(void* pData)
+//-----------------------------------------------------------------------------
+{
+    delete (SvrLinearArena*)pData;
+}
+
+//-----------------------------------------------------------------------------
+static void CreateThreadArenaKey()
+//-----------------------------------------------------------------------------
+{
+    pthread_key_create(&gThreadArenaKey, DestroyThreadArena);
+}
+
+//-----------------------------------------------------------------------------
+SvrLinearArena& SvrGetThreadArena()
+//-----------------------------------------------------------------------------
+{
+    pthread_once(&gThreadArenaOnce, CreateThreadArenaKey);
+
+    SvrLinearArena* pArena = (SvrLinearArena*)pthread_getspecific(gThreadArenaKey);
+    if (pArena == NULL)
+    {
+        pArena = new SvrLinearArena();
+        pArena->Initialize("Thread", SVR_THREAD_ARENA_SIZE);
+        pthread_setspecific(gThreadArenaKey, pArena);
+    }
+    return *pArena;
+}
+
+//-----------------------------------------------------------------------------
+void SvrLogMemoryStats()
+//-----------------------------------------------------------------------------
+{
+    pthread_mutex_lock(&gTrackedArenaLock);
+    for (int i = 0; i < gNumTrackedArenas; i++)
+    {
+        // Other threads may be allocating, the numbers are a snapshot
+        SvrArenaStats stats;
+        gTrackedArenas[i]->GetStats(&stats);
+        LOGI("Arena %-8s: high water %zu KB of %zu KB reserved, %u heap spills",
+             stats.name, stats.highWater / 1024, stats.capacity / 1024, stats.overflowCount);
+    }
+    pthread_mutex_unlock(&gTrackedArenaLock);
+}
+
+}   // namespace Svr
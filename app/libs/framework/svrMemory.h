@@ -0,0 +1,121 @@
+//=============================================================================
+// FILE: svrMemory.h
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#pragma once
+
+#include <stddef.h>
+
+// Reserved address space for each thread's arena.  Pages are only committed when
+// touched, but stay committed once they have been, so this is sized for the usual
+// load rather than the largest: bigger staging (the top levels of large textures,
+// big meshes) spills to the heap for the duration of its scope.
+#define SVR_THREAD_ARENA_SIZE       (4 * 1024 * 1024)
+
+#define SVR_DEFAULT_ALIGNMENT       16
+
+namespace Svr
+{
+    struct SvrArenaMarker
+    {
+        size_t          offset;
+        unsigned int    overflowCount;
+    };
+
+    struct SvrArenaStats
+    {
+        const char*     name;
+        size_t          capacity;
+        size_t          used;
+        size_t          highWater;      // Largest in-arena usage since Initialize
+        size_t          overflowBytes;  // Bytes that spilled to the heap since the last reset
+        unsigned int    overflowCount;  // Heap spills since Initialize
+    };
+
+    // Bump allocator over one reserved range.  Allocation is a pointer increment and
+    // freeing happens all at once with Reset or back to a marker, both O(1) apart
+    // from releasing heap spills.  An allocation that does not fit spills to the heap
+    // and is released with the rest of the arena, it is counted so the reserve can
+    // be raised.  An arena must only be used by one thread at a time.
+    class SvrLinearArena
+    {
+    public:
+        SvrLinearArena();
+        ~SvrLinearArena();
+
+        bool            Initialize(const char* pName, size_t capacity);
+        void            Destroy();
+
+        void*           Alloc(size_t size, size_t alignment = SVR_DEFAULT_ALIGNMENT);
+
+        template <typename T>
+        T*              AllocArray(size_t count)
+        {
+            return (T*)Alloc(count * sizeof(T), __alignof__(T) > SVR_DEFAULT_ALIGNMENT ? __alignof__(T) : SVR_DEFAULT_ALIGNMENT);
+        }
+
+        SvrArenaMarker  GetMarker() const;
+        void            FreeToMarker(const SvrArenaMarker& marker);
+        void            Reset();
+
+        size_t          GetUsed() const { return mUsed; }
+        size_t          GetCapacity() const { return mCapacity; }
+        size_t          GetHighWater() const { return mHighWater; }
+        void            GetStats(SvrArenaStats* pStats) const;
+
+    private:
+        struct Overflow
+        {
+            Overflow*   pNext;
+            size_t      size;
+        };
+
+        SvrLinearArena(const SvrLinearArena&);
+        SvrLinearArena& operator=(const SvrLinearArena&);
+
+        void*           AllocOverflow(size_t size, size_t alignment);
+
+        const char*     mName;
+        unsigned char*  mBase;
+        size_t          mCapacity;
+        size_t          mUsed;
+        size_t          mHighWater;
+
+        Overflow*       mOverflow;
+        unsigned int    mOverflowLive;
+        unsigned int    mOverflowTotal;
+        size_t          mOverflowBytes;
+    };
+
+    // Releases everything allocated from the arena during the scope
+    class SvrArenaScope
+    {
+    public:
+        explicit SvrArenaScope(SvrLinearArena& arena)
+            : mArena(arena)
+            , mMarker(arena.GetMarker())
+        {}
+
+        ~SvrArenaScope()
+        {
+            mArena.FreeToMarker(mMarker);
+        }
+
+    private:
+        SvrArenaScope(const SvrArenaScope&);
+        SvrArenaScope& operator=(const SvrArenaScope&);
+
+        SvrLinearArena& mArena;
+        SvrArenaMarker  mMarker;
+    };
+
+    // Scratch arena private to the calling thread, created on first use and released
+    // when the thread exits.  Loaders open an SvrArenaScope on it around a load, so
+    // anything they stage is gone once the load returns.
+    SvrLinearArena& SvrGetThreadArena();
+
+    void            SvrLogMemoryStats();
+}
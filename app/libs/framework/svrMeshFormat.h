@@ -0,0 +1,104 @@
+//=============================================================================
+// FILE: svrMeshFormat.h
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#pragma once
+
+#include <stdint.h>
+
+// On disk layout of a compiled mesh, shared by the runtime (SvrGeometry) and the
+// offline converter (tools/svrmesh).  All fields are little endian.
+//
+//  SvrMeshHeader
+//  SvrMeshAttribute[numAttributes]
+//  SvrMeshSubMesh[numSubMeshes]
+//  SvrMeshLod[numSubMeshes * numLods]   sub-mesh major, version 3 and up
+//  vertex data                     interleaved, vertexStride bytes per vertex
+//  index data                      indexType, one list for all sub-meshes
+//
+// Both payloads start on a SVR_MESH_DATA_ALIGN boundary and are in the layout GL
+// takes them, so loading is a matter of handing them to glBufferData.  Sub-mesh
+// indices address the shared vertex buffer directly, GLES 3.0 has no base vertex.
+//
+// Attributes may be stored quantized (see svrmesh -p/-n/-t):
+//  position    GL_FLOAT, or GL_HALF_FLOAT / normalized GL_SHORT of the position
+//              remapped into [-1, 1] over the bounds.  The vertex shader undoes it
+//              with position * positionScale + positionBias.
+//  normal      GL_FLOAT, or 2 normalized GL_SHORTs holding an octahedral encoding
+//  texcoord    GL_FLOAT, GL_HALF_FLOAT or normalized GL_UNSIGNED_SHORT
+// SVR_MESH_GLSL_DECODE (svrGeometry.h) has the matching shader side.
+//
+// Each sub-mesh has numLods levels of detail (svrmesh -l), all indexing the same
+// vertices.  Level 0 is the sub-mesh's own range, coarser levels follow it in the
+// index data.  A sub-mesh that could not be simplified as far repeats its last level.
+//
+// Version 1 files end the header at boundsMax and are never quantized, version 2
+// files end it at positionBias and have a single level.
+
+#define SVR_MESH_MAGIC              0x4D525653      // "SVRM"
+#define SVR_MESH_VERSION            3
+#define SVR_MESH_HEADER_SIZE_V1     88
+#define SVR_MESH_HEADER_SIZE_V2     112
+#define SVR_MESH_DATA_ALIGN         16
+#define SVR_MESH_MAX_ATTRIBUTES     8
+#define SVR_MESH_NAME_LENGTH        32
+#define SVR_MESH_MAX_LODS           8
+
+namespace Svr
+{
+    struct SvrMeshHeader
+    {
+        uint32_t    magic;
+        uint32_t    version;
+        uint32_t    numAttributes;
+        uint32_t    numSubMeshes;
+        uint32_t    numVertices;
+        uint32_t    vertexStride;
+        uint32_t    numIndices;
+        uint32_t    indexType;          // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+        uint64_t    vertexDataOffset;
+        uint64_t    vertexDataSize;
+        uint64_t    indexDataOffset;
+        uint64_t    indexDataSize;
+        float       boundsMin[3];
+        float       boundsMax[3];
+        float       positionScale[3];   // Dequantization, 1 for float positions
+        float       positionBias[3];    // 0 for float positions
+        uint32_t    numLods;            // Levels per sub-mesh, at least 1
+        uint32_t    reserved;
+    };
+
+    // One vertex attribute, the arguments of glVertexAttribPointer
+    struct SvrMeshAttribute
+    {
+        uint32_t    location;           // SvrAttributeLocation
+        uint32_t    size;
+        uint32_t    type;
+        uint32_t    normalized;
+        uint32_t    offset;
+    };
+
+    struct SvrMeshSubMesh
+    {
+        uint32_t    firstIndex;
+        uint32_t    numIndices;
+        float       boundsMin[3];
+        float       boundsMax[3];
+        char        name[SVR_MESH_NAME_LENGTH];     // NUL terminated, may be empty
+    };
+
+    struct SvrMeshLod
+    {
+        uint32_t    firstIndex;
+        uint32_t    numIndices;
+        float       error;              // Largest displacement from level 0, in position units
+    };
+
+    typedef int SVR_MESH_HEADER_SIZE_ASSERT[sizeof(SvrMeshHeader) == 120];
+    typedef int SVR_MESH_ATTRIBUTE_SIZE_ASSERT[sizeof(SvrMeshAttribute) == 20];
+    typedef int SVR_MESH_SUBMESH_SIZE_ASSERT[sizeof(SvrMeshSubMesh) == 64];
+    typedef int SVR_MESH_LOD_SIZE_ASSERT[sizeof(SvrMeshLod) == 12];
+}
@@ -0,0 +1,446 @@
+//=============================================================================
+// FILE: svrMeshOptimizer.cpp
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "svrMeshOptimizer.h"
+
+// LRU cache the Forsyth scores model, larger than the FIFO analyzed so the order
+// holds up across GPUs
+#define FORSYTH_CACHE_SIZE          32
+#define FORSYTH_MAX_VALENCE         32
+#define FORSYTH_CACHE_DECAY         1.5f
+#define FORSYTH_LAST_TRIANGLE_SCORE 0.75f
+#define FORSYTH_VALENCE_SCALE       2.0f
+#define FORSYTH_VALENCE_POWER       0.5f
+
+namespace Svr
+{
+
+struct ForsythScores
+{
+    float   cache[FORSYTH_CACHE_SIZE];
+    float   valence[FORSYTH_MAX_VALENCE + 1];
+
+    ForsythScores()
+    {
+        // The three vertices of the last triangle score the same so its neighbours
+        // are taken in any rotation
+        for (int i = 0; i < FORSYTH_CACHE_SIZE; i++)
+        {
+            cache[i] = (i < 3) ? FORSYTH_LAST_TRIANGLE_SCORE :
+                       powf(1.0f - (float)(i - 3) / (FORSYTH_CACHE_SIZE - 3), FORSYTH_CACHE_DECAY);
+        }
+
+        // Vertices with few triangles left are finished off first, or they linger
+        valence[0] = 0.0f;
+        for (int i = 1; i <= FORSYTH_MAX_VALENCE; i++)
+        {
+            valence[i] = FORSYTH_VALENCE_SCALE * powf((float)i, -FORSYTH_VALENCE_POWER);
+        }
+    }
+};
+
+//-----------------------------------------------------------------------------
+static inline float L_VertexScore(const ForsythScores& scores, int cachePosition, uint32_t liveTriangles)
+//-----------------------------------------------------------------------------
+{
+    if (liveTriangles == 0)
+    {
+        return -1.0f;
+    }
+
+    float score = (cachePosition >= 0) ? scores.cache[cachePosition] : 0.0f;
+    return score + scores.valence[std::min(liveTriangles, (uint32_t)FORSYTH_MAX_VALENCE)];
+}
+
+//-----------------------------------------------------------------------------
+static void L_BuildAdjacency(const uint32_t* pIndices, size_t numIndices, size_t numVertices,
+                             std::vector<uint32_t>& offsets, std::vector<uint32_t>& triangles)
+//-----------------------------------------------------------------------------
+{
+    offsets.assign(numVertices + 1, 0);
+    for (size_t i = 0; i < numIndices; i++)
+    {
+        offsets[pIndices[i] + 1]++;
+    }
+    for (size_t v = 0; v < numVertices; v++)
+    {
+        offsets[v + 1] += offsets[v];
+    }
+
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    triangles.resize(numIndices);
+    for (size_t i = 0; i < numIndices; i++)
+    {
+        triangles[fill[pIndices[i]]++] = (uint32_t)(i / 3);
+    }
+}
+
+//-----------------------------------------------------------------------------
+SvrVertexCacheStats SvrAnalyzeVertexCache(const uint32_t* pIndices, size_t numIndices, size_t numVertices, uint32_t cacheSize)
+//-----------------------------------------------------------------------------
+{
+    SvrVertexCacheStats stats;
+    memset(&stats, 0, sizeof(stats));
+    if (numIndices < 3)
+    {
+        return stats;
+    }
+
+    // A vertex is cached while fewer than cacheSize misses have happened since its own
+    std::vector<uint32_t> missTime(numVertices, 0);
+    std::vector<bool> referenced(numVertices, false);
+    uint32_t time = cacheSize + 1;
+    uint32_t numReferenced = 0;
+
+    for (size_t i = 0; i < numIndices; i++)
+    {
+        uint32_t v = pIndices[i];
+        if (time - missTime[v] > cacheSize)
+        {
+            missTime[v] = time++;
+            stats.numTransformed++;
+        }
+        if (!referenced[v])
+        {
+            referenced[v] = true;
+            numReferenced++;
+        }
+    }
+
+    stats.acmr = (float)stats.numTransformed / (float)(numIndices / 3);
+    stats.atvr = (float)stats.numTransformed / (float)numReferenced;
+    return stats;
+}
+
+//-----------------------------------------------------------------------------
+void SvrOptimizeVertexCache(uint32_t* pDest, const uint32_t* pIndices, size_t numIndices, size_t numVertices)
+//-----------------------------------------------------------------------------
+{
+    static const ForsythScores scores;
+
+    size_t numTriangles = numIndices / 3;
+    if (numTriangles == 0)
+    {
+        return;
+    }
+
+    std::vector<uint32_t> source(pIndices, pIndices + numTriangles * 3);
+
+    // Triangles of each vertex, the first liveTriangles[v] of them not yet emitted
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> adjacency;
+    L_BuildAdjacency(&source[0], source.size(), numVertices, offsets, adjacency);
+
+    std::vector<uint32_t> liveTriangles(numVertices);
+    std::vector<int> cachePosition(numVertices, -1);
+    std::vector<float> vertexScore(numVertices);
+    for (size_t v = 0; v < numVertices; v++)
+    {
+        liveTriangles[v] = offsets[v + 1] - offsets[v];
+        vertexScore[v] = L_VertexScore(scores, -1, liveTriangles[v]);
+    }
+
+    std::vector<float> triangleScore(numTriangles);
+    std::vector<bool> emitted(numTriangles, false);
+    size_t best = 0;
+    for (size_t t = 0; t < numTriangles; t++)
+    {
+        const uint32_t* pTri = &source[t * 3];
+        triangleScore[t] = vertexScore[pTri[0]] + vertexScore[pTri[1]] + vertexScore[pTri[2]];
+        if (triangleScore[t] > triangleScore[best])
+        {
+            best = t;
+        }
+    }
+
+    uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+    uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+    int cacheCount = 0;
+    size_t cursor = 0;
+
+    for (size_t output = 0; output < numTriangles; output++)
+    {
+        if (best == (size_t)-1)
+        {
+            // Nothing in the cache connects to what is left, start over anywhere
+            while (emitted[cursor])
+            {
+                cursor++;
+            }
+            best = cursor;
+        }
+
+        const uint32_t* pTri = &source[best * 3];
+        emitted[best] = true;
+        pDest[output * 3 + 0] = pTri[0];
+        pDest[output * 3 + 1] = pTri[1];
+        pDest[output * 3 + 2] = pTri[2];
+
+        // Take the triangle out of its vertices' live lists
+        for (int c = 0; c < 3; c++)
+        {
+            uint32_t v = pTri[c];
+            uint32_t* pList = &adjacency[offsets[v]];
+            for (uint32_t i = 0; i < liveTriangles[v]; i++)
+            {
+                if (pList[i] == best)
+                {
+                    std::swap(pList[i], pList[liveTriangles[v] - 1]);
+                    liveTriangles[v]--;
+                    break;
+                }
+            }
+        }
+
+        // Its vertices move to the front of the LRU
+        int newCount = 0;
+        for (int c = 0; c < 3; c++)
+        {
+            if (std::find(newCache, newCache + newCount, pTri[c]) == newCache + newCount)
+            {
+                newCache[newCount++] = pTri[c];
+            }
+        }
+        for (int i = 0; i < cacheCount; i++)
+        {
+            if (cache[i] != pTri[0] && cache[i] != pTri[1] && cache[i] != pTri[2])
+            {
+                newCache[newCount++] = cache[i];
+            }
+        }
+
+        // Only triangles around vertices whose position changed need a new score
+        float bestScore = -1.0f;
+        best = (size_t)-1;
+        for (int i = 0; i < newCount; i++)
+        {
+            uint32_t v = newCache[i];
+            cachePosition[v] = (i < FORSYTH_CACHE_SIZE) ? i : -1;
+            vertexScore[v] = L_VertexScore(scores, cachePosition[v], liveTriangles[v]);
+        }
+        for (int i = 0; i < newCount; i++)
+        {
+            uint32_t v = newCache[i];
+            const uint32_t* pList = &adjacency[offsets[v]];
+            for (uint32_t j = 0; j < liveTriangles[v]; j++)
+            {
+                uint32_t t = pList[j];
+                const uint32_t* pOther = &source[t * 3];
+                triangleScore[t] = vertexScore[pOther[0]] + vertexScore[pOther[1]] + vertexScore[pOther[2]];
+                if (triangleScore[t] > bestScore)
+                {
+                    bestScore = triangleScore[t];
+                    best = t;
+                }
+            }
+        }
+
+        cacheCount = std::min(newCount, FORSYTH_CACHE_SIZE);
+        memcpy(cache, newCache, cacheCount * sizeof(uint32_t));
+    }
+}
+
+struct OverdrawCluster
+{
+    uint32_t    firstTriangle;
+    uint32_t    numTriangles;
+    float       sortKey;
+};
+
+//-----------------------------------------------------------------------------
+static bool L_CompareClusters(const OverdrawCluster& a, const OverdrawCluster& b)
+//-----------------------------------------------------------------------------
+{
+    return a.sortKey > b.sortKey;
+}
+
+//-----------------------------------------------------------------------------
+static uint32_t L_CountMisses(const uint32_t* pTri, std::vector<uint32_t>& missTime, uint32_t& time)
+//-----------------------------------------------------------------------------
+{
+    uint32_t misses = 0;
+    for (int c = 0; c < 3; c++)
+    {
+        if (time - missTime[pTri[c]] > SVR_VERTEX_CACHE_SIZE)
+        {
+            missTime[pTri[c]] = time++;
+            misses++;
+        }
+    }
+    return misses;
+}
+
+//-----------------------------------------------------------------------------
+void SvrOptimizeOverdraw(uint32_t* pDest, const uint32_t* pIndices, size_t numIndices,
+                         const void* pVertices, size_t numVertices, size_t vertexStride, float threshold)
+//-----------------------------------------------------------------------------
+{
+    size_t numTriangles = numIndices / 3;
+    if (numTriangles == 0)
+    {
+        return;
+    }
+
+    // Hard boundaries: triangles that find none of their vertices in the cache
+    std::vector<uint32_t> missTime(numVertices, 0);
+    uint32_t time = SVR_VERTEX_CACHE_SIZE + 1;
+    std::vector<uint32_t> hardStarts;
+    for (size_t t = 0; t < numTriangles; t++)
+    {
+        if (L_CountMisses(pIndices + t * 3, missTime, time) == 3)
+        {
+            hardStarts.push_back((uint32_t)t);
+        }
+    }
+    if (hardStarts.empty() || hardStarts[0] != 0)
+    {
+        hardStarts.insert(hardStarts.begin(), 0);
+    }
+    hardStarts.push_back((uint32_t)numTriangles);
+
+    // Soft boundaries: wherever a piece has reached the cluster's ACMR (within the
+    // threshold) it can be cut off without costing more shading
+    std::vector<OverdrawCluster> clusters;
+    for (size_t h = 0; h + 1 < hardStarts.size(); h++)
+    {
+        uint32_t begin = hardStarts[h];
+        uint32_t end = hardStarts[h + 1];
+
+        time += SVR_VERTEX_CACHE_SIZE + 1;
+        uint32_t clusterMisses = 0;
+        for (uint32_t t = begin; t < end; t++)
+        {
+            clusterMisses += L_CountMisses(pIndices + t * 3, missTime, time);
+        }
+        float clusterThreshold = threshold * (float)clusterMisses / (float)(end - begin);
+
+        time += SVR_VERTEX_CACHE_SIZE + 1;
+        uint32_t start = begin;
+        uint32_t runningMisses = 0;
+        for (uint32_t t = begin; t < end; t++)
+        {
+            runningMisses += L_CountMisses(pIndices + t * 3, missTime, time);
+            if ((float)runningMisses <= clusterThreshold * (float)(t + 1 - start))
+            {
+                OverdrawCluster cluster = { start, t + 1 - start, 0.0f };
+                clusters.push_back(cluster);
+                start = t + 1;
+                runningMisses = 0;
+                time += SVR_VERTEX_CACHE_SIZE + 1;
+            }
+        }
+        if (start != end)
+        {
+            OverdrawCluster cluster = { start, end - start, 0.0f };
+            clusters.push_back(cluster);
+        }
+    }
+
+    // Area weighted centroid and normal of each cluster, and of the mesh
+    const unsigned char* pBytes = (const unsigned char*)pVertices;
+    std::vector<float> clusterData(clusters.size() * 6, 0.0f);
+    float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+    float meshArea = 0.0f;
+
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        float* pCentroid = &clusterData[c * 6];
+        float* pNormal = pCentroid + 3;
+        float clusterArea = 0.0f;
+
+        for (uint32_t t = clusters[c].firstTriangle; t < clusters[c].firstTriangle + clusters[c].numTriangles; t++)
+        {
+            const float* p0 = (const float*)(pBytes + pIndices[t * 3 + 0] * vertexStride);
+            const float* p1 = (const float*)(pBytes + pIndices[t * 3 + 1] * vertexStride);
+            const float* p2 = (const float*)(pBytes + pIndices[t * 3 + 2] * vertexStride);
+
+            float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+            for (int k = 0; k < 3; k++)
+            {
+                float center = (p0[k] + p1[k] + p2[k]) / 3.0f;
+                pCentroid[k] += center * area;
+                meshCentroid[k] += center * area;
+                pNormal[k] += n[k];
+            }
+            clusterArea += area;
+        }
+
+        meshArea += clusterArea;
+        float inverse = (clusterArea > 0.0f) ? 1.0f / clusterArea : 0.0f;
+        for (int k = 0; k < 3; k++)
+        {
+            pCentroid[k] *= inverse;
+        }
+    }
+
+    float inverseArea = (meshArea > 0.0f) ? 1.0f / meshArea : 0.0f;
+    for (int k = 0; k < 3; k++)
+    {
+        meshCentroid[k] *= inverseArea;
+    }
+
+    // Clusters far out along their own normal face the viewer whenever something
+    // behind them does, so they go first
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        const float* pCentroid = &clusterData[c * 6];
+        const float* pNormal = pCentroid + 3;
+        float length = sqrtf(pNormal[0] * pNormal[0] + pNormal[1] * pNormal[1] + pNormal[2] * pNormal[2]);
+        float inverse = (length > 0.0f) ? 1.0f / length : 0.0f;
+
+        clusters[c].sortKey = ((pCentroid[0] - meshCentroid[0]) * pNormal[0] +
+                               (pCentroid[1] - meshCentroid[1]) * pNormal[1] +
+                               (pCentroid[2] - meshCentroid[2]) * pNormal[2]) * inverse;
+    }
+    std::stable_sort(clusters.begin(), clusters.end(), L_CompareClusters);
+
+    uint32_t* pOut = pDest;
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        size_t count = clusters[c].numTriangles * 3;
+        memcpy(pOut, pIndices + clusters[c].firstTriangle * 3, count * sizeof(uint32_t));
+        pOut += count;
+    }
+}
+
+//-----------------------------------------------------------------------------
+size_t SvrOptimizeVertexFetch(void* pDestVertices, uint32_t* pIndices, size_t numIndices,
+                              const void* pVertices, size_t numVertices, size_t vertexStride)
+//-----------------------------------------------------------------------------
+{
+    const uint32_t kUnused = 0xFFFFFFFF;
+    std::vector<uint32_t> remap(numVertices, kUnused);
+
+    const unsigned char* pSource = (const unsigned char*)pVertices;
+    unsigned char* pDest = (unsigned char*)pDestVertices;
+    uint32_t numUsed = 0;
+
+    for (size_t i = 0; i < numIndices; i++)
+    {
+        uint32_t v = pIndices[i];
+        if (remap[v] == kUnused)
+        {
+            memcpy(pDest + (size_t)numUsed * vertexStride, pSource + (size_t)v * vertexStride, vertexStride);
+            remap[v] = numUsed++;
+        }
+        pIndices[i] = remap[v];
+    }
+
+    return numUsed;
+}
+
+}   // namespace Svr
@@ -0,0 +1,51 @@
+//=============================================================================
+// FILE: svrMeshOptimizer.h
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Post-transform cache modelled when analyzing.  Adreno and Mali keep somewhere
+// between 16 and 32 shaded vertices per bin, 16 is the pessimistic end.
+#define SVR_VERTEX_CACHE_SIZE       16
+
+// Overdraw ordering may raise ACMR by this factor at most
+#define SVR_OVERDRAW_THRESHOLD      1.05f
+
+namespace Svr
+{
+    struct SvrVertexCacheStats
+    {
+        uint32_t    numTransformed;     // Cache misses, i.e. vertex shader invocations
+        float       acmr;               // Transformed per triangle, 0.5 is ideal for large grids, 3 is worst
+        float       atvr;               // Transformed per referenced vertex, 1 is ideal
+    };
+
+    // Simulates a FIFO post-transform cache over a triangle list
+    SvrVertexCacheStats SvrAnalyzeVertexCache(const uint32_t* pIndices, size_t numIndices, size_t numVertices,
+                                              uint32_t cacheSize = SVR_VERTEX_CACHE_SIZE);
+
+    // Reorders triangles for post-transform cache hits (Forsyth, "Linear-Speed Vertex
+    // Cache Optimisation").  pDest may equal pIndices.
+    void    SvrOptimizeVertexCache(uint32_t* pDest, const uint32_t* pIndices, size_t numIndices, size_t numVertices);
+
+    // Reorders clusters of a cache optimized list so outward facing ones come first,
+    // which lets early depth rejection skip more of the rest.  Clusters are cut where
+    // the cache is cold anyway, and where ACMR stays within threshold of the whole
+    // cluster's.  Positions are 3 floats at the start of each vertex.  pDest may not
+    // equal pIndices.
+    void    SvrOptimizeOverdraw(uint32_t* pDest, const uint32_t* pIndices, size_t numIndices,
+                                const void* pVertices, size_t numVertices, size_t vertexStride,
+                                float threshold = SVR_OVERDRAW_THRESHOLD);
+
+    // Renumbers vertices in order of first use so fetches walk memory forwards, and
+    // drops vertices no triangle uses.  Indices are rewritten in place, pDestVertices
+    // must not overlap pVertices.  Returns the number of vertices left.
+    size_t  SvrOptimizeVertexFetch(void* pDestVertices, uint32_t* pIndices, size_t numIndices,
+                                   const void* pVertices, size_t numVertices, size_t vertexStride);
+}
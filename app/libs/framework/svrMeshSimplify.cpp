@@ -0,0 +1,770 @@
+//=============================================================================
+// FILE: svrMeshSimplify.cpp
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "svrMeshOptimizer.h"
+#include "svrMeshSimplify.h"
+
+#define SIMPLIFY_MAX_ATTRIBUTES     8
+
+// Planes through border edges count this much more than a face of the same size,
+// which keeps open boundaries from shrinking
+#define SIMPLIFY_BORDER_WEIGHT      10.0f
+
+// Collapses that turn a remaining triangle by more than about 75 degrees are refused
+#define SIMPLIFY_MIN_NORMAL_DOT     0.25f
+
+#define SIMPLIFY_NONE               0xFFFFFFFFu
+#define SIMPLIFY_MANY               0xFFFFFFFEu
+
+namespace Svr
+{
+
+enum SimplifyVertexKind
+{
+    kVertexManifold,        // Interior, one set of attributes
+    kVertexBorder,          // On an open boundary, moves along it only
+    kVertexSeam,            // Two sets of attributes, both move along the seam together
+    kVertexLocked
+};
+
+// Sum of squared distances to planes, pAp + 2bp + c, over total weight w
+struct Quadric
+{
+    float   a00, a11, a22, a01, a02, a12;
+    float   b0, b1, b2;
+    float   c;
+    float   w;
+};
+
+// Squared deviation of one attribute from the linear fit over each face around it,
+// which is the position quadric of the fit plus the terms of the attribute value
+struct AttributeQuadric
+{
+    Quadric q;
+    float   g0, g1, g2;
+    float   d;
+};
+
+struct CollapseCandidate
+{
+    uint32_t    vertex;
+    uint32_t    target;
+    uint32_t    seamTarget;     // Target of the vertex's seam twin, SIMPLIFY_NONE otherwise
+    float       cost;
+};
+
+struct PositionKey
+{
+    uint32_t    bits[3];
+    bool operator==(const PositionKey& other) const
+    {
+        return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2];
+    }
+};
+
+struct PositionKeyHash
+{
+    size_t operator()(const PositionKey& key) const
+    {
+        return (size_t)key.bits[0] * 73856093u ^ (size_t)key.bits[1] * 19349663u ^ (size_t)key.bits[2] * 83492791u;
+    }
+};
+
+struct SimplifyMesh
+{
+    size_t                          numVertices;
+    int                             numAttributes;
+    std::vector<float>              positions;      // Normalized to the unit cube
+    std::vector<float>              attributes;     // Weighted
+    std::vector<uint32_t>           positionIds;    // First vertex at the same position
+    std::vector<uint32_t>           wedges;         // Next vertex at the same position, circular
+    std::vector<Quadric>            quadrics;       // Per position id
+    std::vector<AttributeQuadric>   attributeQuadrics;
+
+    std::vector<uint32_t>           offsets;        // Triangles around each vertex
+    std::vector<uint32_t>           triangles;
+    std::vector<uint32_t>           openOut;        // Vertex across the one open edge leaving it
+    std::vector<uint32_t>           openIn;
+    std::vector<uint8_t>            kinds;
+};
+
+//-----------------------------------------------------------------------------
+static inline void L_Cross(float* pResult, const float* a, const float* b)
+//-----------------------------------------------------------------------------
+{
+    pResult[0] = a[1] * b[2] - a[2] * b[1];
+    pResult[1] = a[2] * b[0] - a[0] * b[2];
+    pResult[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+//-----------------------------------------------------------------------------
+static inline float L_Dot(const float* a, const float* b)
+//-----------------------------------------------------------------------------
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+//-----------------------------------------------------------------------------
+static void L_AddQuadric(Quadric& q, const Quadric& other)
+//-----------------------------------------------------------------------------
+{
+    q.a00 += other.a00;
+    q.a11 += other.a11;
+    q.a22 += other.a22;
+    q.a01 += other.a01;
+    q.a02 += other.a02;
+    q.a12 += other.a12;
+    q.b0 += other.b0;
+    q.b1 += other.b1;
+    q.b2 += other.b2;
+    q.c += other.c;
+    q.w += other.w;
+}
+
+//-----------------------------------------------------------------------------
+static void L_AddPlane(Quadric& q, const float* n, float d, float w)
+//-----------------------------------------------------------------------------
+{
+    q.a00 += w * n[0] * n[0];
+    q.a11 += w * n[1] * n[1];
+    q.a22 += w * n[2] * n[2];
+    q.a01 += w * n[0] * n[1];
+    q.a02 += w * n[0] * n[2];
+    q.a12 += w * n[1] * n[2];
+    q.b0 += w * n[0] * d;
+    q.b1 += w * n[1] * d;
+    q.b2 += w * n[2] * d;
+    q.c += w * d * d;
+    q.w += w;
+}
+
+//-----------------------------------------------------------------------------
+static inline float L_QuadricError(const Quadric& q, const float* p)
+//-----------------------------------------------------------------------------
+{
+    float rx = q.a00 * p[0] + q.a01 * p[1] + q.a02 * p[2];
+    float ry = q.a01 * p[0] + q.a11 * p[1] + q.a12 * p[2];
+    float rz = q.a02 * p[0] + q.a12 * p[1] + q.a22 * p[2];
+    return rx * p[0] + ry * p[1] + rz * p[2] + 2.0f * (q.b0 * p[0] + q.b1 * p[1] + q.b2 * p[2]) + q.c;
+}
+
+//-----------------------------------------------------------------------------
+static inline float L_AttributeError(const AttributeQuadric& aq, const float* p, float value)
+//-----------------------------------------------------------------------------
+{
+    float fit = aq.g0 * p[0] + aq.g1 * p[1] + aq.g2 * p[2] + aq.d;
+    return L_QuadricError(aq.q, p) - 2.0f * value * fit + value * value * aq.q.w;
+}
+
+//-----------------------------------------------------------------------------
+static void L_AddAttributeQuadrics(SimplifyMesh& mesh, const uint32_t* pTri, float weight)
+//-----------------------------------------------------------------------------
+{
+    const float* p0 = &mesh.positions[3 * pTri[0]];
+    const float* p1 = &mesh.positions[3 * pTri[1]];
+    const float* p2 = &mesh.positions[3 * pTri[2]];
+    float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+    float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+
+    float d11 = L_Dot(e1, e1);
+    float d12 = L_Dot(e1, e2);
+    float d22 = L_Dot(e2, e2);
+    float det = d11 * d22 - d12 * d12;
+    if (!(det > 0.0f))
+    {
+        return;
+    }
+
+    int numAttributes = mesh.numAttributes;
+    for (int k = 0; k < numAttributes; k++)
+    {
+        // Gradient in the plane of the face, g.p + d reproduces the attribute at the corners
+        float s0 = mesh.attributes[pTri[0] * numAttributes + k];
+        float delta1 = mesh.attributes[pTri[1] * numAttributes + k] - s0;
+        float delta2 = mesh.attributes[pTri[2] * numAttributes + k] - s0;
+        float alpha = (d22 * delta1 - d12 * delta2) / det;
+        float beta = (d11 * delta2 - d12 * delta1) / det;
+        float g[3] = { alpha * e1[0] + beta * e2[0], alpha * e1[1] + beta * e2[1], alpha * e1[2] + beta * e2[2] };
+        float d = s0 - L_Dot(g, p0);
+
+        for (int c = 0; c < 3; c++)
+        {
+            AttributeQuadric& aq = mesh.attributeQuadrics[pTri[c] * numAttributes + k];
+            L_AddPlane(aq.q, g, d, weight);
+            aq.g0 += weight * g[0];
+            aq.g1 += weight * g[1];
+            aq.g2 += weight * g[2];
+            aq.d += weight * d;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+static void L_BuildAdjacency(SimplifyMesh& mesh, const uint32_t* pIndices, size_t numIndices)
+//-----------------------------------------------------------------------------
+{
+    mesh.offsets.assign(mesh.numVertices + 1, 0);
+    for (size_t i = 0; i < numIndices; i++)
+    {
+        mesh.offsets[pIndices[i] + 1]++;
+    }
+    for (size_t v = 0; v < mesh.numVertices; v++)
+    {
+        mesh.offsets[v + 1] += mesh.offsets[v];
+    }
+
+    std::vector<uint32_t> fill(mesh.offsets.begin(), mesh.offsets.end() - 1);
+    mesh.triangles.resize(numIndices);
+    for (size_t i = 0; i < numIndices; i++)
+    {
+        mesh.triangles[fill[pIndices[i]]++] = (uint32_t)(i / 3);
+    }
+}
+
+//-----------------------------------------------------------------------------
+static bool L_HasEdge(const SimplifyMesh& mesh, const uint32_t* pIndices, uint32_t a, uint32_t b)
+//-----------------------------------------------------------------------------
+{
+    for (uint32_t i = mesh.offsets[a]; i < mesh.offsets[a + 1]; i++)
+    {
+        const uint32_t* pTri = pIndices + 3 * mesh.triangles[i];
+        if ((pTri[0] == a && pTri[1] == b) || (pTri[1] == a && pTri[2] == b) || (pTri[2] == a && pTri[0] == b))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+static bool L_HasPositionEdge(const SimplifyMesh& mesh, const uint32_t* pIndices, uint32_t a, uint32_t b)
+//-----------------------------------------------------------------------------
+{
+    // Any vertex at a's position to any vertex at b's
+    uint32_t positionB = mesh.positionIds[b];
+    uint32_t wedge = a;
+    do
+    {
+        for (uint32_t i = mesh.offsets[wedge]; i < mesh.offsets[wedge + 1]; i++)
+        {
+            const uint32_t* pTri = pIndices + 3 * mesh.triangles[i];
+            for (int c = 0; c < 3; c++)
+            {
+                if (pTri[c] == wedge && mesh.positionIds[pTri[(c + 1) % 3]] == positionB)
+                {
+                    return true;
+                }
+            }
+        }
+        wedge = mesh.wedges[wedge];
+    } while (wedge != a);
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+static void L_ClassifyVertices(SimplifyMesh& mesh, const uint32_t* pIndices, size_t numIndices, bool addBorderPlanes)
+//-----------------------------------------------------------------------------
+{
+    mesh.openOut.assign(mesh.numVertices, SIMPLIFY_NONE);
+    mesh.openIn.assign(mesh.numVertices, SIMPLIFY_NONE);
+
+    for (size_t i = 0; i < numIndices; i++)
+    {
+        uint32_t a = pIndices[i];
+        uint32_t b = pIndices[i - i % 3 + (i % 3 + 1) % 3];
+        if (L_HasEdge(mesh, pIndices, b, a))
+        {
+            continue;
+        }
+
+        mesh.openOut[a] = (mesh.openOut[a] == SIMPLIFY_NONE) ? b : SIMPLIFY_MANY;
+        mesh.openIn[b] = (mesh.openIn[b] == SIMPLIFY_NONE) ? a : SIMPLIFY_MANY;
+
+        // Open in position space too, so a real border rather than an attribute seam
+        if (addBorderPlanes && !L_HasPositionEdge(mesh, pIndices, b, a))
+        {
+            const uint32_t* pTri = pIndices + i - i % 3;
+            const float* p0 = &mesh.positions[3 * pTri[0]];
+            const float* p1 = &mesh.positions[3 * pTri[1]];
+            const float* p2 = &mesh.positions[3 * pTri[2]];
+            float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            float faceNormal[3];
+            L_Cross(faceNormal, e1, e2);
+
+            const float* pa = &mesh.positions[3 * a];
+            const float* pb = &mesh.positions[3 * b];
+            float edge[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+            float n[3];
+            L_Cross(n, edge, faceNormal);
+            float length = sqrtf(L_Dot(n, n));
+            if (length > 0.0f)
+            {
+                n[0] /= length;
+                n[1] /= length;
+                n[2] /= length;
+                float weight = L_Dot(edge, edge) * SIMPLIFY_BORDER_WEIGHT;
+                L_AddPlane(mesh.quadrics[mesh.positionIds[a]], n, -L_Dot(n, pa), weight);
+                L_AddPlane(mesh.quadrics[mesh.positionIds[b]], n, -L_Dot(n, pa), weight);
+            }
+        }
+    }
+
+    mesh.kinds.resize(mesh.numVertices);
+    for (uint32_t v = 0; v < mesh.numVertices; v++)
+    {
+        uint32_t twin = mesh.wedges[v];
+        bool single = (twin == v);
+        bool closed = (mesh.openOut[v] == SIMPLIFY_NONE && mesh.openIn[v] == SIMPLIFY_NONE);
+        bool simpleOpen = (mesh.openOut[v] < SIMPLIFY_MANY && mesh.openIn[v] < SIMPLIFY_MANY);
+
+        if (single)
+        {
+            mesh.kinds[v] = closed ? kVertexManifold : (simpleOpen ? kVertexBorder : kVertexLocked);
+        }
+        else if (mesh.wedges[twin] == v && simpleOpen &&
+                 mesh.openOut[twin] < SIMPLIFY_MANY && mesh.openIn[twin] < SIMPLIFY_MANY &&
+                 L_HasPositionEdge(mesh, pIndices, mesh.openOut[v], v) &&
+                 L_HasPositionEdge(mesh, pIndices, v, mesh.openIn[v]))
+        {
+            mesh.kinds[v] = kVertexSeam;
+        }
+        else
+        {
+            mesh.kinds[v] = kVertexLocked;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+static bool L_HasFlips(const SimplifyMesh& mesh, const uint32_t* pIndices, uint32_t vertex, uint32_t target)
+//-----------------------------------------------------------------------------
+{
+    const float* pTarget = &mesh.positions[3 * target];
+    const float* pVertex = &mesh.positions[3 * vertex];
+    uint32_t targetPosition = mesh.positionIds[target];
+
+    for (uint32_t i = mesh.offsets[vertex]; i < mesh.offsets[vertex + 1]; i++)
+    {
+        const uint32_t* pTri = pIndices + 3 * mesh.triangles[i];
+        if (mesh.positionIds[pTri[0]] == targetPosition || mesh.positionIds[pTri[1]] == targetPosition ||
+            mesh.positionIds[pTri[2]] == targetPosition)
+        {
+            // Collapses away
+            continue;
+        }
+
+        int c = (pTri[0] == vertex) ? 0 : (pTri[1] == vertex ? 1 : 2);
+        const float* p1 = &mesh.positions[3 * pTri[(c + 1) % 3]];
+        const float* p2 = &mesh.positions[3 * pTri[(c + 2) % 3]];
+
+        float e1[3] = { p1[0] - pVertex[0], p1[1] - pVertex[1], p1[2] - pVertex[2] };
+        float e2[3] = { p2[0] - pVertex[0], p2[1] - pVertex[1], p2[2] - pVertex[2] };
+        float f1[3] = { p1[0] - pTarget[0], p1[1] - pTarget[1], p1[2] - pTarget[2] };
+        float f2[3] = { p2[0] - pTarget[0], p2[1] - pTarget[1], p2[2] - pTarget[2] };
+        float before[3];
+        float after[3];
+        L_Cross(before, e1, e2);
+        L_Cross(after, f1, f2);
+
+        float dot = L_Dot(before, after);
+        if (dot <= 0.0f || dot * dot < SIMPLIFY_MIN_NORMAL_DOT * SIMPLIFY_MIN_NORMAL_DOT * L_Dot(before, before) * L_Dot(after, after))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+static float L_CollapseCost(const SimplifyMesh& mesh, uint32_t vertex, uint32_t target, uint32_t twin, uint32_t twinTarget)
+//-----------------------------------------------------------------------------
+{
+    const Quadric& q = mesh.quadrics[mesh.positionIds[vertex]];
+    const float* p = &mesh.positions[3 * target];
+    float error = L_QuadricError(q, p);
+
+    int numAttributes = mesh.numAttributes;
+    for (int k = 0; k < numAttributes; k++)
+    {
+        error += L_AttributeError(mesh.attributeQuadrics[vertex * numAttributes + k], p, mesh.attributes[target * numAttributes + k]);
+        if (twin != SIMPLIFY_NONE)
+        {
+            error += L_AttributeError(mesh.attributeQuadrics[twin * numAttributes + k], p, mesh.attributes[twinTarget * numAttributes + k]);
+        }
+    }
+
+    return std::max(error, 0.0f) / std::max(q.w, FLT_MIN);
+}
+
+//-----------------------------------------------------------------------------
+static void L_AddCandidate(const SimplifyMesh& mesh, uint32_t vertex, uint32_t target, std::vector<CollapseCandidate>& candidates)
+//-----------------------------------------------------------------------------
+{
+    uint8_t kind = mesh.kinds[vertex];
+    if (kind == kVertexLocked || mesh.positionIds[vertex] == mesh.positionIds[target])
+    {
+        return;
+    }
+
+    uint32_t twin = SIMPLIFY_NONE;
+    uint32_t twinTarget = SIMPLIFY_NONE;
+    if (kind == kVertexBorder || kind == kVertexSeam)
+    {
+        if (target != mesh.openOut[vertex] && target != mesh.openIn[vertex])
+        {
+            return;
+        }
+    }
+    if (kind == kVertexSeam)
+    {
+        // The other side of the seam follows onto the vertex of its own at the target
+        twin = mesh.wedges[vertex];
+        uint32_t targetPosition = mesh.positionIds[target];
+        if (mesh.positionIds[mesh.openOut[twin]] == targetPosition)
+            twinTarget = mesh.openOut[twin];
+        else if (mesh.positionIds[mesh.openIn[twin]] == targetPosition)
+            twinTarget = mesh.openIn[twin];
+        else
+            return;
+    }
+
+    CollapseCandidate candidate = { vertex, target, twinTarget, L_CollapseCost(mesh, vertex, target, twin, twinTarget) };
+    candidates.push_back(candidate);
+}
+
+//-----------------------------------------------------------------------------
+static bool L_CompareCandidates(const CollapseCandidate& a, const CollapseCandidate& b)
+//-----------------------------------------------------------------------------
+{
+    return a.cost < b.cost;
+}
+
+//-----------------------------------------------------------------------------
+static uint32_t L_LockRing(const SimplifyMesh& mesh, const uint32_t* pIndices, uint32_t vertex, uint32_t target,
+                           std::vector<uint8_t>& locked)
+//-----------------------------------------------------------------------------
+{
+    // Nothing around the vertex may change again this pass, which keeps the flip
+    // checks of later collapses valid.  Returns the triangles the collapse removes.
+    uint32_t targetPosition = mesh.positionIds[target];
+    uint32_t removed = 0;
+    for (uint32_t i = mesh.offsets[vertex]; i < mesh.offsets[vertex + 1]; i++)
+    {
+        const uint32_t* pTri = pIndices + 3 * mesh.triangles[i];
+        bool collapses = false;
+        for (int c = 0; c < 3; c++)
+        {
+            locked[mesh.positionIds[pTri[c]]] = 1;
+            collapses |= (mesh.positionIds[pTri[c]] == targetPosition);
+        }
+        removed += collapses ? 1 : 0;
+    }
+    return removed;
+}
+
+//-----------------------------------------------------------------------------
+size_t SvrSimplifyMesh(uint32_t* pDest, const uint32_t* pIndices, size_t numIndices,
+                       const void* pVertices, size_t vertexStride,
+                       const float* pAttributeWeights, int numAttributes,
+                       size_t targetIndexCount, float targetError, float* pResultError)
+//-----------------------------------------------------------------------------
+{
+    numIndices -= numIndices % 3;
+    numAttributes = std::max(0, std::min(numAttributes, SIMPLIFY_MAX_ATTRIBUTES));
+    if (pResultError != NULL)
+    {
+        *pResultError = 0.0f;
+    }
+
+    // Work on the vertices the list uses, numbered locally, so a sub-mesh of a large
+    // shared buffer costs no more than its own size
+    std::vector<uint32_t> indices(numIndices);
+    std::vector<uint32_t> globalIds;
+    {
+        std::unordered_map<uint32_t, uint32_t> localIds;
+        localIds.reserve(numIndices / 2);
+        for (size_t i = 0; i < numIndices; i++)
+        {
+            std::pair<std::unordered_map<uint32_t, uint32_t>::iterator, bool> inserted =
+                localIds.insert(std::make_pair(pIndices[i], (uint32_t)globalIds.size()));
+            if (inserted.second)
+            {
+                globalIds.push_back(pIndices[i]);
+            }
+            indices[i] = inserted.first->second;
+        }
+    }
+
+    SimplifyMesh mesh;
+    mesh.numVertices = globalIds.size();
+    mesh.numAttributes = numAttributes;
+    mesh.positions.resize(3 * mesh.numVertices);
+    mesh.attributes.resize(numAttributes * mesh.numVertices);
+    mesh.positionIds.resize(mesh.numVertices);
+    mesh.wedges.resize(mesh.numVertices);
+
+    float boundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float boundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    std::unordered_map<PositionKey, uint32_t, PositionKeyHash> positionMap;
+    positionMap.reserve(mesh.numVertices);
+    for (uint32_t v = 0; v < mesh.numVertices; v++)
+    {
+        const float* pVertex = (const float*)((const unsigned char*)pVertices + globalIds[v] * vertexStride);
+        PositionKey key;
+        memcpy(key.bits, pVertex, sizeof(key.bits));
+        for (int c = 0; c < 3; c++)
+        {
+            mesh.positions[3 * v + c] = pVertex[c];
+            boundsMin[c] = std::min(boundsMin[c], pVertex[c]);
+            boundsMax[c] = std::max(boundsMax[c], pVertex[c]);
+        }
+        for (int k = 0; k < numAttributes; k++)
+        {
+            mesh.attributes[v * numAttributes + k] = pVertex[3 + k] * pAttributeWeights[k];
+        }
+
+        uint32_t first = positionMap.insert(std::make_pair(key, v)).first->second;
+        mesh.positionIds[v] = first;
+        mesh.wedges[v] = mesh.wedges[first];
+        mesh.wedges[first] = v;
+    }
+
+    // Errors are measured in a unit cube, so weights mean the same on any mesh
+    float extent = std::max(boundsMax[0] - boundsMin[0], std::max(boundsMax[1] - boundsMin[1], boundsMax[2] - boundsMin[2]));
+    extent = (extent > 0.0f) ? extent : 1.0f;
+    for (uint32_t v = 0; v < mesh.numVertices; v++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            mesh.positions[3 * v + c] = (mesh.positions[3 * v + c] - boundsMin[c]) / extent;
+        }
+    }
+
+    Quadric zeroQuadric;
+    memset(&zeroQuadric, 0, sizeof(zeroQuadric));
+    AttributeQuadric zeroAttributeQuadric;
+    memset(&zeroAttributeQuadric, 0, sizeof(zeroAttributeQuadric));
+    mesh.quadrics.assign(mesh.numVertices, zeroQuadric);
+    mesh.attributeQuadrics.assign(mesh.numVertices * numAttributes, zeroAttributeQuadric);
+
+    for (size_t i = 0; i < numIndices; i += 3)
+    {
+        const uint32_t* pTri = &indices[i];
+        const float* p0 = &mesh.positions[3 * pTri[0]];
+        const float* p1 = &mesh.positions[3 * pTri[1]];
+        const float* p2 = &mesh.positions[3 * pTri[2]];
+        float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        float n[3];
+        L_Cross(n, e1, e2);
+        float length = sqrtf(L_Dot(n, n));
+        if (length == 0.0f)
+        {
+            continue;
+        }
+
+        // Area weighted, so large faces resist moving more than slivers
+        float area = 0.5f * length;
+        n[0] /= length;
+        n[1] /= length;
+        n[2] /= length;
+        float d = -L_Dot(n, p0);
+        for (int c = 0; c < 3; c++)
+        {
+            L_AddPlane(mesh.quadrics[mesh.positionIds[pTri[c]]], n, d, area);
+        }
+        L_AddAttributeQuadrics(mesh, pTri, area);
+    }
+
+    std::vector<uint32_t> remap(mesh.numVertices);
+    std::vector<uint8_t> locked(mesh.numVertices);
+    std::vector<CollapseCandidate> candidates;
+    float errorLimit = (targetError < FLT_MAX) ? (targetError / extent) * (targetError / extent) : FLT_MAX;
+    float largestCost = 0.0f;
+
+    size_t count = numIndices;
+    bool firstPass = true;
+    while (count > targetIndexCount)
+    {
+        L_BuildAdjacency(mesh, &indices[0], count);
+        L_ClassifyVertices(mesh, &indices[0], count, firstPass);
+        firstPass = false;
+
+        candidates.clear();
+        for (size_t i = 0; i < count; i += 3)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                uint32_t a = indices[i + c];
+                uint32_t b = indices[i + (c + 1) % 3];
+                L_AddCandidate(mesh, a, b, candidates);
+                L_AddCandidate(mesh, b, a, candidates);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), L_CompareCandidates);
+
+        for (uint32_t v = 0; v < mesh.numVertices; v++)
+        {
+            remap[v] = v;
+        }
+        std::fill(locked.begin(), locked.end(), 0);
+
+        size_t trianglesToRemove = (count - targetIndexCount) / 3;
+        size_t trianglesRemoved = 0;
+        size_t numCollapses = 0;
+        for (size_t i = 0; i < candidates.size() && trianglesRemoved < trianglesToRemove; i++)
+        {
+            const CollapseCandidate& candidate = candidates[i];
+            if (candidate.cost > errorLimit)
+            {
+                break;
+            }
+
+            uint32_t vertex = candidate.vertex;
+            uint32_t target = candidate.target;
+            uint32_t twin = (candidate.seamTarget != SIMPLIFY_NONE) ? mesh.wedges[vertex] : SIMPLIFY_NONE;
+            if (locked[mesh.positionIds[vertex]] || locked[mesh.positionIds[target]])
+            {
+                continue;
+            }
+            if (L_HasFlips(mesh, &indices[0], vertex, target) ||
+                (twin != SIMPLIFY_NONE && L_HasFlips(mesh, &indices[0], twin, candidate.seamTarget)))
+            {
+                continue;
+            }
+
+            trianglesRemoved += L_LockRing(mesh, &indices[0], vertex, target, locked);
+            remap[vertex] = target;
+            if (twin != SIMPLIFY_NONE)
+            {
+                trianglesRemoved += L_LockRing(mesh, &indices[0], twin, candidate.seamTarget, locked);
+                remap[twin] = candidate.seamTarget;
+            }
+            locked[mesh.positionIds[target]] = 1;
+
+            L_AddQuadric(mesh.quadrics[mesh.positionIds[target]], mesh.quadrics[mesh.positionIds[vertex]]);
+            for (int k = 0; k < numAttributes; k++)
+            {
+                AttributeQuadric& into = mesh.attributeQuadrics[target * numAttributes + k];
+                const AttributeQuadric& from = mesh.attributeQuadrics[vertex * numAttributes + k];
+                L_AddQuadric(into.q, from.q);
+                into.g0 += from.g0;
+                into.g1 += from.g1;
+                into.g2 += from.g2;
+                into.d += from.d;
+                if (twin != SIMPLIFY_NONE)
+                {
+                    AttributeQuadric& twinInto = mesh.attributeQuadrics[candidate.seamTarget * numAttributes + k];
+                    const AttributeQuadric& twinFrom = mesh.attributeQuadrics[twin * numAttributes + k];
+                    L_AddQuadric(twinInto.q, twinFrom.q);
+                    twinInto.g0 += twinFrom.g0;
+                    twinInto.g1 += twinFrom.g1;
+                    twinInto.g2 += twinFrom.g2;
+                    twinInto.d += twinFrom.d;
+                }
+            }
+
+            largestCost = std::max(largestCost, candidate.cost);
+            numCollapses++;
+        }
+
+        if (numCollapses == 0)
+        {
+            break;
+        }
+
+        // Triangles with two corners at one position are gone
+        size_t write = 0;
+        for (size_t i = 0; i < count; i += 3)
+        {
+            uint32_t a = remap[indices[i + 0]];
+            uint32_t b = remap[indices[i + 1]];
+            uint32_t c = remap[indices[i + 2]];
+            uint32_t pa = mesh.positionIds[a];
+            uint32_t pb = mesh.positionIds[b];
+            uint32_t pc = mesh.positionIds[c];
+            if (pa != pb && pb != pc && pc != pa)
+            {
+                indices[write + 0] = a;
+                indices[write + 1] = b;
+                indices[write + 2] = c;
+                write += 3;
+            }
+        }
+        count = write;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        pDest[i] = globalIds[indices[i]];
+    }
+    if (pResultError != NULL)
+    {
+        *pResultError = sqrtf(largestCost) * extent;
+    }
+    return count;
+}
+
+//-----------------------------------------------------------------------------
+int SvrBuildLodChain(std::vector<uint32_t>& indices, uint32_t firstIndex, uint32_t numIndices,
+                     const void* pVertices, size_t numVertices, size_t vertexStride,
+                     int maxLods, SvrMeshLod* pLods)
+//-----------------------------------------------------------------------------
+{
+    static const float kAttributeWeights[5] =
+    {
+        SVR_LOD_NORMAL_WEIGHT, SVR_LOD_NORMAL_WEIGHT, SVR_LOD_NORMAL_WEIGHT,
+        SVR_LOD_TEXCOORD_WEIGHT, SVR_LOD_TEXCOORD_WEIGHT
+    };
+
+    pLods[0].firstIndex = firstIndex;
+    pLods[0].numIndices = numIndices;
+    pLods[0].error = 0.0f;
+
+    // Each level starts from the one before, which is cheaper than going back to the
+    // full mesh every time and keeps the levels nested
+    std::vector<uint32_t> level;
+    int numLods = 1;
+    maxLods = std::min(maxLods, SVR_MESH_MAX_LODS);
+    while (numLods < maxLods)
+    {
+        const SvrMeshLod previous = pLods[numLods - 1];
+        size_t target = (size_t)(previous.numIndices / 3 * SVR_LOD_REDUCTION) * 3;
+        if (target == 0)
+        {
+            break;
+        }
+
+        level.assign(indices.begin() + previous.firstIndex, indices.begin() + previous.firstIndex + previous.numIndices);
+        float error;
+        size_t count = SvrSimplifyMesh(&level[0], &level[0], level.size(), pVertices, vertexStride,
+                                       kAttributeWeights, 5, target, FLT_MAX, &error);
+        if (count == 0 || count > previous.numIndices * SVR_LOD_MIN_REDUCTION)
+        {
+            break;
+        }
+        SvrOptimizeVertexCache(&level[0], &level[0], count, numVertices);
+
+        SvrMeshLod& lod = pLods[numLods++];
+        lod.firstIndex = (uint32_t)indices.size();
+        lod.numIndices = (uint32_t)count;
+        lod.error = previous.error + error;
+        indices.insert(indices.end(), level.begin(), level.begin() + count);
+    }
+
+    return numLods;
+}
+
+}   // namespace Svr
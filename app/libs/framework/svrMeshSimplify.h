@@ -0,0 +1,57 @@
+//=============================================================================
+// FILE: svrMeshSimplify.h
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "svrMeshFormat.h"
+
+// Levels svrmesh builds by default, including the full detail one
+#define SVR_LOD_DEFAULT_COUNT       4
+
+// Each level aims for this fraction of the previous one's triangles.  A level that
+// cannot get below SVR_LOD_MIN_REDUCTION of the previous ends the chain.
+#define SVR_LOD_REDUCTION           0.5f
+#define SVR_LOD_MIN_REDUCTION       0.9f
+
+// Error weights of the normal and texcoord that follow the position in SvrObjShape
+// and svrmesh vertices, relative to the mesh extent
+#define SVR_LOD_NORMAL_WEIGHT       0.5f
+#define SVR_LOD_TEXCOORD_WEIGHT     1.0f
+
+namespace Svr
+{
+    // Collapses edges by quadric error (Garland and Heckbert, "Surface Simplification
+    // Using Quadric Error Metrics") until the list is down to targetIndexCount, or the
+    // next collapse would cost more than targetError.  Vertices only ever move onto
+    // their neighbours, so the vertex buffer is shared by every level.
+    //
+    // Positions are 3 floats at the start of each vertex.  The numAttributes floats
+    // after them (normals, texcoords) add attribute quadrics scaled by
+    // pAttributeWeights, so collapses that smear them are avoided too.  Borders only
+    // collapse along themselves, attribute seams only as a pair along the seam, and
+    // vertices where neither holds stay put.
+    //
+    // pDest may equal pIndices.  Returns the new index count; *pResultError, when not
+    // NULL, receives the largest collapse error in the units of the positions.
+    size_t  SvrSimplifyMesh(uint32_t* pDest, const uint32_t* pIndices, size_t numIndices,
+                            const void* pVertices, size_t vertexStride,
+                            const float* pAttributeWeights, int numAttributes,
+                            size_t targetIndexCount, float targetError, float* pResultError);
+
+    // Appends simplified copies of indices[firstIndex, firstIndex + numIndices) to
+    // indices, each cache optimized, for vertices laid out as SvrObjShape's.  pLods[0]
+    // is the range itself, errors add up from level to level.  Returns the number of
+    // levels written, at most maxLods.
+    int     SvrBuildLodChain(std::vector<uint32_t>& indices, uint32_t firstIndex, uint32_t numIndices,
+                             const void* pVertices, size_t numVertices, size_t vertexStride,
+                             int maxLods, SvrMeshLod* pLods);
+}
@@ -0,0 +1,541 @@
+//=============================================================================
+// FILE: svrMipGen.cpp
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <GLES3/gl3.h>
+
+#include "svrJobs.h"
+#include "svrMipGen.h"
+
+#ifndef GL_HALF_FLOAT_OES
+#define GL_HALF_FLOAT_OES       0x8D61
+#endif
+
+// Destination rows filtered per job
+#define BAND_ROWS               16
+
+#define MAX_FILTER_TAPS         12
+
+// Linear to sRGB lookup resolution, fine enough that every dark code is reachable
+#define SRGB_ENCODE_TABLE_SIZE  16384
+
+namespace Svr
+{
+
+// One pixel, all channels in one register (NEON on device, SSE on the host tools).
+// Formats with fewer than four channels leave the upper lanes unused.
+typedef float SvrFloat4 __attribute__((vector_size(16)));
+
+struct FilterKernel
+{
+    int     numTaps;
+    int     firstOffset;        // Of the first tap from 2 * x in the source
+    float   weights[MAX_FILTER_TAPS];
+};
+
+static float            gUnormToFloat[256];
+static float            gSrgbToLinear[256];
+static unsigned char    gLinearToSrgb[SRGB_ENCODE_TABLE_SIZE];
+static FilterKernel     gKernels[3];
+static pthread_once_t   gTablesOnce = PTHREAD_ONCE_INIT;
+
+//-----------------------------------------------------------------------------
+static double L_Sinc(double x)
+//-----------------------------------------------------------------------------
+{
+    if (fabs(x) < 1e-6)
+        return 1.0;
+    return sin(M_PI * x) / (M_PI * x);
+}
+
+//-----------------------------------------------------------------------------
+static double L_BesselI0(double x)
+//-----------------------------------------------------------------------------
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; k++)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+//-----------------------------------------------------------------------------
+static void L_BuildKernel(FilterKernel* pKernel, SvrMipFilter filter)
+//-----------------------------------------------------------------------------
+{
+    // Taps sit on source texel centres, distances are measured in destination texels
+    // from the centre of the output texel, which lies between source 2x and 2x + 1
+    switch (filter)
+    {
+    case kMipFilterKaiser:
+        pKernel->numTaps = 8;
+        pKernel->firstOffset = -3;
+        break;
+    case kMipFilterLanczos:
+        pKernel->numTaps = 12;
+        pKernel->firstOffset = -5;
+        break;
+    default:
+        pKernel->numTaps = 2;
+        pKernel->firstOffset = 0;
+        break;
+    }
+
+    const double kaiserAlpha = 4.0;
+    const double kaiserWidth = 2.0;
+
+    double total = 0.0;
+    double weights[MAX_FILTER_TAPS];
+    for (int t = 0; t < pKernel->numTaps; t++)
+    {
+        double d = ((pKernel->firstOffset + t) - 0.5) * 0.5;
+        double w = 1.0;
+        if (filter == kMipFilterKaiser)
+        {
+            double r = d / kaiserWidth;
+            double window = (fabs(r) < 1.0) ? L_BesselI0(kaiserAlpha * sqrt(1.0 - r * r)) / L_BesselI0(kaiserAlpha) : 0.0;
+            w = L_Sinc(d) * window;
+        }
+        else if (filter == kMipFilterLanczos)
+        {
+            w = (fabs(d) < 3.0) ? L_Sinc(d) * L_Sinc(d / 3.0) : 0.0;
+        }
+        weights[t] = w;
+        total += w;
+    }
+
+    for (int t = 0; t < pKernel->numTaps; t++)
+    {
+        pKernel->weights[t] = (float)(weights[t] / total);
+    }
+}
+
+//-----------------------------------------------------------------------------
+static void L_InitTables()
+//-----------------------------------------------------------------------------
+{
+    for (int i = 0; i < 256; i++)
+    {
+        double c = i / 255.0;
+        gUnormToFloat[i] = (float)c;
+        gSrgbToLinear[i] = (float)((c <= 0.04045) ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4));
+    }
+
+    for (int i = 0; i < SRGB_ENCODE_TABLE_SIZE; i++)
+    {
+        double l = i / (double)(SRGB_ENCODE_TABLE_SIZE - 1);
+        double s = (l <= 0.0031308) ? l * 12.92 : 1.055 * pow(l, 1.0 / 2.4) - 0.055;
+        gLinearToSrgb[i] = (unsigned char)(s * 255.0 + 0.5);
+    }
+
+    L_BuildKernel(&gKernels[kMipFilterBox], kMipFilterBox);
+    L_BuildKernel(&gKernels[kMipFilterKaiser], kMipFilterKaiser);
+    L_BuildKernel(&gKernels[kMipFilterLanczos], kMipFilterLanczos);
+}
+
+//-----------------------------------------------------------------------------
+static inline float L_HalfToFloat(uint16_t h)
+//-----------------------------------------------------------------------------
+{
+#if defined(__ARM_FP16_FORMAT_IEEE)
+    __fp16 v;
+    memcpy(&v, &h, sizeof(v));
+    return (float)v;
+#else
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1F;
+    uint32_t mantissa = h & 0x3FF;
+
+    uint32_t bits;
+    if (exponent == 0)
+    {
+        float value = ldexpf((float)mantissa, -24);
+        return sign ? -value : value;
+    }
+    else if (exponent == 31)
+    {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    }
+    else
+    {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+static inline uint16_t L_FloatToHalf(float f)
+//-----------------------------------------------------------------------------
+{
+#if defined(__ARM_FP16_FORMAT_IEEE)
+    __fp16 v = (__fp16)f;
+    uint16_t h;
+    memcpy(&h, &v, sizeof(h));
+    return h;
+#else
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t mantissa = bits & 0x7FFFFF;
+    int exponent = (int)((bits >> 23) & 0xFF);
+
+    if (exponent == 255)
+    {
+        return (uint16_t)(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+    }
+
+    exponent -= 112;
+    if (exponent >= 31)
+    {
+        return (uint16_t)(sign | 0x7C00);
+    }
+
+    // Round to nearest even, into the denormal range if need be
+    int shift = 13;
+    if (exponent <= 0)
+    {
+        if (exponent < -10)
+        {
+            return (uint16_t)sign;
+        }
+        mantissa |= 0x800000;
+        shift = 14 - exponent;
+        exponent = 0;
+    }
+
+    uint32_t half = (exponent << 10) | (mantissa >> shift);
+    uint32_t remainder = mantissa & ((1u << shift) - 1);
+    uint32_t midpoint = 1u << (shift - 1);
+    if (remainder > midpoint || (remainder == midpoint && (half & 1)))
+    {
+        half++;
+    }
+    return (uint16_t)(sign | half);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+static void L_DecodeRow(const SvrMipFormat& format, const void* pRow, uint32_t width, SvrFloat4* pOut)
+//-----------------------------------------------------------------------------
+{
+    uint32_t channels = format.channels;
+
+    if (format.encoding == kMipHalf)
+    {
+        const uint16_t* pSrc = (const uint16_t*)pRow;
+        for (uint32_t x = 0; x < width; x++, pSrc += channels)
+        {
+            SvrFloat4 v = { 0.0f, 0.0f, 0.0f, 0.0f };
+            for (uint32_t c = 0; c < channels; c++)
+                v[c] = L_HalfToFloat(pSrc[c]);
+            pOut[x] = v;
+        }
+        return;
+    }
+
+    // Alpha stays linear in sRGB formats
+    const float* pColorTable = (format.encoding == kMipSrgb8) ? gSrgbToLinear : gUnormToFloat;
+    const unsigned char* pSrc = (const unsigned char*)pRow;
+
+    if (channels == 4)
+    {
+        for (uint32_t x = 0; x < width; x++, pSrc += 4)
+        {
+            SvrFloat4 v = { pColorTable[pSrc[0]], pColorTable[pSrc[1]], pColorTable[pSrc[2]], gUnormToFloat[pSrc[3]] };
+            pOut[x] = v;
+        }
+        return;
+    }
+
+    for (uint32_t x = 0; x < width; x++, pSrc += channels)
+    {
+        SvrFloat4 v = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (uint32_t c = 0; c < channels; c++)
+            v[c] = pColorTable[pSrc[c]];
+        pOut[x] = v;
+    }
+}
+
+//-----------------------------------------------------------------------------
+static void L_EncodeRow(const SvrMipFormat& format, const SvrFloat4* pIn, uint32_t width, void* pRow)
+//-----------------------------------------------------------------------------
+{
+    uint32_t channels = format.channels;
+
+    if (format.encoding == kMipHalf)
+    {
+        uint16_t* pDst = (uint16_t*)pRow;
+        for (uint32_t x = 0; x < width; x++, pDst += channels)
+        {
+            for (uint32_t c = 0; c < channels; c++)
+                pDst[c] = L_FloatToHalf(pIn[x][c]);
+        }
+        return;
+    }
+
+    const SvrFloat4 zero = { 0.0f, 0.0f, 0.0f, 0.0f };
+    const SvrFloat4 one = { 1.0f, 1.0f, 1.0f, 1.0f };
+    unsigned char* pDst = (unsigned char*)pRow;
+
+    if (format.encoding == kMipSrgb8)
+    {
+        // Sharper filters overshoot, clamp before the table lookup
+        const float scale = (float)(SRGB_ENCODE_TABLE_SIZE - 1);
+        uint32_t colorChannels = (channels == 4) ? 3 : channels;
+        for (uint32_t x = 0; x < width; x++, pDst += channels)
+        {
+            SvrFloat4 v = pIn[x];
+            v = (v < zero) ? zero : v;
+            v = (v > one) ? one : v;
+            for (uint32_t c = 0; c < colorChannels; c++)
+                pDst[c] = gLinearToSrgb[(int)(v[c] * scale + 0.5f)];
+            if (channels == 4)
+                pDst[3] = (unsigned char)(v[3] * 255.0f + 0.5f);
+        }
+        return;
+    }
+
+    const SvrFloat4 scale = { 255.0f, 255.0f, 255.0f, 255.0f };
+    const SvrFloat4 round = { 0.5f, 0.5f, 0.5f, 0.5f };
+    for (uint32_t x = 0; x < width; x++, pDst += channels)
+    {
+        SvrFloat4 v = pIn[x];
+        v = (v < zero) ? zero : v;
+        v = (v > one) ? one : v;
+        v = v * scale + round;
+        for (uint32_t c = 0; c < channels; c++)
+            pDst[c] = (unsigned char)v[c];
+    }
+}
+
+//-----------------------------------------------------------------------------
+static void L_FilterRow(const FilterKernel& kernel, const SvrFloat4* pSrc, uint32_t srcWidth, SvrFloat4* pDst, uint32_t dstWidth)
+//-----------------------------------------------------------------------------
+{
+    SvrFloat4 weights[MAX_FILTER_TAPS];
+    for (int t = 0; t < kernel.numTaps; t++)
+    {
+        float w = kernel.weights[t];
+        SvrFloat4 splat = { w, w, w, w };
+        weights[t] = splat;
+    }
+
+    int lastSrc = (int)srcWidth - 1;
+    for (uint32_t x = 0; x < dstWidth; x++)
+    {
+        int first = 2 * (int)x + kernel.firstOffset;
+        SvrFloat4 sum = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+        if (first >= 0 && first + kernel.numTaps - 1 <= lastSrc)
+        {
+            const SvrFloat4* pTaps = pSrc + first;
+            for (int t = 0; t < kernel.numTaps; t++)
+                sum += pTaps[t] * weights[t];
+        }
+        else
+        {
+            // Clamp to edge
+            for (int t = 0; t < kernel.numTaps; t++)
+            {
+                int i = first + t;
+                i = (i < 0) ? 0 : ((i > lastSrc) ? lastSrc : i);
+                sum += pSrc[i] * weights[t];
+            }
+        }
+
+        pDst[x] = sum;
+    }
+}
+
+struct DownsampleJob
+{
+    const SvrMipFormat*     pFormat;
+    const FilterKernel*     pKernel;
+    const SvrMipImage*      pSrc;
+    const SvrMipImage*      pDst;
+};
+
+//-----------------------------------------------------------------------------
+static void L_DownsampleRows(void* pContext, int beginRow, int endRow)
+//-----------------------------------------------------------------------------
+{
+    const DownsampleJob& job = *(const DownsampleJob*)pContext;
+    const FilterKernel& kernel = *job.pKernel;
+    const SvrMipImage& src = *job.pSrc;
+    const SvrMipImage& dst = *job.pDst;
+
+    // Horizontal pass over every source row the band touches, then the vertical pass
+    // down those rows.  Rows shared with the neighbouring bands are filtered twice.
+    int firstSrcRow = 2 * beginRow + kernel.firstOffset;
+    int numSrcRows = 2 * (endRow - beginRow - 1) + kernel.numTaps;
+    int lastSrcRow = (int)src.height - 1;
+
+    SvrFloat4* pScratch = (SvrFloat4*)malloc(sizeof(SvrFloat4) * (src.width + (numSrcRows + 1) * dst.width));
+    if (pScratch == NULL)
+    {
+        return;
+    }
+    SvrFloat4* pDecoded = pScratch;
+    SvrFloat4* pFiltered = pDecoded + src.width;
+    SvrFloat4* pOutRow = pFiltered + numSrcRows * dst.width;
+
+    for (int r = 0; r < numSrcRows; r++)
+    {
+        int row = firstSrcRow + r;
+        row = (row < 0) ? 0 : ((row > lastSrcRow) ? lastSrcRow : row);
+        L_DecodeRow(*job.pFormat, (const unsigned char*)src.pData + (size_t)row * src.rowPitch, src.width, pDecoded);
+        L_FilterRow(kernel, pDecoded, src.width, pFiltered + r * dst.width, dst.width);
+    }
+
+    SvrFloat4 weights[MAX_FILTER_TAPS];
+    for (int t = 0; t < kernel.numTaps; t++)
+    {
+        float w = kernel.weights[t];
+        SvrFloat4 splat = { w, w, w, w };
+        weights[t] = splat;
+    }
+
+    for (int y = beginRow; y < endRow; y++)
+    {
+        const SvrFloat4* pRows = pFiltered + (2 * (y - beginRow)) * dst.width;
+        for (uint32_t x = 0; x < dst.width; x++)
+        {
+            SvrFloat4 sum = { 0.0f, 0.0f, 0.0f, 0.0f };
+            for (int t = 0; t < kernel.numTaps; t++)
+                sum += pRows[t * dst.width + x] * weights[t];
+            pOutRow[x] = sum;
+        }
+        L_EncodeRow(*job.pFormat, pOutRow, dst.width, (unsigned char*)dst.pData + (size_t)y * dst.rowPitch);
+    }
+
+    free(pScratch);
+}
+
+//-----------------------------------------------------------------------------
+bool SvrGetMipFormat(uint32_t glInternalFormat, uint32_t glType, SvrMipFormat* pFormat)
+//-----------------------------------------------------------------------------
+{
+    bool isByte = (glType == GL_UNSIGNED_BYTE);
+    bool isHalf = (glType == GL_HALF_FLOAT || glType == GL_HALF_FLOAT_OES);
+
+    switch (glInternalFormat)
+    {
+    case GL_RGBA8:          pFormat->encoding = kMipUnorm8; pFormat->channels = 4; return isByte;
+    case GL_RGB8:           pFormat->encoding = kMipUnorm8; pFormat->channels = 3; return isByte;
+    case GL_RG8:            pFormat->encoding = kMipUnorm8; pFormat->channels = 2; return isByte;
+    case GL_R8:             pFormat->encoding = kMipUnorm8; pFormat->channels = 1; return isByte;
+    case GL_SRGB8_ALPHA8:   pFormat->encoding = kMipSrgb8;  pFormat->channels = 4; return isByte;
+    case GL_SRGB8:          pFormat->encoding = kMipSrgb8;  pFormat->channels = 3; return isByte;
+    case GL_RGBA16F:        pFormat->encoding = kMipHalf;   pFormat->channels = 4; return isHalf;
+    case GL_RGB16F:         pFormat->encoding = kMipHalf;   pFormat->channels = 3; return isHalf;
+    case GL_RG16F:          pFormat->encoding = kMipHalf;   pFormat->channels = 2; return isHalf;
+    case GL_R16F:           pFormat->encoding = kMipHalf;   pFormat->channels = 1; return isHalf;
+
+    // Unsized formats take their encoding from the type
+    case GL_RGBA:           pFormat->channels = 4; break;
+    case GL_RGB:            pFormat->channels = 3; break;
+    case GL_RG:             pFormat->channels = 2; break;
+    case GL_RED:
+    case GL_LUMINANCE:
+    case GL_ALPHA:          pFormat->channels = 1; break;
+    case GL_LUMINANCE_ALPHA: pFormat->channels = 2; break;
+    default:
+        return false;
+    }
+
+    pFormat->encoding = isHalf ? kMipHalf : kMipUnorm8;
+    return isByte || isHalf;
+}
+
+//-----------------------------------------------------------------------------
+uint32_t SvrGetMipLevelCount(uint32_t width, uint32_t height)
+//-----------------------------------------------------------------------------
+{
+    uint32_t size = (width > height) ? width : height;
+    uint32_t levels = 1;
+    while (size > 1)
+    {
+        size >>= 1;
+        levels++;
+    }
+    return levels;
+}
+
+//-----------------------------------------------------------------------------
+uint32_t SvrGetMipRowPitch(const SvrMipFormat& format, uint32_t width)
+//-----------------------------------------------------------------------------
+{
+    uint32_t bytes = width * format.channels * ((format.encoding == kMipHalf) ? 2 : 1);
+    return (bytes + SVR_MIP_ROW_ALIGNMENT - 1) & ~(uint32_t)(SVR_MIP_ROW_ALIGNMENT - 1);
+}
+
+//-----------------------------------------------------------------------------
+size_t SvrGetMipChainSize(const SvrMipFormat& format, uint32_t width, uint32_t height, uint32_t numLevels)
+//-----------------------------------------------------------------------------
+{
+    size_t total = 0;
+    for (uint32_t level = 1; level < numLevels; level++)
+    {
+        width = (width > 1) ? width >> 1 : 1;
+        height = (height > 1) ? height >> 1 : 1;
+        total += (size_t)SvrGetMipRowPitch(format, width) * height;
+    }
+    return total;
+}
+
+//-----------------------------------------------------------------------------
+void SvrDownsample(const SvrMipFormat& format, SvrMipFilter filter, const SvrMipImage& src, const SvrMipImage& dst)
+//-----------------------------------------------------------------------------
+{
+    pthread_once(&gTablesOnce, L_InitTables);
+
+    DownsampleJob job;
+    job.pFormat = &format;
+    job.pKernel = &gKernels[(filter <= kMipFilterLanczos) ? filter : kMipFilterBox];
+    job.pSrc = &src;
+    job.pDst = &dst;
+
+    // Small levels run inline, their bands would be mostly overlap
+    SvrParallelFor(dst.height, BAND_ROWS, L_DownsampleRows, &job);
+}
+
+//-----------------------------------------------------------------------------
+void SvrGenerateMipChain(const SvrMipFormat& format, SvrMipFilter filter, const SvrMipImage& base,
+                         uint32_t numLevels, void* pStorage, SvrMipImage* pLevels)
+//-----------------------------------------------------------------------------
+{
+    // Levels depend on each other, the parallelism is across the rows of each one
+    const SvrMipImage* pPrevious = &base;
+    unsigned char* pNext = (unsigned char*)pStorage;
+
+    for (uint32_t level = 1; level < numLevels; level++)
+    {
+        SvrMipImage& image = pLevels[level - 1];
+        image.width = (pPrevious->width > 1) ? pPrevious->width >> 1 : 1;
+        image.height = (pPrevious->height > 1) ? pPrevious->height >> 1 : 1;
+        image.rowPitch = SvrGetMipRowPitch(format, image.width);
+        image.pData = pNext;
+        pNext += (size_t)image.rowPitch * image.height;
+
+        SvrDownsample(format, filter, *pPrevious, image);
+        pPrevious = &image;
+    }
+}
+
+}   // namespace Svr
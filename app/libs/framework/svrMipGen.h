@@ -0,0 +1,64 @@
+//=============================================================================
+// FILE: svrMipGen.h
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Rows of generated levels are padded to this, which is what KTX files and the
+// default GL_UNPACK_ALIGNMENT expect
+#define SVR_MIP_ROW_ALIGNMENT   4
+
+namespace Svr
+{
+    enum SvrMipEncoding
+    {
+        kMipUnorm8 = 0,
+        kMipSrgb8,              // Colour channels sRGB encoded, alpha linear
+        kMipHalf
+    };
+
+    enum SvrMipFilter
+    {
+        kMipFilterBox = 0,      // 2x2 average, fastest
+        kMipFilterKaiser,       // 8 tap Kaiser windowed sinc, sharper with little ringing
+        kMipFilterLanczos       // 12 tap Lanczos-3, sharpest
+    };
+
+    struct SvrMipFormat
+    {
+        SvrMipEncoding  encoding;
+        uint32_t        channels;       // 1 to 4
+    };
+
+    struct SvrMipImage
+    {
+        void*           pData;
+        uint32_t        width;
+        uint32_t        height;
+        uint32_t        rowPitch;       // Bytes
+    };
+
+    // Maps a GL internal format and type, false when the generator does not handle it
+    bool        SvrGetMipFormat(uint32_t glInternalFormat, uint32_t glType, SvrMipFormat* pFormat);
+
+    uint32_t    SvrGetMipLevelCount(uint32_t width, uint32_t height);
+    uint32_t    SvrGetMipRowPitch(const SvrMipFormat& format, uint32_t width);
+
+    // Bytes needed for levels 1 to numLevels - 1 of a chain with the given base size
+    size_t      SvrGetMipChainSize(const SvrMipFormat& format, uint32_t width, uint32_t height, uint32_t numLevels);
+
+    // Filters src into dst, which must be half its size (rounded down, at least 1).
+    // sRGB data is filtered in linear space.  Rows are split across the job pool.
+    void        SvrDownsample(const SvrMipFormat& format, SvrMipFilter filter, const SvrMipImage& src, const SvrMipImage& dst);
+
+    // Fills pLevels[0 .. numLevels - 2] (levels 1 and up) from base, each level from the
+    // one above it.  Laid out back to back in pStorage, which needs SvrGetMipChainSize bytes.
+    void        SvrGenerateMipChain(const SvrMipFormat& format, SvrMipFilter filter, const SvrMipImage& base,
+                                    uint32_t numLevels, void* pStorage, SvrMipImage* pLevels);
+}
@@ -0,0 +1,716 @@
+//=============================================================================
+// FILE: svrObjImport.cpp
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "svrJobs.h"
+#include "svrMeshOptimizer.h"
+#include "svrMeshSimplify.h"
+#include "svrObjImport.h"
+
+#define MAX_FACE_CORNERS    64
+
+namespace Svr
+{
+
+// Exactly representable powers of ten, larger exponents are applied in steps
+static const double kPowersOfTen[] =
+{
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Face corner whose index counted back from the end of the chunk's own pools, the
+// chunk's offset into the merged pools has to be added once it is known
+struct ObjFixup
+{
+    uint32_t    group;
+    uint32_t    corner;
+    uint32_t    component;      // 0 position, 1 texcoord, 2 normal
+};
+
+struct ObjChunk
+{
+    const char*                 pBegin;
+    const char*                 pEnd;
+
+    std::vector<float>          positions;
+    std::vector<float>          texcoords;
+    std::vector<float>          normals;
+    std::vector<SvrObjGroup>    groups;
+    std::vector<bool>           inheritsName;   // Per group, named before this chunk
+    std::vector<ObjFixup>       fixups;
+
+    bool                        continues;      // groups[0] carries on with the previous chunk's last group
+    bool                        hasName;
+    std::string                 name;
+    bool                        failed;
+    std::string                 error;
+};
+
+//-----------------------------------------------------------------------------
+static inline const char* L_SkipSpace(const char* pText)
+//-----------------------------------------------------------------------------
+{
+    while (*pText == ' ' || *pText == '\t')
+        pText++;
+    return pText;
+}
+
+//-----------------------------------------------------------------------------
+static inline bool L_IsDigit(char c)
+//-----------------------------------------------------------------------------
+{
+    return (unsigned)(c - '0') < 10;
+}
+
+//-----------------------------------------------------------------------------
+float SvrParseObjFloat(const char*& pText)
+//-----------------------------------------------------------------------------
+{
+    const char* p = L_SkipSpace(pText);
+
+    bool negative = (*p == '-');
+    if (*p == '-' || *p == '+')
+        p++;
+
+    // Up to 18 significant digits go into the mantissa, the rest only scale it
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    bool anyDigits = false;
+    while (L_IsDigit(*p))
+    {
+        if (mantissa < 100000000000000000ULL)
+            mantissa = mantissa * 10 + (*p - '0');
+        else
+            exponent++;
+        anyDigits = true;
+        p++;
+    }
+    if (*p == '.')
+    {
+        p++;
+        while (L_IsDigit(*p))
+        {
+            if (mantissa < 100000000000000000ULL)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                exponent--;
+            }
+            anyDigits = true;
+            p++;
+        }
+    }
+
+    if (!anyDigits)
+    {
+        // nan, inf and the like are rare enough for the C library, which must not be
+        // given anything it could skip a newline in
+        float value = 0.0f;
+        if (*p == 'n' || *p == 'N' || *p == 'i' || *p == 'I')
+        {
+            char* pEnd;
+            value = strtof(p, &pEnd);
+            p = pEnd;
+        }
+        pText = p;
+        return negative ? -value : value;
+    }
+
+    if ((*p == 'e' || *p == 'E') && (L_IsDigit(p[1]) || ((p[1] == '-' || p[1] == '+') && L_IsDigit(p[2]))))
+    {
+        p++;
+        bool negativeExponent = (*p == '-');
+        if (*p == '-' || *p == '+')
+            p++;
+        int value = 0;
+        while (L_IsDigit(*p))
+        {
+            if (value < 10000)
+                value = value * 10 + (*p - '0');
+            p++;
+        }
+        exponent += negativeExponent ? -value : value;
+    }
+
+    double result = (double)mantissa;
+    if (mantissa != 0)
+    {
+        while (exponent > 22)
+        {
+            result *= 1e22;
+            exponent -= 22;
+        }
+        while (exponent < -22)
+        {
+            result /= 1e22;
+            exponent += 22;
+        }
+        result = (exponent >= 0) ? result * kPowersOfTen[exponent] : result / kPowersOfTen[-exponent];
+    }
+
+    pText = p;
+    return (float)(negative ? -result : result);
+}
+
+//-----------------------------------------------------------------------------
+static bool L_ParseIndex(const char*& pText, int* pValue)
+//-----------------------------------------------------------------------------
+{
+    const char* p = pText;
+    bool negative = (*p == '-');
+    if (*p == '-' || *p == '+')
+        p++;
+    if (!L_IsDigit(*p))
+        return false;
+
+    int value = 0;
+    while (L_IsDigit(*p))
+    {
+        if (value < (1 << 27))
+            value = value * 10 + (*p - '0');
+        p++;
+    }
+
+    *pValue = negative ? -value : value;
+    pText = p;
+    return value != 0;
+}
+
+//-----------------------------------------------------------------------------
+static inline const char* L_ParseFloats(const char* pText, int count, std::vector<float>& out)
+//-----------------------------------------------------------------------------
+{
+    for (int i = 0; i < count; i++)
+    {
+        out.push_back(SvrParseObjFloat(pText));
+    }
+    return pText;
+}
+
+//-----------------------------------------------------------------------------
+static void L_StartGroup(ObjChunk& chunk, bool named)
+//-----------------------------------------------------------------------------
+{
+    SvrObjGroup& current = chunk.groups.back();
+    if (!current.corners.empty())
+    {
+        chunk.groups.push_back(SvrObjGroup());
+        chunk.inheritsName.push_back(!chunk.hasName);
+        chunk.groups.back().name = chunk.name;
+    }
+    else if (chunk.groups.size() == 1)
+    {
+        // Whether the previous chunk's last group has faces is not known here, the
+        // merge decides between a new group and a rename
+        chunk.continues = false;
+    }
+    else if (!named)
+    {
+        // A material change before any face changes nothing
+        return;
+    }
+
+    if (named)
+    {
+        chunk.groups.back().name = chunk.name;
+        chunk.inheritsName.back() = false;
+    }
+}
+
+//-----------------------------------------------------------------------------
+static bool L_ParseFace(ObjChunk& chunk, const char* pText)
+//-----------------------------------------------------------------------------
+{
+    SvrObjCorner polygon[MAX_FACE_CORNERS];
+    uint8_t relative[MAX_FACE_CORNERS];
+    int numCorners = 0;
+
+    int counts[3] = { (int)(chunk.positions.size() / 3), (int)(chunk.texcoords.size() / 2), (int)(chunk.normals.size() / 3) };
+
+    pText = L_SkipSpace(pText);
+    while (*pText != '\n' && *pText != '\r' && *pText != '#' && *pText != '\0')
+    {
+        if (numCorners == MAX_FACE_CORNERS)
+        {
+            chunk.error = "face has too many corners";
+            return false;
+        }
+
+        // v, v/vt, v//vn or v/vt/vn
+        int values[3] = { 0, 0, 0 };
+        if (!L_ParseIndex(pText, &values[0]))
+        {
+            chunk.error = "bad face index";
+            return false;
+        }
+        if (*pText == '/')
+        {
+            pText++;
+            if (*pText != '/' && !L_ParseIndex(pText, &values[1]))
+            {
+                chunk.error = "bad face texcoord index";
+                return false;
+            }
+            if (*pText == '/')
+            {
+                pText++;
+                if (!L_ParseIndex(pText, &values[2]))
+                {
+                    chunk.error = "bad face normal index";
+                    return false;
+                }
+            }
+        }
+
+        // Positive indices are final, negative ones count back from the chunk so far
+        int resolved[3];
+        relative[numCorners] = 0;
+        for (int c = 0; c < 3; c++)
+        {
+            if (values[c] > 0)
+            {
+                resolved[c] = values[c] - 1;
+            }
+            else if (values[c] < 0)
+            {
+                resolved[c] = counts[c] + values[c];
+                relative[numCorners] |= 1 << c;
+            }
+            else
+            {
+                resolved[c] = -1;
+            }
+        }
+
+        SvrObjCorner& corner = polygon[numCorners++];
+        corner.position = resolved[0];
+        corner.texcoord = resolved[1];
+        corner.normal = resolved[2];
+        pText = L_SkipSpace(pText);
+    }
+
+    SvrObjGroup& group = chunk.groups.back();
+    uint32_t groupIndex = (uint32_t)chunk.groups.size() - 1;
+    for (int i = 2; i < numCorners; i++)
+    {
+        int triangle[3] = { 0, i - 1, i };
+        for (int k = 0; k < 3; k++)
+        {
+            int c = triangle[k];
+            for (uint32_t component = 0; component < 3; component++)
+            {
+                if (relative[c] & (1 << component))
+                {
+                    ObjFixup fixup = { groupIndex, (uint32_t)group.corners.size(), component };
+                    chunk.fixups.push_back(fixup);
+                }
+            }
+            group.corners.push_back(polygon[c]);
+        }
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+static bool L_ParseLine(ObjChunk& chunk, const char* pText)
+//-----------------------------------------------------------------------------
+{
+    pText = L_SkipSpace(pText);
+
+    if (pText[0] == 'v')
+    {
+        if (pText[1] == ' ' || pText[1] == '\t')
+            L_ParseFloats(pText + 2, 3, chunk.positions);
+        else if (pText[1] == 'n' && (pText[2] == ' ' || pText[2] == '\t'))
+            L_ParseFloats(pText + 3, 3, chunk.normals);
+        else if (pText[1] == 't' && (pText[2] == ' ' || pText[2] == '\t'))
+            L_ParseFloats(pText + 3, 2, chunk.texcoords);
+    }
+    else if (pText[0] == 'f' && (pText[1] == ' ' || pText[1] == '\t'))
+    {
+        return L_ParseFace(chunk, pText + 2);
+    }
+    else if ((pText[0] == 'o' || pText[0] == 'g') && (pText[1] == ' ' || pText[1] == '\t'))
+    {
+        const char* pName = L_SkipSpace(pText + 2);
+        const char* pEnd = pName;
+        while (*pEnd != '\0' && *pEnd != '\n' && *pEnd != '\r')
+            pEnd++;
+        chunk.name.assign(pName, pEnd - pName);
+        chunk.hasName = true;
+        L_StartGroup(chunk, true);
+    }
+    else if (strncmp(pText, "usemtl", 6) == 0)
+    {
+        // Materials are bound per draw, so each one needs its own group
+        L_StartGroup(chunk, false);
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+static void L_ParseChunks(void* pContext, int begin, int end)
+//-----------------------------------------------------------------------------
+{
+    ObjChunk* pChunks = (ObjChunk*)pContext;
+    for (int i = begin; i < end; i++)
+    {
+        ObjChunk& chunk = pChunks[i];
+        chunk.groups.push_back(SvrObjGroup());
+        chunk.inheritsName.push_back(true);
+
+        std::string lastLine;
+        const char* p = chunk.pBegin;
+        while (p < chunk.pEnd)
+        {
+            // Every parse stops at the newline, only an unterminated last line needs a copy
+            const char* pLine = p;
+            const char* pLineEnd = (const char*)memchr(p, '\n', chunk.pEnd - p);
+            if (pLineEnd != NULL)
+            {
+                p = pLineEnd + 1;
+            }
+            else
+            {
+                lastLine.assign(p, chunk.pEnd - p);
+                lastLine += '\n';
+                pLine = lastLine.c_str();
+                p = chunk.pEnd;
+            }
+
+            if (!L_ParseLine(chunk, pLine))
+            {
+                chunk.failed = true;
+                break;
+            }
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+static void L_MergeChunk(ObjChunk& chunk, SvrObjData& obj)
+//-----------------------------------------------------------------------------
+{
+    int bases[3] = { (int)(obj.positions.size() / 3), (int)(obj.texcoords.size() / 2), (int)(obj.normals.size() / 3) };
+    for (size_t i = 0; i < chunk.fixups.size(); i++)
+    {
+        const ObjFixup& fixup = chunk.fixups[i];
+        SvrObjCorner& corner = chunk.groups[fixup.group].corners[fixup.corner];
+        switch (fixup.component)
+        {
+        case 0: corner.position += bases[0]; break;
+        case 1: corner.texcoord += bases[1]; break;
+        case 2: corner.normal += bases[2]; break;
+        }
+    }
+
+    obj.positions.insert(obj.positions.end(), chunk.positions.begin(), chunk.positions.end());
+    obj.texcoords.insert(obj.texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+    obj.normals.insert(obj.normals.end(), chunk.normals.begin(), chunk.normals.end());
+
+    for (size_t g = 0; g < chunk.groups.size(); g++)
+    {
+        SvrObjGroup& group = chunk.groups[g];
+        if (obj.groups.empty())
+        {
+            obj.groups.push_back(SvrObjGroup());
+        }
+
+        SvrObjGroup& last = obj.groups.back();
+        if (g == 0 && chunk.continues)
+        {
+            last.corners.insert(last.corners.end(), group.corners.begin(), group.corners.end());
+            continue;
+        }
+
+        if (chunk.inheritsName[g])
+        {
+            group.name = last.name;
+        }
+        if (last.corners.empty())
+        {
+            // Nothing drawn under the old group yet, the new one takes its place
+            last.name.swap(group.name);
+            last.corners.swap(group.corners);
+        }
+        else
+        {
+            obj.groups.push_back(SvrObjGroup());
+            obj.groups.back().name.swap(group.name);
+            obj.groups.back().corners.swap(group.corners);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+bool SvrParseObj(const char* pText, size_t size, SvrObjData& obj, size_t chunkSize)
+//-----------------------------------------------------------------------------
+{
+    obj.positions.clear();
+    obj.texcoords.clear();
+    obj.normals.clear();
+    obj.groups.clear();
+
+    // A few chunks per thread so uneven ones even out, each ending after a newline
+    size_t numChunks;
+    if (chunkSize == 0)
+    {
+        numChunks = size / SVR_OBJ_MIN_CHUNK_SIZE + 1;
+        numChunks = std::min(numChunks, (size_t)SvrGetJobThreadCount() * 4);
+        numChunks = std::min(numChunks, (size_t)SVR_OBJ_MAX_CHUNKS);
+    }
+    else
+    {
+        numChunks = size / chunkSize + 1;
+    }
+
+    std::vector<ObjChunk> chunks(numChunks);
+    const char* pEnd = pText + size;
+    const char* pBegin = pText;
+    for (size_t i = 0; i < numChunks; i++)
+    {
+        const char* pSplit = (i + 1 == numChunks) ? pEnd : pText + size * (i + 1) / numChunks;
+        if (pSplit < pBegin)
+        {
+            pSplit = pBegin;
+        }
+        if (pSplit < pEnd)
+        {
+            const char* pNewline = (const char*)memchr(pSplit, '\n', pEnd - pSplit);
+            pSplit = (pNewline != NULL) ? pNewline + 1 : pEnd;
+        }
+
+        ObjChunk& chunk = chunks[i];
+        chunk.pBegin = pBegin;
+        chunk.pEnd = pSplit;
+        chunk.continues = true;
+        chunk.hasName = false;
+        chunk.failed = false;
+        pBegin = pSplit;
+    }
+
+    SvrParallelFor((int)numChunks, 1, L_ParseChunks, &chunks[0]);
+
+    for (size_t i = 0; i < numChunks; i++)
+    {
+        if (chunks[i].failed)
+        {
+            return false;
+        }
+        L_MergeChunk(chunks[i], obj);
+    }
+
+    if (!obj.groups.empty() && obj.groups.back().corners.empty())
+    {
+        obj.groups.pop_back();
+    }
+
+    // Indices are only known to be in range once every pool is in
+    int counts[3] = { (int)(obj.positions.size() / 3), (int)(obj.texcoords.size() / 2), (int)(obj.normals.size() / 3) };
+    for (size_t g = 0; g < obj.groups.size(); g++)
+    {
+        const std::vector<SvrObjCorner>& corners = obj.groups[g].corners;
+        for (size_t i = 0; i < corners.size(); i++)
+        {
+            const SvrObjCorner& corner = corners[i];
+            if (corner.position < 0 || corner.position >= counts[0] ||
+                corner.texcoord < -1 || corner.texcoord >= counts[1] ||
+                corner.normal < -1 || corner.normal >= counts[2])
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+void SvrGenerateObjNormals(const SvrObjData& obj, std::vector<float>& normals)
+//-----------------------------------------------------------------------------
+{
+    normals.assign(obj.positions.size(), 0.0f);
+    for (size_t g = 0; g < obj.groups.size(); g++)
+    {
+        const std::vector<SvrObjCorner>& corners = obj.groups[g].corners;
+        for (size_t i = 0; i + 2 < corners.size(); i += 3)
+        {
+            const float* p0 = &obj.positions[3 * corners[i + 0].position];
+            const float* p1 = &obj.positions[3 * corners[i + 1].position];
+            const float* p2 = &obj.positions[3 * corners[i + 2].position];
+
+            // Unnormalized cross product, its length is twice the area
+            float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+
+            for (int c = 0; c < 3; c++)
+            {
+                float* pNormal = &normals[3 * corners[i + c].position];
+                pNormal[0] += n[0];
+                pNormal[1] += n[1];
+                pNormal[2] += n[2];
+            }
+        }
+    }
+
+    for (size_t i = 0; i < normals.size(); i += 3)
+    {
+        float length = sqrtf(normals[i] * normals[i] + normals[i + 1] * normals[i + 1] + normals[i + 2] * normals[i + 2]);
+        float scale = (length > 0.0f) ? 1.0f / length : 0.0f;
+        normals[i + 0] *= scale;
+        normals[i + 1] *= scale;
+        normals[i + 2] *= scale;
+    }
+}
+
+struct CornerKey
+{
+    int     position;
+    int     texcoord;
+    int     normal;
+    bool operator==(const CornerKey& other) const
+    {
+        return position == other.position && texcoord == other.texcoord && normal == other.normal;
+    }
+};
+
+struct CornerKeyHash
+{
+    size_t operator()(const CornerKey& key) const
+    {
+        return (size_t)key.position * 73856093u ^ (size_t)key.texcoord * 19349663u ^ (size_t)key.normal * 83492791u;
+    }
+};
+
+struct ShapeJob
+{
+    const SvrObjData*           pObj;
+    const std::vector<float>*   pGeneratedNormals;
+    SvrObjShape*                pShapes;
+    bool                        optimize;
+    int                         maxLods;
+};
+
+//-----------------------------------------------------------------------------
+static void L_BuildShape(const ShapeJob& job, const SvrObjGroup& group, SvrObjShape& shape)
+//-----------------------------------------------------------------------------
+{
+    const SvrObjData& obj = *job.pObj;
+
+    shape.name = group.name;
+    shape.vertices.clear();
+    shape.indices.clear();
+    shape.indices.reserve(group.corners.size());
+    for (int c = 0; c < 3; c++)
+    {
+        shape.boundsMin[c] = HUGE_VALF;
+        shape.boundsMax[c] = -HUGE_VALF;
+    }
+
+    std::unordered_map<CornerKey, uint32_t, CornerKeyHash> vertexMap;
+    vertexMap.reserve(group.corners.size() / 2);
+
+    uint32_t numVertices = 0;
+    for (size_t i = 0; i < group.corners.size(); i++)
+    {
+        const SvrObjCorner& corner = group.corners[i];
+        CornerKey key = { corner.position, corner.texcoord, corner.normal };
+
+        std::pair<std::unordered_map<CornerKey, uint32_t, CornerKeyHash>::iterator, bool> inserted =
+            vertexMap.insert(std::make_pair(key, numVertices));
+        if (inserted.second)
+        {
+            const float* pPosition = &obj.positions[3 * corner.position];
+            const float* pNormal = (corner.normal >= 0) ? &obj.normals[3 * corner.normal] : &(*job.pGeneratedNormals)[3 * corner.position];
+            const float* pTexcoord = (corner.texcoord >= 0) ? &obj.texcoords[2 * corner.texcoord] : NULL;
+
+            float vertex[8] = { pPosition[0], pPosition[1], pPosition[2], pNormal[0], pNormal[1], pNormal[2],
+                                pTexcoord ? pTexcoord[0] : 0.0f, pTexcoord ? pTexcoord[1] : 0.0f };
+            shape.vertices.insert(shape.vertices.end(), vertex, vertex + 8);
+            for (int c = 0; c < 3; c++)
+            {
+                shape.boundsMin[c] = std::min(shape.boundsMin[c], pPosition[c]);
+                shape.boundsMax[c] = std::max(shape.boundsMax[c], pPosition[c]);
+            }
+            numVertices++;
+        }
+        shape.indices.push_back(inserted.first->second);
+    }
+
+    if (job.optimize && !shape.indices.empty())
+    {
+        std::vector<uint32_t> reordered(shape.indices.size());
+        SvrOptimizeVertexCache(&shape.indices[0], &shape.indices[0], shape.indices.size(), numVertices);
+        SvrOptimizeOverdraw(&reordered[0], &shape.indices[0], reordered.size(), &shape.vertices[0], numVertices, 8 * sizeof(float));
+
+        std::vector<float> fetchOrder(shape.vertices.size());
+        SvrOptimizeVertexFetch(&fetchOrder[0], &reordered[0], reordered.size(), &shape.vertices[0], numVertices, 8 * sizeof(float));
+        shape.indices.swap(reordered);
+        shape.vertices.swap(fetchOrder);
+    }
+
+    shape.numLods = 1;
+    shape.lods[0].firstIndex = 0;
+    shape.lods[0].numIndices = (uint32_t)shape.indices.size();
+    shape.lods[0].error = 0.0f;
+    if (job.maxLods > 1 && !shape.indices.empty())
+    {
+        shape.numLods = SvrBuildLodChain(shape.indices, 0, (uint32_t)shape.indices.size(), &shape.vertices[0], numVertices,
+                                         8 * sizeof(float), job.maxLods, shape.lods);
+    }
+}
+
+//-----------------------------------------------------------------------------
+static void L_BuildShapes(void* pContext, int begin, int end)
+//-----------------------------------------------------------------------------
+{
+    const ShapeJob& job = *(const ShapeJob*)pContext;
+    for (int i = begin; i < end; i++)
+    {
+        L_BuildShape(job, job.pObj->groups[i], job.pShapes[i]);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void SvrBuildObjShapes(const SvrObjData& obj, std::vector<SvrObjShape>& shapes, bool optimize, int maxLods)
+//-----------------------------------------------------------------------------
+{
+    bool missingNormals = false;
+    for (size_t g = 0; g < obj.groups.size() && !missingNormals; g++)
+    {
+        const std::vector<SvrObjCorner>& corners = obj.groups[g].corners;
+        for (size_t i = 0; i < corners.size() && !missingNormals; i++)
+        {
+            missingNormals = (corners[i].normal < 0);
+        }
+    }
+
+    std::vector<float> generatedNormals;
+    if (missingNormals)
+    {
+        SvrGenerateObjNormals(obj, generatedNormals);
+    }
+
+    shapes.resize(obj.groups.size());
+    if (shapes.empty())
+    {
+        return;
+    }
+
+    ShapeJob job = { &obj, &generatedNormals, &shapes[0], optimize, optimize ? maxLods : 1 };
+    SvrParallelFor((int)shapes.size(), 1, L_BuildShapes, &job);
+}
+
+}   // namespace Svr
@@ -0,0 +1,79 @@
+//=============================================================================
+// FILE: svrObjImport.h
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "svrMeshFormat.h"
+
+// Text below this is parsed on the calling thread alone
+#define SVR_OBJ_MIN_CHUNK_SIZE      (256 * 1024)
+#define SVR_OBJ_MAX_CHUNKS          64
+
+namespace Svr
+{
+    // One face corner, indices are 0 based into the SvrObjData arrays
+    struct SvrObjCorner
+    {
+        int     position;
+        int     texcoord;       // -1 when the face has none
+        int     normal;         // -1 when the face has none
+    };
+
+    // Faces between two object, group or material changes
+    struct SvrObjGroup
+    {
+        std::string                 name;
+        std::vector<SvrObjCorner>   corners;    // Three per triangle
+    };
+
+    struct SvrObjData
+    {
+        std::vector<float>          positions;  // 3 per vertex
+        std::vector<float>          texcoords;  // 2 per vertex
+        std::vector<float>          normals;    // 3 per vertex
+        std::vector<SvrObjGroup>    groups;
+    };
+
+    // Ready to upload: interleaved position, normal, texcoord (8 floats per vertex)
+    struct SvrObjShape
+    {
+        std::string                 name;
+        std::vector<float>          vertices;
+        std::vector<uint32_t>       indices;
+        float                       boundsMin[3];
+        float                       boundsMax[3];
+        SvrMeshLod                  lods[SVR_MESH_MAX_LODS];    // Ranges of indices, lods[0] is the full shape
+        int                         numLods;
+    };
+
+    // Parses v, vt, vn, f, o, g and usemtl, everything else is skipped.  Polygons are
+    // fanned into triangles.  The text is split into line aligned chunks parsed on the
+    // job pool, each into its own vertex pools, which are then concatenated.  Numbers
+    // always use '.' whatever the locale.  pText need not be terminated.  chunkSize 0
+    // sizes chunks for the job pool, anything else forces chunks of about that many
+    // bytes, however many that makes; results are the same either way.
+    bool    SvrParseObj(const char* pText, size_t size, SvrObjData& obj, size_t chunkSize = 0);
+
+    // Area weighted average of the faces around each position, for faces without normals
+    void    SvrGenerateObjNormals(const SvrObjData& obj, std::vector<float>& normals);
+
+    // One shape per group: corners merged into vertices, missing normals generated and
+    // the triangles optimized (svrMeshOptimizer.h).  Optimized shapes also get up to
+    // maxLods levels of detail appended to their indices (svrMeshSimplify.h).  Shapes
+    // are built on the job pool.
+    void    SvrBuildObjShapes(const SvrObjData& obj, std::vector<SvrObjShape>& shapes, bool optimize = true, int maxLods = 1);
+
+    // Parses one number at pText, which is left after it.  Only spaces and tabs are
+    // skipped first, so a parse never runs past the end of a line.
+    float   SvrParseObjFloat(const char*& pText);
+}
@@ -0,0 +1,398 @@
+//=============================================================================
+// FILE: svrOcclusion.cpp
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "svrCpuTimer.h"
+#include "svrJobs.h"
+#include "svrOcclusion.h"
+#include "svrSimd.h"
+#include "svrUtil.h"
+
+namespace Svr
+{
+
+//-----------------------------------------------------------------------------
+SvrOcclusionBuffer::SvrOcclusionBuffer()
+//-----------------------------------------------------------------------------
+    : mWidth(0)
+    , mHeight(0)
+    , mBinsX(0)
+    , mBinsY(0)
+    , mTilesX(0)
+    , mTilesY(0)
+    , mViewProjection(1.0f)
+{
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+//-----------------------------------------------------------------------------
+void SvrOcclusionBuffer::Initialize(int width, int height)
+//-----------------------------------------------------------------------------
+{
+    if (width % SVR_OCCLUSION_BIN_WIDTH != 0 || height % SVR_OCCLUSION_BIN_HEIGHT != 0)
+    {
+        LOGE("SvrOcclusionBuffer: %dx%d is not a multiple of the %dx%d bins, rounding up", width, height,
+             SVR_OCCLUSION_BIN_WIDTH, SVR_OCCLUSION_BIN_HEIGHT);
+        width = (width + SVR_OCCLUSION_BIN_WIDTH - 1) / SVR_OCCLUSION_BIN_WIDTH * SVR_OCCLUSION_BIN_WIDTH;
+        height = (height + SVR_OCCLUSION_BIN_HEIGHT - 1) / SVR_OCCLUSION_BIN_HEIGHT * SVR_OCCLUSION_BIN_HEIGHT;
+    }
+
+    mWidth = width;
+    mHeight = height;
+    mBinsX = width / SVR_OCCLUSION_BIN_WIDTH;
+    mBinsY = height / SVR_OCCLUSION_BIN_HEIGHT;
+    mTilesX = width / SVR_OCCLUSION_TILE_SIZE;
+    mTilesY = height / SVR_OCCLUSION_TILE_SIZE;
+
+    mDepth.assign(mWidth * mHeight, 0.0f);
+    mTileDepth.assign(mTilesX * mTilesY, 0.0f);
+    mBins.resize(mBinsX * mBinsY);
+}
+
+//-----------------------------------------------------------------------------
+void SvrOcclusionBuffer::Destroy()
+//-----------------------------------------------------------------------------
+{
+    std::vector<float>().swap(mDepth);
+    std::vector<float>().swap(mTileDepth);
+    std::vector<Triangle>().swap(mTriangles);
+    std::vector<std::vector<uint32_t> >().swap(mBins);
+    std::vector<glm::vec4>().swap(mScratch);
+    mWidth = 0;
+    mHeight = 0;
+}
+
+//-----------------------------------------------------------------------------
+void SvrOcclusionBuffer::Begin(const glm::mat4& viewProjection)
+//-----------------------------------------------------------------------------
+{
+    mViewProjection = viewProjection;
+
+    std::fill(mDepth.begin(), mDepth.end(), 0.0f);
+    std::fill(mTileDepth.begin(), mTileDepth.end(), 0.0f);
+    mTriangles.clear();
+    for (size_t i = 0; i < mBins.size(); i++)
+    {
+        mBins[i].clear();
+    }
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+//-----------------------------------------------------------------------------
+void SvrOcclusionBuffer::AddOccluder(const void* pVertices, int vertexStride, int numVertices,
+                                     const uint32_t* pIndices, int numIndices, const glm::mat4& modelMatrix)
+//-----------------------------------------------------------------------------
+{
+    uint64_t startTime = GetTimeNano();
+
+    // Vertices to pixels, those too near the eye are flagged with a negative w
+    glm::mat4 transform = mViewProjection * modelMatrix;
+    mScratch.resize(numVertices);
+    for (int i = 0; i < numVertices; i++)
+    {
+        const float* pPosition = (const float*)((const char*)pVertices + (size_t)i * vertexStride);
+        glm::vec4 clip = transform * glm::vec4(pPosition[0], pPosition[1], pPosition[2], 1.0f);
+        if (clip.w < SVR_OCCLUSION_MIN_W)
+        {
+            mScratch[i] = glm::vec4(0.0f, 0.0f, 0.0f, -1.0f);
+            continue;
+        }
+
+        float invW = 1.0f / clip.w;
+        mScratch[i] = glm::vec4((clip.x * invW * 0.5f + 0.5f) * mWidth,
+                                (clip.y * invW * 0.5f + 0.5f) * mHeight,
+                                invW, clip.w);
+    }
+
+    for (int i = 0; i + 2 < numIndices; i += 3)
+    {
+        mStats.numOccluderTriangles++;
+
+        glm::vec4 a = mScratch[pIndices[i]];
+        glm::vec4 b = mScratch[pIndices[i + 1]];
+        glm::vec4 c = mScratch[pIndices[i + 2]];
+        if (a.w < 0.0f || b.w < 0.0f || c.w < 0.0f)
+        {
+            continue;
+        }
+
+        // Pixels whose centers the triangle's bounds hold
+        int minX = std::max(0, (int)ceilf(std::min(a.x, std::min(b.x, c.x)) - 0.5f));
+        int maxX = std::min(mWidth - 1, (int)floorf(std::max(a.x, std::max(b.x, c.x)) - 0.5f));
+        int minY = std::max(0, (int)ceilf(std::min(a.y, std::min(b.y, c.y)) - 0.5f));
+        int maxY = std::min(mHeight - 1, (int)floorf(std::max(a.y, std::max(b.y, c.y)) - 0.5f));
+        if (minX > maxX || minY > maxY)
+        {
+            continue;
+        }
+
+        float area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+        if (area == 0.0f)
+        {
+            continue;
+        }
+        if (area < 0.0f)
+        {
+            std::swap(b, c);
+            area = -area;
+        }
+
+        Triangle triangle;
+        const glm::vec4* corners[3] = { &a, &b, &c };
+        for (int e = 0; e < 3; e++)
+        {
+            const glm::vec4& p = *corners[e];
+            const glm::vec4& q = *corners[(e + 1) % 3];
+            triangle.edges[e][0] = p.y - q.y;
+            triangle.edges[e][1] = q.x - p.x;
+            triangle.edges[e][2] = p.x * q.y - q.x * p.y;
+
+            // Moved in by half a pixel, a center passes only when its whole pixel is inside
+            triangle.edges[e][2] -= 0.5f * (fabsf(triangle.edges[e][0]) + fabsf(triangle.edges[e][1]));
+        }
+
+        // 1/w is linear in screen space, taken at the farthest corner of each pixel
+        float dz1 = b.z - a.z;
+        float dz2 = c.z - a.z;
+        triangle.depth[0] = (dz1 * (c.y - a.y) - dz2 * (b.y - a.y)) / area;
+        triangle.depth[1] = (dz2 * (b.x - a.x) - dz1 * (c.x - a.x)) / area;
+        triangle.depth[2] = a.z - triangle.depth[0] * a.x - triangle.depth[1] * a.y;
+        triangle.depth[2] -= 0.5f * (fabsf(triangle.depth[0]) + fabsf(triangle.depth[1]));
+        triangle.minX = minX;
+        triangle.minY = minY;
+        triangle.maxX = maxX;
+        triangle.maxY = maxY;
+
+        uint32_t index = (uint32_t)mTriangles.size();
+        mTriangles.push_back(triangle);
+        mStats.numRasterTriangles++;
+
+        for (int by = minY / SVR_OCCLUSION_BIN_HEIGHT; by <= maxY / SVR_OCCLUSION_BIN_HEIGHT; by++)
+        {
+            for (int bx = minX / SVR_OCCLUSION_BIN_WIDTH; bx <= maxX / SVR_OCCLUSION_BIN_WIDTH; bx++)
+            {
+                mBins[by * mBinsX + bx].push_back(index);
+                mStats.numBinnedTriangles++;
+            }
+        }
+    }
+
+    mStats.setupMs += (GetTimeNano() - startTime) * NANOSECONDS_TO_MILLISECONDS;
+}
+
+//-----------------------------------------------------------------------------
+void SvrOcclusionBuffer::RasterizeBins(void* pContext, int begin, int end)
+//-----------------------------------------------------------------------------
+{
+    SvrOcclusionBuffer* pBuffer = (SvrOcclusionBuffer*)pContext;
+    for (int bin = begin; bin < end; bin++)
+    {
+        pBuffer->RasterizeBin(bin);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void SvrOcclusionBuffer::RasterizeBin(int bin)
+//-----------------------------------------------------------------------------
+{
+    // Bins own their pixels, so they run in parallel without sharing anything
+    int binX0 = (bin % mBinsX) * SVR_OCCLUSION_BIN_WIDTH;
+    int binY0 = (bin / mBinsX) * SVR_OCCLUSION_BIN_HEIGHT;
+    int binX1 = binX0 + SVR_OCCLUSION_BIN_WIDTH - 1;
+    int binY1 = binY0 + SVR_OCCLUSION_BIN_HEIGHT - 1;
+
+    const SvrFloat4 laneOffsets = SvrSet4(0.5f, 1.5f, 2.5f, 3.5f);
+    const SvrFloat4 zero = SvrSplat4(0.0f);
+
+    const std::vector<uint32_t>& triangles = mBins[bin];
+    for (size_t t = 0; t < triangles.size(); t++)
+    {
+        const Triangle& triangle = mTriangles[triangles[t]];
+
+        // Four pixel groups stay inside the bin since bins are a multiple of four wide
+        int minX = std::max(triangle.minX, binX0) & ~3;
+        int maxX = std::min(triangle.maxX, binX1);
+        int minY = std::max(triangle.minY, binY0);
+        int maxY = std::min(triangle.maxY, binY1);
+
+        SvrFloat4 edgeA0 = SvrSplat4(triangle.edges[0][0]);
+        SvrFloat4 edgeA1 = SvrSplat4(triangle.edges[1][0]);
+        SvrFloat4 edgeA2 = SvrSplat4(triangle.edges[2][0]);
+        SvrFloat4 depthA = SvrSplat4(triangle.depth[0]);
+
+        for (int y = minY; y <= maxY; y++)
+        {
+            float centerY = y + 0.5f;
+            SvrFloat4 edgeRow0 = SvrSplat4(triangle.edges[0][1] * centerY + triangle.edges[0][2]);
+            SvrFloat4 edgeRow1 = SvrSplat4(triangle.edges[1][1] * centerY + triangle.edges[1][2]);
+            SvrFloat4 edgeRow2 = SvrSplat4(triangle.edges[2][1] * centerY + triangle.edges[2][2]);
+            SvrFloat4 depthRow = SvrSplat4(triangle.depth[1] * centerY + triangle.depth[2]);
+
+            float* pRow = &mDepth[y * mWidth];
+            for (int x = minX; x <= maxX; x += 4)
+            {
+                SvrFloat4 centerX = SvrAdd4(SvrSplat4((float)x), laneOffsets);
+                SvrFloat4 inside = SvrAnd4(SvrAnd4(SvrGreater4(SvrAdd4(SvrMul4(edgeA0, centerX), edgeRow0), zero),
+                                            SvrGreater4(SvrAdd4(SvrMul4(edgeA1, centerX), edgeRow1), zero)),
+                                      SvrGreater4(SvrAdd4(SvrMul4(edgeA2, centerX), edgeRow2), zero));
+
+                SvrFloat4 depth = SvrAdd4(SvrMul4(depthA, centerX), depthRow);
+                SvrFloat4 previous = SvrLoad4(pRow + x);
+                SvrStore4(pRow + x, SvrSelect4(inside, SvrMax4(previous, depth), previous));
+            }
+        }
+    }
+
+    // Farthest depth of each tile of the bin
+    for (int ty = binY0 / SVR_OCCLUSION_TILE_SIZE; ty <= binY1 / SVR_OCCLUSION_TILE_SIZE; ty++)
+    {
+        for (int tx = binX0 / SVR_OCCLUSION_TILE_SIZE; tx <= binX1 / SVR_OCCLUSION_TILE_SIZE; tx++)
+        {
+            const float* pTile = &mDepth[ty * SVR_OCCLUSION_TILE_SIZE * mWidth + tx * SVR_OCCLUSION_TILE_SIZE];
+            SvrFloat4 farthest = SvrLoad4(pTile);
+            for (int y = 0; y < SVR_OCCLUSION_TILE_SIZE; y++)
+            {
+                for (int x = 0; x < SVR_OCCLUSION_TILE_SIZE; x += 4)
+                {
+                    farthest = SvrMin4(farthest, SvrLoad4(pTile + y * mWidth + x));
+                }
+            }
+            mTileDepth[ty * mTilesX + tx] = SvrMinLane4(farthest);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void SvrOcclusionBuffer::Rasterize(bool parallel)
+//-----------------------------------------------------------------------------
+{
+    uint64_t startTime = GetTimeNano();
+
+    int numBins = mBinsX * mBinsY;
+    if (parallel)
+    {
+        SvrParallelFor(numBins, 1, RasterizeBins, this);
+    }
+    else
+    {
+        RasterizeBins(this, 0, numBins);
+    }
+
+    mStats.rasterMs += (GetTimeNano() - startTime) * NANOSECONDS_TO_MILLISECONDS;
+}
+
+//-----------------------------------------------------------------------------
+bool SvrOcclusionBuffer::IsBoxVisible(const glm::vec3& boxMin, const glm::vec3& boxMax) const
+//-----------------------------------------------------------------------------
+{
+    // Screen bounds and nearest depth of the corners.  Corners are the first one plus
+    // the transformed box edges, one matrix multiply rather than eight.
+    glm::vec4 origin = mViewProjection * glm::vec4(boxMin, 1.0f);
+    glm::vec4 axisX = mViewProjection[0] * (boxMax.x - boxMin.x);
+    glm::vec4 axisY = mViewProjection[1] * (boxMax.y - boxMin.y);
+    glm::vec4 axisZ = mViewProjection[2] * (boxMax.z - boxMin.z);
+
+    float minX = (float)mWidth;
+    float maxX = 0.0f;
+    float minY = (float)mHeight;
+    float maxY = 0.0f;
+    float nearest = 0.0f;
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec4 clip = origin;
+        if (i & 1) clip += axisX;
+        if (i & 2) clip += axisY;
+        if (i & 4) clip += axisZ;
+        if (clip.w < SVR_OCCLUSION_MIN_W)
+        {
+            return true;
+        }
+
+        float invW = 1.0f / clip.w;
+        float x = (clip.x * invW * 0.5f + 0.5f) * mWidth;
+        float y = (clip.y * invW * 0.5f + 0.5f) * mHeight;
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        nearest = std::max(nearest, invW);
+    }
+
+    // Every pixel the box touches, not only those whose centers it holds
+    int x0 = std::max(0, (int)floorf(minX));
+    int x1 = std::min(mWidth - 1, (int)floorf(maxX));
+    int y0 = std::max(0, (int)floorf(minY));
+    int y1 = std::min(mHeight - 1, (int)floorf(maxY));
+    if (x0 > x1 || y0 > y1)
+    {
+        return true;
+    }
+
+    const SvrFloat4 nearestDepth = SvrSplat4(nearest);
+    for (int ty = y0 / SVR_OCCLUSION_TILE_SIZE; ty <= y1 / SVR_OCCLUSION_TILE_SIZE; ty++)
+    {
+        for (int tx = x0 / SVR_OCCLUSION_TILE_SIZE; tx <= x1 / SVR_OCCLUSION_TILE_SIZE; tx++)
+        {
+            // Occluders all over the tile are nearer than any of the box
+            if (mTileDepth[ty * mTilesX + tx] > nearest)
+            {
+                continue;
+            }
+
+            // Otherwise the pixels the box covers decide
+            int px0 = std::max(x0, tx * SVR_OCCLUSION_TILE_SIZE);
+            int px1 = std::min(x1, tx * SVR_OCCLUSION_TILE_SIZE + SVR_OCCLUSION_TILE_SIZE - 1);
+            int py0 = std::max(y0, ty * SVR_OCCLUSION_TILE_SIZE);
+            int py1 = std::min(y1, ty * SVR_OCCLUSION_TILE_SIZE + SVR_OCCLUSION_TILE_SIZE - 1);
+            for (int y = py0; y <= py1; y++)
+            {
+                const float* pRow = &mDepth[y * mWidth];
+                for (int x = px0 & ~3; x <= px1; x += 4)
+                {
+                    unsigned int lanes = (0xf << std::max(0, px0 - x)) & (0xf >> std::max(0, x + 3 - px1)) & 0xf;
+                    unsigned int hidden = SvrMaskBits4(SvrGreater4(SvrLoad4(pRow + x), nearestDepth));
+                    if ((lanes & ~hidden) != 0)
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+int SvrOcclusionBuffer::FilterVisible(const SvrCullScene& scene, uint32_t* pIndices, int count)
+//-----------------------------------------------------------------------------
+{
+    uint64_t startTime = GetTimeNano();
+
+    int numVisible = 0;
+    for (int i = 0; i < count; i++)
+    {
+        glm::vec3 boxMin;
+        glm::vec3 boxMax;
+        scene.GetBounds(pIndices[i], boxMin, boxMax);
+        if (IsBoxVisible(boxMin, boxMax))
+        {
+            pIndices[numVisible++] = pIndices[i];
+        }
+    }
+
+    mStats.numTested += count;
+    mStats.numOccluded += count - numVisible;
+    mStats.testMs += (GetTimeNano() - startTime) * NANOSECONDS_TO_MILLISECONDS;
+    return numVisible;
+}
+
+}
@@ -0,0 +1,125 @@
+//=============================================================================
+// FILE: svrOcclusion.h
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "svrCulling.h"
+
+// Default depth buffer size.  Occluders only need to be coarse, and the cost is
+// per pixel.
+#define SVR_OCCLUSION_WIDTH         256
+#define SVR_OCCLUSION_HEIGHT        192
+
+// Screen regions rasterized as one job, and the depth tiles of the hierarchy.  The
+// buffer size must be a multiple of the bin size.
+#define SVR_OCCLUSION_BIN_WIDTH     64
+#define SVR_OCCLUSION_BIN_HEIGHT    32
+#define SVR_OCCLUSION_TILE_SIZE     8
+
+// Occluder triangles and occludee boxes with a vertex this close to the eye plane
+// are dropped and kept visible respectively, rather than clipped
+#define SVR_OCCLUSION_MIN_W         1.0e-3f
+
+namespace Svr
+{
+    struct SvrOcclusionStats
+    {
+        unsigned int    numOccluderTriangles;   // Submitted
+        unsigned int    numRasterTriangles;     // Left after near plane, size and screen rejection
+        unsigned int    numBinnedTriangles;     // Triangle bin pairs, more than raster when they straddle bins
+        unsigned int    numTested;
+        unsigned int    numOccluded;
+        float           setupMs;                // Transform, triangle setup and binning
+        float           rasterMs;               // Rasterization and depth hierarchy
+        float           testMs;                 // FilterVisible
+    };
+
+    // CPU occlusion culling against a low resolution depth buffer.  Designated occluder
+    // meshes (walls, floors, large props; simple and closed works best) are rasterized
+    // with SIMD half space tests, four pixels at a time, and the buffer is reduced to the
+    // farthest depth of each tile.  Occludee boxes then test their nearest depth
+    // against the tiles they cover, and the pixels of tiles that do not settle it.
+    //
+    // Depth is 1/w, larger is nearer, the buffer clears to 0.  A pixel only takes an
+    // occluder's depth when the whole pixel is inside the triangle, and then the
+    // triangle's farthest depth across it, so occluders can only come out smaller and
+    // farther than they are: culling is conservative.
+    //
+    //  Begin           once per frame with the view's projection * view
+    //  AddOccluder     per occluder mesh, transforms and bins its triangles
+    //  Rasterize       renders the bins, on the job pool when parallel
+    //  IsBoxVisible / FilterVisible, before draws are queued
+    //
+    // One buffer sees from one point.  For stereo keep one per eye and cull only what
+    // both report hidden, a single center view would miss what one eye sees around an
+    // edge.  Everything runs on the CPU, so results are the same on any platform.
+    class SvrOcclusionBuffer
+    {
+    public:
+        SvrOcclusionBuffer();
+
+        void    Initialize(int width = SVR_OCCLUSION_WIDTH, int height = SVR_OCCLUSION_HEIGHT);
+        void    Destroy();
+
+        void    Begin(const glm::mat4& viewProjection);
+
+        // Positions are 3 floats at the start of each vertex.  Triangles are two sided.
+        void    AddOccluder(const void* pVertices, int vertexStride, int numVertices,
+                            const uint32_t* pIndices, int numIndices, const glm::mat4& modelMatrix);
+
+        void    Rasterize(bool parallel = true);
+
+        // World space box.  Boxes reaching behind the eye, or off the buffer, are visible.
+        bool    IsBoxVisible(const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+
+        // Removes the objects hidden behind occluders from a list of indices into scene,
+        // e.g. the output of SvrCullScene::Cull, keeping the order.  Returns the new count.
+        int     FilterVisible(const SvrCullScene& scene, uint32_t* pIndices, int count);
+
+        int     GetWidth() const { return mWidth; }
+        int     GetHeight() const { return mHeight; }
+        const float* GetDepth() const { return mDepth.empty() ? NULL : &mDepth[0]; }
+        const SvrOcclusionStats& GetStats() const { return mStats; }
+
+    private:
+        // Edge functions and the 1/w plane, all in pixels, with the pixel bounds
+        struct Triangle
+        {
+            float   edges[3][3];
+            float   depth[3];
+            int     minX;
+            int     minY;
+            int     maxX;
+            int     maxY;
+        };
+
+        static void RasterizeBins(void* pContext, int begin, int end);
+        void    RasterizeBin(int bin);
+
+        int                     mWidth;
+        int                     mHeight;
+        int                     mBinsX;
+        int                     mBinsY;
+        int                     mTilesX;
+        int                     mTilesY;
+
+        glm::mat4               mViewProjection;
+        std::vector<float>      mDepth;
+        std::vector<float>      mTileDepth;     // Farthest depth per tile
+        std::vector<Triangle>   mTriangles;
+        std::vector<std::vector<uint32_t> > mBins;
+        std::vector<glm::vec4>  mScratch;       // Screen x, y, 1/w and w per occluder vertex
+
+        SvrOcclusionStats       mStats;
+    };
+}
@@ -0,0 +1,651 @@
+//=============================================================================
+// FILE: svrRenderGraph.cpp
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#include <stdio.h>
+#include <string.h>
+#include <GLES3/gl3.h>
+
+#include <algorithm>
+
+#include "svrCpuTimer.h"
+#include "svrRenderGraph.h"
+#include "svrUtil.h"
+
+// Attachment bits as indices, for the per resource tables
+#define GRAPH_NUM_ATTACHMENTS   2
+
+namespace Svr
+{
+
+//-----------------------------------------------------------------------------
+static inline int L_CountBits(int attachments)
+//-----------------------------------------------------------------------------
+{
+    return ((attachments & kAttachmentColor) ? 1 : 0) + ((attachments & kAttachmentDepth) ? 1 : 0);
+}
+
+//-----------------------------------------------------------------------------
+static const char* L_AttachmentNames(int attachments)
+//-----------------------------------------------------------------------------
+{
+    static const char* names[] = { "-", "color", "depth", "color+depth" };
+    return names[attachments & kAttachmentAll];
+}
+
+//-----------------------------------------------------------------------------
+SvrRenderGraph::SvrRenderGraph()
+//-----------------------------------------------------------------------------
+    : mPool(NULL)
+    , mCompiled(false)
+{
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+//-----------------------------------------------------------------------------
+void SvrRenderGraph::Initialize(SvrRenderTargetPool* pPool)
+//-----------------------------------------------------------------------------
+{
+    mPool = pPool;
+    Reset();
+}
+
+//-----------------------------------------------------------------------------
+void SvrRenderGraph::Destroy()
+//-----------------------------------------------------------------------------
+{
+    mPool = NULL;
+    mCompiled = false;
+    std::vector<Resource>().swap(mResources);
+    std::vector<Pass>().swap(mPasses);
+    std::vector<ReadEntry>().swap(mReads);
+    std::vector<Dependency>().swap(mDependencies);
+    std::vector<Target>().swap(mTargets);
+    std::vector<int>().swap(mLastWriter);
+}
+
+//-----------------------------------------------------------------------------
+void SvrRenderGraph::Reset()
+//-----------------------------------------------------------------------------
+{
+    // Storage is kept for the next frame
+    mCompiled = false;
+    mResources.clear();
+    mPasses.clear();
+    mReads.clear();
+    mDependencies.clear();
+    mTargets.clear();
+}
+
+//-----------------------------------------------------------------------------
+SvrGraphResource SvrRenderGraph::CreateTarget(const char* pName, const SvrRenderTargetDesc& desc)
+//-----------------------------------------------------------------------------
+{
+    Resource resource;
+    resource.pName = pName;
+    resource.desc = desc;
+    resource.imported = false;
+    resource.framebufferId = 0;
+    resource.firstPass = -1;
+    resource.lastPass = -1;
+    resource.target = -1;
+    mResources.push_back(resource);
+    return (SvrGraphResource)mResources.size() - 1;
+}
+
+//-----------------------------------------------------------------------------
+SvrGraphResource SvrRenderGraph::ImportTarget(const char* pName, unsigned int framebufferId, int width, int height,
+                                              bool hasDepth)
+//-----------------------------------------------------------------------------
+{
+    Resource resource;
+    resource.pName = pName;
+    resource.desc.width = width;
+    resource.desc.height = height;
+    resource.desc.samples = 1;
+    resource.desc.colorSizedFormat = 0;
+    resource.desc.requiresDepth = hasDepth;
+    resource.imported = true;
+    resource.framebufferId = framebufferId;
+    resource.firstPass = -1;
+    resource.lastPass = -1;
+    resource.target = -1;
+    mResources.push_back(resource);
+    return (SvrGraphResource)mResources.size() - 1;
+}
+
+//-----------------------------------------------------------------------------
+int SvrRenderGraph::AddPass(const char* pName, SvrGraphPassFn pfnExecute, void* pUser)
+//-----------------------------------------------------------------------------
+{
+    Pass pass;
+    pass.pName = pName;
+    pass.pfnExecute = pfnExecute;
+    pass.pUser = pUser;
+    pass.resource = -1;
+    pass.writeAttachments = 0;
+    pass.clearAttachments = 0;
+    pass.clearColor = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+    pass.clearDepth = 1.0f;
+    pass.sideEffect = false;
+    pass.kept = false;
+    pass.loadAttachments = 0;
+    pass.storeAttachments = 0;
+    pass.continuesRun = false;
+    pass.endsRun = true;
+    mPasses.push_back(pass);
+    mCompiled = false;
+    return (int)mPasses.size() - 1;
+}
+
+//-----------------------------------------------------------------------------
+void SvrRenderGraph::Write(int pass, SvrGraphResource resource, int attachments, int clearAttachments)
+//-----------------------------------------------------------------------------
+{
+    Pass& p = mPasses[pass];
+    if (p.resource >= 0 && p.resource != resource)
+    {
+        LOGE("SvrRenderGraph: Pass %s already writes %s", p.pName, mResources[p.resource].pName);
+        return;
+    }
+
+    int available = kAttachmentColor | (mResources[resource].desc.requiresDepth ? kAttachmentDepth : 0);
+    p.resource = resource;
+    p.writeAttachments |= (attachments | clearAttachments) & available;
+    p.clearAttachments |= clearAttachments & available;
+}
+
+//-----------------------------------------------------------------------------
+void SvrRenderGraph::SetClearValues(int pass, const glm::vec4& color, float depth)
+//-----------------------------------------------------------------------------
+{
+    mPasses[pass].clearColor = color;
+    mPasses[pass].clearDepth = depth;
+}
+
+//-----------------------------------------------------------------------------
+void SvrRenderGraph::Read(int pass, SvrGraphResource resource)
+//-----------------------------------------------------------------------------
+{
+    ReadEntry entry;
+    entry.pass = pass;
+    entry.resource = resource;
+    mReads.push_back(entry);
+}
+
+//-----------------------------------------------------------------------------
+void SvrRenderGraph::SetSideEffect(int pass)
+//-----------------------------------------------------------------------------
+{
+    mPasses[pass].sideEffect = true;
+}
+
+//-----------------------------------------------------------------------------
+void SvrRenderGraph::AddDependency(int consumer, int producer, SvrGraphResource resource, int attachment, bool load)
+//-----------------------------------------------------------------------------
+{
+    Dependency dependency;
+    dependency.consumer = consumer;
+    dependency.producer = producer;
+    dependency.resource = resource;
+    dependency.attachment = attachment;
+    dependency.load = load;
+    mDependencies.push_back(dependency);
+}
+
+//-----------------------------------------------------------------------------
+bool SvrRenderGraph::Compile()
+//-----------------------------------------------------------------------------
+{
+    uint64_t startTime = GetTimeNano();
+    bool valid = true;
+
+    int numPasses = (int)mPasses.size();
+    int numResources = (int)mResources.size();
+
+    // Reads are usually declared right after their pass, only sort when they are not
+    for (size_t r = 1; r < mReads.size(); r++)
+    {
+        if (mReads[r].pass < mReads[r - 1].pass)
+        {
+            std::sort(mReads.begin(), mReads.end(), ReadLess);
+            break;
+        }
+    }
+
+    // Forward: who each read and each draw over earlier contents depends on
+    mDependencies.clear();
+    mLastWriter.assign(numResources * GRAPH_NUM_ATTACHMENTS, -1);
+    size_t read = 0;
+    for (int p = 0; p < numPasses; p++)
+    {
+        Pass& pass = mPasses[p];
+        pass.kept = pass.sideEffect || (pass.resource >= 0 && mResources[pass.resource].imported);
+        pass.loadAttachments = 0;
+        pass.storeAttachments = 0;
+
+        for (; read < mReads.size() && mReads[read].pass == p; read++)
+        {
+            SvrGraphResource resource = mReads[read].resource;
+            int producer = mLastWriter[resource * GRAPH_NUM_ATTACHMENTS + 0];
+            if (producer >= 0)
+            {
+                AddDependency(p, producer, resource, kAttachmentColor, false);
+            }
+            else if (!mResources[resource].imported)
+            {
+                LOGE("SvrRenderGraph: Pass %s reads %s before any pass writes it", pass.pName, mResources[resource].pName);
+                valid = false;
+            }
+        }
+
+        if (pass.resource < 0)
+        {
+            continue;
+        }
+
+        for (int a = 0; a < GRAPH_NUM_ATTACHMENTS; a++)
+        {
+            int attachment = 1 << a;
+            int& lastWriter = mLastWriter[pass.resource * GRAPH_NUM_ATTACHMENTS + a];
+            if ((pass.writeAttachments & attachment) && !(pass.clearAttachments & attachment))
+            {
+                if (lastWriter >= 0)
+                {
+                    AddDependency(p, lastWriter, pass.resource, attachment, true);
+                }
+                else if (mResources[pass.resource].imported)
+                {
+                    // Drawing over what the last frame, or someone else, left there
+                    pass.loadAttachments |= attachment;
+                }
+            }
+            if (pass.writeAttachments & attachment)
+            {
+                lastWriter = p;
+            }
+        }
+    }
+
+    // Backward: consumers come after their producers, so walking the dependencies in
+    // reverse settles every consumer before its producers are looked at
+    for (size_t d = mDependencies.size(); d-- > 0; )
+    {
+        const Dependency& dependency = mDependencies[d];
+        if (!mPasses[dependency.consumer].kept)
+        {
+            continue;
+        }
+
+        Pass& producer = mPasses[dependency.producer];
+        producer.kept = true;
+        producer.storeAttachments |= dependency.attachment;
+        if (dependency.load)
+        {
+            mPasses[dependency.consumer].loadAttachments |= dependency.attachment;
+        }
+
+        // Passes in between that draw into the same target but not this attachment
+        // have to carry it through
+        for (int p = dependency.producer + 1; p < dependency.consumer; p++)
+        {
+            Pass& between = mPasses[p];
+            if (between.resource == dependency.resource && !(between.writeAttachments & dependency.attachment))
+            {
+                between.loadAttachments |= dependency.attachment;
+                between.storeAttachments |= dependency.attachment;
+            }
+        }
+    }
+
+    // Lifetimes over the kept passes
+    for (int r = 0; r < numResources; r++)
+    {
+        mResources[r].firstPass = -1;
+        mResources[r].lastPass = -1;
+        mResources[r].target = -1;
+    }
+
+    memset(&mStats, 0, sizeof(mStats));
+    mStats.numPasses = numPasses;
+    mStats.numResources = numResources;
+
+    read = 0;
+    int previous = -1;
+    for (int p = 0; p < numPasses; p++)
+    {
+        Pass& pass = mPasses[p];
+        if (!pass.kept)
+        {
+            mStats.numCulled++;
+            for (; read < mReads.size() && mReads[read].pass == p; read++)
+            {
+            }
+            continue;
+        }
+
+        for (; read < mReads.size() && mReads[read].pass == p; read++)
+        {
+            Resource& resource = mResources[mReads[read].resource];
+            resource.firstPass = (resource.firstPass < 0) ? p : resource.firstPass;
+            resource.lastPass = p;
+        }
+
+        // A pass drawing on where the kept pass before it left off, without clearing,
+        // runs in the same render pass: nothing goes to memory and back in between
+        pass.continuesRun = (previous >= 0 && pass.resource >= 0 && mPasses[previous].resource == pass.resource &&
+                             pass.clearAttachments == 0);
+        pass.endsRun = true;
+        if (pass.continuesRun)
+        {
+            mPasses[previous].endsRun = false;
+        }
+        previous = p;
+
+        if (pass.resource >= 0)
+        {
+            Resource& resource = mResources[pass.resource];
+            resource.firstPass = (resource.firstPass < 0) ? p : resource.firstPass;
+            resource.lastPass = p;
+
+            if (resource.imported)
+            {
+                pass.storeAttachments |= pass.writeAttachments & kAttachmentColor;
+            }
+        }
+    }
+
+    for (int p = 0; p < numPasses; p++)
+    {
+        const Pass& pass = mPasses[p];
+        if (!pass.kept || pass.resource < 0)
+        {
+            continue;
+        }
+
+        const Resource& resource = mResources[pass.resource];
+        int available = kAttachmentColor | (resource.desc.requiresDepth ? kAttachmentDepth : 0);
+        mStats.numClears += L_CountBits(pass.clearAttachments);
+        if (!pass.continuesRun)
+        {
+            mStats.numLoads += L_CountBits(pass.loadAttachments);
+            mStats.numInvalidates += L_CountBits(available & ~pass.loadAttachments & ~pass.clearAttachments);
+        }
+        if (pass.endsRun)
+        {
+            mStats.numStores += L_CountBits(pass.storeAttachments);
+            mStats.numInvalidates += L_CountBits(available & ~pass.storeAttachments);
+        }
+    }
+
+    // Transient resources in order of first use take the first pool target of their
+    // description that is free by then
+    mTargets.clear();
+    for (int p = 0; p < numPasses; p++)
+    {
+        const Pass& pass = mPasses[p];
+        if (!pass.kept || pass.resource < 0)
+        {
+            continue;
+        }
+
+        Resource& resource = mResources[pass.resource];
+        if (resource.imported || resource.firstPass != p)
+        {
+            continue;
+        }
+
+        for (size_t t = 0; t < mTargets.size(); t++)
+        {
+            const Target& target = mTargets[t];
+            if (target.lastPass < p && target.desc.width == resource.desc.width &&
+                target.desc.height == resource.desc.height && target.desc.samples == resource.desc.samples &&
+                target.desc.colorSizedFormat == resource.desc.colorSizedFormat &&
+                target.desc.requiresDepth == resource.desc.requiresDepth)
+            {
+                resource.target = (int)t;
+                break;
+            }
+        }
+        if (resource.target < 0)
+        {
+            Target target;
+            target.desc = resource.desc;
+            target.pTarget = NULL;
+            mTargets.push_back(target);
+            resource.target = (int)mTargets.size() - 1;
+        }
+        mTargets[resource.target].lastPass = resource.lastPass;
+    }
+
+    // Transients only ever read were warned about above
+    for (int r = 0; r < numResources; r++)
+    {
+        const Resource& resource = mResources[r];
+        if (!resource.imported && resource.firstPass >= 0 && resource.target < 0)
+        {
+            valid = false;
+        }
+    }
+
+    mStats.numTargets = (unsigned int)mTargets.size();
+    mStats.compileMs = (GetTimeNano() - startTime) * 1.0e-6f;
+    mCompiled = valid;
+    return valid;
+}
+
+//-----------------------------------------------------------------------------
+static void L_InvalidateImported(unsigned int framebufferId, int attachments)
+//-----------------------------------------------------------------------------
+{
+    // The window's buffers have their own names
+    GLenum invalidate[3];
+    int numInvalidate = 0;
+    if (attachments & kAttachmentColor)
+    {
+        invalidate[numInvalidate++] = (framebufferId == 0) ? GL_COLOR : GL_COLOR_ATTACHMENT0;
+    }
+    if (attachments & kAttachmentDepth)
+    {
+        invalidate[numInvalidate++] = (framebufferId == 0) ? GL_DEPTH : GL_DEPTH_ATTACHMENT;
+        invalidate[numInvalidate++] = (framebufferId == 0) ? GL_STENCIL : GL_STENCIL_ATTACHMENT;
+    }
+    if (numInvalidate > 0)
+    {
+        GL(glInvalidateFramebuffer(GL_FRAMEBUFFER, numInvalidate, invalidate));
+    }
+}
+
+//-----------------------------------------------------------------------------
+void SvrRenderGraph::BeginPass(const Pass& pass)
+//-----------------------------------------------------------------------------
+{
+    const Resource& resource = mResources[pass.resource];
+    int available = kAttachmentColor | (resource.desc.requiresDepth ? kAttachmentDepth : 0);
+
+    if (resource.imported)
+    {
+        GL(glBindFramebuffer(GL_FRAMEBUFFER, resource.framebufferId));
+        GL(glViewport(0, 0, resource.desc.width, resource.desc.height));
+        GL(glScissor(0, 0, resource.desc.width, resource.desc.height));
+        L_InvalidateImported(resource.framebufferId, available & ~pass.loadAttachments);
+    }
+    else
+    {
+        mPool->BeginPass(mTargets[resource.target].pTarget, pass.loadAttachments);
+    }
+
+    // Masks gate clears as well as draws
+    GLbitfield clearBits = 0;
+    if (pass.clearAttachments & kAttachmentColor)
+    {
+        GL(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+        GL(glClearColor(pass.clearColor.r, pass.clearColor.g, pass.clearColor.b, pass.clearColor.a));
+        clearBits |= GL_COLOR_BUFFER_BIT;
+    }
+    if (pass.clearAttachments & kAttachmentDepth)
+    {
+        GL(glDepthMask(GL_TRUE));
+        GL(glStencilMask(0xff));
+        GL(glClearDepthf(pass.clearDepth));
+        GL(glClearStencil(0));
+        clearBits |= GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT;
+    }
+    if (clearBits != 0)
+    {
+        GL(glClear(clearBits));
+    }
+}
+
+//-----------------------------------------------------------------------------
+void SvrRenderGraph::EndPass(const Pass& pass)
+//-----------------------------------------------------------------------------
+{
+    const Resource& resource = mResources[pass.resource];
+    if (resource.imported)
+    {
+        int available = kAttachmentColor | (resource.desc.requiresDepth ? kAttachmentDepth : 0);
+        L_InvalidateImported(resource.framebufferId, available & ~pass.storeAttachments);
+    }
+    else
+    {
+        mPool->EndPass(mTargets[resource.target].pTarget, pass.storeAttachments);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void SvrRenderGraph::Execute()
+//-----------------------------------------------------------------------------
+{
+    if (!mCompiled)
+    {
+        LOGE("SvrRenderGraph: Execute without a successful Compile");
+        return;
+    }
+
+    if (!mTargets.empty() && mPool == NULL)
+    {
+        LOGE("SvrRenderGraph: Transient targets need a pool");
+        return;
+    }
+
+    // Aliasing was settled by Compile, each target is leased for the whole frame
+    for (size_t t = 0; t < mTargets.size(); t++)
+    {
+        mTargets[t].pTarget = mPool->Acquire(mTargets[t].desc);
+    }
+
+    for (size_t p = 0; p < mPasses.size(); p++)
+    {
+        const Pass& pass = mPasses[p];
+        if (!pass.kept)
+        {
+            continue;
+        }
+
+        if (pass.resource >= 0 && !pass.continuesRun)
+        {
+            BeginPass(pass);
+        }
+        if (pass.pfnExecute != NULL)
+        {
+            pass.pfnExecute(*this, pass.pUser);
+        }
+        if (pass.resource >= 0 && pass.endsRun)
+        {
+            EndPass(pass);
+        }
+    }
+
+    GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+
+    for (size_t t = 0; t < mTargets.size(); t++)
+    {
+        mPool->Release(mTargets[t].pTarget);
+        mTargets[t].pTarget = NULL;
+    }
+}
+
+//-----------------------------------------------------------------------------
+SvrRenderTarget* SvrRenderGraph::GetTarget(SvrGraphResource resource) const
+//-----------------------------------------------------------------------------
+{
+    const Resource& r = mResources[resource];
+    if (r.imported || r.target < 0)
+    {
+        return NULL;
+    }
+    return mTargets[r.target].pTarget;
+}
+
+//-----------------------------------------------------------------------------
+int SvrRenderGraph::Dump(char* pBuffer, int bufferSize) const
+//-----------------------------------------------------------------------------
+{
+    int length = 0;
+
+#define GRAPH_PRINT(...)                                                                    \
+    length += snprintf(pBuffer + (length < bufferSize ? length : bufferSize),              \
+                       (length < bufferSize) ? bufferSize - length : 0, __VA_ARGS__)
+
+    GRAPH_PRINT("Render graph: %u passes (%u culled), %u resources on %u targets, compiled in %.3f ms\n",
+                mStats.numPasses, mStats.numCulled, mStats.numResources, mStats.numTargets, mStats.compileMs);
+    GRAPH_PRINT("  clears %u, loads %u, stores %u, invalidates %u\n",
+                mStats.numClears, mStats.numLoads, mStats.numStores, mStats.numInvalidates);
+
+    size_t read = 0;
+    for (size_t p = 0; p < mPasses.size(); p++)
+    {
+        const Pass& pass = mPasses[p];
+        GRAPH_PRINT("  %c %2d %-20s", pass.kept ? ' ' : 'x', (int)p, pass.pName);
+        if (pass.resource >= 0)
+        {
+            GRAPH_PRINT(" -> %s (clear %s, load %s, store %s)", mResources[pass.resource].pName,
+                        L_AttachmentNames(pass.clearAttachments),
+                        pass.continuesRun ? "merged" : L_AttachmentNames(pass.loadAttachments),
+                        pass.endsRun ? L_AttachmentNames(pass.storeAttachments) : "merged");
+        }
+        for (bool first = true; read < mReads.size() && mReads[read].pass == (int)p; read++, first = false)
+        {
+            GRAPH_PRINT("%s%s", first ? " reads " : ", ", mResources[mReads[read].resource].pName);
+        }
+        GRAPH_PRINT("%s\n", pass.sideEffect ? " [side effect]" : "");
+    }
+
+    for (size_t r = 0; r < mResources.size(); r++)
+    {
+        const Resource& resource = mResources[r];
+        const SvrRenderTargetDesc& desc = resource.desc;
+        GRAPH_PRINT("    %-20s %dx%d", resource.pName, desc.width, desc.height);
+        if (resource.imported)
+        {
+            GRAPH_PRINT(" imported framebuffer %u", resource.framebufferId);
+        }
+        else
+        {
+            GRAPH_PRINT(" x%d format 0x%x%s", desc.samples, desc.colorSizedFormat, desc.requiresDepth ? " +depth" : "");
+        }
+        if (resource.firstPass < 0)
+        {
+            GRAPH_PRINT(", unused\n");
+        }
+        else
+        {
+            GRAPH_PRINT(", passes %d to %d", resource.firstPass, resource.lastPass);
+            if (resource.target >= 0)
+            {
+                GRAPH_PRINT(", target %d", resource.target);
+            }
+            GRAPH_PRINT("\n");
+        }
+    }
+
+#undef GRAPH_PRINT
+
+    return (length < bufferSize) ? length : bufferSize - 1;
+}
+
+}
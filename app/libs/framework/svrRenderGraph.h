@@ -0,0 +1,175 @@
+//=============================================================================
+// FILE: svrRenderGraph.h
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "svrRenderTargetPool.h"
+
+namespace Svr
+{
+    class SvrRenderGraph;
+
+    typedef int SvrGraphResource;
+
+    // Issues the draws of a pass, its target is bound, cleared and has the viewport set
+    typedef void (*SvrGraphPassFn)(SvrRenderGraph& graph, void* pUser);
+
+    struct SvrRenderGraphStats
+    {
+        unsigned int    numPasses;
+        unsigned int    numCulled;          // Passes nothing needed the output of
+        unsigned int    numResources;
+        unsigned int    numTargets;         // Pool targets behind the transient resources
+        unsigned int    numClears;          // Attachments cleared
+        unsigned int    numLoads;           // Attachments read in at the start of a pass
+        unsigned int    numStores;          // Attachments written back at the end of a pass
+        unsigned int    numInvalidates;     // Attachments neither loaded nor stored
+        float           compileMs;
+    };
+
+    // Rendering of a frame declared as passes and the targets they read and write,
+    // rather than a hand ordered series of binds and clears.  Each frame:
+    //
+    //  Reset
+    //  CreateTarget / ImportTarget     transient targets, or framebuffers owned elsewhere
+    //  AddPass, then Write and Read    what each pass draws into and samples
+    //  Compile                         culls, plans loads, stores and memory
+    //  Execute
+    //
+    // Passes run in the order they were added.  A pass is culled unless it has side
+    // effects, writes an imported target, or writes something a kept pass reads or
+    // draws over.  An attachment is loaded only when a kept pass before wrote it and
+    // this one draws over it without clearing, and stored only when a later pass reads
+    // or loads it (imported color is always stored), everything else is invalidated.
+    // Consecutive kept passes drawing into one target without clearing are merged into
+    // one render pass, with no store and load between them.
+    // Transient targets of the same description whose passes do not overlap share one
+    // target from the pool.
+    //
+    // Names are kept as pointers, pass string literals.  Resource and pass indices are
+    // valid until the next Reset.  A steady frame allocates nothing.
+    class SvrRenderGraph
+    {
+    public:
+        SvrRenderGraph();
+
+        void    Initialize(SvrRenderTargetPool* pPool);
+        void    Destroy();
+
+        void    Reset();
+
+        SvrGraphResource    CreateTarget(const char* pName, const SvrRenderTargetDesc& desc);
+
+        // framebufferId 0 is the window.  The contents are kept from frame to frame.
+        SvrGraphResource    ImportTarget(const char* pName, unsigned int framebufferId, int width, int height,
+                                         bool hasDepth);
+
+        int     AddPass(const char* pName, SvrGraphPassFn pfnExecute, void* pUser);
+
+        // The pass draws into the attachments of resource, at most one resource per pass.
+        // Those in clearAttachments are cleared first, the others keep what earlier
+        // passes drew.
+        void    Write(int pass, SvrGraphResource resource, int attachments = kAttachmentAll, int clearAttachments = 0);
+        void    SetClearValues(int pass, const glm::vec4& color, float depth = 1.0f);
+
+        // The pass samples the color of resource
+        void    Read(int pass, SvrGraphResource resource);
+
+        // Never culled, for passes that work outside the graph (reading pixels back)
+        void    SetSideEffect(int pass);
+
+        bool    Compile();
+        void    Execute();
+
+        // For passes to find what they read, NULL for imported targets and outside Execute
+        SvrRenderTarget*    GetTarget(SvrGraphResource resource) const;
+
+        // The compiled frame as text, a line per pass and per resource.  Returns the
+        // length, truncated to bufferSize.
+        int     Dump(char* pBuffer, int bufferSize) const;
+
+        const SvrRenderGraphStats& GetStats() const { return mStats; }
+
+    private:
+        struct Resource
+        {
+            const char*         pName;
+            SvrRenderTargetDesc desc;
+            bool                imported;
+            unsigned int        framebufferId;
+
+            int                 firstPass;      // Kept passes only, -1 when unused
+            int                 lastPass;
+            int                 target;         // Index into mTargets
+        };
+
+        struct Pass
+        {
+            const char*         pName;
+            SvrGraphPassFn      pfnExecute;
+            void*               pUser;
+            SvrGraphResource    resource;       // -1 without one
+            int                 writeAttachments;
+            int                 clearAttachments;
+            glm::vec4           clearColor;
+            float               clearDepth;
+            bool                sideEffect;
+
+            bool                kept;
+            bool                continuesRun;   // Same render pass as the kept pass before
+            bool                endsRun;
+            int                 loadAttachments;
+            int                 storeAttachments;
+        };
+
+        struct ReadEntry
+        {
+            int                 pass;
+            SvrGraphResource    resource;
+        };
+
+        // A pass needing the attachment of an earlier one, drawing over it when load
+        // is set and sampling it otherwise
+        struct Dependency
+        {
+            int                 consumer;
+            int                 producer;
+            SvrGraphResource    resource;
+            int                 attachment;
+            bool                load;
+        };
+
+        struct Target
+        {
+            SvrRenderTargetDesc desc;
+            int                 lastPass;
+            SvrRenderTarget*    pTarget;
+        };
+
+        static bool ReadLess(const ReadEntry& a, const ReadEntry& b) { return a.pass < b.pass; }
+
+        void    AddDependency(int consumer, int producer, SvrGraphResource resource, int attachment, bool load);
+        void    BeginPass(const Pass& pass);
+        void    EndPass(const Pass& pass);
+
+        SvrRenderTargetPool*    mPool;
+        bool                    mCompiled;
+
+        std::vector<Resource>   mResources;
+        std::vector<Pass>       mPasses;
+        std::vector<ReadEntry>  mReads;
+        std::vector<Dependency> mDependencies;
+        std::vector<Target>     mTargets;
+        std::vector<int>        mLastWriter;    // Per resource and attachment while compiling
+
+        SvrRenderGraphStats     mStats;
+    };
+}
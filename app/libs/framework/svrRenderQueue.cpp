@@ -0,0 +1,315 @@
+//=============================================================================
+// FILE: svrRenderQueue.cpp
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#include <string.h>
+#include <GLES3/gl3.h>
+
+#include "svrRenderQueue.h"
+#include "svrUtil.h"
+
+#define SORT_KEY_MASK(bits)     ((1ull << (bits)) - 1)
+
+namespace Svr
+{
+
+//-----------------------------------------------------------------------------
+static inline uint64_t L_DepthBits(float viewDepth)
+//-----------------------------------------------------------------------------
+{
+    // Positive floats order the same as their bit patterns, the top 24 bits keep the
+    // exponent and 15 bits of mantissa, a relative precision of 1/32768 at any range
+    if (!(viewDepth > 0.0f))
+    {
+        return 0;
+    }
+
+    uint32_t bits;
+    memcpy(&bits, &viewDepth, sizeof(bits));
+    return bits >> (32 - SVR_SORT_KEY_DEPTH_BITS - 1);
+}
+
+//-----------------------------------------------------------------------------
+static inline uint64_t L_GeometryBits(const SvrGeometry* pGeometry, int lod)
+//-----------------------------------------------------------------------------
+{
+    // Fibonacci hash of the address, low bits for the level so every level of one
+    // geometry stays together
+    const int lodBits = 3;
+    uint32_t hash = (uint32_t)((uintptr_t)pGeometry >> 4) * 2654435761u;
+    return ((hash >> (32 - SVR_SORT_KEY_GEOMETRY_BITS + lodBits)) << lodBits) | (lod & ((1 << lodBits) - 1));
+}
+
+//-----------------------------------------------------------------------------
+uint64_t SvrMakeSortKey(SvrRenderPass pass, SvrShader* pShader, unsigned int materialId,
+                        const SvrGeometry* pGeometry, int lod, float viewDepth)
+//-----------------------------------------------------------------------------
+{
+    uint64_t passBits = (uint64_t)pass & SORT_KEY_MASK(SVR_SORT_KEY_PASS_BITS);
+    uint64_t shaderBits = (uint64_t)(pShader != NULL ? pShader->GetShaderId() : 0) & SORT_KEY_MASK(SVR_SORT_KEY_SHADER_BITS);
+    uint64_t materialBits = (uint64_t)materialId & SORT_KEY_MASK(SVR_SORT_KEY_MATERIAL_BITS);
+    uint64_t geometryBits = L_GeometryBits(pGeometry, lod);
+    uint64_t depthBits = L_DepthBits(viewDepth);
+
+    uint64_t state = (shaderBits << (SVR_SORT_KEY_MATERIAL_BITS + SVR_SORT_KEY_GEOMETRY_BITS)) |
+                     (materialBits << SVR_SORT_KEY_GEOMETRY_BITS) |
+                     geometryBits;
+
+    if (pass >= kPassBlend)
+    {
+        depthBits = SORT_KEY_MASK(SVR_SORT_KEY_DEPTH_BITS) - depthBits;
+        return (passBits << (64 - SVR_SORT_KEY_PASS_BITS)) |
+               (depthBits << (64 - SVR_SORT_KEY_PASS_BITS - SVR_SORT_KEY_DEPTH_BITS)) |
+               state;
+    }
+
+    return (passBits << (64 - SVR_SORT_KEY_PASS_BITS)) |
+           (state << SVR_SORT_KEY_DEPTH_BITS) |
+           depthBits;
+}
+
+//-----------------------------------------------------------------------------
+SvrRenderQueue::SvrRenderQueue()
+//-----------------------------------------------------------------------------
+    : mBufferId(0)
+    , mBufferSize(0)
+    , mBufferCursor(0)
+{
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+//-----------------------------------------------------------------------------
+void SvrRenderQueue::Initialize(size_t bufferSize)
+//-----------------------------------------------------------------------------
+{
+    mBufferSize = bufferSize;
+    mBufferCursor = 0;
+
+    GL(glGenBuffers(1, &mBufferId));
+    GL(glBindBuffer(GL_ARRAY_BUFFER, mBufferId));
+    GL(glBufferData(GL_ARRAY_BUFFER, mBufferSize, NULL, GL_STREAM_DRAW));
+    GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+}
+
+//-----------------------------------------------------------------------------
+void SvrRenderQueue::Destroy()
+//-----------------------------------------------------------------------------
+{
+    if (mBufferId != 0)
+    {
+        GL(glDeleteBuffers(1, &mBufferId));
+        mBufferId = 0;
+    }
+    mBufferSize = 0;
+    mBufferCursor = 0;
+
+    std::vector<SvrDrawPacket>().swap(mPackets);
+    std::vector<SortEntry>().swap(mEntries);
+    std::vector<SortEntry>().swap(mScratch);
+    std::vector<Batch>().swap(mBatches);
+}
+
+//-----------------------------------------------------------------------------
+void SvrRenderQueue::Add(uint64_t sortKey, SvrShader* pShader, unsigned int materialId, SvrGeometry* pGeometry,
+                         const glm::mat4& modelMatrix, const glm::vec4& color)
+//-----------------------------------------------------------------------------
+{
+    mPackets.push_back(SvrDrawPacket());
+    SvrDrawPacket& packet = mPackets.back();
+    packet.sortKey = sortKey;
+    packet.pShader = pShader;
+    packet.pGeometry = pGeometry;
+    packet.materialId = materialId;
+    packet.lod = pGeometry->GetLod();
+    packet.instance.modelMatrix = modelMatrix;
+    packet.instance.color = color;
+}
+
+//-----------------------------------------------------------------------------
+void SvrRenderQueue::Sort()
+//-----------------------------------------------------------------------------
+{
+    size_t numPackets = mPackets.size();
+    mBatches.clear();
+    mStats.numPackets = (unsigned int)numPackets;
+    if (numPackets == 0)
+    {
+        return;
+    }
+
+    // Keys and indices sort, the packets themselves never move
+    mEntries.resize(numPackets);
+    mScratch.resize(numPackets);
+    for (size_t i = 0; i < numPackets; i++)
+    {
+        mEntries[i].key = mPackets[i].sortKey;
+        mEntries[i].packet = (uint32_t)i;
+    }
+
+    if (SvrRadixSort64(&mEntries[0], &mScratch[0], numPackets) != &mEntries[0])
+    {
+        mEntries.swap(mScratch);
+    }
+
+    size_t baseOffset = StreamInstances();
+    if (baseOffset == (size_t)-1)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < numPackets; i++)
+    {
+        const SvrDrawPacket& packet = mPackets[mEntries[i].packet];
+        if (!mBatches.empty())
+        {
+            Batch& batch = mBatches.back();
+            if (batch.pShader == packet.pShader && batch.materialId == packet.materialId &&
+                batch.pGeometry == packet.pGeometry && batch.lod == packet.lod)
+            {
+                batch.numInstances++;
+                continue;
+            }
+        }
+
+        Batch batch;
+        batch.pShader = packet.pShader;
+        batch.pGeometry = packet.pGeometry;
+        batch.materialId = packet.materialId;
+        batch.lod = packet.lod;
+        batch.numInstances = 1;
+        batch.instanceOffset = baseOffset + i * sizeof(SvrInstanceData);
+        mBatches.push_back(batch);
+    }
+}
+
+//-----------------------------------------------------------------------------
+size_t SvrRenderQueue::StreamInstances()
+//-----------------------------------------------------------------------------
+{
+    // Writes go after whatever earlier frames left in flight, so no mapping waits on the
+    // GPU.  When the buffer is used up it is orphaned and the driver hands out fresh
+    // storage while the old one drains.
+    size_t size = mPackets.size() * sizeof(SvrInstanceData);
+    GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+
+    GL(glBindBuffer(GL_ARRAY_BUFFER, mBufferId));
+    if (mBufferCursor + size > mBufferSize)
+    {
+        if (size > mBufferSize)
+        {
+            LOGI("SvrRenderQueue: Growing instance buffer to hold %d instances", (int)mPackets.size());
+            mBufferSize = (size > mBufferSize * 2) ? size : mBufferSize * 2;
+        }
+        GL(glBufferData(GL_ARRAY_BUFFER, mBufferSize, NULL, GL_STREAM_DRAW));
+        mBufferCursor = 0;
+    }
+
+    size_t offset = mBufferCursor;
+    SvrInstanceData* pDst = (SvrInstanceData*)glMapBufferRange(GL_ARRAY_BUFFER, offset, size, access);
+    if (pDst == NULL)
+    {
+        LOGE("SvrRenderQueue: Failed to map %d bytes of the instance buffer", (int)size);
+        GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+        return (size_t)-1;
+    }
+
+    for (size_t i = 0; i < mEntries.size(); i++)
+    {
+        pDst[i] = mPackets[mEntries[i].packet].instance;
+    }
+
+    GL(glUnmapBuffer(GL_ARRAY_BUFFER));
+    GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+    mBufferCursor += size;
+    return offset;
+}
+
+//-----------------------------------------------------------------------------
+void SvrRenderQueue::Flush(SvrBindStateFn pfnBindState, void* pUser, int viewInstances)
+//-----------------------------------------------------------------------------
+{
+    mStats.numDraws = 0;
+    mStats.numInstances = 0;
+    mStats.numShaderChanges = 0;
+    mStats.numMaterialChanges = 0;
+    mStats.numGeometryChanges = 0;
+    if (mBatches.empty())
+    {
+        return;
+    }
+
+    SvrShader* pBoundShader = NULL;
+    unsigned int boundMaterial = 0;
+    unsigned int boundVao = 0;
+
+    // Attribute pointers latch the buffer bound here, the vertex arrays keep their own
+    // index buffers
+    GL(glBindBuffer(GL_ARRAY_BUFFER, mBufferId));
+
+    for (size_t i = 0; i < mBatches.size(); i++)
+    {
+        const Batch& batch = mBatches[i];
+
+        bool shaderChanged = (batch.pShader != pBoundShader);
+        if (shaderChanged)
+        {
+            batch.pShader->Bind();
+            pBoundShader = batch.pShader;
+            mStats.numShaderChanges++;
+        }
+        if (shaderChanged || batch.materialId != boundMaterial)
+        {
+            if (pfnBindState != NULL)
+            {
+                pfnBindState(batch.pShader, batch.materialId, pUser);
+            }
+            boundMaterial = batch.materialId;
+            mStats.numMaterialChanges++;
+        }
+
+        unsigned int vao = batch.pGeometry->GetVaoId();
+        if (vao != boundVao)
+        {
+            GL(glBindVertexArray(vao));
+            boundVao = vao;
+            mStats.numGeometryChanges++;
+        }
+        batch.pGeometry->EnableInstanceArrays(viewInstances);
+
+        // No base instance in ES 3.0, each batch points the attributes at its own run
+        for (int c = 0; c < 4; c++)
+        {
+            GL(glVertexAttribPointer(kInstanceModel + c, 4, GL_FLOAT, GL_FALSE, sizeof(SvrInstanceData),
+                                     (void*)(batch.instanceOffset + offsetof(SvrInstanceData, modelMatrix) + c * sizeof(glm::vec4))));
+        }
+        GL(glVertexAttribPointer(kInstanceColor, 4, GL_FLOAT, GL_FALSE, sizeof(SvrInstanceData),
+                                 (void*)(batch.instanceOffset + offsetof(SvrInstanceData, color))));
+
+        unsigned int indexType = batch.pGeometry->GetIndexType();
+        int indexSize = (indexType == GL_UNSIGNED_SHORT) ? sizeof(unsigned short) : sizeof(unsigned int);
+        const SvrMeshLod& lod = batch.pGeometry->GetLodInfo(batch.lod);
+        GL(glDrawElementsInstanced(GL_TRIANGLES, lod.numIndices, indexType,
+                                   (void*)((size_t)lod.firstIndex * indexSize), batch.numInstances * viewInstances));
+        mStats.numDraws++;
+        mStats.numInstances += batch.numInstances * viewInstances;
+    }
+
+    GL(glBindVertexArray(0));
+    GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    pBoundShader->Unbind();
+}
+
+//-----------------------------------------------------------------------------
+void SvrRenderQueue::Clear()
+//-----------------------------------------------------------------------------
+{
+    // Storage is kept, a steady scene allocates nothing after its first frames
+    mPackets.clear();
+    mBatches.clear();
+}
+
+}
@@ -0,0 +1,241 @@
+//=============================================================================
+// FILE: svrRenderQueue.h
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "svrGeometry.h"
+#include "svrShader.h"
+
+// Streamed instance buffer, written front to back and orphaned when it wraps.  A
+// frame with more instances than fit grows it.
+#define SVR_RENDER_QUEUE_BUFFER_SIZE    (1024 * 1024)
+
+// Sort key, most significant first.  Blended passes swap the depth in above the
+// state so they draw back to front, everything else draws front to back within
+// each run of equal state.
+//
+//  63..60  pass
+//  59..50  shader
+//  49..38  material
+//  37..24  geometry and level of detail
+//  23..0   view depth
+#define SVR_SORT_KEY_PASS_BITS          4
+#define SVR_SORT_KEY_SHADER_BITS        10
+#define SVR_SORT_KEY_MATERIAL_BITS      12
+#define SVR_SORT_KEY_GEOMETRY_BITS      14
+#define SVR_SORT_KEY_DEPTH_BITS         24
+
+// Vertex shader side of queued draws, per instance attributes at kInstanceModel
+// and kInstanceColor (SvrInstanceData)
+#define SVR_INSTANCE_GLSL                                                           \
+    "layout(location = 5) in mat4 aInstanceModel;\n"                                \
+    "layout(location = 9) in vec4 aInstanceColor;\n"
+
+// Vertex shader side of stereo, one of these after the #version line.  Shaders pick
+// their eye's matrices with SVR_VIEW_ID and pass the clip space position through
+// SvrStereoPosition:
+//
+//  gl_Position = SvrStereoPosition(uProjMatrix * uViewMatrix[SVR_VIEW_ID] * worldPos);
+//
+// Multiview draws both eyes into the slices of an array target in one draw.
+#define SVR_STEREO_MULTIVIEW_GLSL                                                   \
+    "#extension GL_OVR_multiview2 : require\n"                                      \
+    "layout(num_views = 2) in;\n"                                                   \
+    "#define SVR_VIEW_ID int(gl_ViewID_OVR)\n"                                      \
+    "#define SvrStereoPosition(clipPos) (clipPos)\n"
+
+// Instanced stereo, for Flush with viewInstances 2: even instances are the left eye,
+// odd the right, squeezed into their half of a double wide target and clipped at
+// its middle.
+#define SVR_STEREO_INSTANCED_GLSL                                                   \
+    "#extension GL_EXT_clip_cull_distance : require\n"                              \
+    "#define SVR_VIEW_ID (gl_InstanceID & 1)\n"                                     \
+    "vec4 SvrStereoPosition(vec4 clipPos)\n"                                        \
+    "{\n"                                                                           \
+    "    float side = float(SVR_VIEW_ID) * 2.0 - 1.0;\n"                            \
+    "    clipPos.x = clipPos.x * 0.5 + side * 0.5 * clipPos.w;\n"                   \
+    "    gl_ClipDistance[0] = side * clipPos.x;\n"                                  \
+    "    return clipPos;\n"                                                         \
+    "}\n"
+
+// One eye per Flush, uViewId set by the SvrBindStateFn
+#define SVR_STEREO_DOUBLE_PASS_GLSL                                                 \
+    "uniform uint uViewId;\n"                                                       \
+    "#define SVR_VIEW_ID int(uViewId)\n"                                            \
+    "#define SvrStereoPosition(clipPos) (clipPos)\n"
+
+namespace Svr
+{
+    enum SvrRenderPass
+    {
+        kPassOpaque = 0,
+        kPassAlphaTest = 1,
+        kPassBlend = 2,         // This and above sort back to front
+        kPassOverlay = 3
+    };
+
+    // Streamed per instance, what used to be the per object uniforms
+    struct SvrInstanceData
+    {
+        glm::mat4       modelMatrix;
+        glm::vec4       color;
+    };
+
+    struct SvrDrawPacket
+    {
+        uint64_t        sortKey;
+        SvrShader*      pShader;
+        SvrGeometry*    pGeometry;
+        unsigned int    materialId;
+        int             lod;
+        SvrInstanceData instance;
+    };
+
+    struct SvrRenderQueueStats
+    {
+        unsigned int    numPackets;
+        unsigned int    numDraws;           // glDrawElementsInstanced calls per Flush
+        unsigned int    numInstances;       // Drawn per Flush, counting each view
+        unsigned int    numShaderChanges;
+        unsigned int    numMaterialChanges; // SvrBindStateFn calls
+        unsigned int    numGeometryChanges; // Vertex array binds
+    };
+
+    // Packs a sort key.  Shaders, materials and geometry are folded into their fields,
+    // two that collide only cost batching, never correctness: batches compare the
+    // packets themselves.  viewDepth is the distance along the view direction, anything
+    // behind the eye sorts as 0.
+    uint64_t SvrMakeSortKey(SvrRenderPass pass, SvrShader* pShader, unsigned int materialId,
+                            const SvrGeometry* pGeometry, int lod, float viewDepth);
+
+    // Called by Flush after binding a shader, and again on each material change, to set
+    // the view uniforms and bind textures
+    typedef void (*SvrBindStateFn)(SvrShader* pShader, unsigned int materialId, void* pUser);
+
+    // Draws collected over a frame, radix sorted on their keys and submitted in runs.
+    // Consecutive packets with the same shader, material, geometry and level of detail
+    // collapse into one glDrawElementsInstanced, their SvrInstanceData streamed to a
+    // buffer bound as instanced vertex attributes on the geometry's vertex array.
+    //
+    //  Add     per visible object
+    //  Sort    once per frame: sorts, builds the batches and streams the instances
+    //  Flush   per eye, once for both with multiview or instanced stereo
+    //  Clear   once the frame is submitted
+    //
+    // Render thread only, Initialize, Sort and Flush need the GL context.
+    class SvrRenderQueue
+    {
+    public:
+        SvrRenderQueue();
+
+        void Initialize(size_t bufferSize = SVR_RENDER_QUEUE_BUFFER_SIZE);
+        void Destroy();
+
+        // Draws the geometry's current level of detail
+        void Add(uint64_t sortKey, SvrShader* pShader, unsigned int materialId, SvrGeometry* pGeometry,
+                 const glm::mat4& modelMatrix, const glm::vec4& color);
+
+        void Sort();
+        // viewInstances 2 draws every instance twice, for SVR_STEREO_INSTANCED_GLSL
+        void Flush(SvrBindStateFn pfnBindState, void* pUser, int viewInstances = 1);
+        void Clear();
+
+        unsigned int GetPacketCount() const { return (unsigned int)mPackets.size(); }
+        const SvrRenderQueueStats& GetStats() const { return mStats; }
+
+    private:
+        struct SortEntry
+        {
+            uint64_t        key;
+            uint32_t        packet;
+        };
+
+        struct Batch
+        {
+            SvrShader*      pShader;
+            SvrGeometry*    pGeometry;
+            unsigned int    materialId;
+            int             lod;
+            unsigned int    numInstances;
+            size_t          instanceOffset;     // Bytes into the instance buffer
+        };
+
+        SvrRenderQueue(const SvrRenderQueue&);
+        SvrRenderQueue& operator=(const SvrRenderQueue&);
+
+        size_t StreamInstances();
+
+        std::vector<SvrDrawPacket>  mPackets;
+        std::vector<SortEntry>      mEntries;
+        std::vector<SortEntry>      mScratch;
+        std::vector<Batch>          mBatches;
+
+        unsigned int    mBufferId;
+        size_t          mBufferSize;
+        size_t          mBufferCursor;
+        SvrRenderQueueStats mStats;
+    };
+
+    // Sorts pEntries on their 64 bit keys, 8 bits a pass, stable.  Passes where every
+    // key has the same byte are skipped, so keys that differ only in a few fields
+    // cost only those.  pScratch must hold count entries; returns whichever of the
+    // two holds the result.
+    template <typename T>
+    T* SvrRadixSort64(T* pEntries, T* pScratch, size_t count)
+    {
+        if (count < 2)
+        {
+            return pEntries;
+        }
+
+        uint32_t histograms[8][256] = {};
+        for (size_t i = 0; i < count; i++)
+        {
+            uint64_t key = pEntries[i].key;
+            for (int b = 0; b < 8; b++)
+            {
+                histograms[b][(key >> (b * 8)) & 0xff]++;
+            }
+        }
+
+        T* pSrc = pEntries;
+        T* pDst = pScratch;
+        for (int b = 0; b < 8; b++)
+        {
+            uint32_t* pCounts = histograms[b];
+            if (pCounts[(pSrc[0].key >> (b * 8)) & 0xff] == count)
+            {
+                continue;
+            }
+
+            uint32_t offset = 0;
+            for (int i = 0; i < 256; i++)
+            {
+                uint32_t n = pCounts[i];
+                pCounts[i] = offset;
+                offset += n;
+            }
+
+            for (size_t i = 0; i < count; i++)
+            {
+                pDst[pCounts[(pSrc[i].key >> (b * 8)) & 0xff]++] = pSrc[i];
+            }
+
+            T* pTemp = pSrc;
+            pSrc = pDst;
+            pDst = pTemp;
+        }
+        return pSrc;
+    }
+}
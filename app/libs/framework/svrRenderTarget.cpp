@@ -248,6 +248,8 @@ SvrRenderTarget::SvrRenderTarget()
     : mWidth(0)
     , mHeight(0)
     , mSamples(0)
+    , mColorFormat(0)
+    , mHasStencil(false)
     , mColorAttachmentId(0)
     , mDepthAttachmentId(0)
     , mFramebufferId(0)
@@ -322,9 +324,18 @@ void SvrRenderTarget::InitializeMultiSample(int width, int height, int samples,
 
 void SvrRenderTarget::Initialize(int width, int height, int samples, int colorSizedFormat, bool requiresDepth)
 {
+    if (mFramebufferId != 0)
+    {
+        Destroy();
+    }
+
     mWidth = width;
     mHeight = height;
     mSamples = samples;
+    mColorFormat = colorSizedFormat;
+
+    // Only the multisampled depth renderbuffer is packed with stencil
+    mHasStencil = requiresDepth && samples > 1;
 
     int format, type;
     GetFormatTypeFromSizedFormat( colorSizedFormat, format, type);
@@ -380,6 +391,26 @@ void SvrRenderTarget::Unbind()
     GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
 }
 
+void SvrRenderTarget::Invalidate(int attachments)
+{
+    GLenum invalidate[2];
+    int numInvalidate = 0;
+
+    if ((attachments & kAttachmentColor) && mColorAttachmentId != 0)
+    {
+        invalidate[numInvalidate++] = GL_COLOR_ATTACHMENT0;
+    }
+    if ((attachments & kAttachmentDepth) && mDepthAttachmentId != 0)
+    {
+        invalidate[numInvalidate++] = mHasStencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+    }
+
+    if (numInvalidate > 0)
+    {
+        GL(glInvalidateFramebuffer(GL_FRAMEBUFFER, numInvalidate, invalidate));
+    }
+}
+
 unsigned int SvrRenderTarget::GetColorAttachment() const
 {
     return mColorAttachmentId;
@@ -410,4 +441,19 @@ int SvrRenderTarget::GetSamples() const
 	return mSamples;
 }
 
+int SvrRenderTarget::GetColorFormat() const
+{
+    return mColorFormat;
+}
+
+bool SvrRenderTarget::HasDepth() const
+{
+    return mDepthAttachmentId != 0;
+}
+
+bool SvrRenderTarget::HasStencil() const
+{
+    return mHasStencil;
+}
+
 }//namespace Svr
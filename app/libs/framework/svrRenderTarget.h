@@ -9,6 +9,14 @@
 
 namespace Svr
 {
+    // Attachments of a render target, depth includes stencil when the target has it
+    enum SvrAttachmentFlags
+    {
+        kAttachmentColor = (1 << 0),
+        kAttachmentDepth = (1 << 1),
+        kAttachmentAll = kAttachmentColor | kAttachmentDepth
+    };
+
     class SvrRenderTarget
     {
     public:
@@ -20,6 +28,11 @@ namespace Svr
         void Bind();
         void Unbind();
 
+        // Marks the contents of the attachments as no longer needed (glInvalidateFramebuffer),
+        // the target must be bound.  Tiled GPUs then neither write them back to memory at
+        // the end of a pass nor read them in at the start of the next one.
+        void Invalidate(int attachments);
+
         unsigned int GetColorAttachment() const;
         unsigned int GetDepthAttachment() const;
         unsigned int GetFrameBufferId() const;
@@ -27,6 +40,9 @@ namespace Svr
 		int GetWidth() const;
 		int GetHeight() const;
 		int GetSamples() const;
+        int GetColorFormat() const;
+        bool HasDepth() const;
+        bool HasStencil() const;
 
     private:
 		void InitializeSingleSample(int width, int height, int samples, int colorSizedFormat, int format, int type, bool requiresDepth);
@@ -35,6 +51,8 @@ namespace Svr
         int mWidth;
         int mHeight;
         int mSamples;
+        int mColorFormat;
+        bool mHasStencil;
 
         unsigned int mColorAttachmentId;
         unsigned int mDepthAttachmentId;
@@ -0,0 +1,325 @@
+//=============================================================================
+// FILE: svrRenderTargetPool.cpp
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#include <string.h>
+#include <GLES3/gl3.h>
+
+#include "svrRenderTargetPool.h"
+#include "svrUtil.h"
+
+namespace Svr
+{
+
+//-----------------------------------------------------------------------------
+static int L_BytesPerPixel(int sizedFormat)
+//-----------------------------------------------------------------------------
+{
+    switch (sizedFormat)
+    {
+    case GL_R8:
+    case GL_R8_SNORM:
+    case GL_R8UI:
+    case GL_R8I:
+        return 1;
+    case GL_R16F:
+    case GL_R16UI:
+    case GL_R16I:
+    case GL_RG8:
+    case GL_RG8_SNORM:
+    case GL_RG8UI:
+    case GL_RG8I:
+    case GL_RGB565:
+    case GL_RGB5_A1:
+    case GL_RGBA4:
+        return 2;
+    case GL_RGB8:
+    case GL_SRGB8:
+    case GL_RGB8_SNORM:
+    case GL_RGB8UI:
+    case GL_RGB8I:
+        return 3;
+    case GL_RG16F:
+    case GL_RG16UI:
+    case GL_RG16I:
+    case GL_R32F:
+    case GL_R32UI:
+    case GL_R32I:
+    case GL_R11F_G11F_B10F:
+    case GL_RGB9_E5:
+    case GL_RGBA8:
+    case GL_SRGB8_ALPHA8:
+    case GL_RGBA8_SNORM:
+    case GL_RGBA8UI:
+    case GL_RGBA8I:
+    case GL_RGB10_A2:
+    case GL_RGB10_A2UI:
+        return 4;
+    case GL_RGB16F:
+    case GL_RGB16UI:
+    case GL_RGB16I:
+        return 6;
+    case GL_RG32F:
+    case GL_RG32UI:
+    case GL_RG32I:
+    case GL_RGBA16F:
+    case GL_RGBA16UI:
+    case GL_RGBA16I:
+        return 8;
+    case GL_RGB32F:
+    case GL_RGB32UI:
+    case GL_RGB32I:
+        return 12;
+    case GL_RGBA32F:
+    case GL_RGBA32UI:
+    case GL_RGBA32I:
+        return 16;
+    }
+    return 4;
+}
+
+//-----------------------------------------------------------------------------
+static bool L_SameDesc(const SvrRenderTargetDesc& a, const SvrRenderTargetDesc& b)
+//-----------------------------------------------------------------------------
+{
+    return a.width == b.width && a.height == b.height && a.samples == b.samples &&
+           a.colorSizedFormat == b.colorSizedFormat && a.requiresDepth == b.requiresDepth;
+}
+
+//-----------------------------------------------------------------------------
+SvrRenderTargetPool::SvrRenderTargetPool()
+//-----------------------------------------------------------------------------
+    : mIdleFrames(SVR_RENDER_TARGET_POOL_IDLE_FRAMES)
+    , mFrame(0)
+{
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+//-----------------------------------------------------------------------------
+SvrRenderTargetPool::~SvrRenderTargetPool()
+//-----------------------------------------------------------------------------
+{
+    Destroy();
+}
+
+//-----------------------------------------------------------------------------
+void SvrRenderTargetPool::Initialize(int idleFrames)
+//-----------------------------------------------------------------------------
+{
+    mIdleFrames = idleFrames;
+    mFrame = 0;
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+//-----------------------------------------------------------------------------
+void SvrRenderTargetPool::Destroy()
+//-----------------------------------------------------------------------------
+{
+    for (size_t i = 0; i < mEntries.size(); i++)
+    {
+        if (mEntries[i].refCount > 0)
+        {
+            LOGE("SvrRenderTargetPool: Destroying a %dx%d target that is still leased",
+                 mEntries[i].desc.width, mEntries[i].desc.height);
+        }
+        delete mEntries[i].pTarget;
+    }
+    std::vector<Entry>().swap(mEntries);
+
+    mStats.numTargets = 0;
+    mStats.numLeased = 0;
+    mStats.poolBytes = 0;
+}
+
+//-----------------------------------------------------------------------------
+void SvrRenderTargetPool::BeginFrame()
+//-----------------------------------------------------------------------------
+{
+    mFrame++;
+
+    unsigned int numTargets = mStats.numTargets;
+    unsigned int numLeased = mStats.numLeased;
+    size_t poolBytes = mStats.poolBytes;
+    memset(&mStats, 0, sizeof(mStats));
+    mStats.numTargets = numTargets;
+    mStats.numLeased = numLeased;
+    mStats.poolBytes = poolBytes;
+
+    for (size_t i = 0; i < mEntries.size(); )
+    {
+        Entry& entry = mEntries[i];
+        if (entry.refCount == 0 && mFrame - entry.lastUsedFrame > (unsigned int)mIdleFrames)
+        {
+            mStats.numTargets--;
+            mStats.numDestroyed++;
+            mStats.poolBytes -= entry.colorBytes + entry.depthBytes;
+            delete entry.pTarget;
+
+            entry = mEntries.back();
+            mEntries.pop_back();
+            continue;
+        }
+        i++;
+    }
+}
+
+//-----------------------------------------------------------------------------
+SvrRenderTarget* SvrRenderTargetPool::Acquire(const SvrRenderTargetDesc& desc)
+//-----------------------------------------------------------------------------
+{
+    mStats.numAcquired++;
+    mStats.numLeased++;
+
+    // Of the free targets that match, the one released most recently
+    Entry* pFree = NULL;
+    for (size_t i = 0; i < mEntries.size(); i++)
+    {
+        Entry& entry = mEntries[i];
+        if (entry.refCount == 0 && L_SameDesc(entry.desc, desc) &&
+            (pFree == NULL || entry.lastUsedFrame > pFree->lastUsedFrame))
+        {
+            pFree = &entry;
+        }
+    }
+
+    if (pFree != NULL)
+    {
+        if (pFree->lastUsedFrame == mFrame)
+        {
+            mStats.numAliased++;
+        }
+        pFree->refCount = 1;
+        pFree->lastUsedFrame = mFrame;
+        return pFree->pTarget;
+    }
+
+    Entry entry;
+    entry.pTarget = new SvrRenderTarget();
+    entry.pTarget->Initialize(desc.width, desc.height, desc.samples, desc.colorSizedFormat, desc.requiresDepth);
+    entry.desc = desc;
+    entry.refCount = 1;
+    entry.lastUsedFrame = mFrame;
+
+    size_t pixels = (size_t)desc.width * desc.height * (desc.samples > 1 ? desc.samples : 1);
+    entry.colorBytes = pixels * L_BytesPerPixel(desc.colorSizedFormat);
+    entry.depthBytes = desc.requiresDepth ? pixels * 4 : 0;
+    mEntries.push_back(entry);
+
+    mStats.numTargets++;
+    mStats.numCreated++;
+    mStats.poolBytes += entry.colorBytes + entry.depthBytes;
+    return entry.pTarget;
+}
+
+//-----------------------------------------------------------------------------
+SvrRenderTargetPool::Entry* SvrRenderTargetPool::FindEntry(SvrRenderTarget* pTarget)
+//-----------------------------------------------------------------------------
+{
+    for (size_t i = 0; i < mEntries.size(); i++)
+    {
+        if (mEntries[i].pTarget == pTarget)
+        {
+            return &mEntries[i];
+        }
+    }
+
+    LOGE("SvrRenderTargetPool: Target %p is not from this pool", pTarget);
+    return NULL;
+}
+
+//-----------------------------------------------------------------------------
+void SvrRenderTargetPool::AddRef(SvrRenderTarget* pTarget)
+//-----------------------------------------------------------------------------
+{
+    Entry* pEntry = FindEntry(pTarget);
+    if (pEntry == NULL)
+    {
+        return;
+    }
+    if (pEntry->refCount == 0)
+    {
+        LOGE("SvrRenderTargetPool: AddRef on a released target");
+        return;
+    }
+    pEntry->refCount++;
+}
+
+//-----------------------------------------------------------------------------
+void SvrRenderTargetPool::Release(SvrRenderTarget* pTarget)
+//-----------------------------------------------------------------------------
+{
+    Entry* pEntry = FindEntry(pTarget);
+    if (pEntry == NULL)
+    {
+        return;
+    }
+    if (pEntry->refCount == 0)
+    {
+        LOGE("SvrRenderTargetPool: Target released more often than it was acquired");
+        return;
+    }
+
+    pEntry->lastUsedFrame = mFrame;
+    if (--pEntry->refCount == 0)
+    {
+        mStats.numLeased--;
+    }
+}
+
+//-----------------------------------------------------------------------------
+void SvrRenderTargetPool::CountAttachments(const Entry& entry, int attachments, unsigned int& count, size_t& bytes)
+//-----------------------------------------------------------------------------
+{
+    if (attachments & kAttachmentColor)
+    {
+        count++;
+        bytes += entry.colorBytes;
+    }
+    if ((attachments & kAttachmentDepth) && entry.depthBytes != 0)
+    {
+        count++;
+        bytes += entry.depthBytes;
+    }
+}
+
+//-----------------------------------------------------------------------------
+void SvrRenderTargetPool::BeginPass(SvrRenderTarget* pTarget, int loadAttachments)
+//-----------------------------------------------------------------------------
+{
+    Entry* pEntry = FindEntry(pTarget);
+    if (pEntry == NULL)
+    {
+        return;
+    }
+
+    pTarget->Bind();
+    GL(glViewport(0, 0, pEntry->desc.width, pEntry->desc.height));
+    GL(glScissor(0, 0, pEntry->desc.width, pEntry->desc.height));
+
+    int discard = kAttachmentAll & ~loadAttachments;
+    pTarget->Invalidate(discard);
+    CountAttachments(*pEntry, loadAttachments, mStats.numLoaded, mStats.bytesLoaded);
+    CountAttachments(*pEntry, discard, mStats.numInvalidated, mStats.bytesInvalidated);
+}
+
+//-----------------------------------------------------------------------------
+void SvrRenderTargetPool::EndPass(SvrRenderTarget* pTarget, int storeAttachments)
+//-----------------------------------------------------------------------------
+{
+    Entry* pEntry = FindEntry(pTarget);
+    if (pEntry == NULL)
+    {
+        return;
+    }
+
+    // Must come before the framebuffer changes, that is where tiles are written out
+    int discard = kAttachmentAll & ~storeAttachments;
+    pTarget->Invalidate(discard);
+    CountAttachments(*pEntry, storeAttachments, mStats.numStored, mStats.bytesStored);
+    CountAttachments(*pEntry, discard, mStats.numInvalidated, mStats.bytesInvalidated);
+}
+
+}
@@ -0,0 +1,111 @@
+//=============================================================================
+// FILE: svrRenderTargetPool.h
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#pragma once
+
+#include <stddef.h>
+
+#include <vector>
+
+#include "svrRenderTarget.h"
+
+// Frames a released target stays in the pool, unused, before it is destroyed
+#define SVR_RENDER_TARGET_POOL_IDLE_FRAMES  60
+
+namespace Svr
+{
+    // What SvrRenderTarget::Initialize takes, targets are only shared between equal ones
+    struct SvrRenderTargetDesc
+    {
+        int     width;
+        int     height;
+        int     samples;
+        int     colorSizedFormat;
+        bool    requiresDepth;
+    };
+
+    // Per frame, since BeginFrame.  Bytes are the full size of the attachments, what a
+    // tiled GPU moves to or from memory for them.
+    struct SvrRenderTargetPoolStats
+    {
+        unsigned int    numTargets;             // Alive in the pool, leased or not
+        unsigned int    numLeased;              // Out at the moment
+        unsigned int    numAcquired;
+        unsigned int    numCreated;
+        unsigned int    numAliased;             // Acquires given a target another pass released this frame
+        unsigned int    numDestroyed;
+
+        unsigned int    numLoaded;              // Attachments read in by BeginPass
+        unsigned int    numStored;              // Attachments written back by EndPass
+        unsigned int    numInvalidated;         // Attachments dropped by BeginPass and EndPass
+        size_t          bytesLoaded;
+        size_t          bytesStored;
+        size_t          bytesInvalidated;
+
+        size_t          poolBytes;              // Memory held by every target in the pool
+    };
+
+    // Render targets shared between passes and kept across frames.  A pass leases a
+    // target of the size and format it needs, and when it is done releases it for the
+    // next pass wanting the same: transient targets of passes that do not overlap end
+    // up in the same memory.  Leases are reference counted, a pass that hands its
+    // output to later readers adds a reference for each.
+    //
+    // BeginPass and EndPass bracket the draws into a target and say which attachments
+    // are read in at the start and written back at the end, the rest are invalidated.
+    // By default depth and stencil are never kept, so on tiled GPUs they only live in
+    // tile memory.
+    class SvrRenderTargetPool
+    {
+    public:
+        SvrRenderTargetPool();
+        ~SvrRenderTargetPool();
+
+        void    Initialize(int idleFrames = SVR_RENDER_TARGET_POOL_IDLE_FRAMES);
+        void    Destroy();
+
+        // Starts the frame's stats and destroys targets unused for idleFrames frames
+        void    BeginFrame();
+
+        // Returns a target with a reference count of one.  Its contents are undefined.
+        SvrRenderTarget*    Acquire(const SvrRenderTargetDesc& desc);
+        void                AddRef(SvrRenderTarget* pTarget);
+
+        // Back to the pool with the last reference
+        void                Release(SvrRenderTarget* pTarget);
+
+        // Binds the target and sets the viewport.  Attachments not in loadAttachments are
+        // invalidated, clear them or draw over every pixel.
+        void    BeginPass(SvrRenderTarget* pTarget, int loadAttachments = 0);
+
+        // With the target still bound after its last draw.  Attachments not in
+        // storeAttachments are invalidated.
+        void    EndPass(SvrRenderTarget* pTarget, int storeAttachments = kAttachmentColor);
+
+        const SvrRenderTargetPoolStats& GetStats() const { return mStats; }
+
+    private:
+        struct Entry
+        {
+            SvrRenderTarget*    pTarget;
+            SvrRenderTargetDesc desc;
+            int                 refCount;
+            unsigned int        lastUsedFrame;
+            size_t              colorBytes;
+            size_t              depthBytes;
+        };
+
+        Entry*  FindEntry(SvrRenderTarget* pTarget);
+        void    CountAttachments(const Entry& entry, int attachments, unsigned int& count, size_t& bytes);
+
+        std::vector<Entry>      mEntries;
+        int                     mIdleFrames;
+        unsigned int            mFrame;
+
+        SvrRenderTargetPoolStats    mStats;
+    };
+}
@@ -0,0 +1,412 @@
+//=============================================================================
+// FILE: svrRingBuffer.h
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+
+// Fixed capacity lock-free rings for handing data between threads.
+//
+//  SpscRing    one producer thread, one consumer thread
+//  MpscRing    any number of producer threads, one consumer thread
+//  SpmcRing    one producer thread, any number of consumer threads
+//
+// Capacity must be a power of two.  Head and tail live on separate cache lines
+// so the producer and consumer never write to the same line.  Push/Pop never
+// block: they return false (or a short count) when the ring is full or empty,
+// so callers decide whether to spin, drop or fall back to a wait.
+//
+// Unlike PooledRing the ring owns element lifetime: data is copied in on push
+// and copied out on pop, or accessed in place through the claim/commit calls.
+// Instances contain over-aligned members, allocate them statically or as members
+// of statically allocated objects rather than with plain new.
+
+#define SVR_CACHE_LINE_SIZE 64
+
+namespace Svr
+{
+
+template <typename T, unsigned int SIZE>
+class SpscRing
+{
+    static_assert(SIZE >= 2 && (SIZE & (SIZE - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+    SpscRing()
+        : mHead(0)
+        , mCachedTail(0)
+        , mTail(0)
+        , mCachedHead(0)
+    {}
+
+    // Producer side
+    bool Push(const T& item)
+    {
+        unsigned int tail = mTail.load(std::memory_order_relaxed);
+        if (tail - mCachedHead == SIZE)
+        {
+            mCachedHead = mHead.load(std::memory_order_acquire);
+            if (tail - mCachedHead == SIZE)
+                return false;
+        }
+
+        mItems[tail & kMask] = item;
+        mTail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    unsigned int PushBatch(const T* items, unsigned int count)
+    {
+        unsigned int tail = mTail.load(std::memory_order_relaxed);
+        unsigned int space = SIZE - (tail - mCachedHead);
+        if (space < count)
+        {
+            mCachedHead = mHead.load(std::memory_order_acquire);
+            space = SIZE - (tail - mCachedHead);
+        }
+
+        count = (count < space) ? count : space;
+        for (unsigned int i = 0; i < count; i++)
+            mItems[(tail + i) & kMask] = items[i];
+
+        mTail.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    // Returns up to maxCount contiguous slots to write in place, *pCount receives the
+    // number actually available (which may be less at the wrap point).  Publish the
+    // written slots with Commit.
+    T* Claim(unsigned int maxCount, unsigned int* pCount)
+    {
+        unsigned int tail = mTail.load(std::memory_order_relaxed);
+        unsigned int space = SIZE - (tail - mCachedHead);
+        if (space < maxCount)
+        {
+            mCachedHead = mHead.load(std::memory_order_acquire);
+            space = SIZE - (tail - mCachedHead);
+        }
+
+        unsigned int index = tail & kMask;
+        unsigned int contiguous = SIZE - index;
+        unsigned int count = (maxCount < space) ? maxCount : space;
+        *pCount = (count < contiguous) ? count : contiguous;
+        return &mItems[index];
+    }
+
+    void Commit(unsigned int count)
+    {
+        mTail.store(mTail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    // Consumer side
+    bool Pop(T* pItem)
+    {
+        unsigned int head = mHead.load(std::memory_order_relaxed);
+        if (head == mCachedTail)
+        {
+            mCachedTail = mTail.load(std::memory_order_acquire);
+            if (head == mCachedTail)
+                return false;
+        }
+
+        *pItem = mItems[head & kMask];
+        mHead.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    unsigned int PopBatch(T* items, unsigned int maxCount)
+    {
+        unsigned int head = mHead.load(std::memory_order_relaxed);
+        unsigned int available = mCachedTail - head;
+        if (available < maxCount)
+        {
+            mCachedTail = mTail.load(std::memory_order_acquire);
+            available = mCachedTail - head;
+        }
+
+        unsigned int count = (maxCount < available) ? maxCount : available;
+        for (unsigned int i = 0; i < count; i++)
+            items[i] = mItems[(head + i) & kMask];
+
+        mHead.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    // Returns up to maxCount contiguous readable slots in place, release them with CommitRead
+    const T* ClaimRead(unsigned int maxCount, unsigned int* pCount)
+    {
+        unsigned int head = mHead.load(std::memory_order_relaxed);
+        unsigned int available = mCachedTail - head;
+        if (available < maxCount)
+        {
+            mCachedTail = mTail.load(std::memory_order_acquire);
+            available = mCachedTail - head;
+        }
+
+        unsigned int index = head & kMask;
+        unsigned int contiguous = SIZE - index;
+        unsigned int count = (maxCount < available) ? maxCount : available;
+        *pCount = (count < contiguous) ? count : contiguous;
+        return &mItems[index];
+    }
+
+    void CommitRead(unsigned int count)
+    {
+        mHead.store(mHead.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    // Approximate when called while the other side is active
+    unsigned int Size() const
+    {
+        return mTail.load(std::memory_order_acquire) - mHead.load(std::memory_order_acquire);
+    }
+
+    bool Empty() const
+    {
+        return Size() == 0;
+    }
+
+    unsigned int Capacity() const
+    {
+        return SIZE;
+    }
+
+private:
+    enum { kMask = SIZE - 1 };
+
+    // Consumer owned
+    alignas(SVR_CACHE_LINE_SIZE) std::atomic<unsigned int> mHead;
+    unsigned int        mCachedTail;
+
+    // Producer owned
+    alignas(SVR_CACHE_LINE_SIZE) std::atomic<unsigned int> mTail;
+    unsigned int        mCachedHead;
+
+    alignas(SVR_CACHE_LINE_SIZE) T mItems[SIZE];
+};
+
+// Bounded ring with a sequence number per slot (D. Vyukov's bounded MPMC queue).
+// The side that can have several threads reserves slots with a CAS, the single
+// threaded side just advances its index.  Slot sequence numbers tell each side
+// when a slot has been filled or drained, so no thread ever waits on a lock.
+template <typename T, unsigned int SIZE, bool MULTI_PRODUCER, bool MULTI_CONSUMER>
+class SequenceRing
+{
+    static_assert(SIZE >= 2 && (SIZE & (SIZE - 1)) == 0, "Ring size must be a power of two");
+
+public:
+    SequenceRing()
+        : mHead(0)
+        , mTail(0)
+    {
+        for (unsigned int i = 0; i < SIZE; i++)
+            mCells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    bool Push(const T& item)
+    {
+        unsigned int count;
+        unsigned int pos = ReserveWrite(1, &count);
+        if (count == 0)
+            return false;
+
+        mCells[pos & kMask].data = item;
+        mCells[pos & kMask].sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    unsigned int PushBatch(const T* items, unsigned int count)
+    {
+        unsigned int pos = ReserveWrite(count, &count);
+        for (unsigned int i = 0; i < count; i++)
+        {
+            Cell& cell = mCells[(pos + i) & kMask];
+            cell.data = items[i];
+            cell.sequence.store(pos + i + 1, std::memory_order_release);
+        }
+        return count;
+    }
+
+    // In place write of up to maxCount consecutive slots (they may wrap, address them
+    // through Slot).  Every claimed slot must be published with Commit(pos, count).
+    unsigned int Claim(unsigned int maxCount, unsigned int* pCount)
+    {
+        return ReserveWrite(maxCount, pCount);
+    }
+
+    void Commit(unsigned int pos, unsigned int count)
+    {
+        for (unsigned int i = 0; i < count; i++)
+            mCells[(pos + i) & kMask].sequence.store(pos + i + 1, std::memory_order_release);
+    }
+
+    bool Pop(T* pItem)
+    {
+        unsigned int count;
+        unsigned int pos = ReserveRead(1, &count);
+        if (count == 0)
+            return false;
+
+        *pItem = mCells[pos & kMask].data;
+        mCells[pos & kMask].sequence.store(pos + SIZE, std::memory_order_release);
+        return true;
+    }
+
+    unsigned int PopBatch(T* items, unsigned int maxCount)
+    {
+        unsigned int count;
+        unsigned int pos = ReserveRead(maxCount, &count);
+        for (unsigned int i = 0; i < count; i++)
+        {
+            Cell& cell = mCells[(pos + i) & kMask];
+            items[i] = cell.data;
+            cell.sequence.store(pos + i + SIZE, std::memory_order_release);
+        }
+        return count;
+    }
+
+    unsigned int ClaimRead(unsigned int maxCount, unsigned int* pCount)
+    {
+        return ReserveRead(maxCount, pCount);
+    }
+
+    void CommitRead(unsigned int pos, unsigned int count)
+    {
+        for (unsigned int i = 0; i < count; i++)
+            mCells[(pos + i) & kMask].sequence.store(pos + i + SIZE, std::memory_order_release);
+    }
+
+    T& Slot(unsigned int pos)
+    {
+        return mCells[pos & kMask].data;
+    }
+
+    unsigned int Size() const
+    {
+        return mTail.load(std::memory_order_acquire) - mHead.load(std::memory_order_acquire);
+    }
+
+    bool Empty() const
+    {
+        return Size() == 0;
+    }
+
+    unsigned int Capacity() const
+    {
+        return SIZE;
+    }
+
+private:
+    // Counts how many consecutive slots from pos are in the wanted state, up to maxCount
+    unsigned int CountReady(unsigned int pos, unsigned int maxCount, unsigned int offset) const
+    {
+        unsigned int count = 0;
+        while (count < maxCount &&
+               mCells[(pos + count) & kMask].sequence.load(std::memory_order_acquire) == pos + count + offset)
+        {
+            count++;
+        }
+        return count;
+    }
+
+    unsigned int ReserveWrite(unsigned int maxCount, unsigned int* pCount)
+    {
+        unsigned int pos = mTail.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            // A slot is writable once its sequence has come back around to its position
+            unsigned int count = CountReady(pos, maxCount, 0);
+            if (count == 0)
+            {
+                unsigned int seq = mCells[pos & kMask].sequence.load(std::memory_order_acquire);
+                if ((int)(seq - pos) < 0 || !MULTI_PRODUCER)
+                {
+                    *pCount = 0;
+                    return pos;
+                }
+
+                // Another producer took this slot, retry from the new tail
+                pos = mTail.load(std::memory_order_relaxed);
+                continue;
+            }
+
+            if (!MULTI_PRODUCER)
+            {
+                mTail.store(pos + count, std::memory_order_relaxed);
+                *pCount = count;
+                return pos;
+            }
+
+            if (mTail.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed))
+            {
+                *pCount = count;
+                return pos;
+            }
+        }
+    }
+
+    unsigned int ReserveRead(unsigned int maxCount, unsigned int* pCount)
+    {
+        unsigned int pos = mHead.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            // A slot is readable once the producer has stamped it with position + 1
+            unsigned int count = CountReady(pos, maxCount, 1);
+            if (count == 0)
+            {
+                unsigned int seq = mCells[pos & kMask].sequence.load(std::memory_order_acquire);
+                if ((int)(seq - (pos + 1)) < 0 || !MULTI_CONSUMER)
+                {
+                    *pCount = 0;
+                    return pos;
+                }
+
+                pos = mHead.load(std::memory_order_relaxed);
+                continue;
+            }
+
+            if (!MULTI_CONSUMER)
+            {
+                mHead.store(pos + count, std::memory_order_relaxed);
+                *pCount = count;
+                return pos;
+            }
+
+            if (mHead.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed))
+            {
+                *pCount = count;
+                return pos;
+            }
+        }
+    }
+
+    enum { kMask = SIZE - 1 };
+
+    struct Cell
+    {
+        std::atomic<unsigned int>   sequence;
+        T                           data;
+    };
+
+    alignas(SVR_CACHE_LINE_SIZE) std::atomic<unsigned int> mHead;
+    alignas(SVR_CACHE_LINE_SIZE) std::atomic<unsigned int> mTail;
+    alignas(SVR_CACHE_LINE_SIZE) Cell mCells[SIZE];
+};
+
+template <typename T, unsigned int SIZE>
+class MpscRing : public SequenceRing<T, SIZE, true, false>
+{
+};
+
+template <typename T, unsigned int SIZE>
+class SpmcRing : public SequenceRing<T, SIZE, false, true>
+{
+};
+
+}
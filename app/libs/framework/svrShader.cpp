@@ -6,6 +6,8 @@
 //
 //=============================================================================
 
+#include <string.h>
+
 #include "svrShader.h"
 #include "svrUtil.h"
 
@@ -106,6 +108,12 @@ bool SvrShader::Initialize(const char* pVertSrc, const char* pFragSrc, const cha
         GLenum uniformType;
         GL(glGetActiveUniform( mShaderId, i, MAX_UNIFORM_NAME_LENGTH - 1, &uniformNameLength, &uniformSize, &uniformType, &nameBuffer[0]));
         nameBuffer[uniformNameLength] = 0;
+
+        // Arrays are listed as name[0], they are set through their plain name
+        if (uniformSize > 1 && uniformNameLength > 3 && strcmp(&nameBuffer[uniformNameLength - 3], "[0]") == 0)
+        {
+            nameBuffer[uniformNameLength - 3] = 0;
+        }
         unsigned int location = GL(glGetUniformLocation( mShaderId, nameBuffer ));
 
         SvrUniform uniform;
@@ -196,7 +204,7 @@ void SvrShader::SetUniformMat4fv(const char* name, unsigned int count, float *pD
 
 void SvrShader::SetUniformMat4fv(int location, unsigned int count, float *pData)
 {
-    GL(glUniformMatrix4fv(location, 2, GL_FALSE, pData));
+    GL(glUniformMatrix4fv(location, count, GL_FALSE, pData));
 }
 
 void SvrShader::SetUniformVec4(const char* name, glm::vec4& vector)
@@ -24,7 +24,9 @@ namespace Svr
         kNormal = 1,
         kColor = 2,
         kTexcoord0 = 3,
-        kTexcoord1 = 4
+        kTexcoord1 = 4,
+        kInstanceModel = 5,     // mat4, takes 5 to 8
+        kInstanceColor = 9
     } ;
 
     struct SvrAttribute
@@ -0,0 +1,121 @@
+//=============================================================================
+// FILE: svrSimd.h
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Four lanes of floats over SSE2 or NEON, with a scalar fallback, for kernels that
+// are written once for every target.  Comparisons return masks that are all ones or
+// all zeros per lane, SvrMaskBits4 packs them to one bit per lane.
+
+namespace Svr
+{
+
+#if defined(__SSE2__)
+typedef __m128 SvrFloat4;
+
+inline SvrFloat4 SvrSplat4(float value) { return _mm_set1_ps(value); }
+inline SvrFloat4 SvrSet4(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+inline SvrFloat4 SvrLoad4(const float* p) { return _mm_loadu_ps(p); }
+inline void SvrStore4(float* p, SvrFloat4 v) { _mm_storeu_ps(p, v); }
+inline SvrFloat4 SvrAdd4(SvrFloat4 a, SvrFloat4 b) { return _mm_add_ps(a, b); }
+inline SvrFloat4 SvrSub4(SvrFloat4 a, SvrFloat4 b) { return _mm_sub_ps(a, b); }
+inline SvrFloat4 SvrMul4(SvrFloat4 a, SvrFloat4 b) { return _mm_mul_ps(a, b); }
+inline SvrFloat4 SvrMin4(SvrFloat4 a, SvrFloat4 b) { return _mm_min_ps(a, b); }
+inline SvrFloat4 SvrMax4(SvrFloat4 a, SvrFloat4 b) { return _mm_max_ps(a, b); }
+inline SvrFloat4 SvrGreater4(SvrFloat4 a, SvrFloat4 b) { return _mm_cmpgt_ps(a, b); }
+inline SvrFloat4 SvrAnd4(SvrFloat4 a, SvrFloat4 b) { return _mm_and_ps(a, b); }
+inline SvrFloat4 SvrOr4(SvrFloat4 a, SvrFloat4 b) { return _mm_or_ps(a, b); }
+inline SvrFloat4 SvrSelect4(SvrFloat4 mask, SvrFloat4 a, SvrFloat4 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+inline unsigned int SvrMaskBits4(SvrFloat4 mask) { return (unsigned int)_mm_movemask_ps(mask); }
+inline float SvrMinLane4(SvrFloat4 v)
+{
+    v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(v);
+}
+inline float SvrMaxLane4(SvrFloat4 v)
+{
+    v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(v);
+}
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+typedef float32x4_t SvrFloat4;
+
+inline SvrFloat4 SvrSplat4(float value) { return vdupq_n_f32(value); }
+inline SvrFloat4 SvrSet4(float a, float b, float c, float d) { float v[4] = { a, b, c, d }; return vld1q_f32(v); }
+inline SvrFloat4 SvrLoad4(const float* p) { return vld1q_f32(p); }
+inline void SvrStore4(float* p, SvrFloat4 v) { vst1q_f32(p, v); }
+inline SvrFloat4 SvrAdd4(SvrFloat4 a, SvrFloat4 b) { return vaddq_f32(a, b); }
+inline SvrFloat4 SvrSub4(SvrFloat4 a, SvrFloat4 b) { return vsubq_f32(a, b); }
+inline SvrFloat4 SvrMul4(SvrFloat4 a, SvrFloat4 b) { return vmulq_f32(a, b); }
+inline SvrFloat4 SvrMin4(SvrFloat4 a, SvrFloat4 b) { return vminq_f32(a, b); }
+inline SvrFloat4 SvrMax4(SvrFloat4 a, SvrFloat4 b) { return vmaxq_f32(a, b); }
+inline SvrFloat4 SvrGreater4(SvrFloat4 a, SvrFloat4 b) { return vreinterpretq_f32_u32(vcgtq_f32(a, b)); }
+inline SvrFloat4 SvrAnd4(SvrFloat4 a, SvrFloat4 b) { return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+inline SvrFloat4 SvrOr4(SvrFloat4 a, SvrFloat4 b) { return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+inline SvrFloat4 SvrSelect4(SvrFloat4 mask, SvrFloat4 a, SvrFloat4 b) { return vbslq_f32(vreinterpretq_u32_f32(mask), a, b); }
+inline unsigned int SvrMaskBits4(SvrFloat4 mask)
+{
+    // No movemask on NEON: one bit per lane, then a horizontal add
+    static const uint32_t laneBits[4] = { 1, 2, 4, 8 };
+    uint32x4_t bits = vandq_u32(vreinterpretq_u32_f32(mask), vld1q_u32(laneBits));
+    uint32x2_t sum = vadd_u32(vget_low_u32(bits), vget_high_u32(bits));
+    return vget_lane_u32(vpadd_u32(sum, sum), 0);
+}
+inline float SvrMinLane4(SvrFloat4 v)
+{
+    float32x2_t m = vpmin_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpmin_f32(m, m), 0);
+}
+inline float SvrMaxLane4(SvrFloat4 v)
+{
+    float32x2_t m = vpmax_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpmax_f32(m, m), 0);
+}
+#else
+// Scalar fallback, masks are 1 or 0 per lane
+struct SvrFloat4
+{
+    float   v[4];
+};
+
+inline SvrFloat4 SvrSet4(float a, float b, float c, float d) { SvrFloat4 r = { { a, b, c, d } }; return r; }
+inline SvrFloat4 SvrSplat4(float value) { return SvrSet4(value, value, value, value); }
+inline SvrFloat4 SvrLoad4(const float* p) { return SvrSet4(p[0], p[1], p[2], p[3]); }
+inline void SvrStore4(float* p, SvrFloat4 a) { memcpy(p, a.v, sizeof(a.v)); }
+inline SvrFloat4 SvrAdd4(SvrFloat4 a, SvrFloat4 b) { for (int i = 0; i < 4; i++) a.v[i] += b.v[i]; return a; }
+inline SvrFloat4 SvrSub4(SvrFloat4 a, SvrFloat4 b) { for (int i = 0; i < 4; i++) a.v[i] -= b.v[i]; return a; }
+inline SvrFloat4 SvrMul4(SvrFloat4 a, SvrFloat4 b) { for (int i = 0; i < 4; i++) a.v[i] *= b.v[i]; return a; }
+inline SvrFloat4 SvrMin4(SvrFloat4 a, SvrFloat4 b) { for (int i = 0; i < 4; i++) a.v[i] = (b.v[i] < a.v[i]) ? b.v[i] : a.v[i]; return a; }
+inline SvrFloat4 SvrMax4(SvrFloat4 a, SvrFloat4 b) { for (int i = 0; i < 4; i++) a.v[i] = (b.v[i] > a.v[i]) ? b.v[i] : a.v[i]; return a; }
+inline SvrFloat4 SvrGreater4(SvrFloat4 a, SvrFloat4 b) { for (int i = 0; i < 4; i++) a.v[i] = (a.v[i] > b.v[i]) ? 1.0f : 0.0f; return a; }
+inline SvrFloat4 SvrAnd4(SvrFloat4 a, SvrFloat4 b) { for (int i = 0; i < 4; i++) a.v[i] *= b.v[i]; return a; }
+inline SvrFloat4 SvrOr4(SvrFloat4 a, SvrFloat4 b) { for (int i = 0; i < 4; i++) a.v[i] = (a.v[i] != 0.0f || b.v[i] != 0.0f) ? 1.0f : 0.0f; return a; }
+inline SvrFloat4 SvrSelect4(SvrFloat4 mask, SvrFloat4 a, SvrFloat4 b) { for (int i = 0; i < 4; i++) a.v[i] = (mask.v[i] != 0.0f) ? a.v[i] : b.v[i]; return a; }
+inline unsigned int SvrMaskBits4(SvrFloat4 mask)
+{
+    unsigned int bits = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        bits |= (mask.v[i] != 0.0f) ? (1 << i) : 0;
+    }
+    return bits;
+}
+inline float SvrMinLane4(SvrFloat4 a) { float m = (a.v[1] < a.v[0]) ? a.v[1] : a.v[0]; m = (a.v[2] < m) ? a.v[2] : m; return (a.v[3] < m) ? a.v[3] : m; }
+inline float SvrMaxLane4(SvrFloat4 a) { float m = (a.v[1] > a.v[0]) ? a.v[1] : a.v[0]; m = (a.v[2] > m) ? a.v[2] : m; return (a.v[3] > m) ? a.v[3] : m; }
+#endif
+}
@@ -0,0 +1,263 @@
+//=============================================================================
+// FILE: svrSlab.cpp
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#include <sched.h>
+#include <stdlib.h>
+
+#include "svrSlab.h"
+#include "svrUtil.h"
+
+namespace Svr
+{
+
+//-----------------------------------------------------------------------------
+void SlabPoolBase::Lock()
+//-----------------------------------------------------------------------------
+{
+    // Held for a handful of pointer updates, a mutex would cost more than it saves
+    while (mLock.exchange(true, std::memory_order_acquire))
+    {
+        while (mLock.load(std::memory_order_relaxed))
+        {
+            sched_yield();
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void SlabPoolBase::Unlock()
+//-----------------------------------------------------------------------------
+{
+    mLock.store(false, std::memory_order_release);
+}
+
+//-----------------------------------------------------------------------------
+void* SlabPoolBase::AllocLocked()
+//-----------------------------------------------------------------------------
+{
+    if (mFreeList != nullptr)
+    {
+        FreeBlock* pBlock = mFreeList;
+        mFreeList = pBlock->pNext;
+        mLiveCount++;
+        return pBlock;
+    }
+
+    if (mCursor + mBlockSize > mEnd)
+    {
+        void* pSlab = nullptr;
+        if (posix_memalign(&pSlab, 64, SVR_SLAB_SIZE) != 0)
+        {
+            LOGE("SlabPool: Unable to allocate slab for %zu byte blocks", mBlockSize);
+            return nullptr;
+        }
+
+        // Whatever is left of the previous slab is abandoned, it is less than a block
+        mCursor = (unsigned char*)pSlab;
+        mEnd = mCursor + SVR_SLAB_SIZE;
+        mSlabCount++;
+    }
+
+    void* pBlock = mCursor;
+    mCursor += mBlockSize;
+    mLiveCount++;
+    return pBlock;
+}
+
+//-----------------------------------------------------------------------------
+void* SlabPoolBase::Alloc()
+//-----------------------------------------------------------------------------
+{
+    Lock();
+    void* pBlock = AllocLocked();
+    Unlock();
+    return pBlock;
+}
+
+//-----------------------------------------------------------------------------
+void SlabPoolBase::Free(void* pBlock)
+//-----------------------------------------------------------------------------
+{
+    FreeBatch(&pBlock, 1);
+}
+
+//-----------------------------------------------------------------------------
+unsigned int SlabPoolBase::AllocBatch(void** pBlocks, unsigned int count)
+//-----------------------------------------------------------------------------
+{
+    unsigned int allocated = 0;
+
+    Lock();
+    while (allocated < count)
+    {
+        void* pBlock = AllocLocked();
+        if (pBlock == nullptr)
+        {
+            break;
+        }
+        pBlocks[allocated++] = pBlock;
+    }
+    Unlock();
+
+    return allocated;
+}
+
+//-----------------------------------------------------------------------------
+void SlabPoolBase::FreeBatch(void* const* pBlocks, unsigned int count)
+//-----------------------------------------------------------------------------
+{
+    Lock();
+    for (unsigned int i = 0; i < count; i++)
+    {
+        FreeBlock* pBlock = (FreeBlock*)pBlocks[i];
+        if (pBlock != nullptr)
+        {
+            pBlock->pNext = mFreeList;
+            mFreeList = pBlock;
+            mLiveCount--;
+        }
+    }
+    Unlock();
+}
+
+// Size classes are 16 bytes apart up to 128 and 32 bytes apart above that
+static SlabPoolBase gSizeClassPools[] =
+{
+    { 16 },  { 32 },  { 48 },  { 64 },  { 80 },  { 96 },
+    { 112 }, { 128 }, { 160 }, { 192 }, { 224 }, { 256 },
+};
+
+enum
+{
+    kNumSizeClasses = sizeof(gSizeClassPools) / sizeof(gSizeClassPools[0])
+};
+
+// Size class for each 16 byte granule
+static const unsigned char gSizeClassForGranule[kSlabMaxSize / 16 + 1] =
+{
+    0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 8, 9, 9, 10, 10, 11, 11
+};
+
+//-----------------------------------------------------------------------------
+static inline unsigned int SizeClass(size_t size)
+//-----------------------------------------------------------------------------
+{
+    return gSizeClassForGranule[(size + 15) >> 4];
+}
+
+#if SVR_SLAB_THREAD_CACHE_SIZE > 0
+struct SlabThreadCache
+{
+    void*           blocks[kNumSizeClasses][SVR_SLAB_THREAD_CACHE_SIZE];
+    unsigned int    count[kNumSizeClasses];
+
+    ~SlabThreadCache()
+    {
+        // Hand everything back so other threads can reuse it
+        for (unsigned int i = 0; i < kNumSizeClasses; i++)
+        {
+            gSizeClassPools[i].FreeBatch(blocks[i], count[i]);
+            count[i] = 0;
+        }
+    }
+};
+
+static thread_local SlabThreadCache tSlabCache;
+#endif // SVR_SLAB_THREAD_CACHE_SIZE > 0
+
+//-----------------------------------------------------------------------------
+void* SlabAlloc(size_t size)
+//-----------------------------------------------------------------------------
+{
+    if (size > kSlabMaxSize)
+    {
+        return malloc(size);
+    }
+
+    unsigned int sizeClass = SizeClass(size);
+
+#if SVR_SLAB_THREAD_CACHE_SIZE > 0
+    SlabThreadCache& cache = tSlabCache;
+    if (cache.count[sizeClass] == 0)
+    {
+        // Refill half the cache so alternating alloc/free does not bounce on the pool
+        cache.count[sizeClass] = gSizeClassPools[sizeClass].AllocBatch(cache.blocks[sizeClass], SVR_SLAB_THREAD_CACHE_SIZE / 2);
+        if (cache.count[sizeClass] == 0)
+        {
+            return nullptr;
+        }
+
+        // Blocks are popped from the end, reverse them so consecutive allocations
+        // come out in address order
+        void** pBlocks = cache.blocks[sizeClass];
+        for (unsigned int i = 0, j = cache.count[sizeClass] - 1; i < j; i++, j--)
+        {
+            void* pTemp = pBlocks[i];
+            pBlocks[i] = pBlocks[j];
+            pBlocks[j] = pTemp;
+        }
+    }
+    return cache.blocks[sizeClass][--cache.count[sizeClass]];
+#else
+    return gSizeClassPools[sizeClass].Alloc();
+#endif // SVR_SLAB_THREAD_CACHE_SIZE > 0
+}
+
+//-----------------------------------------------------------------------------
+void SlabFree(void* pBlock, size_t size)
+//-----------------------------------------------------------------------------
+{
+    if (pBlock == nullptr)
+    {
+        return;
+    }
+
+    if (size > kSlabMaxSize)
+    {
+        free(pBlock);
+        return;
+    }
+
+    unsigned int sizeClass = SizeClass(size);
+
+#if SVR_SLAB_THREAD_CACHE_SIZE > 0
+    SlabThreadCache& cache = tSlabCache;
+    if (cache.count[sizeClass] == SVR_SLAB_THREAD_CACHE_SIZE)
+    {
+        // Return the older half, the most recently freed blocks are the warm ones
+        const unsigned int half = SVR_SLAB_THREAD_CACHE_SIZE / 2;
+        gSizeClassPools[sizeClass].FreeBatch(cache.blocks[sizeClass], half);
+        for (unsigned int i = 0; i < half; i++)
+        {
+            cache.blocks[sizeClass][i] = cache.blocks[sizeClass][i + half];
+        }
+        cache.count[sizeClass] = half;
+    }
+    cache.blocks[sizeClass][cache.count[sizeClass]++] = pBlock;
+#else
+    gSizeClassPools[sizeClass].Free(pBlock);
+#endif // SVR_SLAB_THREAD_CACHE_SIZE > 0
+}
+
+//-----------------------------------------------------------------------------
+void SlabLogStats()
+//-----------------------------------------------------------------------------
+{
+    for (unsigned int i = 0; i < kNumSizeClasses; i++)
+    {
+        const SlabPoolBase& pool = gSizeClassPools[i];
+        if (pool.GetSlabCount() == 0)
+        {
+            continue;
+        }
+
+        // Live counts include blocks parked in thread caches
+        LOGI("Slab %3zu bytes: %u live blocks in %u slabs", pool.GetBlockSize(), pool.GetLiveCount(), pool.GetSlabCount());
+    }
+}
+
+}   // namespace Svr
@@ -0,0 +1,125 @@
+//=============================================================================
+// FILE: svrSlab.h
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+
+#pragma once
+
+#include <atomic>
+#include <new>
+#include <stddef.h>
+
+// Fixed size block pools for small, long lived nodes.  Blocks are carved out of
+// SVR_SLAB_SIZE slabs in allocation order, so nodes created together (a map being
+// filled, the config registry at static init) end up packed next to each other
+// instead of scattered across the heap.  Freed blocks go on a per pool free list
+// and slabs are never returned, the pools only ever hold the peak node count.
+//
+// Pools are constant initialized and safe to use from static constructors.
+
+#define SVR_SLAB_SIZE               (64 * 1024)
+
+// Blocks each thread keeps per size class before going back to the shared pool.
+// Set to 0 to disable the thread caches.
+#define SVR_SLAB_THREAD_CACHE_SIZE  32
+
+namespace Svr
+{
+
+class SlabPoolBase
+{
+public:
+    constexpr SlabPoolBase(size_t blockSize)
+        : mBlockSize(blockSize)
+        , mLock(false)
+        , mFreeList(nullptr)
+        , mCursor(nullptr)
+        , mEnd(nullptr)
+        , mSlabCount(0)
+        , mLiveCount(0)
+    {}
+
+    void*           Alloc();
+    void            Free(void* pBlock);
+
+    // Moves up to count blocks in or out of the pool under a single lock
+    unsigned int    AllocBatch(void** pBlocks, unsigned int count);
+    void            FreeBatch(void* const* pBlocks, unsigned int count);
+
+    size_t          GetBlockSize() const { return mBlockSize; }
+    unsigned int    GetSlabCount() const { return mSlabCount; }
+    unsigned int    GetLiveCount() const { return mLiveCount; }
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock*  pNext;
+    };
+
+    SlabPoolBase(const SlabPoolBase&);
+    SlabPoolBase& operator=(const SlabPoolBase&);
+
+    void            Lock();
+    void            Unlock();
+    void*           AllocLocked();
+
+    const size_t        mBlockSize;
+    std::atomic<bool>   mLock;
+
+    FreeBlock*          mFreeList;
+    unsigned char*      mCursor;        // Unused tail of the newest slab
+    unsigned char*      mEnd;
+
+    unsigned int        mSlabCount;
+    unsigned int        mLiveCount;
+};
+
+// Pool of T sized blocks with typed construction
+template <class T>
+class SlabPool : public SlabPoolBase
+{
+public:
+    constexpr SlabPool()
+        : SlabPoolBase((sizeof(T) + sizeof(void*) - 1) & ~(sizeof(void*) - 1))
+    {}
+
+    template <typename... Args>
+    T* New(Args&&... args)
+    {
+        void* pBlock = Alloc();
+        return (pBlock) ? new (pBlock) T(static_cast<Args&&>(args)...) : nullptr;
+    }
+
+    void Delete(T* pObject)
+    {
+        if (pObject)
+        {
+            pObject->~T();
+            Free(pObject);
+        }
+    }
+};
+
+// General small object allocator: sizes up to kSlabMaxSize are rounded up to one of
+// a set of size classes, each backed by its own pool and thread cache.  Larger
+// requests go straight to malloc.  The size passed to SlabFree must match the
+// size passed to SlabAlloc.
+enum
+{
+    kSlabMaxSize = 256
+};
+
+void*   SlabAlloc(size_t size);
+void    SlabFree(void* pBlock, size_t size);
+void    SlabLogStats();
+
+}   // namespace Svr
+
+// Routes single object new/delete of a class hierarchy through the slab allocator.
+// The class needs a virtual destructor if objects are deleted through a base pointer.
+#define SVR_SLAB_ALLOCATED \
+    static void* operator new(size_t size) { void* pBlock = Svr::SlabAlloc(size); if (!pBlock) throw std::bad_alloc(); return pBlock; } \
+    static void operator delete(void* pBlock, size_t size) { Svr::SlabFree(pBlock, size); }
@@ -0,0 +1,1082 @@
+//=============================================================================
+// FILE: svrTextureStreamer.cpp
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <new>
+
+#include "svrArchive.h"
+#include "svrCpuTimer.h"
+#include "svrMemory.h"
+#include "svrTextureStreamer.h"
+#include "svrUtil.h"
+
+// Offsets of staged levels are kept aligned for the driver's copy engine
+#define STAGING_ALIGNMENT   256
+
+namespace Svr
+{
+
+static_assert(SVR_STREAM_MAX_TEXTURES <= 65536, "Slot indices are stored as unsigned short");
+
+//-----------------------------------------------------------------------------
+SvrTextureStreamer::SvrTextureStreamer()
+//-----------------------------------------------------------------------------
+    : mNextSequence(0)
+    , mQueueCount(0)
+    , mQueueDirty(false)
+    , mShutdown(false)
+    , mpCompleted(NULL)
+    , mNumWorkers(0)
+    , mInitialized(false)
+    , mPlaceholder(0)
+    , mStagingBuffer(0)
+    , mStagingFrame(0)
+    , mStagingUsed(0)
+    , mStagingReady(false)
+    , mFrameIndex(0)
+    , mBudget(SVR_RESIDENCY_DEFAULT_BUDGET)
+    , mPressureBudget(0)
+    , mLastLowMemoryFrame(0)
+    , mLowMemory(false)
+{
+    for (int i = 0; i < SVR_STREAM_MAX_TEXTURES; i++)
+    {
+        mSlots[i].state.store(kStreamFree, std::memory_order_relaxed);
+        mSlots[i].pSource = NULL;
+        mSlots[i].texture = 0;
+        mSlots[i].uploadTexture = 0;
+        mSlots[i].textureSize = 0;
+        mSlots[i].uploadSize = 0;
+    }
+    for (int i = 0; i < SVR_STREAM_STAGING_FRAMES; i++)
+    {
+        mStagingFences[i] = 0;
+    }
+    mBasePath[0] = 0;
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+//-----------------------------------------------------------------------------
+SvrTextureStreamer::~SvrTextureStreamer()
+//-----------------------------------------------------------------------------
+{
+    Shutdown();
+}
+
+//-----------------------------------------------------------------------------
+bool SvrTextureStreamer::Initialize(const char* pBasePath, int numWorkers)
+//-----------------------------------------------------------------------------
+{
+    if (mInitialized)
+    {
+        return true;
+    }
+
+    snprintf(mBasePath, sizeof(mBasePath), "%s", pBasePath ? pBasePath : ".");
+
+    // The ring holds cache line aligned members, keep it off the plain heap
+    void* pRingMemory = NULL;
+    if (posix_memalign(&pRingMemory, SVR_CACHE_LINE_SIZE, sizeof(CompletionRing)) != 0)
+    {
+        LOGE("SvrTextureStreamer: Unable to allocate completion ring");
+        return false;
+    }
+    mpCompleted = new (pRingMemory) CompletionRing();
+
+    pthread_mutex_init(&mQueueLock, NULL);
+    pthread_cond_init(&mQueueCond, NULL);
+    mQueueCount = 0;
+    mQueueDirty = false;
+    mShutdown = false;
+
+    // Shown until the first level of a 2D texture is in
+    const GLubyte grey[4] = { 128, 128, 128, 255 };
+    glGenTextures(1, &mPlaceholder);
+    glBindTexture(GL_TEXTURE_2D, mPlaceholder);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, 1, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenBuffers(1, &mStagingBuffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mStagingBuffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, SVR_STREAM_STAGING_SIZE * SVR_STREAM_STAGING_FRAMES, NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    mStagingFrame = 0;
+    mStagingUsed = 0;
+
+    mNumWorkers = std::max(1, std::min(numWorkers, SVR_STREAM_MAX_WORKERS));
+    for (int i = 0; i < mNumWorkers; i++)
+    {
+        if (pthread_create(&mWorkers[i], NULL, WorkerMain, this) != 0)
+        {
+            LOGE("SvrTextureStreamer: Unable to start worker %d", i);
+            mNumWorkers = i;
+            break;
+        }
+    }
+
+    mInitialized = true;
+    LOGI("SvrTextureStreamer: Started %d workers, %d x %d KB staging", mNumWorkers,
+         SVR_STREAM_STAGING_FRAMES, SVR_STREAM_STAGING_SIZE / 1024);
+
+    if (mNumWorkers == 0)
+    {
+        Shutdown();
+        return false;
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+void SvrTextureStreamer::Shutdown()
+//-----------------------------------------------------------------------------
+{
+    if (!mInitialized)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&mQueueLock);
+    mShutdown = true;
+    pthread_cond_broadcast(&mQueueCond);
+    pthread_mutex_unlock(&mQueueLock);
+
+    for (int i = 0; i < mNumWorkers; i++)
+    {
+        pthread_join(mWorkers[i], NULL);
+    }
+    mNumWorkers = 0;
+
+    // Workers are gone, every slot can be torn down directly
+    for (int i = 0; i < SVR_STREAM_MAX_TEXTURES; i++)
+    {
+        if (mSlots[i].state.load(std::memory_order_relaxed) != kStreamFree)
+        {
+            FreeSlot(mSlots[i]);
+        }
+    }
+    mQueueCount = 0;
+
+    for (int i = 0; i < SVR_STREAM_STAGING_FRAMES; i++)
+    {
+        if (mStagingFences[i] != 0)
+        {
+            glDeleteSync(mStagingFences[i]);
+            mStagingFences[i] = 0;
+        }
+    }
+    glDeleteBuffers(1, &mStagingBuffer);
+    glDeleteTextures(1, &mPlaceholder);
+    mStagingBuffer = 0;
+    mPlaceholder = 0;
+
+    mpCompleted->~CompletionRing();
+    free(mpCompleted);
+    mpCompleted = NULL;
+
+    pthread_cond_destroy(&mQueueCond);
+    pthread_mutex_destroy(&mQueueLock);
+
+    mInitialized = false;
+}
+
+//-----------------------------------------------------------------------------
+bool SvrTextureStreamer::QueueOrder(unsigned short a, unsigned short b) const
+//-----------------------------------------------------------------------------
+{
+    // Heap comparator: true when a should be served after b
+    const Slot& slotA = mSlots[a];
+    const Slot& slotB = mSlots[b];
+    if (slotA.visible != slotB.visible)
+        return slotB.visible;
+    if (slotA.priority != slotB.priority)
+        return slotA.priority < slotB.priority;
+    return (int)(slotA.sequence - slotB.sequence) > 0;
+}
+
+//-----------------------------------------------------------------------------
+SvrTextureHandle SvrTextureStreamer::Request(const char* pName, float priority)
+//-----------------------------------------------------------------------------
+{
+    if (!mInitialized)
+    {
+        LOGE("SvrTextureStreamer: Request for %s before Initialize", pName);
+        return 0;
+    }
+
+    if (strlen(pName) >= SVR_STREAM_NAME_LENGTH)
+    {
+        LOGE("SvrTextureStreamer: Name too long: %s", pName);
+        return 0;
+    }
+
+    unsigned short index = 0;
+    while (index < SVR_STREAM_MAX_TEXTURES && mSlots[index].state.load(std::memory_order_relaxed) != kStreamFree)
+    {
+        index++;
+    }
+    if (index == SVR_STREAM_MAX_TEXTURES)
+    {
+        LOGE("SvrTextureStreamer: Out of slots, dropping request for %s", pName);
+        return 0;
+    }
+
+    Slot& slot = mSlots[index];
+    strcpy(slot.name, pName);
+    slot.visible = true;
+    slot.priority = priority;
+    slot.sequence = mNextSequence++;
+    slot.releasePending = false;
+    slot.pSource = NULL;
+    slot.sourceSize = 0;
+    slot.sourceMapped = false;
+    slot.texture = 0;
+    slot.uploadTexture = 0;
+    slot.target = 0;
+    slot.nextLevel = -1;
+    slot.numLevels = 0;
+    slot.baseLevel = 0;
+    slot.droppedLevels = 0;
+    slot.textureSize = 0;
+    slot.uploadSize = 0;
+    slot.lastUsedFrame = mFrameIndex;
+
+    QueueSlot(index);
+    return index + 1;
+}
+
+//-----------------------------------------------------------------------------
+void SvrTextureStreamer::QueueSlot(unsigned short index)
+//-----------------------------------------------------------------------------
+{
+    pthread_mutex_lock(&mQueueLock);
+    mSlots[index].state.store(kStreamQueued, std::memory_order_relaxed);
+    mQueue[mQueueCount++] = index;
+    if (!mQueueDirty)
+    {
+        std::push_heap(mQueue, mQueue + mQueueCount, [this](unsigned short a, unsigned short b) { return QueueOrder(a, b); });
+    }
+    pthread_cond_signal(&mQueueCond);
+    pthread_mutex_unlock(&mQueueLock);
+}
+
+//-----------------------------------------------------------------------------
+void SvrTextureStreamer::SetPriority(SvrTextureHandle handle, bool visible, float priority)
+//-----------------------------------------------------------------------------
+{
+    if (handle == 0 || handle > SVR_STREAM_MAX_TEXTURES)
+    {
+        return;
+    }
+
+    Slot& slot = mSlots[handle - 1];
+    if (slot.visible == visible && slot.priority == priority)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&mQueueLock);
+    slot.visible = visible;
+    slot.priority = priority;
+    if (slot.state.load(std::memory_order_relaxed) == kStreamQueued)
+    {
+        mQueueDirty = true;
+    }
+    pthread_mutex_unlock(&mQueueLock);
+}
+
+//-----------------------------------------------------------------------------
+void SvrTextureStreamer::RemoveFromQueue(unsigned short index)
+//-----------------------------------------------------------------------------
+{
+    // Caller holds mQueueLock
+    for (unsigned int i = 0; i < mQueueCount; i++)
+    {
+        if (mQueue[i] == index)
+        {
+            mQueue[i] = mQueue[--mQueueCount];
+            mQueueDirty = true;
+            return;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void SvrTextureStreamer::Release(SvrTextureHandle handle)
+//-----------------------------------------------------------------------------
+{
+    if (handle == 0 || handle > SVR_STREAM_MAX_TEXTURES)
+    {
+        return;
+    }
+
+    Slot& slot = mSlots[handle - 1];
+
+    pthread_mutex_lock(&mQueueLock);
+    int state = slot.state.load(std::memory_order_acquire);
+    if (state == kStreamQueued)
+    {
+        RemoveFromQueue(handle - 1);
+    }
+    pthread_mutex_unlock(&mQueueLock);
+
+    if (state == kStreamLoading || state == kStreamParsed)
+    {
+        // Still owned by a worker or sitting in the completion ring, Update frees it
+        slot.releasePending = true;
+        return;
+    }
+
+    if (state != kStreamFree)
+    {
+        FreeSlot(slot);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void SvrTextureStreamer::FreeSlot(Slot& slot)
+//-----------------------------------------------------------------------------
+{
+    if (slot.texture != 0)
+    {
+        glDeleteTextures(1, &slot.texture);
+        slot.texture = 0;
+    }
+    if (slot.uploadTexture != 0)
+    {
+        glDeleteTextures(1, &slot.uploadTexture);
+        slot.uploadTexture = 0;
+    }
+    mStats.residentBytes -= slot.textureSize + slot.uploadSize;
+    slot.textureSize = 0;
+    slot.uploadSize = 0;
+
+    ReleaseSource(slot);
+    slot.releasePending = false;
+    slot.state.store(kStreamFree, std::memory_order_release);
+}
+
+//-----------------------------------------------------------------------------
+void* SvrTextureStreamer::WorkerMain(void* pArg)
+//-----------------------------------------------------------------------------
+{
+    ((SvrTextureStreamer*)pArg)->WorkerLoop();
+    return NULL;
+}
+
+//-----------------------------------------------------------------------------
+bool SvrTextureStreamer::PopRequest(unsigned short* pIndex)
+//-----------------------------------------------------------------------------
+{
+    pthread_mutex_lock(&mQueueLock);
+    while (!mShutdown && mQueueCount == 0)
+    {
+        pthread_cond_wait(&mQueueCond, &mQueueLock);
+    }
+
+    if (mShutdown)
+    {
+        pthread_mutex_unlock(&mQueueLock);
+        return false;
+    }
+
+    auto order = [this](unsigned short a, unsigned short b) { return QueueOrder(a, b); };
+    if (mQueueDirty)
+    {
+        std::make_heap(mQueue, mQueue + mQueueCount, order);
+        mQueueDirty = false;
+    }
+    std::pop_heap(mQueue, mQueue + mQueueCount, order);
+    *pIndex = mQueue[--mQueueCount];
+
+    mSlots[*pIndex].state.store(kStreamLoading, std::memory_order_relaxed);
+    pthread_mutex_unlock(&mQueueLock);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+void SvrTextureStreamer::WorkerLoop()
+//-----------------------------------------------------------------------------
+{
+    unsigned short index;
+    while (PopRequest(&index))
+    {
+        Slot& slot = mSlots[index];
+
+        bool parsed = false;
+        if (LoadSource(slot))
+        {
+            parsed = slot.ktx.Parse(slot.pSource, (uint32)slot.sourceSize) == KTX_SUCCESS;
+            if (parsed)
+            {
+                // Generated levels stream and drop like stored ones
+                slot.ktx.GenerateMips();
+            }
+            else
+            {
+                LOGE("SvrTextureStreamer: Unable to parse %s", slot.name);
+                ReleaseSource(slot);
+            }
+        }
+
+        slot.state.store(parsed ? kStreamParsed : kStreamFailed, std::memory_order_release);
+
+        // Each slot is in the ring at most once, so it can never fill up
+        mpCompleted->Push(index);
+    }
+}
+
+//-----------------------------------------------------------------------------
+bool SvrTextureStreamer::LoadSource(Slot& slot)
+//-----------------------------------------------------------------------------
+{
+    SvrArchiveSpan span;
+    if (SvrFindAsset(slot.name, &span, true))
+    {
+        slot.pSource = span.pData;
+        slot.sourceSize = span.size;
+        slot.sourceMapped = false;
+    }
+    else
+    {
+        char filePath[512];
+        snprintf(filePath, sizeof(filePath), "%s/%s", mBasePath, slot.name);
+
+        int fd = open(filePath, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            LOGE("SvrTextureStreamer: Unable to open %s", filePath);
+            return false;
+        }
+
+        struct stat fileStat;
+        void* pMapping = MAP_FAILED;
+        if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+        {
+            pMapping = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        close(fd);
+        if (pMapping == MAP_FAILED)
+        {
+            LOGE("SvrTextureStreamer: Unable to map %s", filePath);
+            return false;
+        }
+
+        slot.pSource = pMapping;
+        slot.sourceSize = fileStat.st_size;
+        slot.sourceMapped = true;
+        madvise(pMapping, slot.sourceSize, MADV_WILLNEED);
+    }
+
+    // Fault every page in here so the render thread's copy into the staging buffer
+    // never waits on storage
+    const volatile unsigned char* pBytes = (const volatile unsigned char*)slot.pSource;
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    for (size_t offset = 0; offset < slot.sourceSize; offset += pageSize)
+    {
+        (void)pBytes[offset];
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+void SvrTextureStreamer::ReleaseSource(Slot& slot)
+//-----------------------------------------------------------------------------
+{
+    slot.ktx.FreeGeneratedLevels();
+    if (slot.pSource != NULL && slot.sourceMapped)
+    {
+        munmap((void*)slot.pSource, slot.sourceSize);
+    }
+    slot.pSource = NULL;
+    slot.sourceSize = 0;
+    slot.sourceMapped = false;
+}
+
+//-----------------------------------------------------------------------------
+void SvrTextureStreamer::BeginUpload(Slot& slot)
+//-----------------------------------------------------------------------------
+{
+    slot.numLevels = slot.ktx.GetNumLevels();
+    slot.baseLevel = std::min(slot.baseLevel, slot.numLevels - 1);
+
+    slot.uploadTexture = 0;
+    if (slot.ktx.AllocateStorage(&slot.uploadTexture, &slot.target, slot.baseLevel) != KTX_SUCCESS)
+    {
+        LOGE("SvrTextureStreamer: Unable to allocate storage for %s", slot.name);
+        FinishUpload(slot, false);
+        return;
+    }
+    glBindTexture(slot.target, 0);
+
+    slot.uploadSize = 0;
+    for (int level = slot.baseLevel; level < slot.numLevels; level++)
+    {
+        slot.uploadSize += slot.ktx.GetLevelUploadSize(level);
+    }
+    if (slot.ktx.NeedsMipGeneration())
+    {
+        slot.uploadSize += slot.uploadSize / 3;
+    }
+    mStats.residentBytes += slot.uploadSize;
+
+    slot.nextLevel = slot.numLevels - 1;
+    slot.state.store(kStreamUploading, std::memory_order_relaxed);
+}
+
+//-----------------------------------------------------------------------------
+void SvrTextureStreamer::FinishUpload(Slot& slot, bool succeeded)
+//-----------------------------------------------------------------------------
+{
+    // Level pointers go stale with the source, the texture is all that is left
+    ReleaseSource(slot);
+
+    if (succeeded)
+    {
+        // A reduced or restored copy replaces the one that has been in use meanwhile
+        if (slot.texture != 0)
+        {
+            glDeleteTextures(1, &slot.texture);
+            mStats.residentBytes -= slot.textureSize;
+        }
+        slot.texture = slot.uploadTexture;
+        slot.textureSize = slot.uploadSize;
+        slot.droppedLevels = slot.baseLevel;
+    }
+    else if (slot.uploadTexture != 0)
+    {
+        glDeleteTextures(1, &slot.uploadTexture);
+        mStats.residentBytes -= slot.uploadSize;
+    }
+    slot.uploadTexture = 0;
+    slot.uploadSize = 0;
+
+    // A failed reload leaves the current texture in place
+    slot.state.store((slot.texture != 0) ? kStreamResident : kStreamFailed, std::memory_order_relaxed);
+}
+
+//-----------------------------------------------------------------------------
+SvrTextureStreamer::Slot* SvrTextureStreamer::PickUpload()
+//-----------------------------------------------------------------------------
+{
+    // Visible first, then whichever texture has the smallest level pending so every
+    // texture gets a coarse version before any gets its full resolution
+    Slot* pBest = NULL;
+    uint32 bestSize = 0;
+    for (int i = 0; i < SVR_STREAM_MAX_TEXTURES; i++)
+    {
+        Slot& slot = mSlots[i];
+        if (slot.state.load(std::memory_order_relaxed) != kStreamUploading)
+            continue;
+
+        uint32 size = slot.ktx.GetLevelUploadSize(slot.nextLevel);
+        if (pBest == NULL ||
+            (slot.visible != pBest->visible && slot.visible) ||
+            (slot.visible == pBest->visible && (size < bestSize || (size == bestSize && slot.priority > pBest->priority))))
+        {
+            pBest = &slot;
+            bestSize = size;
+        }
+    }
+    return pBest;
+}
+
+//-----------------------------------------------------------------------------
+bool SvrTextureStreamer::UploadNextLevel(Slot& slot)
+//-----------------------------------------------------------------------------
+{
+    uint32 level = slot.nextLevel;
+    size_t size = slot.ktx.GetLevelUploadSize(level);
+    size_t alignedSize = (size + STAGING_ALIGNMENT - 1) & ~(size_t)(STAGING_ALIGNMENT - 1);
+
+    glBindTexture(slot.target, slot.uploadTexture);
+
+    TKTXErrorCode result;
+    if (size > SVR_STREAM_STAGING_SIZE)
+    {
+        // Would never fit a segment, let the driver take its own copy
+        SvrArenaScope scope(SvrGetThreadArena());
+        uint8* pCopy = SvrGetThreadArena().AllocArray<uint8>(size);
+        slot.ktx.CopyLevel(level, pCopy);
+        result = slot.ktx.UploadLevel(level, pCopy, slot.baseLevel);
+    }
+    else
+    {
+        if (mStagingUsed + alignedSize > SVR_STREAM_STAGING_SIZE)
+        {
+            // Segment is full for this frame
+            glBindTexture(slot.target, 0);
+            return false;
+        }
+
+        if (!mStagingReady)
+        {
+            // First use of the segment this frame, the GPU must be done with its last copies
+            GLsync fence = mStagingFences[mStagingFrame];
+            if (fence != 0)
+            {
+                if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+                {
+                    mStats.stagingStalled = true;
+                    glBindTexture(slot.target, 0);
+                    return false;
+                }
+                glDeleteSync(fence);
+                mStagingFences[mStagingFrame] = 0;
+            }
+            mStagingReady = true;
+        }
+
+        size_t offset = mStagingFrame * SVR_STREAM_STAGING_SIZE + mStagingUsed;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mStagingBuffer);
+        void* pStaging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, offset, size,
+                                          GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (pStaging == NULL)
+        {
+            LOGE("SvrTextureStreamer: Unable to map staging buffer");
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            glBindTexture(slot.target, 0);
+            return false;
+        }
+
+        slot.ktx.CopyLevel(level, pStaging);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        result = slot.ktx.UploadLevel(level, (const void*)offset, slot.baseLevel);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        mStagingUsed += alignedSize;
+    }
+
+    if (result != KTX_SUCCESS)
+    {
+        LOGE("SvrTextureStreamer: Upload of level %d of %s failed", level, slot.name);
+        glBindTexture(slot.target, 0);
+        FinishUpload(slot, false);
+        return true;
+    }
+
+    // Sample only from what has arrived
+    glTexParameteri(slot.target, GL_TEXTURE_BASE_LEVEL, level - slot.baseLevel);
+    slot.nextLevel--;
+
+    mStats.levelsUploaded++;
+    mStats.bytesUploaded += size;
+
+    if (slot.nextLevel < slot.baseLevel)
+    {
+        if (slot.ktx.NeedsMipGeneration())
+        {
+            glGenerateMipmap(slot.target);
+        }
+        FinishUpload(slot, true);
+    }
+
+    glBindTexture(slot.target, 0);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+void SvrTextureStreamer::Update(float budgetMs)
+//-----------------------------------------------------------------------------
+{
+    if (!mInitialized)
+    {
+        return;
+    }
+
+    uint64_t startTime = GetTimeNano();
+    uint64_t budgetNs = (uint64_t)(budgetMs * 1.0e6f);
+
+    mStats.levelsUploaded = 0;
+    mStats.bytesUploaded = 0;
+    mStats.stagingStalled = false;
+
+    unsigned short index;
+    while (mpCompleted->Pop(&index))
+    {
+        Slot& slot = mSlots[index];
+        if (slot.releasePending)
+        {
+            FreeSlot(slot);
+        }
+        else if (slot.state.load(std::memory_order_acquire) == kStreamParsed)
+        {
+            BeginUpload(slot);
+        }
+        else if (slot.state.load(std::memory_order_relaxed) == kStreamFailed && slot.texture != 0)
+        {
+            // Reload failed, keep what is there
+            slot.state.store(kStreamResident, std::memory_order_relaxed);
+        }
+    }
+
+    UpdateResidency();
+
+    // KTX rows are 4 byte aligned
+    GLint previousUnpackAlignment = 4;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &previousUnpackAlignment);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    mStagingUsed = 0;
+    mStagingReady = false;
+    while (GetTimeNano() - startTime < budgetNs)
+    {
+        Slot* pSlot = PickUpload();
+        if (pSlot == NULL || !UploadNextLevel(*pSlot))
+        {
+            break;
+        }
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, previousUnpackAlignment);
+
+    if (mStagingUsed > 0)
+    {
+        mStagingFences[mStagingFrame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        mStagingFrame = (mStagingFrame + 1) % SVR_STREAM_STAGING_FRAMES;
+    }
+
+    mStats.uploadMs = (float)(GetTimeNano() - startTime) * NANOSECONDS_TO_MILLISECONDS;
+}
+
+//-----------------------------------------------------------------------------
+GLuint SvrTextureStreamer::GetTexture(SvrTextureHandle handle, GLenum* pTarget)
+//-----------------------------------------------------------------------------
+{
+    if (handle == 0 || handle > SVR_STREAM_MAX_TEXTURES)
+    {
+        return 0;
+    }
+
+    Slot& slot = mSlots[handle - 1];
+    int state = slot.state.load(std::memory_order_relaxed);
+    if (state == kStreamFree)
+    {
+        return 0;
+    }
+
+    slot.lastUsedFrame = mFrameIndex;
+    if (state == kStreamEvicted)
+    {
+        Reload(slot, slot.droppedLevels);
+    }
+
+    GLuint texture = slot.texture;
+    if (texture == 0 && state == kStreamUploading && slot.nextLevel < slot.numLevels - 1)
+    {
+        // First load still going, show the levels that are in
+        texture = slot.uploadTexture;
+    }
+
+    if (texture != 0)
+    {
+        if (pTarget)
+        {
+            *pTarget = slot.target;
+        }
+        return texture;
+    }
+
+    if (slot.target != 0 && slot.target != GL_TEXTURE_2D)
+    {
+        return 0;
+    }
+
+    if (pTarget)
+    {
+        *pTarget = GL_TEXTURE_2D;
+    }
+    return mPlaceholder;
+}
+
+//-----------------------------------------------------------------------------
+SvrStreamState SvrTextureStreamer::GetState(SvrTextureHandle handle) const
+//-----------------------------------------------------------------------------
+{
+    if (handle == 0 || handle > SVR_STREAM_MAX_TEXTURES)
+    {
+        return kStreamFree;
+    }
+    return (SvrStreamState)mSlots[handle - 1].state.load(std::memory_order_relaxed);
+}
+
+//-----------------------------------------------------------------------------
+bool SvrTextureStreamer::IsResident(SvrTextureHandle handle) const
+//-----------------------------------------------------------------------------
+{
+    if (handle == 0 || handle > SVR_STREAM_MAX_TEXTURES)
+    {
+        return false;
+    }
+    return mSlots[handle - 1].texture != 0;
+}
+
+//-----------------------------------------------------------------------------
+void SvrTextureStreamer::SetBudget(size_t budgetBytes)
+//-----------------------------------------------------------------------------
+{
+    mBudget = budgetBytes;
+}
+
+//-----------------------------------------------------------------------------
+void SvrTextureStreamer::OnLowMemory()
+//-----------------------------------------------------------------------------
+{
+    // Acted on by the next Update
+    mLowMemory = true;
+}
+
+//-----------------------------------------------------------------------------
+size_t SvrTextureStreamer::GetEventualSize(const Slot& slot) const
+//-----------------------------------------------------------------------------
+{
+    int state = slot.state.load(std::memory_order_relaxed);
+    if (state == kStreamUploading)
+    {
+        return slot.uploadSize;
+    }
+
+    if (slot.texture != 0 && state != kStreamResident)
+    {
+        // Reload not started on the GPU yet, each level is a quarter of the one above
+        int levels = slot.baseLevel - slot.droppedLevels;
+        return (levels >= 0) ? (slot.textureSize >> (2 * levels)) : (slot.textureSize << (-2 * levels));
+    }
+
+    return slot.textureSize;
+}
+
+//-----------------------------------------------------------------------------
+void SvrTextureStreamer::Reload(Slot& slot, int baseLevel)
+//-----------------------------------------------------------------------------
+{
+    slot.baseLevel = baseLevel;
+    slot.sequence = mNextSequence++;
+    QueueSlot((unsigned short)(&slot - mSlots));
+}
+
+//-----------------------------------------------------------------------------
+void SvrTextureStreamer::Evict(Slot& slot)
+//-----------------------------------------------------------------------------
+{
+    // droppedLevels is kept so the texture comes back the way it left
+    glDeleteTextures(1, &slot.texture);
+    mStats.residentBytes -= slot.textureSize;
+    slot.texture = 0;
+    slot.textureSize = 0;
+    slot.state.store(kStreamEvicted, std::memory_order_relaxed);
+    mStats.totalEvictions++;
+}
+
+//-----------------------------------------------------------------------------
+void SvrTextureStreamer::UpdateResidency()
+//-----------------------------------------------------------------------------
+{
+    mFrameIndex++;
+
+    if (mLowMemory)
+    {
+        mLowMemory = false;
+        mLastLowMemoryFrame = mFrameIndex;
+        mStats.totalLowMemoryEvents++;
+
+        // Whatever has not been drawn lately goes right away
+        for (int i = 0; i < SVR_STREAM_MAX_TEXTURES; i++)
+        {
+            Slot& slot = mSlots[i];
+            if (slot.state.load(std::memory_order_relaxed) == kStreamResident &&
+                mFrameIndex - slot.lastUsedFrame > SVR_RESIDENCY_IDLE_FRAMES)
+            {
+                Evict(slot);
+            }
+        }
+
+        mPressureBudget = mStats.residentBytes - mStats.residentBytes / 4;
+        LOGW("SvrTextureStreamer: Low memory, texture budget lowered to %zu KB", mPressureBudget / 1024);
+        LogStats();
+    }
+
+    if (mPressureBudget != 0 && mFrameIndex - mLastLowMemoryFrame > SVR_RESIDENCY_RECOVER_FRAMES)
+    {
+        LOGI("SvrTextureStreamer: Memory pressure over, texture budget back to %zu KB", mBudget / 1024);
+        mPressureBudget = 0;
+    }
+
+    size_t budget = mBudget;
+    if (mPressureBudget != 0 && mPressureBudget < budget)
+    {
+        budget = mPressureBudget;
+    }
+    mStats.budgetBytes = budget;
+    mStats.underPressure = (mPressureBudget != 0);
+
+    if (mStats.residentBytes > budget)
+    {
+        TrimToBudget(budget);
+    }
+    else if (mPressureBudget == 0)
+    {
+        RestoreLevels(budget);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void SvrTextureStreamer::TrimToBudget(size_t budget)
+//-----------------------------------------------------------------------------
+{
+    // Count reloads already under way at the size they will end up
+    size_t projected = 0;
+    for (int i = 0; i < SVR_STREAM_MAX_TEXTURES; i++)
+    {
+        projected += GetEventualSize(mSlots[i]);
+    }
+
+    bool skipped[SVR_STREAM_MAX_TEXTURES];
+    memset(skipped, 0, sizeof(skipped));
+
+    while (projected > budget)
+    {
+        // Least recently used complete texture, the largest of those used in the same frame
+        Slot* pVictim = NULL;
+        for (int i = 0; i < SVR_STREAM_MAX_TEXTURES; i++)
+        {
+            Slot& slot = mSlots[i];
+            if (skipped[i] || slot.state.load(std::memory_order_relaxed) != kStreamResident)
+                continue;
+
+            int age = (int)(pVictim ? pVictim->lastUsedFrame - slot.lastUsedFrame : 0);
+            if (pVictim == NULL || age > 0 || (age == 0 && slot.textureSize > pVictim->textureSize))
+            {
+                pVictim = &slot;
+            }
+        }
+
+        if (pVictim == NULL)
+        {
+            break;
+        }
+
+        bool idle = (mFrameIndex - pVictim->lastUsedFrame > SVR_RESIDENCY_IDLE_FRAMES);
+        bool canDrop = (pVictim->droppedLevels < SVR_RESIDENCY_MAX_DROPPED &&
+                        pVictim->droppedLevels + 1 < pVictim->numLevels);
+        if (idle)
+        {
+            projected -= pVictim->textureSize;
+            Evict(*pVictim);
+        }
+        else if (canDrop)
+        {
+            projected -= pVictim->textureSize - (pVictim->textureSize >> 2);
+            Reload(*pVictim, pVictim->droppedLevels + 1);
+            mStats.totalMipDrops++;
+        }
+        else
+        {
+            // In use and already as small as it gets
+            skipped[pVictim - mSlots] = true;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void SvrTextureStreamer::RestoreLevels(size_t budget)
+//-----------------------------------------------------------------------------
+{
+    // One texture at a time, most recently used first.  Both copies exist until the
+    // larger one is complete, so the old size counts against the headroom as well.
+    Slot* pCandidate = NULL;
+    for (int i = 0; i < SVR_STREAM_MAX_TEXTURES; i++)
+    {
+        Slot& slot = mSlots[i];
+        int state = slot.state.load(std::memory_order_relaxed);
+        if (slot.texture != 0 && state != kStreamResident)
+        {
+            return;
+        }
+
+        if (state != kStreamResident || slot.droppedLevels == 0 ||
+            mFrameIndex - slot.lastUsedFrame > SVR_RESIDENCY_IDLE_FRAMES)
+            continue;
+
+        if (pCandidate == NULL || (int)(slot.lastUsedFrame - pCandidate->lastUsedFrame) > 0)
+        {
+            pCandidate = &slot;
+        }
+    }
+
+    if (pCandidate == NULL)
+    {
+        return;
+    }
+
+    size_t peak = mStats.residentBytes + (pCandidate->textureSize << 2);
+    if (peak <= (size_t)(budget * SVR_RESIDENCY_RESTORE_HEADROOM))
+    {
+        Reload(*pCandidate, pCandidate->droppedLevels - 1);
+        mStats.totalRestores++;
+    }
+}
+
+//-----------------------------------------------------------------------------
+void SvrTextureStreamer::GetStats(SvrStreamStats* pStats) const
+//-----------------------------------------------------------------------------
+{
+    *pStats = mStats;
+    pStats->numQueued = 0;
+    pStats->numLoading = 0;
+    pStats->numUploading = 0;
+    pStats->numResident = 0;
+    pStats->numEvicted = 0;
+    pStats->numFailed = 0;
+    pStats->droppedLevels = 0;
+
+    for (int i = 0; i < SVR_STREAM_MAX_TEXTURES; i++)
+    {
+        switch (mSlots[i].state.load(std::memory_order_relaxed))
+        {
+        case kStreamQueued:     pStats->numQueued++;    break;
+        case kStreamLoading:
+        case kStreamParsed:     pStats->numLoading++;   break;
+        case kStreamUploading:  pStats->numUploading++; break;
+        case kStreamResident:   pStats->numResident++;  break;
+        case kStreamEvicted:    pStats->numEvicted++;   break;
+        case kStreamFailed:     pStats->numFailed++;    break;
+        default:                                        break;
+        }
+
+        if (mSlots[i].texture != 0)
+        {
+            pStats->droppedLevels += mSlots[i].droppedLevels;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void SvrTextureStreamer::LogStats() const
+//-----------------------------------------------------------------------------
+{
+    SvrStreamStats stats;
+    GetStats(&stats);
+
+    LOGI("SvrTextureStreamer: %u resident, %u loading, %u uploading, %u evicted, %u failed",
+         stats.numResident, stats.numQueued + stats.numLoading, stats.numUploading, stats.numEvicted, stats.numFailed);
+    LOGI("    %zu KB of %zu KB budget%s, %u levels dropped", stats.residentBytes / 1024, stats.budgetBytes / 1024,
+         stats.underPressure ? " (under pressure)" : "", stats.droppedLevels);
+    LOGI("    %u evictions, %u mip drops, %u restores, %u low memory warnings", stats.totalEvictions,
+         stats.totalMipDrops, stats.totalRestores, stats.totalLowMemoryEvents);
+}
+
+}   // namespace Svr
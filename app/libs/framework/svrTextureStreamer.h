@@ -0,0 +1,226 @@
+//=============================================================================
+// FILE: svrTextureStreamer.h
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//=============================================================================
+#pragma once
+
+#include <atomic>
+#include <pthread.h>
+#include <stddef.h>
+
+#include <GLES3/gl3.h>
+
+#include "svrKtxLoader.h"
+#include "svrRingBuffer.h"
+
+#define SVR_STREAM_MAX_TEXTURES     256         // Power of two, also sizes the completion ring
+#define SVR_STREAM_MAX_WORKERS      4
+#define SVR_STREAM_NUM_WORKERS      2
+#define SVR_STREAM_NAME_LENGTH      128
+
+// Pixel unpack staging is one buffer split in per frame segments, each fenced so a
+// segment is only rewritten once the GPU has consumed the copies made from it.
+// Levels larger than a segment are uploaded from client memory instead.
+#define SVR_STREAM_STAGING_FRAMES   3
+#define SVR_STREAM_STAGING_SIZE     (4 * 1024 * 1024)
+
+// Residency.  Textures over budget first lose their top levels (each one a quarter of
+// the remaining size), textures not drawn for SVR_RESIDENCY_IDLE_FRAMES are evicted
+// outright.  A low memory warning lowers the budget to 3/4 of what is resident until
+// SVR_RESIDENCY_RECOVER_FRAMES pass without another one, then levels are brought back
+// one at a time while they fit under SVR_RESIDENCY_RESTORE_HEADROOM of the budget.
+#define SVR_RESIDENCY_DEFAULT_BUDGET    (192 * 1024 * 1024)
+#define SVR_RESIDENCY_MAX_DROPPED       3
+#define SVR_RESIDENCY_IDLE_FRAMES       120
+#define SVR_RESIDENCY_RECOVER_FRAMES    600
+#define SVR_RESIDENCY_RESTORE_HEADROOM  0.875f
+
+namespace Svr
+{
+    // 0 is never a valid handle
+    typedef unsigned int SvrTextureHandle;
+
+    enum SvrStreamState
+    {
+        kStreamFree = 0,
+        kStreamQueued,          // Waiting for a worker
+        kStreamLoading,         // Worker is reading and parsing
+        kStreamParsed,          // Waiting for the render thread to pick it up
+        kStreamUploading,       // Levels are going up, smallest first
+        kStreamResident,        // All levels uploaded
+        kStreamEvicted,         // Freed for memory, reloaded when next used
+        kStreamFailed
+    };
+
+    struct SvrStreamStats
+    {
+        unsigned int    numQueued;
+        unsigned int    numLoading;
+        unsigned int    numUploading;
+        unsigned int    numResident;
+        unsigned int    numEvicted;
+        unsigned int    numFailed;
+
+        // Residency
+        size_t          residentBytes;      // Texture storage currently allocated, uploads in flight included
+        size_t          budgetBytes;        // Budget in effect, lowered while under memory pressure
+        unsigned int    droppedLevels;      // Top levels currently left out across all textures
+        bool            underPressure;
+        unsigned int    totalEvictions;
+        unsigned int    totalMipDrops;
+        unsigned int    totalRestores;
+        unsigned int    totalLowMemoryEvents;
+
+        // Last call to Update
+        unsigned int    levelsUploaded;
+        size_t          bytesUploaded;
+        float           uploadMs;
+        bool            stagingStalled;     // The staging segment was still in use by the GPU
+    };
+
+    // Loads KTX textures in the background.  Worker threads read the file (from the
+    // mounted archives, else from the base path) and parse it, the render thread then
+    // uploads it a level at a time within a per frame time budget.  Levels go up from
+    // the smallest, and GL_TEXTURE_BASE_LEVEL follows them, so a texture can be drawn
+    // at low resolution while the rest of its chain is still on the way.
+    //
+    // Requests are served visible first, then by descending priority, then in request
+    // order.  Uploads likewise favour visible textures and, across textures, whichever
+    // has the smallest level pending.
+    //
+    // Texture storage is accounted per texture and held under a budget, see the
+    // SVR_RESIDENCY_ defines above.  Recency comes from GetTexture, so textures should
+    // be fetched through their handle every frame they are drawn.  Reduced and restored
+    // textures are rebuilt from their source in the background, the current texture
+    // stays in use until the replacement is complete.
+    //
+    // All calls except the workers' come from the render thread with the context current.
+    class SvrTextureStreamer
+    {
+    public:
+        SvrTextureStreamer();
+        ~SvrTextureStreamer();
+
+        bool                Initialize(const char* pBasePath, int numWorkers = SVR_STREAM_NUM_WORKERS);
+        void                Shutdown();
+
+        SvrTextureHandle    Request(const char* pName, float priority = 0.0f);
+        void                SetPriority(SvrTextureHandle handle, bool visible, float priority);
+        void                Release(SvrTextureHandle handle);
+
+        // Takes finished loads from the workers and uploads levels until budgetMs is spent
+        void                Update(float budgetMs);
+
+        // Until the first level is in, 2D requests get a 1x1 grey placeholder and other
+        // targets get 0.  The handle switches to the real texture on its own.  Marks the
+        // texture as used this frame, and queues an evicted one to be loaded again.
+        GLuint              GetTexture(SvrTextureHandle handle, GLenum* pTarget = NULL);
+        SvrStreamState      GetState(SvrTextureHandle handle) const;
+        bool                IsResident(SvrTextureHandle handle) const;
+
+        void                SetBudget(size_t budgetBytes);
+        void                OnLowMemory();
+
+        void                GetStats(SvrStreamStats* pStats) const;
+        void                LogStats() const;
+
+    private:
+        struct Slot
+        {
+            char                name[SVR_STREAM_NAME_LENGTH];
+            std::atomic<int>    state;
+
+            // Queue ordering, guarded by mQueueLock while the slot is queued
+            bool                visible;
+            float               priority;
+            unsigned int        sequence;
+
+            bool                releasePending;
+
+            // Written by the worker until the slot is handed back
+            KtxTexture          ktx;
+            const void*         pSource;
+            size_t              sourceSize;
+            bool                sourceMapped;
+
+            // Render thread
+            GLuint              texture;        // Complete texture, 0 until the first load finishes
+            GLuint              uploadTexture;  // Texture being built, replaces texture when done
+            GLenum              target;
+            int                 nextLevel;      // Next level to upload, -1 once all are in
+            int                 numLevels;
+            int                 baseLevel;      // Top levels left out of the load in progress
+            int                 droppedLevels;  // Top levels left out of texture
+            size_t              textureSize;
+            size_t              uploadSize;
+            unsigned int        lastUsedFrame;
+        };
+
+        typedef MpscRing<unsigned short, SVR_STREAM_MAX_TEXTURES> CompletionRing;
+
+        SvrTextureStreamer(const SvrTextureStreamer&);
+        SvrTextureStreamer& operator=(const SvrTextureStreamer&);
+
+        static void*        WorkerMain(void* pArg);
+        void                WorkerLoop();
+        bool                PopRequest(unsigned short* pIndex);
+        bool                LoadSource(Slot& slot);
+        void                ReleaseSource(Slot& slot);
+
+        bool                QueueOrder(unsigned short a, unsigned short b) const;
+        void                QueueSlot(unsigned short index);
+        void                RemoveFromQueue(unsigned short index);
+
+        void                BeginUpload(Slot& slot);
+        Slot*               PickUpload();
+        bool                UploadNextLevel(Slot& slot);
+        void                FinishUpload(Slot& slot, bool succeeded);
+        void                FreeSlot(Slot& slot);
+
+        void                UpdateResidency();
+        void                TrimToBudget(size_t budget);
+        void                RestoreLevels(size_t budget);
+        void                Reload(Slot& slot, int baseLevel);
+        void                Evict(Slot& slot);
+        size_t              GetEventualSize(const Slot& slot) const;
+
+        Slot                mSlots[SVR_STREAM_MAX_TEXTURES];
+        unsigned int        mNextSequence;
+
+        // Request queue, a binary heap of slot indices
+        pthread_mutex_t     mQueueLock;
+        pthread_cond_t      mQueueCond;
+        unsigned short      mQueue[SVR_STREAM_MAX_TEXTURES];
+        unsigned int        mQueueCount;
+        bool                mQueueDirty;        // Priorities changed, heap needs rebuilding
+        bool                mShutdown;
+
+        // Parsed slots on their way back to the render thread
+        CompletionRing*     mpCompleted;
+
+        pthread_t           mWorkers[SVR_STREAM_MAX_WORKERS];
+        int                 mNumWorkers;
+
+        char                mBasePath[256];
+        bool                mInitialized;
+
+        GLuint              mPlaceholder;
+        GLuint              mStagingBuffer;
+        GLsync              mStagingFences[SVR_STREAM_STAGING_FRAMES];
+        unsigned int        mStagingFrame;
+        size_t              mStagingUsed;
+        bool                mStagingReady;
+
+        // Residency
+        unsigned int        mFrameIndex;
+        size_t              mBudget;
+        size_t              mPressureBudget;    // 0 when not under pressure
+        unsigned int        mLastLowMemoryFrame;
+        bool                mLowMemory;
+
+        SvrStreamStats      mStats;
+    };
+}
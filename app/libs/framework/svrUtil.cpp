@@ -20,8 +20,32 @@
 
 namespace Svr
 {
+    void SvrCheckGlError(const char* file, int line)
+    {
+        // Errors queue up until read, so drain them all to report each one once
+        for (GLenum error = glGetError(); error != GL_NO_ERROR; error = glGetError())
+        {
+            const char* pName = "unknown";
+            switch (error)
+            {
+            case GL_INVALID_ENUM:                   pName = "GL_INVALID_ENUM"; break;
+            case GL_INVALID_VALUE:                  pName = "GL_INVALID_VALUE"; break;
+            case GL_INVALID_OPERATION:              pName = "GL_INVALID_OPERATION"; break;
+            case GL_INVALID_FRAMEBUFFER_OPERATION:  pName = "GL_INVALID_FRAMEBUFFER_OPERATION"; break;
+            case GL_OUT_OF_MEMORY:                  pName = "GL_OUT_OF_MEMORY"; break;
+            }
+            LOGE("%s(%d): GL error 0x%x (%s)", file, line, error, pName);
+        }
+    }
 
-
+    void SvrCheckEglError(const char* file, int line)
+    {
+        EGLint error = eglGetError();
+        if (error != EGL_SUCCESS)
+        {
+            LOGE("%s(%d): EGL error 0x%x", file, line, error);
+        }
+    }
 
     void SvrGetEyeViewMatrices(const svrHeadPoseState& poseState, bool bUseHeadModel,
                                float ipd, float headHeight, float headDepth, glm::mat4& outLeftEyeMatrix, glm::mat4& outRightEyeMatrix)
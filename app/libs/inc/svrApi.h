@@ -258,6 +258,10 @@ SVRP_EXPORT void svrSubmitFrame(const svrFrameParams* pFrameParams);
 
 SVRP_EXPORT bool svrIsVRModeStopped();
 
+//! \brief Applies configuration file changes picked up since the last call
+//! \note Call once per frame from the render thread, render thread affinity is set here
+SVRP_EXPORT void svrUpdateConfig();
+
 #ifdef __cplusplus 
 }
 #endif
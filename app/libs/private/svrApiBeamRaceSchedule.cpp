@@ -0,0 +1,70 @@
+//=============================================================================
+// FILE: svrApiBeamRaceSchedule.cpp
+//                  Copyright (c) 2016 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//==============================================================================
+#include "private/svrApiBeamRaceSchedule.h"
+
+//-----------------------------------------------------------------------------
+void svrBuildBeamRaceSchedule(uint64_t vsyncTimeNano, double framePeriodNano, double scanoutPct,
+                              uint32_t numLines, int numSlices, uint64_t marginNano,
+                              svrBeamRaceSchedule* pSchedule)
+//-----------------------------------------------------------------------------
+{
+    if (numLines == 0)
+    {
+        numLines = 1;
+    }
+
+    if (numSlices < 1)
+    {
+        numSlices = 1;
+    }
+    else if (numSlices > SVR_MAX_BEAM_RACE_SLICES)
+    {
+        numSlices = SVR_MAX_BEAM_RACE_SLICES;
+    }
+
+    if ((uint32_t)numSlices > numLines)
+    {
+        numSlices = (int)numLines;
+    }
+
+    if (scanoutPct <= 0.0 || scanoutPct > 1.0)
+    {
+        scanoutPct = 1.0;
+    }
+
+    pSchedule->numSlices = numSlices;
+    pSchedule->numLines = numLines;
+    pSchedule->vsyncTimeNano = vsyncTimeNano;
+    pSchedule->framePeriodNano = framePeriodNano;
+
+    const double lineNano = (framePeriodNano * scanoutPct) / (double)numLines;
+
+    for (int i = 0; i < numSlices; i++)
+    {
+        svrBeamRaceSlice& slice = pSchedule->slices[i];
+        slice.firstLine = 1 + (uint32_t)(((uint64_t)i * numLines) / numSlices);
+        slice.lastLine = (uint32_t)(((uint64_t)(i + 1) * numLines) / numSlices);
+        slice.scanoutStartNano = vsyncTimeNano + (uint64_t)((slice.firstLine - 1) * lineNano);
+        slice.scanoutEndNano = vsyncTimeNano + (uint64_t)(slice.lastLine * lineNano);
+        slice.poseTimeNano = slice.scanoutStartNano + (slice.scanoutEndNano - slice.scanoutStartNano) / 2;
+        slice.deadlineNano = slice.scanoutStartNano - marginNano;
+    }
+
+    // Each slice is released while the raster is scanning out the slice before it,
+    // slice 0 is released by the last slice of the previous frame
+    for (int i = 0; i < numSlices; i++)
+    {
+        svrBeamRaceSlice& slice = pSchedule->slices[i];
+        const svrBeamRaceSlice& prev = pSchedule->slices[(i + numSlices - 1) % numSlices];
+        slice.triggerLine = prev.firstLine;
+        slice.triggerTimeNano = prev.scanoutStartNano;
+        if (i == 0)
+        {
+            slice.triggerTimeNano -= (uint64_t)framePeriodNano;
+        }
+    }
+}
@@ -0,0 +1,50 @@
+//=============================================================================
+// FILE: svrApiBeamRaceSchedule.h
+//                  Copyright (c) 2016 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//==============================================================================
+#ifndef _SVR_API_BEAM_RACE_SCHEDULE_H_
+#define _SVR_API_BEAM_RACE_SCHEDULE_H_
+
+#include <stdint.h>
+
+#define SVR_MAX_BEAM_RACE_SLICES    16
+
+// Timing for one horizontal strip of the display.  Lines are display lines in
+// scanout order (1 to N, the same numbering the line pointer interrupt uses).
+struct svrBeamRaceSlice
+{
+    uint32_t    firstLine;          // First display line covered by the slice
+    uint32_t    lastLine;           // Last display line covered by the slice
+    uint32_t    triggerLine;        // Line pointer interrupt that releases rendering of this slice
+    uint64_t    triggerTimeNano;    // Time the raster reaches triggerLine
+    uint64_t    scanoutStartNano;   // Time the raster reaches firstLine
+    uint64_t    scanoutEndNano;     // Time the raster has finished lastLine
+    uint64_t    poseTimeNano;       // Time the slice pose is predicted for (middle of the slice scanout)
+    uint64_t    deadlineNano;       // Latest time rendering of the slice may complete
+};
+
+// Slice timing for the frame that starts scanning out at vsyncTimeNano
+struct svrBeamRaceSchedule
+{
+    int                 numSlices;
+    uint32_t            numLines;
+    uint64_t            vsyncTimeNano;
+    double              framePeriodNano;
+    svrBeamRaceSlice    slices[SVR_MAX_BEAM_RACE_SLICES];
+};
+
+// Builds the slice layout and timing for a frame.  Each slice is released when the
+// raster enters the previous slice (slice 0 is released by the last slice of the
+// previous frame) and must be complete marginNano before its own first line is
+// scanned out.  Pure function with no device dependencies.
+//
+// Only the schedule exists so far.  Arming the line pointer interrupt at each
+// triggerLine is left to the warp thread that renders the slices, which this tree
+// does not have yet (svrBeginTimeWarp is not built).
+void svrBuildBeamRaceSchedule(uint64_t vsyncTimeNano, double framePeriodNano, double scanoutPct,
+                              uint32_t numLines, int numSlices, uint64_t marginNano,
+                              svrBeamRaceSchedule* pSchedule);
+
+#endif //_SVR_API_BEAM_RACE_SCHEDULE_H_
@@ -0,0 +1,354 @@
+//=============================================================================
+// FILE: svrApiConfigWatch.cpp
+//                  Copyright (c) 2016 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//==============================================================================
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#include "svrApi.h"
+#include "svrUtil.h"
+#include "svrConfig.h"
+
+#include "private/svrApiCore.h"
+#include "private/svrApiConfigWatch.h"
+
+using namespace Svr;
+
+// Config reload properties
+VAR(bool, gEnableConfigReload, false, kVariableNonpersistent);      //Reload configuration variables while running whenever the config file or QVR service config changes
+VAR(int, gConfigReloadPollMs, 1000, kVariableNonpersistent);        //Interval the QVR service config buffer is checked for changes (milliseconds)
+
+#define MAX_CONFIG_PATH_LENGTH  256
+
+struct SvrConfigWatchState
+{
+    pthread_t       thread;
+    bool            running;
+
+    int             inotifyFd;
+    int             wakePipe[2];
+
+    char            filePath[MAX_CONFIG_PATH_LENGTH];
+    char            fileName[MAX_CONFIG_PATH_LENGTH];
+
+    char*           serviceBuffer;
+    unsigned int    serviceBufferLength;
+};
+
+static SvrConfigWatchState gConfigWatch = { 0, false, -1, { -1, -1 }, { 0 }, { 0 }, NULL, 0 };
+
+// Reloaded config text waiting for the render thread.  The watch thread publishes a whole
+// file at a time and svrApplyPendingConfig takes it, so a frame never sees half of a reload.
+static char* gPendingConfigBuffer = NULL;
+
+//-----------------------------------------------------------------------------
+static void svrQueueConfigBuffer(char* pBuffer)
+//-----------------------------------------------------------------------------
+{
+    // A reload the render thread has not picked up yet is superseded by this one
+    char* pOld = __atomic_exchange_n(&gPendingConfigBuffer, pBuffer, __ATOMIC_RELEASE);
+    free(pOld);
+}
+
+//-----------------------------------------------------------------------------
+static char* svrReadConfigFile(const char* pPath)
+//-----------------------------------------------------------------------------
+{
+    FILE* fp = fopen(pPath, "r");
+    if (fp == NULL)
+    {
+        LOGE("Unable to open config file: %s", pPath);
+        return NULL;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if (size < 0)
+    {
+        fclose(fp);
+        return NULL;
+    }
+
+    char* p = (char*)malloc(size + 1);
+    size_t len = fread(p, 1, size, fp);
+    p[len] = 0;
+    fclose(fp);
+    return p;
+}
+
+#ifdef USE_QVR_SERVICE
+//-----------------------------------------------------------------------------
+static char* svrFetchServiceConfig(unsigned int* pLength)
+//-----------------------------------------------------------------------------
+{
+    if (gAppContext == NULL || gAppContext->qvrService == NULL)
+    {
+        return NULL;
+    }
+
+    unsigned int len = 0;
+    if (gAppContext->qvrService->GetParam(QVRSERVICE_SDK_CONFIG_FILE, &len, NULL) != 0 || len == 0)
+    {
+        return NULL;
+    }
+
+    char* p = (char*)malloc(len + 1);
+    if (gAppContext->qvrService->GetParam(QVRSERVICE_SDK_CONFIG_FILE, &len, p) != 0)
+    {
+        free(p);
+        return NULL;
+    }
+    p[len] = 0;
+
+    *pLength = len;
+    return p;
+}
+
+//-----------------------------------------------------------------------------
+static void svrCheckServiceConfig()
+//-----------------------------------------------------------------------------
+{
+    unsigned int len = 0;
+    char* p = svrFetchServiceConfig(&len);
+    if (p == NULL)
+    {
+        return;
+    }
+
+    if (gConfigWatch.serviceBuffer != NULL &&
+        len == gConfigWatch.serviceBufferLength &&
+        memcmp(p, gConfigWatch.serviceBuffer, len) == 0)
+    {
+        free(p);
+        return;
+    }
+
+    // The first snapshot is only a baseline, the initial load is owned by svrInitialize
+    if (gConfigWatch.serviceBuffer != NULL)
+    {
+        LOGI("QVR Service config changed, reloading variables [len=%d]", len);
+        svrQueueConfigBuffer(strdup(p));
+    }
+
+    free(gConfigWatch.serviceBuffer);
+    gConfigWatch.serviceBuffer = p;
+    gConfigWatch.serviceBufferLength = len;
+}
+#endif // USE_QVR_SERVICE
+
+//-----------------------------------------------------------------------------
+static bool svrProcessInotifyEvents()
+//-----------------------------------------------------------------------------
+{
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool changed = false;
+
+    for (;;)
+    {
+        ssize_t len = read(gConfigWatch.inotifyFd, buffer, sizeof(buffer));
+        if (len <= 0)
+        {
+            break;
+        }
+
+        for (char* ptr = buffer; ptr < buffer + len; )
+        {
+            const struct inotify_event* event = (const struct inotify_event*)ptr;
+            if (event->len > 0 && strcmp(event->name, gConfigWatch.fileName) == 0)
+            {
+                changed = true;
+            }
+            ptr += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    return changed;
+}
+
+//-----------------------------------------------------------------------------
+static void* ConfigWatchThreadMain(void* arg)
+//-----------------------------------------------------------------------------
+{
+    LOGI("Config watch thread starting loop...");
+
+    struct pollfd fds[2];
+    memset(fds, 0, sizeof(fds));
+    fds[0].fd = gConfigWatch.wakePipe[0];
+    fds[0].events = POLLIN;
+    fds[1].fd = gConfigWatch.inotifyFd;
+    fds[1].events = POLLIN;
+    int numFds = (gConfigWatch.inotifyFd >= 0) ? 2 : 1;
+
+    while (1)
+    {
+        int timeout = -1;
+#ifdef USE_QVR_SERVICE
+        timeout = (gConfigReloadPollMs > 0) ? gConfigReloadPollMs : -1;
+#endif // USE_QVR_SERVICE
+
+        int res = poll(fds, numFds, timeout);
+        if (res < 0 && errno != EINTR)
+        {
+            LOGE("Config watch poll failed: %s", strerror(errno));
+            break;
+        }
+
+        if (fds[0].revents & (POLLIN | POLLHUP))
+        {
+            break;
+        }
+
+        // Editors write to a temp file and rename it over the original, so both
+        // a close after write and a move into the directory count as a change
+        if (numFds > 1 && (fds[1].revents & POLLIN) && svrProcessInotifyEvents())
+        {
+            LOGI("Config file changed, reloading variables: %s", gConfigWatch.filePath);
+            char* p = svrReadConfigFile(gConfigWatch.filePath);
+            if (p != NULL)
+            {
+                svrQueueConfigBuffer(p);
+            }
+        }
+
+#ifdef USE_QVR_SERVICE
+        if (res == 0)
+        {
+            svrCheckServiceConfig();
+        }
+#endif // USE_QVR_SERVICE
+    }
+
+    LOGI("Config watch thread exiting");
+    return NULL;
+}
+
+//-----------------------------------------------------------------------------
+void svrApplyPendingConfig()
+//-----------------------------------------------------------------------------
+{
+    char* p = __atomic_exchange_n(&gPendingConfigBuffer, NULL, __ATOMIC_ACQUIRE);
+    if (p == NULL)
+    {
+        return;
+    }
+
+    LoadVariableBuffer(p);
+    free(p);
+}
+
+//-----------------------------------------------------------------------------
+bool svrStartConfigWatch(const char* configFilePath)
+//-----------------------------------------------------------------------------
+{
+    if (!gEnableConfigReload || gConfigWatch.running)
+    {
+        return false;
+    }
+
+    strncpy(gConfigWatch.filePath, configFilePath, MAX_CONFIG_PATH_LENGTH - 1);
+    gConfigWatch.filePath[MAX_CONFIG_PATH_LENGTH - 1] = 0;
+
+    // inotify only reports renames on the directory, so watch that and filter by name
+    char dirPath[MAX_CONFIG_PATH_LENGTH];
+    strcpy(dirPath, gConfigWatch.filePath);
+    char* slash = strrchr(dirPath, '/');
+    if (slash != NULL)
+    {
+        strcpy(gConfigWatch.fileName, slash + 1);
+        *slash = 0;
+    }
+    else
+    {
+        strcpy(gConfigWatch.fileName, dirPath);
+        strcpy(dirPath, ".");
+    }
+
+    if (pipe2(gConfigWatch.wakePipe, O_CLOEXEC) != 0)
+    {
+        LOGE("svrStartConfigWatch: Failed to create wake pipe: %s", strerror(errno));
+        return false;
+    }
+
+    gConfigWatch.inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (gConfigWatch.inotifyFd >= 0 &&
+        inotify_add_watch(gConfigWatch.inotifyFd, dirPath, IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        LOGE("svrStartConfigWatch: Unable to watch %s: %s", dirPath, strerror(errno));
+        close(gConfigWatch.inotifyFd);
+        gConfigWatch.inotifyFd = -1;
+    }
+
+#ifdef USE_QVR_SERVICE
+    svrCheckServiceConfig();
+#endif // USE_QVR_SERVICE
+
+    int status = pthread_create(&gConfigWatch.thread, NULL, &ConfigWatchThreadMain, NULL);
+    if (status != 0)
+    {
+        LOGE("svrStartConfigWatch: Failed to create config watch thread");
+        svrStopConfigWatch();
+        return false;
+    }
+    pthread_setname_np(gConfigWatch.thread, "svrConfigWatch");
+
+    gConfigWatch.running = true;
+    LOGI("Config reload enabled for %s", gConfigWatch.filePath);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+void svrStopConfigWatch()
+//-----------------------------------------------------------------------------
+{
+    if (gConfigWatch.running)
+    {
+        char c = 0;
+        ssize_t res;
+        do
+        {
+            res = write(gConfigWatch.wakePipe[1], &c, 1);
+        } while (res < 0 && errno == EINTR);
+
+        if (res != 1)
+        {
+            // Closing the write end hangs up the pipe, which wakes the thread just as well
+            LOGE("svrStopConfigWatch: Failed to write wake pipe: %s", strerror(errno));
+            close(gConfigWatch.wakePipe[1]);
+            gConfigWatch.wakePipe[1] = -1;
+        }
+        pthread_join(gConfigWatch.thread, NULL);
+        gConfigWatch.running = false;
+    }
+
+    if (gConfigWatch.inotifyFd >= 0)
+    {
+        close(gConfigWatch.inotifyFd);
+    }
+
+    if (gConfigWatch.wakePipe[0] >= 0)
+    {
+        close(gConfigWatch.wakePipe[0]);
+    }
+
+    if (gConfigWatch.wakePipe[1] >= 0)
+    {
+        close(gConfigWatch.wakePipe[1]);
+    }
+
+    free(gConfigWatch.serviceBuffer);
+    svrQueueConfigBuffer(NULL);
+    memset(&gConfigWatch, 0, sizeof(SvrConfigWatchState));
+    gConfigWatch.inotifyFd = -1;
+    gConfigWatch.wakePipe[0] = -1;
+    gConfigWatch.wakePipe[1] = -1;
+}
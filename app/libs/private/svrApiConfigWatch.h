@@ -0,0 +1,20 @@
+//=============================================================================
+// FILE: svrApiConfigWatch.h
+//                  Copyright (c) 2016 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+//==============================================================================
+#ifndef _SVR_API_CONFIG_WATCH_H_
+#define _SVR_API_CONFIG_WATCH_H_
+
+// Starts a thread that reloads configuration variables whenever the given config
+// file is rewritten (and, when connected to the QVR service, whenever the service
+// config buffer changes).  Does nothing unless gEnableConfigReload is set.
+bool svrStartConfigWatch(const char* configFilePath);
+void svrStopConfigWatch();
+
+// Applies the most recent reload, if any, in one go.  Called from the render thread
+// in svrSubmitFrame so variables only change between frames.
+void svrApplyPendingConfig();
+
+#endif //_SVR_API_CONFIG_WATCH_H_
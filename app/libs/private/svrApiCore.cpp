@@ -28,12 +28,11 @@
 #include "svrConfig.h"
 
 #include "private/svrApiCore.h"
+#include "private/svrApiConfigWatch.h"
 #include "private/svrApiHelper.h"
 #include "private/svrApiPredictiveSensor.h"
 #include "private/svrApiSensor.h"
 
-#define QVRSERVICE_SDK_CONFIG_FILE  "sdk-config-file"
-
 using namespace Svr;
 
 // Surface Properties
@@ -173,6 +172,88 @@ static void svrLinePtrCallback(void *ctx, uint64_t vsync_ts)
     PROFILE_FREE(0, 0);
 }
 
+enum svrConfigChange
+{
+    kConfigChangeAffinity = (1 << 0),
+    kConfigChangeCpuLevel = (1 << 1),
+    kConfigChangeGpuLevel = (1 << 2)
+};
+
+//Set by the config watch thread, consumed by the render thread
+static int gPendingConfigChanges = 0;
+
+//Performance levels last requested by the application, restored when a forced level is cleared
+static svrPerfLevel gAppCpuPerfLevel = kPerfSystem;
+static svrPerfLevel gAppGpuPerfLevel = kPerfSystem;
+
+void svrSetCpuPerfLevel(svrPerfLevel level);
+void svrSetGpuPerfLevel(svrPerfLevel level);
+
+//-----------------------------------------------------------------------------
+static void svrConfigChangedCallback(VariableBase* variable, void* userData)
+//-----------------------------------------------------------------------------
+{
+    LOGI("Config variable %s changed", variable->GetName());
+    __atomic_fetch_or(&gPendingConfigChanges, (int)(intptr_t)userData, __ATOMIC_RELEASE);
+}
+
+//-----------------------------------------------------------------------------
+static void svrRegisterConfigCallbacks()
+//-----------------------------------------------------------------------------
+{
+    static const char* cpuLevelVars[] = { "gForceCpuLevel", "gCpuLvl1Min", "gCpuLvl1Max", "gCpuLvl2Min", "gCpuLvl2Max", "gCpuLvl3Min", "gCpuLvl3Max" };
+    static const char* gpuLevelVars[] = { "gForceGpuLevel", "gGpuLvl1Min", "gGpuLvl1Max", "gGpuLvl2Min", "gGpuLvl2Max", "gGpuLvl3Min", "gGpuLvl3Max" };
+
+    SetVariableCallback("gRenderThreadCore", svrConfigChangedCallback, (void*)kConfigChangeAffinity);
+    for (unsigned int i = 0; i < sizeof(cpuLevelVars) / sizeof(cpuLevelVars[0]); i++)
+    {
+        SetVariableCallback(cpuLevelVars[i], svrConfigChangedCallback, (void*)kConfigChangeCpuLevel);
+    }
+    for (unsigned int i = 0; i < sizeof(gpuLevelVars) / sizeof(gpuLevelVars[0]); i++)
+    {
+        SetVariableCallback(gpuLevelVars[i], svrConfigChangedCallback, (void*)kConfigChangeGpuLevel);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void svrUpdateConfig()
+//-----------------------------------------------------------------------------
+{
+    // Setting the reloaded variables fires the callbacks above on this thread, so
+    // everything a reload changes is picked up by the exchange below
+    svrApplyPendingConfig();
+
+    int changes = __atomic_exchange_n(&gPendingConfigChanges, 0, __ATOMIC_ACQUIRE);
+    if (changes == 0)
+    {
+        return;
+    }
+
+    if (changes & kConfigChangeAffinity)
+    {
+        if (gRenderThreadCore >= 0)
+        {
+            LOGI("Setting Eye Render Affinity to %d", gRenderThreadCore);
+            svrSetThreadAffinity(gRenderThreadCore);
+        }
+        else
+        {
+            LOGI("Clearing Eye Render Affinity");
+            svrClearThreadAffinity();
+        }
+    }
+
+    if (changes & kConfigChangeCpuLevel)
+    {
+        svrSetCpuPerfLevel((gForceCpuLevel < 0) ? gAppCpuPerfLevel : (svrPerfLevel)gForceCpuLevel);
+    }
+
+    if (changes & kConfigChangeGpuLevel)
+    {
+        svrSetGpuPerfLevel((gForceGpuLevel < 0) ? gAppGpuPerfLevel : (svrPerfLevel)gForceGpuLevel);
+    }
+}
+
 #ifdef USE_QVR_SERVICE
 //-----------------------------------------------------------------------------
 void svrNotifyFailedQvrService()
@@ -505,6 +586,9 @@ bool svrInitialize(const svrInitParams* pInitParams)
 
     gAppContext->currentTrackingMode = 0;
 
+    //All variables have registered by now, lock in the lookup index before loading values
+    FinalizeVariables();
+
 #ifdef USE_QVR_SERVICE
     //Connect to the QVR Service
     LOGI("Connecting to QVR Service...");
@@ -600,7 +684,10 @@ bool svrInitialize(const svrInitParams* pInitParams)
         LOGI("Forcing minVsync = %d", gForceMinVsync);
     }*/
 
-
+    //Pick up config changes while running, changes that must happen on the render thread
+    //are deferred to svrUpdateConfig
+    svrRegisterConfigCallbacks();
+    svrStartConfigWatch(gSvrConfigFilePath);
 
     return true;
 }
@@ -609,6 +696,8 @@ bool svrInitialize(const svrInitParams* pInitParams)
 void svrShutdown()
 //-----------------------------------------------------------------------------
 {
+    svrStopConfigWatch();
+
     if (gAppContext != NULL)
     {
 #ifdef USE_QVR_SERVICE
@@ -756,6 +845,9 @@ void svrBeginVr(const svrBeginParams* pBeginParams)
     LOGI("Set tracking mode context...");
     svrSetTrackingMode(gAppContext->currentTrackingMode);
 
+    gAppCpuPerfLevel = pBeginParams->cpuPerfLevel;
+    gAppGpuPerfLevel = pBeginParams->gpuPerfLevel;
+
     LOGI("Creating mode context...");
     gAppContext->modeContext = new SvrModeContext();
     
@@ -1136,6 +1228,9 @@ bool svrIsVRModeStopped()
 void svrSetPerformanceLevels(svrPerfLevel cpuPerfLevel, svrPerfLevel gpuPerfLevel)
 //-----------------------------------------------------------------------------
 {
+    gAppCpuPerfLevel = cpuPerfLevel;
+    gAppGpuPerfLevel = gpuPerfLevel;
+
     // If the config flag is set to override the performance levels allow this.
     // Otherwise do nothing here
     if (gForceCpuLevel < 0)
@@ -32,6 +32,8 @@
 
 #ifdef USE_QVR_SERVICE
 #include "QVRServiceClient.hpp"
+
+#define QVRSERVICE_SDK_CONFIG_FILE  "sdk-config-file"
 #endif // USE_QVR_SERVICE
 
 #define NUM_SWAP_FRAMES 5
@@ -8,8 +8,11 @@
 
 #include <unistd.h>
 
+#include <algorithm>
+
 #include "svrApi.h"
 
+#include "svrArchive.h"
 #include "svrProfile.h"
 #include "svrUtil.h"
 #include "LocalApp.h"
@@ -20,6 +23,21 @@
 
 #define NUM_MULTIVIEW_SLICES    2
 
+// Eye buffers are resolved on tile, only the single sampled result is in memory.
+// Drivers without the multisampled framebuffer entry points resolve with a blit.
+#define EYE_BUFFER_SAMPLES      2
+
+// Packed assets (built with tools/svrpack) are looked up before loose files
+#define ASSET_ARCHIVE_NAME      "assets.svra"
+
+// Render thread time given to texture uploads each frame
+#define TEXTURE_UPLOAD_BUDGET_MS    2.0f
+
+// The scene objects sit in a ring around the viewer
+#define NUM_SCENE_OBJECTS       6
+#define SCENE_RING_RADIUS       3.0f
+#define SCENE_OBJECT_SCALE      0.5f
+
 
 using namespace Svr;
 
@@ -42,6 +60,13 @@ PFNGLFRAMEBUFFERTEXTUREMULTISAMPLEMULTIVIEWOVR glFramebufferTextureMultisampleMu
 typedef void(*PFNGLTEXSTORAGE3DMULTISAMPLEOES)(GLenum, GLsizei, GLenum, GLsizei, GLsizei, GLsizei, GLboolean);
 PFNGLTEXSTORAGE3DMULTISAMPLEOES glTexStorage3DMultisampleOES = NULL;
 
+typedef void(*PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXT)(GLenum, GLenum, GLenum, GLuint, GLint, GLsizei);
+PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXT glFramebufferTexture2DMultisampleEXTProc = NULL;
+
+#ifndef GL_CLIP_DISTANCE0_EXT
+#define GL_CLIP_DISTANCE0_EXT                   0x3000
+#endif // GL_CLIP_DISTANCE0_EXT
+
 // These are from eglextQCOM.h
 #ifndef EGL_NEW_IMAGE_QCOM
 #define EGL_NEW_IMAGE_QCOM              0x3120
@@ -55,19 +80,23 @@ PFNGLTEXSTORAGE3DMULTISAMPLEOES glTexStorage3DMultisampleOES = NULL;
 #define EGL_FORMAT_RGBA_8888_QCOM       0x3122
 #endif // EGL_FORMAT_RGBA_8888_QCOM
 
+// How both eyes are drawn.  Initialize falls back from multiview to instanced to
+// double pass as the device lacks what each needs.
 enum eRenderMode
 {
-    kRenderModeSingle = 0,
-    kRenderModeDouble,
-    kRenderModeMultiview
+    kRenderModeDouble = 0,      // Every draw once per eye, into one slice of the eye buffer array
+    kRenderModeMultiview,       // OVR_multiview2, both slices in one draw
+    kRenderModeInstanced        // Twice the instances, into a double wide eye buffer
 };
-eRenderMode gRenderMode = kRenderModeSingle;
+eRenderMode gRenderMode = kRenderModeMultiview;
 
 // Configuration Variables
 
 
 // For testing warping we need to sometimes turn off frame submit. These work with gTouchTogglesSubmitFrame
-bool gSubmitFrame = true;
+// Off while svrBeginVr leaves svrBeginTimeWarp commented out: with no warp thread to
+// consume the eye buffers svrSubmitFrame waits on warpBufferConsumedCv forever.
+bool gSubmitFrame = false;
 unsigned int gLastToggleTime = 0;
 
 // Sometimes we need to test application running slower than TimeWarp.
@@ -77,6 +106,35 @@ unsigned int gLastRenderTime = 0;
 //TODO: Add this to config file and check in the arrow object
 bool gUseArrows = false;
 
+// Scene vertex shader, after "#version 300 es" and the SVR_STEREO_*_GLSL of gRenderMode
+static const char* gSceneVertexBody =
+    SVR_INSTANCE_GLSL
+    "uniform mat4 uViewMatrix[2];\n"
+    "uniform mat4 uProjMatrix;\n"
+    "in vec3 position;\n"
+    "in vec3 normal;\n"
+    "out vec3 vNormal;\n"
+    "out vec4 vColor;\n"
+    "void main()\n"
+    "{\n"
+    "    vec4 worldPos = aInstanceModel * vec4(position, 1.0);\n"
+    "    vNormal = mat3(aInstanceModel) * normal;\n"
+    "    vColor = aInstanceColor;\n"
+    "    gl_Position = SvrStereoPosition(uProjMatrix * uViewMatrix[SVR_VIEW_ID] * worldPos);\n"
+    "}\n";
+
+static const char* gSceneFragment =
+    "#version 300 es\n"
+    "precision mediump float;\n"
+    "in vec3 vNormal;\n"
+    "in vec4 vColor;\n"
+    "out vec4 outColor;\n"
+    "void main()\n"
+    "{\n"
+    "    float light = 0.3 + 0.7 * max(dot(normalize(vNormal), vec3(0.27, 0.89, 0.36)), 0.0);\n"
+    "    outColor = vec4(vColor.rgb * light, vColor.a);\n"
+    "}\n";
+
 //-----------------------------------------------------------------------------
 unsigned int GetTimeMS()
 //-----------------------------------------------------------------------------
@@ -93,40 +151,39 @@ unsigned int GetTimeMS()
 }
 
 LocalApp::LocalApp()
-        : mMdlRotation(0.0f)
+        : mLastFPSTime(0)
+        , mMdlRotation(0.0f)
+        , mSceneReady(false)
         , mFrameTimer(64)
+        , mSubmitTimer(64)
+        , mEyeWidth(0)
+        , mEyeHeight(0)
+        , mEyeDraws(0)
+        , mImageFrameBuffer(0)
+        , mImageTexture(0)
 {
+    memset(mEyeBuffers, 0, sizeof(mEyeBuffers));
 }
 
-//-----------------------------------------------------------------------------
-void * LocalApp::GetFileBuffer(const char *pFileName, int *pBufferSize)
-//-----------------------------------------------------------------------------
+bool LocalApp::LoadTextures()
 {
-    char filePath[512];
-
-    sprintf(filePath, "%s/%s", mAppContext.externalPath, pFileName);
-
-    LOGI("Opening File: %s", filePath);
-    FILE* fp = fopen(filePath, "rb");
-    if (!fp)
+    static const char* overlayFiles[kNumOverlayImages] =
     {
-        LOGE("Unable to open file: %s", filePath);
-        return NULL;
+        "overlay_mono.ktx",
+        "overlay_left.ktx",
+        "overlay_right.ktx",
+        "overlay_quad.ktx",
+    };
+
+    bool allQueued = true;
+    for (int whichImage = 0; whichImage < kNumOverlayImages; whichImage++)
+    {
+        mOverlayHandles[whichImage] = mTextureStreamer.Request(overlayFiles[whichImage]);
+        mOverlayTextures[whichImage] = mTextureStreamer.GetTexture(mOverlayHandles[whichImage]);
+        allQueued &= (mOverlayHandles[whichImage] != 0);
     }
 
-    // Need the file size
-    fseek(fp, 0, SEEK_END);
-    *pBufferSize = ftell(fp);
-    fseek(fp, 0, SEEK_SET);
-
-    // Now read the file into the new buffer
-    char* pRetBuff = new char[*pBufferSize + 1];
-    fread(pRetBuff, 1, *pBufferSize, fp);
-    pRetBuff[*pBufferSize] = 0;
-
-    fclose(fp);
-
-    return pRetBuff;
+    return allQueued;
 }
 
 bool LocalApp::LoadTextureCommon(GLuint *pTexture, const char *pFileName)
@@ -230,22 +287,83 @@ bool LocalApp::CreateEglImage()
     return true;
 }
 
+// Runs as a pass of the render graph, which has bound and cleared the image framebuffer
 void LocalApp::UpdateEglImage()
 {
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mImageFrameBuffer);
     GLenum nDrawBuffer[] = { GL_COLOR_ATTACHMENT0 };
-    glViewport(0, 0, mImageWidth, mImageHeight);
-    glScissor(0, 0, mImageWidth, mImageHeight);
     glDrawBuffers(1, nDrawBuffer);
 
-    glClearColor(0.45f, 0.2f, 0.45f, 0.5f);
-    glClear(GL_COLOR_BUFFER_BIT);
-
     // Bind the blit shader...
 
+}
+
+void LocalApp::UpdateEglImagePass(Svr::SvrRenderGraph& graph, void* pUser)
+{
+    ((LocalApp*)pUser)->UpdateEglImage();
+}
 
-    // Unbind the frame buffer
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+// Blits resolves [first, first + count) into the single sampled eye buffer, then
+// binds the framebuffer the pass drew into again for the graph to end the pass on
+static void L_ResolveEyeBuffer(const MultiViewBuffer& buffer, int first, int count, int width, int height, GLuint drawnFboId)
+{
+    static const GLenum colorAttachment = GL_COLOR_ATTACHMENT0;
+    for (int whichResolve = first; whichResolve < first + count; whichResolve++)
+    {
+        GL(glBindFramebuffer(GL_READ_FRAMEBUFFER, buffer.mResolveReadFboId[whichResolve]));
+        GL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, buffer.mResolveDrawFboId[whichResolve]));
+        GL(glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST));
+        GL(glInvalidateFramebuffer(GL_READ_FRAMEBUFFER, 1, &colorAttachment));
+    }
+    GL(glBindFramebuffer(GL_FRAMEBUFFER, drawnFboId));
+}
+
+void LocalApp::RenderEyePass(Svr::SvrRenderGraph& graph, void* pUser)
+{
+    EyePass* pEyePass = (EyePass*)pUser;
+    LocalApp* pApp = pEyePass->pApp;
+
+    if (gRenderMode == kRenderModeInstanced)
+    {
+        GL(glEnable(GL_CLIP_DISTANCE0_EXT));
+        pApp->mRenderQueue.Flush(BindEyeState, pEyePass, SVR_NUM_EYES);
+        GL(glDisable(GL_CLIP_DISTANCE0_EXT));
+    }
+    else
+    {
+        pApp->mRenderQueue.Flush(BindEyeState, pEyePass);
+    }
+    pApp->mEyeDraws += pApp->mRenderQueue.GetStats().numDraws;
+
+    const MultiViewBuffer& buffer = pApp->mEyeBuffers[pApp->mAppContext.eyeBufferIndex];
+    if (buffer.mNumResolves == 0)
+    {
+        return;
+    }
+
+    if (gRenderMode == kRenderModeDouble)
+    {
+        L_ResolveEyeBuffer(buffer, pEyePass->eye, 1, pApp->mEyeWidth, pApp->mEyeHeight,
+                           buffer.mEyeFboId[pEyePass->eye]);
+    }
+    else
+    {
+        int eyesWidth = (gRenderMode == kRenderModeInstanced) ? pApp->mEyeWidth * 2 : pApp->mEyeWidth;
+        L_ResolveEyeBuffer(buffer, 0, buffer.mNumResolves, eyesWidth, pApp->mEyeHeight, buffer.mFboId);
+    }
+}
+
+// View uniforms of the SVR_STEREO_*_GLSL shaders
+void LocalApp::BindEyeState(Svr::SvrShader* pShader, unsigned int materialId, void* pUser)
+{
+    EyePass* pEyePass = (EyePass*)pUser;
+    LocalApp* pApp = pEyePass->pApp;
+
+    pShader->SetUniformMat4fv("uViewMatrix", SVR_NUM_EYES, glm::value_ptr(pApp->mViewMtx[0]));
+    pShader->SetUniformMat4("uProjMatrix", pApp->mProjMtx);
+    if (gRenderMode == kRenderModeDouble)
+    {
+        pShader->SetUniform1ui("uViewId", pEyePass->eye);
+    }
 }
 
 void LocalApp::CreateBlitAssets()
@@ -260,7 +378,92 @@ void LocalApp::InitializeModel(const char* path)
 
 
 
-void LocalApp::InitializeFunctions()
+static bool L_HasGlExtension(const char* pName)
+{
+    GLint numExtensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+    for (GLint whichExtension = 0; whichExtension < numExtensions; whichExtension++)
+    {
+        const char* pExtension = (const char*)glGetStringi(GL_EXTENSIONS, whichExtension);
+        if (pExtension != NULL && strcmp(pExtension, pName) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static const char* L_RenderModeName(eRenderMode mode)
+{
+    switch (mode)
+    {
+    case kRenderModeDouble:     return "Double pass";
+    case kRenderModeMultiview:  return "Multiview";
+    case kRenderModeInstanced:  return "Instanced stereo";
+    }
+    return "Unknown";
+}
+
+// Attaches numSlices slices of an array texture to the bound draw framebuffer,
+// rendered multisampled and resolved on tile when samples > 1.  Only asked for
+// samples > 1 when glFramebufferTextureMultisampleMultiviewOVR exists.
+static void L_AttachSlices(GLenum attachment, GLuint textureId, int firstSlice, int numSlices, int samples)
+{
+    if (samples > 1)
+    {
+        GL(glFramebufferTextureMultisampleMultiviewOVR(GL_DRAW_FRAMEBUFFER, attachment, textureId, 0, samples, firstSlice, numSlices));
+    }
+    else if (numSlices > 1)
+    {
+        GL(glFramebufferTextureMultiviewOVR(GL_DRAW_FRAMEBUFFER, attachment, textureId, 0, firstSlice, numSlices));
+    }
+    else
+    {
+        GL(glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, attachment, textureId, 0, firstSlice));
+    }
+}
+
+static GLuint L_CreateMsaaRenderbuffer(GLenum format, int width, int height, int samples)
+{
+    GLuint renderbufferId = 0;
+    GL(glGenRenderbuffers(1, &renderbufferId));
+    GL(glBindRenderbuffer(GL_RENDERBUFFER, renderbufferId));
+    GL(glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, format, width, height));
+    GL(glBindRenderbuffer(GL_RENDERBUFFER, 0));
+    return renderbufferId;
+}
+
+static bool L_CheckFramebuffer(const char* pName)
+{
+    GLenum status = glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER);
+    if (status == GL_FRAMEBUFFER_COMPLETE)
+    {
+        return true;
+    }
+
+    switch (status)
+    {
+    case GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT:
+        LOGE("%s framebuffer incomplete: GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT", pName);
+        break;
+    case GL_FRAMEBUFFER_INCOMPLETE_MISSING_ATTACHMENT:
+        LOGE("%s framebuffer incomplete: GL_FRAMEBUFFER_INCOMPLETE_MISSING_ATTACHMENT", pName);
+        break;
+    case GL_FRAMEBUFFER_INCOMPLETE_MULTISAMPLE:
+        LOGE("%s framebuffer incomplete: GL_FRAMEBUFFER_INCOMPLETE_MULTISAMPLE", pName);
+        break;
+    case GL_FRAMEBUFFER_UNSUPPORTED:
+        LOGE("%s framebuffer incomplete: GL_FRAMEBUFFER_UNSUPPORTED", pName);
+        break;
+    default:
+        LOGE("%s framebuffer incomplete: 0x%x", pName, status);
+        break;
+    }
+    return false;
+}
+
+// Returns false without the multiview functions, the multisampled ones are optional
+bool LocalApp::InitializeFunctions()
 {
     LOGI("**************************************************");
     LOGI("Initializing Function: glFramebufferTextureMultiviewOVR");
@@ -269,7 +472,6 @@ void LocalApp::InitializeFunctions()
     if (!glFramebufferTextureMultiviewOVR)
     {
         LOGE("Failed to  get proc address for glFramebufferTextureMultiviewOVR!!");
-        exit(EXIT_FAILURE);
     }
 
     LOGI("**************************************************");
@@ -279,7 +481,6 @@ void LocalApp::InitializeFunctions()
     if (!glFramebufferTextureMultisampleMultiviewOVR)
     {
         LOGE("Failed to  get proc address for glFramebufferTextureMultisampleMultiviewOVR!!");
-        exit(EXIT_FAILURE);
     }
 
     LOGI("**************************************************");
@@ -289,19 +490,384 @@ void LocalApp::InitializeFunctions()
     if (!glTexStorage3DMultisampleOES)
     {
         LOGE("Failed to  get proc address for glTexStorage3DMultisampleOES!!");
-        exit(EXIT_FAILURE);
     }
+
+    LOGI("**************************************************");
+    LOGI("Initializing Function: glFramebufferTexture2DMultisampleEXT");
+    LOGI("**************************************************");
+    glFramebufferTexture2DMultisampleEXTProc = (PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXT)eglGetProcAddress("glFramebufferTexture2DMultisampleEXT");
+    if (!glFramebufferTexture2DMultisampleEXTProc)
+    {
+        LOGE("Failed to  get proc address for glFramebufferTexture2DMultisampleEXT!!");
+    }
+
+    return glFramebufferTextureMultiviewOVR != NULL && L_HasGlExtension("GL_OVR_multiview2");
 }
 
+// Eye buffer for the kEyeBufferArray layout, both eyes in one framebuffer for
+// multiview, otherwise one per slice
 void LocalApp::InitializeMultiView(int whichBuffer, int width, int height, int samples)
 {
+    MultiViewBuffer& buffer = mEyeBuffers[whichBuffer];
+
+    // Without on tile resolve draw into multisampled storage and blit each slice out
+    bool resolveOnTile = (samples > 1 && glFramebufferTextureMultisampleMultiviewOVR != NULL);
+    bool resolveBlit = (samples > 1 && !resolveOnTile);
+    if (resolveBlit && gRenderMode == kRenderModeMultiview &&
+        (glTexStorage3DMultisampleOES == NULL || !L_HasGlExtension("GL_OES_texture_storage_multisample_2d_array")))
+    {
+        LOGW("No multisampled array textures for multiview, eye buffers are single sampled");
+        resolveBlit = false;
+    }
+
+    GL(glGenTextures(1, &buffer.mColorId));
+    GL(glBindTexture(GL_TEXTURE_2D_ARRAY, buffer.mColorId));
+    GL(glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8, width, height, NUM_MULTIVIEW_SLICES));
+    GL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    GL(glBindTexture(GL_TEXTURE_2D_ARRAY, 0));
+
+    if (!resolveBlit)
+    {
+        // Never stored, with samples > 1 it only ever exists on tile
+        GL(glGenTextures(1, &buffer.mDepthId));
+        GL(glBindTexture(GL_TEXTURE_2D_ARRAY, buffer.mDepthId));
+        GL(glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT24, width, height, NUM_MULTIVIEW_SLICES));
+        GL(glBindTexture(GL_TEXTURE_2D_ARRAY, 0));
+    }
+    else if (gRenderMode == kRenderModeMultiview)
+    {
+        // Multiview only attaches array textures, one multisampled slice per eye
+        GL(glGenTextures(1, &buffer.mMsaaColorId));
+        GL(glBindTexture(GL_TEXTURE_2D_MULTISAMPLE_ARRAY, buffer.mMsaaColorId));
+        GL(glTexStorage3DMultisampleOES(GL_TEXTURE_2D_MULTISAMPLE_ARRAY, samples, GL_RGBA8, width, height, NUM_MULTIVIEW_SLICES, GL_TRUE));
+        GL(glGenTextures(1, &buffer.mMsaaDepthId));
+        GL(glBindTexture(GL_TEXTURE_2D_MULTISAMPLE_ARRAY, buffer.mMsaaDepthId));
+        GL(glTexStorage3DMultisampleOES(GL_TEXTURE_2D_MULTISAMPLE_ARRAY, samples, GL_DEPTH_COMPONENT24, width, height, NUM_MULTIVIEW_SLICES, GL_TRUE));
+        GL(glBindTexture(GL_TEXTURE_2D_MULTISAMPLE_ARRAY, 0));
+    }
+    else
+    {
+        // The eyes are drawn one after the other, so they share one set of samples
+        buffer.mMsaaColorId = L_CreateMsaaRenderbuffer(GL_RGBA8, width, height, samples);
+        buffer.mMsaaDepthId = L_CreateMsaaRenderbuffer(GL_DEPTH_COMPONENT24, width, height, samples);
+    }
+
+    int attachSamples = resolveOnTile ? samples : 1;
+    if (gRenderMode == kRenderModeMultiview)
+    {
+        GL(glGenFramebuffers(1, &buffer.mFboId));
+        GL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, buffer.mFboId));
+        if (resolveBlit)
+        {
+            L_AttachSlices(GL_COLOR_ATTACHMENT0, buffer.mMsaaColorId, 0, NUM_MULTIVIEW_SLICES, 1);
+            L_AttachSlices(GL_DEPTH_ATTACHMENT, buffer.mMsaaDepthId, 0, NUM_MULTIVIEW_SLICES, 1);
+        }
+        else
+        {
+            L_AttachSlices(GL_COLOR_ATTACHMENT0, buffer.mColorId, 0, NUM_MULTIVIEW_SLICES, attachSamples);
+            L_AttachSlices(GL_DEPTH_ATTACHMENT, buffer.mDepthId, 0, NUM_MULTIVIEW_SLICES, attachSamples);
+        }
+        L_CheckFramebuffer("Multiview eye buffer");
+    }
+    else
+    {
+        for (int whichEye = 0; whichEye < SVR_NUM_EYES; whichEye++)
+        {
+            GL(glGenFramebuffers(1, &buffer.mEyeFboId[whichEye]));
+            GL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, buffer.mEyeFboId[whichEye]));
+            if (resolveBlit)
+            {
+                GL(glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, buffer.mMsaaColorId));
+                GL(glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, buffer.mMsaaDepthId));
+            }
+            else
+            {
+                L_AttachSlices(GL_COLOR_ATTACHMENT0, buffer.mColorId, whichEye, 1, attachSamples);
+                L_AttachSlices(GL_DEPTH_ATTACHMENT, buffer.mDepthId, whichEye, 1, attachSamples);
+            }
+            L_CheckFramebuffer("Eye buffer slice");
+        }
+    }
 
+    if (resolveBlit)
+    {
+        for (int whichEye = 0; whichEye < SVR_NUM_EYES; whichEye++)
+        {
+            GL(glGenFramebuffers(1, &buffer.mResolveReadFboId[whichEye]));
+            GL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, buffer.mResolveReadFboId[whichEye]));
+            if (gRenderMode == kRenderModeMultiview)
+            {
+                GL(glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, buffer.mMsaaColorId, 0, whichEye));
+            }
+            else
+            {
+                GL(glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, buffer.mMsaaColorId));
+            }
+            L_CheckFramebuffer("Eye buffer resolve source");
+
+            GL(glGenFramebuffers(1, &buffer.mResolveDrawFboId[whichEye]));
+            GL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, buffer.mResolveDrawFboId[whichEye]));
+            GL(glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, buffer.mColorId, 0, whichEye));
+            L_CheckFramebuffer("Eye buffer resolve");
+        }
+        buffer.mNumResolves = SVR_NUM_EYES;
+    }
+    GL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0));
+}
+
+// Eye buffer for the kEyeBufferStereoSingle layout, left eye on the left half
+void LocalApp::InitializeDoubleWide(int whichBuffer, int width, int height, int samples)
+{
+    MultiViewBuffer& buffer = mEyeBuffers[whichBuffer];
+    bool resolveOnTile = (samples > 1 && glFramebufferTexture2DMultisampleEXTProc != NULL);
+    bool resolveBlit = (samples > 1 && !resolveOnTile);
+
+    GL(glGenTextures(1, &buffer.mColorId));
+    GL(glBindTexture(GL_TEXTURE_2D, buffer.mColorId));
+    GL(glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width * 2, height));
+    GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    GL(glBindTexture(GL_TEXTURE_2D, 0));
+
+    if (resolveBlit)
+    {
+        buffer.mMsaaColorId = L_CreateMsaaRenderbuffer(GL_RGBA8, width * 2, height, samples);
+        buffer.mMsaaDepthId = L_CreateMsaaRenderbuffer(GL_DEPTH_COMPONENT24, width * 2, height, samples);
+    }
+    else
+    {
+        GL(glGenTextures(1, &buffer.mDepthId));
+        GL(glBindTexture(GL_TEXTURE_2D, buffer.mDepthId));
+        GL(glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, width * 2, height));
+        GL(glBindTexture(GL_TEXTURE_2D, 0));
+    }
+
+    GL(glGenFramebuffers(1, &buffer.mFboId));
+    GL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, buffer.mFboId));
+    if (resolveOnTile)
+    {
+        GL(glFramebufferTexture2DMultisampleEXTProc(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, buffer.mColorId, 0, samples));
+        GL(glFramebufferTexture2DMultisampleEXTProc(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, buffer.mDepthId, 0, samples));
+    }
+    else if (resolveBlit)
+    {
+        GL(glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, buffer.mMsaaColorId));
+        GL(glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, buffer.mMsaaDepthId));
+    }
+    else
+    {
+        GL(glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, buffer.mColorId, 0));
+        GL(glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, buffer.mDepthId, 0));
+    }
+    L_CheckFramebuffer("Double wide eye buffer");
+
+    if (resolveBlit)
+    {
+        // Both eyes resolve in one blit
+        GL(glGenFramebuffers(1, &buffer.mResolveReadFboId[0]));
+        GL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, buffer.mResolveReadFboId[0]));
+        GL(glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, buffer.mMsaaColorId));
+        L_CheckFramebuffer("Eye buffer resolve source");
+
+        GL(glGenFramebuffers(1, &buffer.mResolveDrawFboId[0]));
+        GL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, buffer.mResolveDrawFboId[0]));
+        GL(glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, buffer.mColorId, 0));
+        L_CheckFramebuffer("Eye buffer resolve");
+        buffer.mNumResolves = 1;
+    }
+    GL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0));
+}
+
+void LocalApp::DestroyEyeBuffers()
+{
+    for (int whichBuffer = 0; whichBuffer < SVR_NUM_EYE_BUFFERS; whichBuffer++)
+    {
+        MultiViewBuffer& buffer = mEyeBuffers[whichBuffer];
+        if (buffer.mFboId != 0)
+        {
+            GL(glDeleteFramebuffers(1, &buffer.mFboId));
+        }
+        for (int whichEye = 0; whichEye < SVR_NUM_EYES; whichEye++)
+        {
+            if (buffer.mEyeFboId[whichEye] != 0)
+            {
+                GL(glDeleteFramebuffers(1, &buffer.mEyeFboId[whichEye]));
+            }
+        }
+        if (buffer.mColorId != 0)
+        {
+            GL(glDeleteTextures(1, &buffer.mColorId));
+        }
+        if (buffer.mDepthId != 0)
+        {
+            GL(glDeleteTextures(1, &buffer.mDepthId));
+        }
+
+        for (int whichResolve = 0; whichResolve < buffer.mNumResolves; whichResolve++)
+        {
+            GL(glDeleteFramebuffers(1, &buffer.mResolveReadFboId[whichResolve]));
+            GL(glDeleteFramebuffers(1, &buffer.mResolveDrawFboId[whichResolve]));
+        }
+        if (buffer.mMsaaColorId != 0)
+        {
+            // The render mode does not change after Initialize, so it still says what these are
+            if (gRenderMode == kRenderModeMultiview)
+            {
+                GL(glDeleteTextures(1, &buffer.mMsaaColorId));
+                GL(glDeleteTextures(1, &buffer.mMsaaDepthId));
+            }
+            else
+            {
+                GL(glDeleteRenderbuffers(1, &buffer.mMsaaColorId));
+                GL(glDeleteRenderbuffers(1, &buffer.mMsaaDepthId));
+            }
+        }
+        memset(&buffer, 0, sizeof(buffer));
+    }
+}
+
+// Unit cube, four vertices of position and normal per face
+static void L_BuildCube(float* pVertices, unsigned int* pIndices)
+{
+    for (int face = 0; face < 6; face++)
+    {
+        int axis = face / 2;
+        float sign = (face & 1) ? -1.0f : 1.0f;
+        glm::vec3 normal(0.0f);
+        normal[axis] = sign;
+        glm::vec3 u(0.0f);
+        u[(axis + 1) % 3] = 0.5f;
+        glm::vec3 v = glm::cross(normal, u);
+
+        static const float corners[4][2] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+        for (int corner = 0; corner < 4; corner++)
+        {
+            glm::vec3 position = normal * 0.5f + u * corners[corner][0] + v * corners[corner][1];
+            float* pVertex = &pVertices[(face * 4 + corner) * 6];
+            memcpy(&pVertex[0], &position[0], 3 * sizeof(float));
+            memcpy(&pVertex[3], &normal[0], 3 * sizeof(float));
+        }
+
+        static const unsigned int quad[6] = { 0, 1, 2, 0, 2, 3 };
+        for (int i = 0; i < 6; i++)
+        {
+            pIndices[face * 6 + i] = face * 4 + quad[i];
+        }
+    }
+}
+
+bool LocalApp::CreateSceneAssets()
+{
+    L_BuildCube(mCubeVertices, mCubeIndices);
+
+    SvrProgramAttribute attribs[2] =
+    {
+        { kPosition, 3, GL_FLOAT, false, 6 * sizeof(float), 0 },
+        { kNormal, 3, GL_FLOAT, false, 6 * sizeof(float), 3 * sizeof(float) },
+    };
+    mCubeGeometry.Initialize(attribs, 2, mCubeIndices, 36, mCubeVertices, sizeof(mCubeVertices), 24);
+    mCubeGeometry.SetBounds(glm::vec3(-0.5f), glm::vec3(0.5f));
+
+    const char* pStereo = SVR_STEREO_DOUBLE_PASS_GLSL;
+    if (gRenderMode == kRenderModeMultiview)
+    {
+        pStereo = SVR_STEREO_MULTIVIEW_GLSL;
+    }
+    else if (gRenderMode == kRenderModeInstanced)
+    {
+        pStereo = SVR_STEREO_INSTANCED_GLSL;
+    }
+
+    char vertexSource[4096];
+    snprintf(vertexSource, sizeof(vertexSource), "#version 300 es\n%s%s", pStereo, gSceneVertexBody);
+    if (!mSceneShader.Initialize(vertexSource, gSceneFragment, "SceneVertex", "SceneFragment"))
+    {
+        LOGE("Unable to build the %s scene shader, nothing will be drawn", L_RenderModeName(gRenderMode));
+        return false;
+    }
+
+    static const glm::vec3 colors[NUM_SCENE_OBJECTS] =
+    {
+        glm::vec3(0.9f, 0.2f, 0.2f), glm::vec3(0.9f, 0.6f, 0.1f), glm::vec3(0.9f, 0.9f, 0.2f),
+        glm::vec3(0.2f, 0.8f, 0.3f), glm::vec3(0.2f, 0.5f, 0.9f), glm::vec3(0.7f, 0.3f, 0.9f),
+    };
+    mCullScene.Clear();
+    for (int whichObject = 0; whichObject < NUM_SCENE_OBJECTS; whichObject++)
+    {
+        mMdlColor[whichObject] = colors[whichObject];
+        mCullScene.AddObject(mMdlMtx[whichObject], mCubeGeometry.GetBoundsMin(), mCubeGeometry.GetBoundsMax());
+    }
+    return true;
+}
+
+void LocalApp::DestroySceneAssets()
+{
+    mSceneShader.Destroy();
+    mCubeGeometry.Destroy();
+    mCullScene.Clear();
+    mSceneReady = false;
 }
 
 void LocalApp::Initialize()
 {
+    char archivePath[512];
+    sprintf(archivePath, "%s/%s", mAppContext.externalPath, ASSET_ARCHIVE_NAME);
+    if (access(archivePath, R_OK) == 0)
+    {
+        SvrMountArchive(archivePath);
+    }
+
+    mTextureStreamer.Initialize(mAppContext.externalPath);
+    LoadTextures();
+
+    mTargetPool.Initialize();
+    mRenderGraph.Initialize(&mTargetPool);
+
+    // Best stereo the device has
+    if (gRenderMode == kRenderModeMultiview && !InitializeFunctions())
+    {
+        gRenderMode = kRenderModeInstanced;
+    }
+    if (gRenderMode == kRenderModeInstanced && !L_HasGlExtension("GL_EXT_clip_cull_distance"))
+    {
+        gRenderMode = kRenderModeDouble;
+    }
+    LOGI("Stereo rendering: %s", L_RenderModeName(gRenderMode));
+
+    mEyeWidth = mAppContext.targetEyeWidth;
+    mEyeHeight = mAppContext.targetEyeHeight;
+    for (int whichBuffer = 0; whichBuffer < SVR_NUM_EYE_BUFFERS; whichBuffer++)
+    {
+        if (gRenderMode == kRenderModeInstanced)
+        {
+            InitializeDoubleWide(whichBuffer, mEyeWidth, mEyeHeight, EYE_BUFFER_SAMPLES);
+        }
+        else
+        {
+            InitializeMultiView(whichBuffer, mEyeWidth, mEyeHeight, EYE_BUFFER_SAMPLES);
+        }
+    }
+    mAppContext.eyeBufferIndex = 0;
 
+    for (int whichEye = 0; whichEye < SVR_NUM_EYES; whichEye++)
+    {
+        mEyePasses[whichEye].pApp = this;
+        mEyePasses[whichEye].eye = whichEye;
+    }
 
+    mProjMtx = glm::perspective(mAppContext.targetEyeFovYDeg * DEG_TO_RAD,
+                                (float)mEyeWidth / (float)mEyeHeight, 0.1f, 100.0f);
+    mRenderQueue.Initialize();
+    for (int whichEye = 0; whichEye < SVR_NUM_EYES; whichEye++)
+    {
+        mOcclusion[whichEye].Initialize();
+    }
+    mSceneReady = CreateSceneAssets();
 }
 
 void LocalApp::DestroyBlitAssets()
@@ -330,12 +896,54 @@ void LocalApp::Update()
 
     mFrameCount++;
 
+    // Each object spins in place, half a turn every six seconds
+    mMdlRotation = fmodf(TimeNow * 0.0005f, 2.0f * (float)M_PI);
+    for (int whichObject = 0; whichObject < NUM_SCENE_OBJECTS; whichObject++)
+    {
+        float angle = whichObject * 2.0f * (float)M_PI / NUM_SCENE_OBJECTS;
+        mMdlMtx[whichObject] = glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 1.0f, 0.0f)) *
+                               glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -SCENE_RING_RADIUS)) *
+                               glm::rotate(glm::mat4(1.0f), mMdlRotation, glm::normalize(glm::vec3(1.0f, 1.0f, 0.0f))) *
+                               glm::scale(glm::mat4(1.0f), glm::vec3(SCENE_OBJECT_SCALE));
+        if (mSceneReady)
+        {
+            mCullScene.SetBounds(whichObject, mMdlMtx[whichObject], mCubeGeometry.GetBoundsMin(), mCubeGeometry.GetBoundsMax());
+        }
+    }
+
+    // Overlay handles switch over to the real textures as their levels arrive
+    mTextureStreamer.Update(TEXTURE_UPLOAD_BUDGET_MS);
+    for (int whichImage = 0; whichImage < kNumOverlayImages; whichImage++)
+    {
+        mOverlayTextures[whichImage] = mTextureStreamer.GetTexture(mOverlayHandles[whichImage]);
+    }
 
 
 
     PROFILE_EXIT(GROUP_WORLDRENDER);
 }
-void LocalApp::Shutdown() {}
+void LocalApp::OnLowMemory()
+{
+    // Overlays drop their top levels or are evicted, and come back once the pressure is over
+    mTextureStreamer.OnLowMemory();
+}
+
+void LocalApp::Shutdown()
+{
+    DestroySceneAssets();
+    mRenderQueue.Destroy();
+    for (int whichEye = 0; whichEye < SVR_NUM_EYES; whichEye++)
+    {
+        mOcclusion[whichEye].Destroy();
+    }
+    DestroyEyeBuffers();
+    mRenderGraph.Destroy();
+    mTargetPool.Destroy();
+
+    // Workers may still be reading from the archives
+    mTextureStreamer.Shutdown();
+    SvrUnmountArchives();
+}
 
 void LocalApp::Render()
 {
@@ -375,8 +983,116 @@ void LocalApp::Render()
                           currentIpd, headHeight, headDepth,
                           mViewMtx[kLeft], mViewMtx[kRight]);
 
+    // Culled once against both eyes, then by occlusion per eye, then sorted front to
+    // back, and levels of detail picked, from between the eyes
+    if (mSceneReady)
+    {
+        SvrFrustum frustum;
+        SvrGetStereoCullFrustum(mViewMtx[kLeft], mViewMtx[kRight], mProjMtx, frustum);
+        int numVisible = mCullScene.Cull(frustum, mVisibleObjects);
+
+        // An object is only dropped when both eyes have it hidden
+        uint32_t eyeVisible[SVR_NUM_EYES][NUM_SCENE_OBJECTS];
+        int numEyeVisible[SVR_NUM_EYES];
+        for (int whichEye = 0; whichEye < SVR_NUM_EYES; whichEye++)
+        {
+            SvrOcclusionBuffer& occlusion = mOcclusion[whichEye];
+            occlusion.Begin(mProjMtx * mViewMtx[whichEye]);
+            for (int whichVisible = 0; whichVisible < numVisible; whichVisible++)
+            {
+                occlusion.AddOccluder(mCubeVertices, 6 * sizeof(float), 24, mCubeIndices, 36,
+                                      mMdlMtx[mVisibleObjects[whichVisible]]);
+            }
+            occlusion.Rasterize(false);
+
+            memcpy(eyeVisible[whichEye], mVisibleObjects, numVisible * sizeof(uint32_t));
+            numEyeVisible[whichEye] = occlusion.FilterVisible(mCullScene, eyeVisible[whichEye], numVisible);
+        }
+        numVisible = std::set_union(eyeVisible[kLeft], eyeVisible[kLeft] + numEyeVisible[kLeft],
+                                    eyeVisible[kRight], eyeVisible[kRight] + numEyeVisible[kRight],
+                                    mVisibleObjects) - mVisibleObjects;
+
+        glm::mat4 centerView = glm::translate(mViewMtx[kLeft], glm::vec3(0.5f * currentIpd, 0.0f, 0.0f));
+        glm::vec3 centerEye = glm::vec3(glm::inverse(centerView)[3]);
+        float lodScale = SvrGeometry::GetLodProjectionScale(mEyeHeight, mAppContext.targetEyeFovYDeg);
+        for (int whichVisible = 0; whichVisible < numVisible; whichVisible++)
+        {
+            int whichObject = mVisibleObjects[whichVisible];
+            // Every object shares the geometry, Add takes the level UpdateLod just set
+            int lod = mCubeGeometry.UpdateLod(mMdlMtx[whichObject], centerEye, lodScale);
+            float viewDepth = -(centerView * mMdlMtx[whichObject][3]).z;
+            mRenderQueue.Add(SvrMakeSortKey(kPassOpaque, &mSceneShader, 0, &mCubeGeometry, lod, viewDepth),
+                             &mSceneShader, 0, &mCubeGeometry, mMdlMtx[whichObject], glm::vec4(mMdlColor[whichObject], 1.0f));
+        }
+    }
+
+    mTargetPool.BeginFrame();
+    mRenderGraph.Reset();
+    mRenderQueue.Sort();
+    mEyeDraws = 0;
+
+    // Depth is never stored, the graph invalidates it at the end of each eye
+    static const glm::vec4 eyeClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    const MultiViewBuffer& eyeBuffer = mEyeBuffers[mAppContext.eyeBufferIndex];
+    if (gRenderMode == kRenderModeDouble)
+    {
+        static const char* eyeNames[SVR_NUM_EYES] = { "Left Eye", "Right Eye" };
+        for (int whichEye = 0; whichEye < SVR_NUM_EYES; whichEye++)
+        {
+            Svr::SvrGraphResource eye = mRenderGraph.ImportTarget(eyeNames[whichEye], eyeBuffer.mEyeFboId[whichEye],
+                                                                  mEyeWidth, mEyeHeight, true);
+            int pass = mRenderGraph.AddPass(eyeNames[whichEye], RenderEyePass, &mEyePasses[whichEye]);
+            mRenderGraph.Write(pass, eye, Svr::kAttachmentAll, Svr::kAttachmentAll);
+            mRenderGraph.SetClearValues(pass, eyeClearColor);
+        }
+    }
+    else
+    {
+        int eyesWidth = (gRenderMode == kRenderModeInstanced) ? mEyeWidth * 2 : mEyeWidth;
+        Svr::SvrGraphResource eyes = mRenderGraph.ImportTarget("Eyes", eyeBuffer.mFboId, eyesWidth, mEyeHeight, true);
+        int pass = mRenderGraph.AddPass("Eyes", RenderEyePass, &mEyePasses[kLeft]);
+        mRenderGraph.Write(pass, eyes, Svr::kAttachmentAll, Svr::kAttachmentAll);
+        mRenderGraph.SetClearValues(pass, eyeClearColor);
+    }
 
+    if (mImageFrameBuffer != 0)
+    {
+        Svr::SvrGraphResource overlay = mRenderGraph.ImportTarget("Overlay", mImageFrameBuffer,
+                                                                  mImageWidth, mImageHeight, false);
+        int pass = mRenderGraph.AddPass("UpdateEglImage", UpdateEglImagePass, this);
+        mRenderGraph.Write(pass, overlay, Svr::kAttachmentColor, Svr::kAttachmentColor);
+        mRenderGraph.SetClearValues(pass, glm::vec4(0.45f, 0.2f, 0.45f, 0.5f));
+    }
 
+    if (mRenderGraph.Compile())
+    {
+        mSubmitTimer.Start();
+        mRenderGraph.Execute();
+        mSubmitTimer.Stop();
+    }
+    mRenderQueue.Clear();
+
+    svrFrameParams frameParams;
+    memset(&frameParams, 0, sizeof(frameParams));
+    frameParams.frameIndex = mAppContext.frameCount;
+    frameParams.minVsyncs = 1;
+    frameParams.eyeBufferType = (gRenderMode == kRenderModeInstanced) ? kEyeBufferStereoSingle : kEyeBufferArray;
+    frameParams.eyeBufferArray[0] = eyeBuffer.mColorId;
+    frameParams.headPoseState = poseState;
+    frameParams.warpType = kSimple;
+    if (gSubmitFrame)
+    {
+        svrSubmitFrame(&frameParams);
+    }
+    mAppContext.eyeBufferIndex = (mAppContext.eyeBufferIndex + 1) % SVR_NUM_EYE_BUFFERS;
+
+    unsigned int timeNow = GetTimeMS();
+    if (timeNow - mLastFPSTime > 1000)
+    {
+        LOGI("%s: %u eye draws, %0.3f ms submitting", L_RenderModeName(gRenderMode), mEyeDraws,
+             mSubmitTimer.GetAverageTime());
+        mLastFPSTime = timeNow;
+    }
 
     mFrameTimer.Stop();
 
@@ -21,11 +21,16 @@
 
 #include "svrApplication.h"
 #include "svrCpuTimer.h"
-//#include "svrGeometry.h"
+#include "svrCulling.h"
+#include "svrRenderGraph.h"
+#include "svrRenderQueue.h"
+#include "svrTextureStreamer.h"
+#include "svrGeometry.h"
+#include "svrOcclusion.h"
 //#include "svrGpuTimer.h"
 //#include "svrKtxLoader.h"
 //#include "svrRenderTarget.h"
-//#include "svrShader.h"
+#include "svrShader.h"
 #include "svrUtil.h"
 
 #include "glm/glm.hpp"
@@ -34,11 +39,21 @@
 #include "glm/gtx/euler_angles.hpp"
 #include "glm/gtx/transform.hpp"
 
+// Both eyes of one eye buffer.  Color and depth are two slice arrays, or double wide
+// for instanced stereo.
 struct MultiViewBuffer
 {
     unsigned int    mColorId;
     unsigned int    mDepthId;
-    unsigned int    mFboId;
+    unsigned int    mFboId;                         // Both slices, multiview
+    unsigned int    mEyeFboId[SVR_NUM_EYES];        // One slice each, double pass
+
+    // Multisampled without on tile resolve: drawn into these, then blitted to mColorId
+    unsigned int    mMsaaColorId;                   // Multisample array for multiview, else a renderbuffer
+    unsigned int    mMsaaDepthId;
+    unsigned int    mResolveReadFboId[SVR_NUM_EYES];
+    unsigned int    mResolveDrawFboId[SVR_NUM_EYES];
+    int             mNumResolves;                   // 0 when resolved on tile or single sampled
 };
 
 enum OverlayImages
@@ -59,22 +74,38 @@ public:
     void Shutdown();
     void Update();
     void Render();
+    void OnLowMemory();
 
 
 private:
-    void *  GetFileBuffer(const char *pFileName, int *bufferSize);
+    // Queues the overlay textures with the streamer, they appear as they finish loading
     bool    LoadTextures();
     bool    LoadTextureCommon(GLuint *pTexture, const char *pFileName);
 
     bool    CreateEglImage();
     void    UpdateEglImage();
+    static void UpdateEglImagePass(Svr::SvrRenderGraph& graph, void* pUser);
 
-    void    InitializeFunctions();
+    bool    InitializeFunctions();
     void    InitializeMultiView(int whichBuffer, int width, int height, int samples);
+    void    InitializeDoubleWide(int whichBuffer, int width, int height, int samples);
+    void    DestroyEyeBuffers();
+
+    struct EyePass
+    {
+        LocalApp*   pApp;
+        int         eye;        // Double pass only, the others draw both
+    };
+    static void RenderEyePass(Svr::SvrRenderGraph& graph, void* pUser);
+    static void BindEyeState(Svr::SvrShader* pShader, unsigned int materialId, void* pUser);
 
     void    CreateBlitAssets();
     void    DestroyBlitAssets();
 
+    // Cube drawn for each of the mMdlMtx objects, with the stereo preamble of gRenderMode
+    bool    CreateSceneAssets();
+    void    DestroySceneAssets();
+
     void    InitializeModel(const char* path);
 
     //void    InitializeShader(Svr::SvrShader &whichShader, const char* vertexPath, const char* fragmentPath, const char* vertexName, const char* fragmentName);
@@ -94,12 +125,41 @@ private:
 
     float                       mMdlRotation;
 
+    Svr::SvrGeometry            mCubeGeometry;
+    Svr::SvrShader              mSceneShader;
+    bool                        mSceneReady;
+
+    // World bounds of the mMdlMtx objects, one cull for both eyes per frame
+    Svr::SvrCullScene           mCullScene;
+    uint32_t                    mVisibleObjects[6];
+
+    // The cubes in view are also the occluders, kept on the CPU for the eyes' buffers
+    float                       mCubeVertices[24 * 6];
+    unsigned int                mCubeIndices[36];
+    Svr::SvrOcclusionBuffer     mOcclusion[SVR_NUM_EYES];
+
 
 
     Svr::SvrBufferedCpuTimer    mFrameTimer;
+    Svr::SvrBufferedCpuTimer    mSubmitTimer;   // Executing the frame's passes
+
+
+    Svr::SvrTextureStreamer     mTextureStreamer;
+
+    // Targets and passes of the frame, rebuilt every Render
+    Svr::SvrRenderTargetPool    mTargetPool;
+    Svr::SvrRenderGraph         mRenderGraph;
 
+    // Objects queued here are drawn for both eyes the way gRenderMode says
+    Svr::SvrRenderQueue         mRenderQueue;
+    MultiViewBuffer             mEyeBuffers[SVR_NUM_EYE_BUFFERS];
+    EyePass                     mEyePasses[SVR_NUM_EYES];
+    int                         mEyeWidth;
+    int                         mEyeHeight;
+    unsigned int                mEyeDraws;      // This frame, summed over the eye passes
 
     // Testing overlay
+    Svr::SvrTextureHandle       mOverlayHandles[kNumOverlayImages];
     GLuint                      mOverlayTextures[kNumOverlayImages];
     GLuint                      mImageFrameBuffer;
     GLuint                      mImageTexture;
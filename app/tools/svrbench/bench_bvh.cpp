@@ -0,0 +1,446 @@
+//=============================================================================
+// FILE: bench_bvh.cpp
+//
+//                  Copyright (c) 2016 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+// Checks SvrBvh against brute force and times build, refit and queries on the
+// two kinds of tree the app builds: the triangles of a terrain with props lying
+// around over it, picked with gaze rays from head height, and the boxes of a
+// scene's instances, queried with spheres and view frustums.
+//
+//  usage: bench_bvh [gridSize] [numBoxes]
+//
+// The terrain is gridSize x gridSize quads, two triangles each, plus
+// gridSize^2 / 4 loose triangles.
+//=============================================================================
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "svrBvh.h"
+#include "svrJobs.h"
+
+using namespace Svr;
+
+// Rays checked against brute force, which is a full pass over the primitives each
+#define NUM_CHECK_RAYS      200
+#define NUM_CHECK_QUERIES   50
+
+static int gFailures = 0;
+
+//-----------------------------------------------------------------------------
+static void Check(bool condition, const char* pWhat, int numMismatches, int numTests)
+//-----------------------------------------------------------------------------
+{
+    if (!condition)
+    {
+        printf("FAIL %s: %d of %d differ\n", pWhat, numMismatches, numTests);
+        gFailures++;
+    }
+}
+
+//-----------------------------------------------------------------------------
+static float Random(float low, float high)
+//-----------------------------------------------------------------------------
+{
+    return low + (high - low) * (float)rand() / (float)RAND_MAX;
+}
+
+//-----------------------------------------------------------------------------
+static double ElapsedMilli(std::chrono::steady_clock::time_point start)
+//-----------------------------------------------------------------------------
+{
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// 100m square of rolling terrain, then loose triangles up to 10m over it
+//-----------------------------------------------------------------------------
+static void MakeTerrain(int gridSize, std::vector<glm::vec3>& vertices, std::vector<uint32_t>& indices)
+//-----------------------------------------------------------------------------
+{
+    for (int z = 0; z <= gridSize; z++)
+    {
+        for (int x = 0; x <= gridSize; x++)
+        {
+            float fx = x * 100.0f / gridSize - 50.0f;
+            float fz = z * 100.0f / gridSize - 50.0f;
+            vertices.push_back(glm::vec3(fx, 3.0f * sinf(fx * 0.3f) * cosf(fz * 0.2f) + Random(0.0f, 0.2f), fz));
+        }
+    }
+
+    for (int z = 0; z < gridSize; z++)
+    {
+        for (int x = 0; x < gridSize; x++)
+        {
+            uint32_t i0 = z * (gridSize + 1) + x;
+            uint32_t i1 = i0 + gridSize + 1;
+            uint32_t quad[6] = { i0, i0 + 1, i1, i0 + 1, i1 + 1, i1 };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+
+    for (int i = 0; i < gridSize * gridSize / 4; i++)
+    {
+        glm::vec3 center(Random(-50.0f, 50.0f), Random(0.0f, 10.0f), Random(-50.0f, 50.0f));
+        uint32_t first = (uint32_t)vertices.size();
+        for (int k = 0; k < 3; k++)
+        {
+            vertices.push_back(center + glm::vec3(Random(-0.5f, 0.5f), Random(-0.5f, 0.5f), Random(-0.5f, 0.5f)));
+            indices.push_back(first + k);
+        }
+    }
+}
+
+// Nearest two sided hit over every triangle (Moller-Trumbore)
+//-----------------------------------------------------------------------------
+static bool IntersectTrianglesBrute(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices,
+                                    const SvrRay& ray, float& outDistance)
+//-----------------------------------------------------------------------------
+{
+    bool found = false;
+    outDistance = ray.maxDistance;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        glm::vec3 v0 = vertices[indices[i]];
+        glm::vec3 edge1 = vertices[indices[i + 1]] - v0;
+        glm::vec3 edge2 = vertices[indices[i + 2]] - v0;
+
+        glm::vec3 p = glm::cross(ray.direction, edge2);
+        float det = glm::dot(edge1, p);
+        if (det == 0.0f)
+        {
+            continue;
+        }
+
+        float invDet = 1.0f / det;
+        glm::vec3 s = ray.origin - v0;
+        float u = glm::dot(s, p) * invDet;
+        glm::vec3 q = glm::cross(s, edge1);
+        float v = glm::dot(ray.direction, q) * invDet;
+        float t = glm::dot(edge2, q) * invDet;
+        if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t >= 0.0f && t < outDistance)
+        {
+            outDistance = t;
+            found = true;
+        }
+    }
+    return found;
+}
+
+// Nearest entry into any box, or the origin when it starts inside one
+//-----------------------------------------------------------------------------
+static bool IntersectBoxesBrute(const std::vector<glm::vec3>& boxMin, const std::vector<glm::vec3>& boxMax,
+                                const SvrRay& ray, float& outDistance)
+//-----------------------------------------------------------------------------
+{
+    bool found = false;
+    outDistance = ray.maxDistance;
+    for (size_t i = 0; i < boxMin.size(); i++)
+    {
+        float tNear = 0.0f;
+        float tFar = ray.maxDistance;
+        for (int k = 0; k < 3; k++)
+        {
+            float t0 = (boxMin[i][k] - ray.origin[k]) / ray.direction[k];
+            float t1 = (boxMax[i][k] - ray.origin[k]) / ray.direction[k];
+            tNear = glm::max(tNear, glm::min(t0, t1));
+            tFar = glm::min(tFar, glm::max(t0, t1));
+        }
+
+        if (tNear <= tFar && tNear < outDistance)
+        {
+            outDistance = tNear;
+            found = true;
+        }
+    }
+    return found;
+}
+
+//-----------------------------------------------------------------------------
+static std::vector<SvrRay> MakeGazeRays(int numRays)
+//-----------------------------------------------------------------------------
+{
+    std::vector<SvrRay> rays(numRays);
+    for (int i = 0; i < numRays; i++)
+    {
+        rays[i].origin = glm::vec3(Random(-40.0f, 40.0f), 6.0f, Random(-40.0f, 40.0f));
+        rays[i].direction = glm::normalize(glm::vec3(Random(-1.0f, 1.0f), Random(-1.0f, 0.2f), Random(-1.0f, 1.0f)));
+        rays[i].maxDistance = 200.0f;
+    }
+    return rays;
+}
+
+//-----------------------------------------------------------------------------
+static int CheckTriangleRays(const SvrBvh& bvh, const std::vector<glm::vec3>& vertices,
+                             const std::vector<uint32_t>& indices, const std::vector<SvrRay>& rays)
+//-----------------------------------------------------------------------------
+{
+    int numMismatches = 0;
+    for (int i = 0; i < NUM_CHECK_RAYS && i < (int)rays.size(); i++)
+    {
+        float distance;
+        bool bruteHit = IntersectTrianglesBrute(vertices, indices, rays[i], distance);
+
+        SvrRayHit hit;
+        bool bvhHit = bvh.IntersectRay(rays[i], hit);
+        if (bvhHit != bruteHit || (bvhHit && fabsf(hit.distance - distance) > 1e-3f))
+        {
+            numMismatches++;
+        }
+    }
+    return numMismatches;
+}
+
+//-----------------------------------------------------------------------------
+static double TimeRays(const SvrBvh& bvh, const std::vector<SvrRay>& rays, int* pNumHits)
+//-----------------------------------------------------------------------------
+{
+    int numHits = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rays.size(); i++)
+    {
+        SvrRayHit hit;
+        numHits += bvh.IntersectRay(rays[i], hit) ? 1 : 0;
+    }
+    *pNumHits = numHits;
+    return ElapsedMilli(start) * 1e3 / rays.size();
+}
+
+//-----------------------------------------------------------------------------
+static void RunTriangles(int gridSize)
+//-----------------------------------------------------------------------------
+{
+    srand(gridSize);
+    std::vector<glm::vec3> vertices;
+    std::vector<uint32_t> indices;
+    MakeTerrain(gridSize, vertices, indices);
+
+    SvrBvh bvh;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bvh.BuildTriangles(&vertices[0], sizeof(glm::vec3), &indices[0], (int)indices.size(), false);
+    double serialMilli = ElapsedMilli(start);
+
+    start = std::chrono::steady_clock::now();
+    bvh.BuildTriangles(&vertices[0], sizeof(glm::vec3), &indices[0], (int)indices.size(), true);
+    double parallelMilli = ElapsedMilli(start);
+
+    printf("%8d triangles: build %7.2fms, on %d job threads %7.2fms, %d nodes\n", bvh.GetPrimitiveCount(),
+           serialMilli, SvrGetJobThreadCount(), parallelMilli, bvh.GetNodeCount());
+
+    std::vector<SvrRay> rays = MakeGazeRays(20000);
+    int numMismatches = CheckTriangleRays(bvh, vertices, indices, rays);
+    Check(numMismatches == 0, "triangle rays match brute force", numMismatches, NUM_CHECK_RAYS);
+
+    int numHits;
+    double rayMicro = TimeRays(bvh, rays, &numHits);
+    printf("%8d gaze rays: %6.3fus/ray, %d hit\n", (int)rays.size(), rayMicro, numHits);
+
+    // Swell the terrain, the tree keeps its shape and only its bounds change
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        vertices[i].y += 0.5f * sinf(vertices[i].x * 0.1f);
+    }
+
+    start = std::chrono::steady_clock::now();
+    bvh.RefitTriangles(&vertices[0], sizeof(glm::vec3));
+    double refitMilli = ElapsedMilli(start);
+
+    numMismatches = CheckTriangleRays(bvh, vertices, indices, rays);
+    Check(numMismatches == 0, "triangle rays match brute force after refit", numMismatches, NUM_CHECK_RAYS);
+
+    rayMicro = TimeRays(bvh, rays, &numHits);
+    printf("           refit: %7.2fms, then %6.3fus/ray, %d hit\n", refitMilli, rayMicro, numHits);
+}
+
+// Boxes with some point no further than radius from the center
+//-----------------------------------------------------------------------------
+static std::vector<uint32_t> QuerySphereBrute(const std::vector<glm::vec3>& boxMin, const std::vector<glm::vec3>& boxMax,
+                                              const glm::vec3& center, float radius)
+//-----------------------------------------------------------------------------
+{
+    std::vector<uint32_t> found;
+    for (size_t i = 0; i < boxMin.size(); i++)
+    {
+        glm::vec3 outside = glm::max(glm::max(boxMin[i] - center, center - boxMax[i]), glm::vec3(0.0f));
+        if (glm::dot(outside, outside) <= radius * radius)
+        {
+            found.push_back((uint32_t)i);
+        }
+    }
+    return found;
+}
+
+//-----------------------------------------------------------------------------
+static std::vector<uint32_t> QueryFrustumBrute(const std::vector<glm::vec3>& boxMin, const std::vector<glm::vec3>& boxMax,
+                                               const SvrFrustum& frustum)
+//-----------------------------------------------------------------------------
+{
+    std::vector<uint32_t> found;
+    for (size_t i = 0; i < boxMin.size(); i++)
+    {
+        glm::vec3 center = (boxMin[i] + boxMax[i]) * 0.5f;
+        glm::vec3 extent = (boxMax[i] - boxMin[i]) * 0.5f;
+
+        bool outside = false;
+        for (int p = 0; p < kNumFrustumPlanes; p++)
+        {
+            glm::vec3 normal(frustum.planes[p]);
+            outside |= (glm::dot(normal, center) + frustum.planes[p].w + glm::dot(glm::abs(normal), extent) < 0.0f);
+        }
+
+        if (!outside)
+        {
+            found.push_back((uint32_t)i);
+        }
+    }
+    return found;
+}
+
+//-----------------------------------------------------------------------------
+static bool SameSorted(std::vector<uint32_t>& out, int count, const std::vector<uint32_t>& reference)
+//-----------------------------------------------------------------------------
+{
+    std::sort(out.begin(), out.begin() + count);
+    return count == (int)reference.size() && std::equal(reference.begin(), reference.end(), out.begin());
+}
+
+//-----------------------------------------------------------------------------
+static void RunBoxes(int numBoxes)
+//-----------------------------------------------------------------------------
+{
+    srand(numBoxes);
+    std::vector<glm::vec3> boxMin(numBoxes);
+    std::vector<glm::vec3> boxMax(numBoxes);
+    for (int i = 0; i < numBoxes; i++)
+    {
+        glm::vec3 center(Random(-100.0f, 100.0f), Random(0.0f, 20.0f), Random(-100.0f, 100.0f));
+        glm::vec3 extent(Random(0.1f, 1.0f), Random(0.1f, 1.0f), Random(0.1f, 1.0f));
+        boxMin[i] = center - extent;
+        boxMax[i] = center + extent;
+    }
+
+    SvrBvh bvh;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bvh.BuildBoxes(&boxMin[0], &boxMax[0], numBoxes, false);
+    double serialMilli = ElapsedMilli(start);
+
+    start = std::chrono::steady_clock::now();
+    bvh.BuildBoxes(&boxMin[0], &boxMax[0], numBoxes, true);
+    double parallelMilli = ElapsedMilli(start);
+
+    printf("%8d boxes:     build %7.2fms, on %d job threads %7.2fms, %d nodes\n", numBoxes, serialMilli,
+           SvrGetJobThreadCount(), parallelMilli, bvh.GetNodeCount());
+
+    std::vector<uint32_t> out(numBoxes);
+    int numMismatches = 0;
+    for (int q = 0; q < NUM_CHECK_QUERIES; q++)
+    {
+        glm::vec3 center(Random(-100.0f, 100.0f), Random(0.0f, 20.0f), Random(-100.0f, 100.0f));
+        float radius = Random(1.0f, 10.0f);
+        int count = bvh.QuerySphere(center, radius, &out[0], numBoxes);
+        numMismatches += SameSorted(out, count, QuerySphereBrute(boxMin, boxMax, center, radius)) ? 0 : 1;
+    }
+    Check(numMismatches == 0, "sphere queries match brute force", numMismatches, NUM_CHECK_QUERIES);
+
+    // Views from head height over the scene, as the culling of one eye would see it
+    glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 60.0f);
+    std::vector<SvrFrustum> frustums(NUM_CHECK_QUERIES);
+    numMismatches = 0;
+    for (int q = 0; q < NUM_CHECK_QUERIES; q++)
+    {
+        glm::vec3 eye(Random(-100.0f, 100.0f), 2.0f, Random(-100.0f, 100.0f));
+        glm::vec3 forward(Random(-1.0f, 1.0f), Random(-0.2f, 0.2f), Random(-1.0f, 1.0f));
+        SvrExtractFrustum(projection * glm::lookAt(eye, eye + forward, glm::vec3(0.0f, 1.0f, 0.0f)), frustums[q]);
+
+        int count = bvh.QueryFrustum(frustums[q], &out[0], numBoxes);
+        numMismatches += SameSorted(out, count, QueryFrustumBrute(boxMin, boxMax, frustums[q])) ? 0 : 1;
+    }
+    Check(numMismatches == 0, "frustum queries match brute force", numMismatches, NUM_CHECK_QUERIES);
+
+    const int numQueries = 2000;
+    long numFound = 0;
+    start = std::chrono::steady_clock::now();
+    for (int q = 0; q < numQueries; q++)
+    {
+        glm::vec3 center(Random(-100.0f, 100.0f), Random(0.0f, 20.0f), Random(-100.0f, 100.0f));
+        numFound += bvh.QuerySphere(center, 5.0f, &out[0], numBoxes);
+    }
+    double sphereMicro = ElapsedMilli(start) * 1e3 / numQueries;
+    printf("%8d spheres:   %7.3fus/query, %.1f found\n", numQueries, sphereMicro, (double)numFound / numQueries);
+
+    numFound = 0;
+    start = std::chrono::steady_clock::now();
+    for (int q = 0; q < numQueries; q++)
+    {
+        numFound += bvh.QueryFrustum(frustums[q % NUM_CHECK_QUERIES], &out[0], numBoxes);
+    }
+    double frustumMicro = ElapsedMilli(start) * 1e3 / numQueries;
+    printf("%8d frustums:  %7.3fus/query, %.1f found\n", numQueries, frustumMicro, (double)numFound / numQueries);
+
+    // Nudge every box by up to a meter and refit, then pick against the boxes themselves
+    for (int i = 0; i < numBoxes; i++)
+    {
+        glm::vec3 offset(Random(-1.0f, 1.0f), 0.0f, Random(-1.0f, 1.0f));
+        boxMin[i] += offset;
+        boxMax[i] += offset;
+    }
+
+    start = std::chrono::steady_clock::now();
+    bvh.RefitBoxes(&boxMin[0], &boxMax[0]);
+    double refitMilli = ElapsedMilli(start);
+
+    numMismatches = 0;
+    for (int i = 0; i < NUM_CHECK_RAYS; i++)
+    {
+        SvrRay ray;
+        ray.origin = glm::vec3(Random(-100.0f, 100.0f), Random(0.0f, 20.0f), Random(-100.0f, 100.0f));
+        ray.direction = glm::normalize(glm::vec3(Random(-1.0f, 1.0f), Random(-1.0f, 1.0f), Random(-1.0f, 1.0f)));
+        ray.maxDistance = 1000.0f;
+
+        float distance;
+        bool bruteHit = IntersectBoxesBrute(boxMin, boxMax, ray, distance);
+
+        SvrRayHit hit;
+        bool bvhHit = bvh.IntersectRay(ray, hit);
+        if (bvhHit != bruteHit || (bvhHit && fabsf(hit.distance - distance) > 1e-3f))
+        {
+            numMismatches++;
+        }
+    }
+    Check(numMismatches == 0, "box rays match brute force after refit", numMismatches, NUM_CHECK_RAYS);
+    printf("           refit: %7.2fms\n", refitMilli);
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+//-----------------------------------------------------------------------------
+{
+    int gridSize = (argc > 1) ? atoi(argv[1]) : 512;
+    int numBoxes = (argc > 2) ? atoi(argv[2]) : 100000;
+    if (gridSize < 1 || numBoxes < 1)
+    {
+        printf("usage: bench_bvh [gridSize] [numBoxes]\n");
+        return 1;
+    }
+
+    RunTriangles(gridSize);
+    RunBoxes(numBoxes);
+
+    SvrShutdownJobs();
+
+    if (gFailures != 0)
+    {
+        printf("%d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
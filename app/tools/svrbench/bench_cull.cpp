@@ -0,0 +1,270 @@
+//=============================================================================
+// FILE: bench_cull.cpp
+//
+//                  Copyright (c) 2016 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+// Checks SvrCullScene::Cull against a scalar version of the same test and times
+// it on scenes of 10^4 objects up to the given count: each eye culled on its
+// own, both eyes through SvrGetStereoCullFrustum, and the combined frustum on
+// the job pool.  The combined result has to hold everything either eye sees.
+//
+//  usage: bench_cull [maxObjects]
+//=============================================================================
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "svrCulling.h"
+#include "svrJobs.h"
+
+using namespace Svr;
+
+struct Bounds
+{
+    glm::vec3   boxMin;
+    glm::vec3   boxMax;
+    float       radius;
+};
+
+static int gFailures = 0;
+
+//-----------------------------------------------------------------------------
+static void Check(bool condition, const char* pWhat, int numObjects)
+//-----------------------------------------------------------------------------
+{
+    if (!condition)
+    {
+        printf("FAIL %s: %d objects\n", pWhat, numObjects);
+        gFailures++;
+    }
+}
+
+//-----------------------------------------------------------------------------
+static float Random(float low, float high)
+//-----------------------------------------------------------------------------
+{
+    return low + (high - low) * (float)rand() / (float)RAND_MAX;
+}
+
+// Boxes of up to a couple of meters over a 200m square around the viewer, each with
+// a sphere somewhere between the inscribed and the circumscribed one
+//-----------------------------------------------------------------------------
+static std::vector<Bounds> MakeBounds(int numObjects)
+//-----------------------------------------------------------------------------
+{
+    std::vector<Bounds> bounds(numObjects);
+    for (int i = 0; i < numObjects; i++)
+    {
+        glm::vec3 center(Random(-100.0f, 100.0f), Random(-20.0f, 20.0f), Random(-100.0f, 100.0f));
+        glm::vec3 extent(Random(0.1f, 1.0f), Random(0.1f, 1.0f), Random(0.1f, 1.0f));
+        float minExtent = glm::min(extent.x, glm::min(extent.y, extent.z));
+
+        bounds[i].boxMin = center - extent;
+        bounds[i].boxMax = center + extent;
+        bounds[i].radius = Random(minExtent, glm::length(extent));
+    }
+    return bounds;
+}
+
+// The kernel's test one object at a time: visible unless, for some plane, the nearer
+// of the sphere and the box is entirely behind it
+//-----------------------------------------------------------------------------
+static int CullScalar(const std::vector<Bounds>& bounds, const SvrFrustum& frustum, uint32_t* pVisible)
+//-----------------------------------------------------------------------------
+{
+    int numVisible = 0;
+    for (size_t i = 0; i < bounds.size(); i++)
+    {
+        glm::vec3 center = (bounds[i].boxMin + bounds[i].boxMax) * 0.5f;
+        glm::vec3 extent = (bounds[i].boxMax - bounds[i].boxMin) * 0.5f;
+
+        bool outside = false;
+        for (int p = 0; p < kNumFrustumPlanes; p++)
+        {
+            // Summed in the kernel's order so the two round the same way
+            const glm::vec4& plane = frustum.planes[p];
+            float d = (plane.x * center.x + plane.y * center.y) + (plane.z * center.z + plane.w);
+            float boxRadius = (fabsf(plane.x) * extent.x + fabsf(plane.y) * extent.y) + fabsf(plane.z) * extent.z;
+            outside |= (d + glm::min(bounds[i].radius, boxRadius) < 0.0f);
+        }
+
+        if (!outside)
+        {
+            pVisible[numVisible++] = (uint32_t)i;
+        }
+    }
+    return numVisible;
+}
+
+//-----------------------------------------------------------------------------
+static bool SameIndices(const uint32_t* pA, int countA, const uint32_t* pB, int countB)
+//-----------------------------------------------------------------------------
+{
+    if (countA != countB)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < countA; i++)
+    {
+        if (pA[i] != pB[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+static double ElapsedMilli(std::chrono::steady_clock::time_point start, int numRuns)
+//-----------------------------------------------------------------------------
+{
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / numRuns;
+}
+
+//-----------------------------------------------------------------------------
+static void RunScene(int numObjects, const SvrFrustum& left, const SvrFrustum& right, const SvrFrustum& combined)
+//-----------------------------------------------------------------------------
+{
+    srand(numObjects);
+    std::vector<Bounds> bounds = MakeBounds(numObjects);
+
+    SvrCullScene scene;
+    scene.Reserve(numObjects);
+    for (int i = 0; i < numObjects; i++)
+    {
+        scene.AddObject(bounds[i].boxMin, bounds[i].boxMax, bounds[i].radius);
+    }
+
+    std::vector<uint32_t> visible(numObjects);
+    std::vector<uint32_t> reference(numObjects);
+    std::vector<uint32_t> parallel(numObjects);
+
+    // Kernel against the scalar test, then the job pool against the serial kernel
+    int numLeft = scene.Cull(left, &visible[0]);
+    Check(SameIndices(&visible[0], numLeft, &reference[0], CullScalar(bounds, left, &reference[0])),
+          "left eye matches the scalar test", numObjects);
+
+    int numCombined = scene.Cull(combined, &visible[0]);
+    Check(SameIndices(&visible[0], numCombined, &reference[0], CullScalar(bounds, combined, &reference[0])),
+          "combined frustum matches the scalar test", numObjects);
+    Check(SameIndices(&visible[0], numCombined, &parallel[0], scene.Cull(combined, &parallel[0], true)),
+          "parallel cull matches the serial one", numObjects);
+
+    // Nothing either eye sees may be dropped by the combined frustum
+    std::vector<char> inCombined(numObjects, 0);
+    for (int i = 0; i < numCombined; i++)
+    {
+        inCombined[visible[i]] = 1;
+    }
+
+    int numMissing = 0;
+    int numRight = scene.Cull(right, &reference[0]);
+    for (int i = 0; i < numRight; i++)
+    {
+        numMissing += inCombined[reference[i]] ? 0 : 1;
+    }
+    numLeft = scene.Cull(left, &reference[0]);
+    for (int i = 0; i < numLeft; i++)
+    {
+        numMissing += inCombined[reference[i]] ? 0 : 1;
+    }
+    Check(numMissing == 0, "combined frustum holds both eyes", numObjects);
+
+    // The small scenes are only there for the partial groups of four
+    if (numObjects < 10000)
+    {
+        return;
+    }
+
+    int numRuns = 2000000 / numObjects + 1;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int r = 0; r < numRuns; r++)
+    {
+        CullScalar(bounds, combined, &reference[0]);
+    }
+    double scalarMilli = ElapsedMilli(start, numRuns);
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < numRuns; r++)
+    {
+        scene.Cull(left, &visible[0]);
+        scene.Cull(right, &visible[0]);
+    }
+    double eyesMilli = ElapsedMilli(start, numRuns);
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < numRuns; r++)
+    {
+        scene.Cull(combined, &visible[0]);
+    }
+    double combinedMilli = ElapsedMilli(start, numRuns);
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < numRuns; r++)
+    {
+        scene.Cull(combined, &parallel[0], true);
+    }
+    double parallelMilli = ElapsedMilli(start, numRuns);
+
+    printf("%7d objects, %5d/%5d/%5d visible L/R/both: scalar %6.3fms, per eye x2 %6.3fms, combined %6.3fms "
+           "(%4.2fns/object), on %d job threads %6.3fms\n",
+           numObjects, numLeft, numRight, numCombined, scalarMilli, eyesMilli, combinedMilli,
+           combinedMilli * 1e6 / numObjects, SvrGetJobThreadCount(), parallelMilli);
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+//-----------------------------------------------------------------------------
+{
+    int maxObjects = (argc > 1) ? atoi(argv[1]) : 100000;
+    if (maxObjects < 1)
+    {
+        printf("usage: bench_cull [maxObjects]\n");
+        return 1;
+    }
+
+    // Eyes as SvrGetEyeViewMatrices places them: shared orientation, 64mm apart
+    glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+    glm::mat4 head = glm::rotate(glm::mat4(1.0f), 0.3f, glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 leftView = glm::translate(glm::mat4(1.0f), glm::vec3(0.032f, 0.0f, 0.0f)) * head;
+    glm::mat4 rightView = glm::translate(glm::mat4(1.0f), glm::vec3(-0.032f, 0.0f, 0.0f)) * head;
+
+    SvrFrustum left, right, combined;
+    SvrExtractFrustum(projection * leftView, left);
+    SvrExtractFrustum(projection * rightView, right);
+    SvrGetStereoCullFrustum(leftView, rightView, projection, combined);
+
+    // Odd sizes leave a partial group of four at the end
+    static const int checkSizes[] = { 1, 5, 4099 };
+    for (size_t i = 0; i < sizeof(checkSizes) / sizeof(checkSizes[0]); i++)
+    {
+        if (checkSizes[i] <= maxObjects)
+        {
+            RunScene(checkSizes[i], left, right, combined);
+        }
+    }
+
+    for (int numObjects = 10000; numObjects <= maxObjects; numObjects = (numObjects == 10000) ? 30000 : numObjects * 10 / 3)
+    {
+        RunScene(numObjects, left, right, combined);
+    }
+
+    SvrShutdownJobs();
+
+    if (gFailures != 0)
+    {
+        printf("%d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
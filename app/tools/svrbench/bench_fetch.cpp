@@ -0,0 +1,262 @@
+//=============================================================================
+// FILE: bench_fetch.cpp
+//
+//                  Copyright (c) 2016 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+// Times an indexed vertex gather over a UV sphere in each vertex layout svrmesh
+// can write, as a CPU stand-in for the GPU's vertex fetch.  Every pass walks the
+// index buffer and reads each referenced vertex in full, once with the caches
+// flushed and once warm.
+//
+//  usage: bench_fetch [numVertices] [mesh.svrm ...]
+//
+// Meshes written by svrmesh can be given after the vertex count to time their
+// real layouts as well.
+//=============================================================================
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "svrMeshFormat.h"
+
+using namespace Svr;
+
+#ifndef GL_UNSIGNED_SHORT
+#define GL_UNSIGNED_SHORT   0x1403
+#endif
+
+// Big enough to push the mesh out of the last level cache between cold passes
+#define FLUSH_BUFFER_SIZE   (32 * 1024 * 1024)
+
+struct Layout
+{
+    const char* pName;
+    uint32_t    stride;
+};
+
+// The strides BuildLayout in svrmesh.cpp produces
+static const Layout gLayouts[] =
+{
+    { "float position, normal, texcoord", 32 },
+    { "float position, oct normal, half texcoord", 20 },
+    { "snorm16 position, oct normal, unorm16 texcoord", 16 },
+};
+
+struct Mesh
+{
+    std::vector<unsigned char>  vertices;
+    std::vector<unsigned char>  indices;
+    uint32_t                    numIndices;
+    uint32_t                    stride;
+    bool                        shortIndices;
+};
+
+static int gFailures = 0;
+static std::vector<char> gFlushBuffer;
+
+//-----------------------------------------------------------------------------
+static void Check(bool condition, const char* pWhat)
+//-----------------------------------------------------------------------------
+{
+    if (!condition)
+    {
+        printf("FAIL %s\n", pWhat);
+        gFailures++;
+    }
+}
+
+// Triangle list over a sphere of rings x segments vertices, in row order the way
+// an unoptimized exporter writes it
+//-----------------------------------------------------------------------------
+static std::vector<uint32_t> BuildSphereIndices(uint32_t rings, uint32_t segments)
+//-----------------------------------------------------------------------------
+{
+    std::vector<uint32_t> indices;
+    for (uint32_t r = 0; r + 1 < rings; r++)
+    {
+        for (uint32_t s = 0; s + 1 < segments; s++)
+        {
+            uint32_t i0 = r * segments + s;
+            uint32_t i1 = i0 + segments;
+            uint32_t tri[6] = { i0, i1, i0 + 1, i0 + 1, i1, i1 + 1 };
+            indices.insert(indices.end(), tri, tri + 6);
+        }
+    }
+    return indices;
+}
+
+//-----------------------------------------------------------------------------
+static Mesh BuildMesh(uint32_t numVertices, const std::vector<uint32_t>& indices, uint32_t stride, bool shortIndices)
+//-----------------------------------------------------------------------------
+{
+    Mesh mesh;
+    mesh.stride = stride;
+    mesh.numIndices = (uint32_t)indices.size();
+    mesh.shortIndices = shortIndices;
+
+    // The contents only have to be the same between runs, not a real encoding
+    mesh.vertices.resize((size_t)numVertices * stride);
+    for (size_t i = 0; i < mesh.vertices.size(); i++)
+        mesh.vertices[i] = (unsigned char)(i * 31 + 7);
+
+    mesh.indices.resize(indices.size() * (shortIndices ? 2 : 4));
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        if (shortIndices)
+            ((uint16_t*)&mesh.indices[0])[i] = (uint16_t)indices[i];
+        else
+            ((uint32_t*)&mesh.indices[0])[i] = indices[i];
+    }
+    return mesh;
+}
+
+//-----------------------------------------------------------------------------
+static bool LoadMesh(const char* pPath, Mesh* pMesh)
+//-----------------------------------------------------------------------------
+{
+    FILE* fp = fopen(pPath, "rb");
+    if (fp == NULL)
+    {
+        printf("Unable to open %s\n", pPath);
+        return false;
+    }
+
+    std::vector<unsigned char> file;
+    unsigned char buffer[65536];
+    size_t bytesRead;
+    while ((bytesRead = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+        file.insert(file.end(), buffer, buffer + bytesRead);
+    fclose(fp);
+
+    const SvrMeshHeader* pHeader = (const SvrMeshHeader*)&file[0];
+    if (file.size() < sizeof(SvrMeshHeader) || pHeader->magic != SVR_MESH_MAGIC ||
+        pHeader->vertexDataOffset + pHeader->vertexDataSize > file.size() ||
+        pHeader->indexDataOffset + pHeader->indexDataSize > file.size())
+    {
+        printf("%s is not a mesh file\n", pPath);
+        return false;
+    }
+
+    pMesh->stride = pHeader->vertexStride;
+    pMesh->numIndices = pHeader->numIndices;
+    pMesh->shortIndices = (pHeader->indexType == GL_UNSIGNED_SHORT);
+    pMesh->vertices.assign(&file[pHeader->vertexDataOffset], &file[pHeader->vertexDataOffset] + pHeader->vertexDataSize);
+    pMesh->indices.assign(&file[pHeader->indexDataOffset], &file[pHeader->indexDataOffset] + pHeader->indexDataSize);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+template <typename IndexType>
+static uint32_t Gather(const Mesh& mesh)
+//-----------------------------------------------------------------------------
+{
+    const IndexType* pIndices = (const IndexType*)&mesh.indices[0];
+    const unsigned char* pVertices = &mesh.vertices[0];
+    const uint32_t numWords = mesh.stride / 4;
+
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < mesh.numIndices; i++)
+    {
+        const unsigned char* pVertex = pVertices + (size_t)pIndices[i] * mesh.stride;
+        for (uint32_t w = 0; w < numWords; w++)
+        {
+            uint32_t word;
+            memcpy(&word, pVertex + w * 4, 4);
+            sum += word;
+        }
+    }
+    return sum;
+}
+
+//-----------------------------------------------------------------------------
+static uint32_t GatherMesh(const Mesh& mesh)
+//-----------------------------------------------------------------------------
+{
+    return mesh.shortIndices ? Gather<uint16_t>(mesh) : Gather<uint32_t>(mesh);
+}
+
+//-----------------------------------------------------------------------------
+static void TimeMesh(const char* pName, const Mesh& mesh, int numPasses)
+//-----------------------------------------------------------------------------
+{
+    double coldMicro = 0.0;
+    double warmMicro = 0.0;
+    uint32_t sum = 0;
+
+    for (int pass = 0; pass < numPasses; pass++)
+    {
+        memset(&gFlushBuffer[0], pass, gFlushBuffer.size());
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        sum += GatherMesh(mesh);
+        std::chrono::steady_clock::time_point cold = std::chrono::steady_clock::now();
+        sum += GatherMesh(mesh);
+        std::chrono::steady_clock::time_point warm = std::chrono::steady_clock::now();
+
+        coldMicro += std::chrono::duration<double, std::micro>(cold - start).count();
+        warmMicro += std::chrono::duration<double, std::micro>(warm - cold).count();
+    }
+
+    double indexBytes = (double)mesh.numIndices * (mesh.shortIndices ? 2 : 4);
+    double fetchBytes = (double)mesh.numIndices * mesh.stride + indexBytes;
+    printf("%-48s %2u B/vertex, %2d bit indices: %6.2f MB fetched, cold %8.1fus, warm %8.1fus (%u)\n",
+           pName, mesh.stride, mesh.shortIndices ? 16 : 32, fetchBytes / (1024.0 * 1024.0),
+           coldMicro / numPasses, warmMicro / numPasses, sum & 1);
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+//-----------------------------------------------------------------------------
+{
+    long numVertices = (argc > 1) ? atol(argv[1]) : 40000;
+    if (numVertices < 4)
+    {
+        printf("usage: bench_fetch [numVertices] [mesh.svrm ...]\n");
+        return 1;
+    }
+
+    gFlushBuffer.resize(FLUSH_BUFFER_SIZE);
+    const int numPasses = 20;
+
+    uint32_t segments = (uint32_t)sqrt((double)numVertices * 2.0);
+    uint32_t rings = (uint32_t)(numVertices / segments);
+    std::vector<uint32_t> indices = BuildSphereIndices(rings, segments);
+    bool fitsShort = (rings * segments < 0xFFFF);
+    printf("UV sphere, %u vertices, %u triangles\n", rings * segments, (uint32_t)indices.size() / 3);
+
+    // Index width must not change what is fetched
+    Mesh wide = BuildMesh(rings * segments, indices, gLayouts[0].stride, false);
+    TimeMesh(gLayouts[0].pName, wide, numPasses);
+    if (fitsShort)
+    {
+        Mesh narrow = BuildMesh(rings * segments, indices, gLayouts[0].stride, true);
+        Check(GatherMesh(narrow) == GatherMesh(wide), "16 and 32 bit indices gather the same vertices");
+    }
+
+    for (size_t i = 0; i < sizeof(gLayouts) / sizeof(gLayouts[0]); i++)
+    {
+        Mesh mesh = BuildMesh(rings * segments, indices, gLayouts[i].stride, fitsShort);
+        TimeMesh(gLayouts[i].pName, mesh, numPasses);
+    }
+
+    for (int i = 2; i < argc; i++)
+    {
+        Mesh mesh;
+        if (LoadMesh(argv[i], &mesh))
+            TimeMesh(argv[i], mesh, numPasses);
+    }
+
+    if (gFailures != 0)
+    {
+        printf("%d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,284 @@
+//=============================================================================
+// FILE: bench_hashtable.cpp
+//
+//                  Copyright (c) 2016 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+// Checks Svr::HashTable against std::unordered_map, then times lookups next to
+// the chained table it replaced.  The chained table is reproduced below as it
+// was: one new'd entry per key and a fixed key % capacity bucket array.
+//
+//  usage: bench_hashtable [numKeys]
+//
+// Timed cases are a shader's uniform names looked up by string, and integer keys
+// with the chained table at Init(32) as the shaders sized it and at Init(numKeys).
+//=============================================================================
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
+#include "svrHashTable.h"
+
+using namespace Svr;
+
+struct Uniform
+{
+    int location;
+    int type;
+};
+
+// The chained table from before the flat rewrite, trimmed to what is timed
+template <class _Key, class _Data, _Key (*hashFn)(const char*)>
+class ChainedHashTable
+{
+private:
+    struct Entry
+    {
+        _Key    key;
+        _Data   data;
+        Entry*  pNext;
+    };
+
+public:
+    ChainedHashTable()
+        : mtable(NULL)
+        , mcapacity(0)
+    {}
+
+    ~ChainedHashTable()
+    {
+        for (unsigned int i = 0; i < mcapacity; i++)
+        {
+            Entry* pEntry = mtable[i];
+            while (pEntry)
+            {
+                Entry* pCurrent = pEntry;
+                pEntry = pEntry->pNext;
+                delete pCurrent;
+            }
+        }
+        delete [] mtable;
+    }
+
+    void Init(unsigned int capacity)
+    {
+        mcapacity = capacity;
+        mtable = new Entry*[capacity];
+        for (unsigned int i = 0; i < mcapacity; i++)
+            mtable[i] = NULL;
+    }
+
+    void Insert(_Key key, const _Data& data)
+    {
+        Entry* pNewEntry = new Entry;
+        pNewEntry->key = key;
+        pNewEntry->data = data;
+        pNewEntry->pNext = NULL;
+
+        Entry** ppEntry = &mtable[key % mcapacity];
+        while (*ppEntry != NULL)
+            ppEntry = &(*ppEntry)->pNext;
+        *ppEntry = pNewEntry;
+    }
+
+    void Insert(const char* key, const _Data& data)
+    {
+        Insert(hashFn(key), data);
+    }
+
+    bool Find(_Key key, _Data* result)
+    {
+        for (Entry* pEntry = mtable[key % mcapacity]; pEntry != NULL; pEntry = pEntry->pNext)
+        {
+            if (pEntry->key == key)
+            {
+                *result = pEntry->data;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool Find(const char* key, _Data* result)
+    {
+        return Find(hashFn(key), result);
+    }
+
+private:
+    Entry**         mtable;
+    unsigned int    mcapacity;
+};
+
+typedef HashTable<unsigned int, Uniform, DjB2Hash> FlatTable;
+typedef ChainedHashTable<unsigned int, Uniform, DjB2Hash> ChainedTable;
+
+static int gFailures = 0;
+
+//-----------------------------------------------------------------------------
+static void Check(bool condition, const char* pWhat)
+//-----------------------------------------------------------------------------
+{
+    if (!condition)
+    {
+        printf("FAIL %s\n", pWhat);
+        gFailures++;
+    }
+}
+
+//-----------------------------------------------------------------------------
+static void RunChecks(const std::vector<unsigned int>& keys)
+//-----------------------------------------------------------------------------
+{
+    FlatTable table;
+    std::unordered_map<unsigned int, int> reference;
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        Uniform u = { (int)i, 0 };
+        table.Insert(keys[i], u);
+        reference[keys[i]] = (int)i;
+    }
+    Check(table.GetCount() == reference.size(), "count");
+
+    Uniform u;
+    bool allFound = true;
+    for (std::unordered_map<unsigned int, int>::const_iterator it = reference.begin(); it != reference.end(); ++it)
+    {
+        allFound &= table.Find(it->first, &u) && u.location == it->second;
+    }
+    Check(allFound, "every key found with its data");
+
+    // Odd keys are never inserted
+    bool noneFound = true;
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        noneFound &= !table.Find(keys[i] | 1, &u) || reference.count(keys[i] | 1) != 0;
+    }
+    Check(noneFound, "missing keys not found");
+
+    size_t numVisited = 0;
+    for (FlatTable::Iterator it = table.GetIterator(); !it.End(); it.Next())
+    {
+        numVisited++;
+    }
+    Check(numVisited == reference.size(), "iterator visits every entry once");
+
+    Uniform replaced = { -1, 1 };
+    table.Insert(keys[0], replaced);
+    Check(table.GetCount() == reference.size() && table.Find(keys[0], &u) && u.location == -1, "insert replaces");
+
+    FlatTable strings;
+    strings.Init(32);
+    Uniform mvp = { 5, 1 };
+    strings.Insert("uMvpMatrix", mvp);
+    Check(strings.Find("uMvpMatrix", &u) && u.location == 5 && !strings.Find("uOther", &u), "string keys");
+
+    FlatTable empty;
+    FlatTable::Iterator it = empty.GetIterator();
+    Check(!empty.Find("x", &u) && it.End(), "empty table");
+}
+
+//-----------------------------------------------------------------------------
+template <class Table>
+static double TimeStringLookups(Table& table, const char* const* ppNames, int numNames, int numLookups)
+//-----------------------------------------------------------------------------
+{
+    volatile int sum = 0;
+    Uniform u;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < numLookups; i++)
+    {
+        if (table.Find(ppNames[i % numNames], &u))
+            sum += u.location;
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / numLookups;
+}
+
+//-----------------------------------------------------------------------------
+template <class Table>
+static double TimeKeyLookups(Table& table, const std::vector<unsigned int>& keys, size_t numLookups)
+//-----------------------------------------------------------------------------
+{
+    volatile int sum = 0;
+    Uniform u;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < numLookups; i++)
+    {
+        // Stride through the keys so a short run still samples every chain position
+        if (table.Find(keys[(i * 40503) % keys.size()], &u))
+            sum += u.location;
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / numLookups;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+//-----------------------------------------------------------------------------
+{
+    int numKeys = (argc > 1) ? atoi(argv[1]) : 100000;
+    if (numKeys < 1)
+    {
+        printf("usage: bench_hashtable [numKeys]\n");
+        return 1;
+    }
+
+    // Even keys scattered over the range, so key | 1 is never present
+    std::vector<unsigned int> keys(numKeys);
+    for (int i = 0; i < numKeys; i++)
+    {
+        keys[i] = ((unsigned int)i * 2654435761u) & ~1u;
+    }
+    RunChecks(keys);
+
+    static const int kNumNames = 32;
+    char names[kNumNames][32];
+    const char* pNames[kNumNames];
+    FlatTable flatNames;
+    ChainedTable chainedNames;
+    chainedNames.Init(32);
+    for (int i = 0; i < kNumNames; i++)
+    {
+        snprintf(names[i], sizeof(names[i]), "uUniformName%d", i);
+        pNames[i] = names[i];
+
+        Uniform u = { i, 0 };
+        flatNames.Insert(pNames[i], u);
+        chainedNames.Insert(pNames[i], u);
+    }
+    printf("%d uniform names: chained %6.1fns, flat %6.1fns\n", kNumNames,
+           TimeStringLookups(chainedNames, pNames, kNumNames, 1000000),
+           TimeStringLookups(flatNames, pNames, kNumNames, 1000000));
+
+    FlatTable flatKeys;
+    ChainedTable chainedSmall;
+    ChainedTable chainedSized;
+    chainedSmall.Init(32);
+    chainedSized.Init(numKeys);
+    for (int i = 0; i < numKeys; i++)
+    {
+        Uniform u = { i, 0 };
+        flatKeys.Insert(keys[i], u);
+        chainedSmall.Insert(keys[i], u);
+        chainedSized.Insert(keys[i], u);
+    }
+
+    // The Init(32) table walks chains of numKeys/32, so give it fewer lookups
+    size_t numLookups = 4000000;
+    size_t numSmallLookups = numLookups / (numKeys / 32 + 1) + 1;
+    printf("%d integer keys: chained Init(32) %10.1fns, chained Init(%d) %6.1fns, flat %6.1fns\n", numKeys,
+           TimeKeyLookups(chainedSmall, keys, numSmallLookups), numKeys,
+           TimeKeyLookups(chainedSized, keys, numLookups),
+           TimeKeyLookups(flatKeys, keys, numLookups));
+
+    if (gFailures != 0)
+    {
+        printf("%d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
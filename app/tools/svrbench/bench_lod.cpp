@@ -0,0 +1,276 @@
+//=============================================================================
+// FILE: bench_lod.cpp
+//
+//                  Copyright (c) 2016 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+// Builds the level of detail chain of a UV sphere with SvrBuildLodChain and
+// checks it, then checks SvrGeometry::UpdateLod walking away from the sphere
+// and back, and on 1000 copies scattered 2 to 200 units around the viewer.
+// The copies report how many of the full detail triangles they draw.  GL is
+// stubbed out (host/glstub.cpp), nothing is uploaded.
+//
+//  usage: bench_lod [rings]
+//
+// The sphere has 4 * rings^2 triangles, 212 rings is about 180k.
+//=============================================================================
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "svrGeometry.h"
+#include "svrJobs.h"
+#include "svrMeshSimplify.h"
+
+using namespace Svr;
+
+// An eye buffer of 1024 pixels high at 90 degrees
+#define EYE_BUFFER_HEIGHT   1024
+#define EYE_BUFFER_FOV_Y    90.0f
+
+#define NUM_COPIES          1000
+
+static int gFailures = 0;
+
+//-----------------------------------------------------------------------------
+static void Check(bool condition, const char* pWhat)
+//-----------------------------------------------------------------------------
+{
+    if (!condition)
+    {
+        printf("FAIL %s\n", pWhat);
+        gFailures++;
+    }
+}
+
+//-----------------------------------------------------------------------------
+static float Random(float low, float high)
+//-----------------------------------------------------------------------------
+{
+    return low + (high - low) * (float)rand() / (float)RAND_MAX;
+}
+
+// Unit sphere in the SvrObjShape layout: position, normal, texcoord.  The texcoord
+// seam duplicates a column of vertices, the poles are a ring of vertices each.
+//-----------------------------------------------------------------------------
+static void BuildSphere(int rings, std::vector<float>& vertices, std::vector<uint32_t>& indices)
+//-----------------------------------------------------------------------------
+{
+    int segments = rings * 2;
+    for (int r = 0; r <= rings; r++)
+    {
+        float theta = (float)M_PI * r / rings;
+        for (int s = 0; s <= segments; s++)
+        {
+            float phi = 2.0f * (float)M_PI * s / segments;
+            float p[3] = { sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi) };
+            vertices.insert(vertices.end(), p, p + 3);
+            vertices.insert(vertices.end(), p, p + 3);
+            vertices.push_back((float)s / segments);
+            vertices.push_back((float)r / rings);
+        }
+    }
+
+    for (int r = 0; r < rings; r++)
+    {
+        for (int s = 0; s < segments; s++)
+        {
+            uint32_t a = r * (segments + 1) + s;
+            uint32_t b = a + segments + 1;
+            uint32_t quad[6] = { a, a + 1, b, a + 1, b + 1, b };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+static double ElapsedMilli(std::chrono::steady_clock::time_point start)
+//-----------------------------------------------------------------------------
+{
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// Distances at which the level changes moving the sphere out to 400 units, then back
+//-----------------------------------------------------------------------------
+static void RunWalk(SvrGeometry& geometry, int numLods, float lodScale)
+//-----------------------------------------------------------------------------
+{
+    std::vector<float> outward(numLods, 0.0f);
+    std::vector<float> inward(numLods, 0.0f);
+
+    int lod = geometry.UpdateLod(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 1.0f), lodScale);
+    Check(lod == 0, "touching the sphere draws full detail");
+
+    for (int step = 1; step <= 4000; step++)
+    {
+        float distance = 0.1f * step;
+        int next = geometry.UpdateLod(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, distance), lodScale);
+        Check(next >= lod && next <= lod + 1, "walking out only ever coarsens one level at a time");
+        if (next != lod)
+        {
+            outward[next] = distance;
+        }
+        lod = next;
+    }
+
+    for (int step = 4000; step >= 1; step--)
+    {
+        float distance = 0.1f * step;
+        int next = geometry.UpdateLod(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, distance), lodScale);
+        Check(next <= lod && next >= lod - 1, "walking back only ever refines one level at a time");
+        if (next != lod)
+        {
+            inward[lod] = distance;
+        }
+        lod = next;
+    }
+    Check(lod == 0, "back at the sphere draws full detail");
+
+    printf("walk: level switches out at");
+    for (int l = 1; l < numLods; l++)
+    {
+        printf(" %.1f", outward[l]);
+        Check(outward[l] > 0.0f && inward[l] > 0.0f, "every level is used walking out and back");
+        Check(inward[l] < outward[l], "levels switch back closer than they switched out");
+        Check(l == 1 || outward[l] > outward[l - 1], "coarser levels switch further out");
+    }
+    printf(", back at");
+    for (int l = numLods - 1; l > 0; l--)
+    {
+        printf(" %.1f", inward[l]);
+    }
+    printf("\n");
+}
+
+// Copies of the sphere, of radius 1 to 2, spread around the viewer
+//-----------------------------------------------------------------------------
+static void RunScatter(const SvrMeshLod* pLods, int numLods, float lodScale)
+//-----------------------------------------------------------------------------
+{
+    srand(NUM_COPIES);
+    std::vector<SvrGeometry> copies(NUM_COPIES);
+    std::vector<glm::mat4> models(NUM_COPIES);
+    for (int i = 0; i < NUM_COPIES; i++)
+    {
+        copies[i].SetBounds(glm::vec3(-1.0f), glm::vec3(1.0f));
+        copies[i].SetLods(pLods, numLods);
+
+        float distance = Random(2.0f, 200.0f);
+        glm::vec3 direction = glm::normalize(glm::vec3(Random(-1.0f, 1.0f), Random(-0.2f, 0.2f), Random(-1.0f, 1.0f)));
+        models[i] = glm::scale(glm::translate(glm::mat4(1.0f), direction * distance), glm::vec3(Random(1.0f, 2.0f)));
+    }
+
+    glm::vec3 eye(0.0f);
+    uint64_t numTriangles = 0;
+    int numOverLimit = 0;
+    std::vector<int> perLevel(numLods, 0);
+    for (int i = 0; i < NUM_COPIES; i++)
+    {
+        int lod = copies[i].UpdateLod(models[i], eye, lodScale);
+        numTriangles += pLods[lod].numIndices / 3;
+        perLevel[lod]++;
+
+        // The level's error projected from the nearest point of the bounds
+        float scale = glm::length(glm::vec3(models[i][0]));
+        float distance = glm::length(glm::vec3(models[i][3]) - eye) - sqrtf(3.0f) * scale;
+        numOverLimit += (pLods[lod].error * lodScale * scale / distance > SVR_LOD_ERROR_PIXELS) ? 1 : 0;
+    }
+    Check(numOverLimit == 0, "no copy shows more than a pixel of error");
+
+    uint64_t numFull = (uint64_t)NUM_COPIES * (pLods[0].numIndices / 3);
+    Check(numTriangles < numFull, "the copies draw fewer triangles than full detail");
+
+    // Steady state: nothing moves, every call keeps its level
+    int numRuns = 1000;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int r = 0; r < numRuns; r++)
+    {
+        for (int i = 0; i < NUM_COPIES; i++)
+        {
+            copies[i].UpdateLod(models[i], eye, lodScale);
+        }
+    }
+    double updateNano = ElapsedMilli(start) * 1e6 / ((double)numRuns * NUM_COPIES);
+
+    printf("%d copies: %llu of %llu triangles (%.1f%%), per level", NUM_COPIES, (unsigned long long)numTriangles,
+           (unsigned long long)numFull, 100.0 * numTriangles / numFull);
+    for (int l = 0; l < numLods; l++)
+    {
+        printf(" %d", perLevel[l]);
+    }
+    printf(", UpdateLod %.1fns\n", updateNano);
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+//-----------------------------------------------------------------------------
+{
+    int rings = (argc > 1) ? atoi(argv[1]) : 212;
+    if (rings < 4)
+    {
+        printf("usage: bench_lod [rings]\n");
+        return 1;
+    }
+
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    BuildSphere(rings, vertices, indices);
+    size_t numVertices = vertices.size() / 8;
+    uint32_t numIndices = (uint32_t)indices.size();
+
+    SvrMeshLod lods[SVR_MESH_MAX_LODS];
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    int numLods = SvrBuildLodChain(indices, 0, numIndices, &vertices[0], numVertices, 8 * sizeof(float),
+                                   SVR_LOD_DEFAULT_COUNT, lods);
+    double buildMilli = ElapsedMilli(start);
+
+    printf("%u triangles, chain built in %.1fms:", numIndices / 3, buildMilli);
+    for (int l = 0; l < numLods; l++)
+    {
+        printf(" %u (%.2f%%)", lods[l].numIndices / 3, 50.0f * lods[l].error);
+    }
+    printf("\n");
+
+    Check(numLods == SVR_LOD_DEFAULT_COUNT, "the sphere gets every level");
+    for (int l = 0; l < numLods; l++)
+    {
+        int numDegenerate = 0;
+        for (uint32_t i = lods[l].firstIndex; i < lods[l].firstIndex + lods[l].numIndices; i += 3)
+        {
+            uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+            numDegenerate += (a == b || b == c || a == c) ? 1 : 0;
+            Check(a < numVertices && b < numVertices && c < numVertices, "levels index the shared vertices");
+        }
+        Check(numDegenerate == 0, "levels have no degenerate triangles");
+        if (l > 0)
+        {
+            Check(lods[l].numIndices < lods[l - 1].numIndices * SVR_LOD_MIN_REDUCTION, "each level reduces the one before");
+            Check(lods[l].error >= lods[l - 1].error, "errors grow level by level");
+        }
+        // Within a tenth of the radius, the sphere is still a sphere
+        Check(lods[l].error < 0.1f, "levels stay close to the surface");
+    }
+
+    float lodScale = SvrGeometry::GetLodProjectionScale(EYE_BUFFER_HEIGHT, EYE_BUFFER_FOV_Y);
+    SvrGeometry sphere;
+    sphere.SetBounds(glm::vec3(-1.0f), glm::vec3(1.0f));
+    sphere.SetLods(lods, numLods);
+    RunWalk(sphere, numLods, lodScale);
+    RunScatter(lods, numLods, lodScale);
+
+    SvrShutdownJobs();
+
+    if (gFailures != 0)
+    {
+        printf("%d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,258 @@
+//=============================================================================
+// FILE: bench_map.cpp
+//
+//                  Copyright (c) 2016 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+// Checks Map's subtree sizes against std::set through random inserts and
+// removes, then times rank (GetIndex) and select (operator[]) from 10^3
+// elements up to the given size.  The walk column is what select cost before
+// the sizes were tracked: stepping Next() from First() index times.
+//
+//  usage: bench_map [maxElements]
+//=============================================================================
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <set>
+#include <vector>
+
+#include "svrContainers.h"
+
+struct Element : public MapElement<Element>
+{
+    typedef int KeyType;
+
+    int mKey;
+
+    Element(int key) : mKey(key) {}
+
+    int GetKey() const
+    {
+        return mKey;
+    }
+};
+
+static int gFailures = 0;
+
+//-----------------------------------------------------------------------------
+static void Check(bool condition, const char* pWhat, long size)
+//-----------------------------------------------------------------------------
+{
+    if (!condition)
+    {
+        printf("FAIL %s: %ld elements\n", pWhat, size);
+        gFailures++;
+    }
+}
+
+// Returns the subtree's element count, failing if it is out of AVL balance
+//-----------------------------------------------------------------------------
+static long CheckSubtree(const Element* pNode, int* pHeight)
+//-----------------------------------------------------------------------------
+{
+    if (pNode == NULL)
+    {
+        *pHeight = 0;
+        return 0;
+    }
+
+    int leftHeight, rightHeight;
+    long count = CheckSubtree(pNode->GetLeftSubnode(), &leftHeight) + CheckSubtree(pNode->GetRightSubnode(), &rightHeight) + 1;
+    Check(abs(leftHeight - rightHeight) <= 1, "balanced", count);
+    *pHeight = ((leftHeight > rightHeight) ? leftHeight : rightHeight) + 1;
+    return count;
+}
+
+//-----------------------------------------------------------------------------
+static void CheckAgainstSet(const Map<Element>& map, const std::set<int>& reference)
+//-----------------------------------------------------------------------------
+{
+    long size = (long)reference.size();
+    int height;
+    Check(CheckSubtree(map.GetRootNode(), &height) == size, "tree size", size);
+    Check(map.GetElementCount() == size, "element count", size);
+
+    long index = 0;
+    Element* pElement = map.First();
+    for (std::set<int>::const_iterator it = reference.begin(); it != reference.end(); ++it, index++)
+    {
+        if (pElement == NULL || pElement->mKey != *it || map[index] != pElement || map.GetIndex(pElement) != index)
+        {
+            Check(false, "rank and select match the key order", size);
+            return;
+        }
+        pElement = pElement->Next();
+    }
+}
+
+//-----------------------------------------------------------------------------
+static void RunChecks(int numKeys)
+//-----------------------------------------------------------------------------
+{
+    std::vector<Element*> elements;
+    for (int i = 0; i < numKeys; i++)
+    {
+        elements.push_back(new Element(i));
+    }
+
+    // Random inserts and removes exercise every rotation's size update
+    Map<Element> map;
+    std::set<int> reference;
+    srand(1);
+    for (int i = 0; i < numKeys * 10; i++)
+    {
+        int key = rand() % numKeys;
+        if (reference.count(key) != 0)
+        {
+            map.Remove(elements[key]);
+            reference.erase(key);
+        }
+        else
+        {
+            map.Insert(elements[key]);
+            reference.insert(key);
+        }
+    }
+    CheckAgainstSet(map, reference);
+
+    if (!reference.empty())
+    {
+        int middle = *reference.begin() + (*reference.rbegin() - *reference.begin()) / 2;
+        std::set<int>::const_iterator lower = reference.lower_bound(middle);
+        std::set<int>::const_iterator upper = reference.upper_bound(middle);
+        Check(map.LowerBound(middle) == ((lower != reference.end()) ? elements[*lower] : NULL), "lower bound", numKeys);
+        Check(map.UpperBound(middle) == ((upper != reference.end()) ? elements[*upper] : NULL), "upper bound", numKeys);
+    }
+    map.RemoveAll();
+
+    // A built tree has to stay consistent once it is edited
+    map.BuildFromSorted(&elements[0], numKeys);
+    reference.clear();
+    for (int i = 0; i < numKeys; i++)
+    {
+        reference.insert(i);
+    }
+    CheckAgainstSet(map, reference);
+
+    for (int i = 0; i < numKeys; i += 3)
+    {
+        map.Remove(elements[i]);
+        reference.erase(i);
+    }
+    for (int i = 0; i < numKeys; i += 6)
+    {
+        map.Insert(elements[i]);
+        reference.insert(i);
+    }
+    CheckAgainstSet(map, reference);
+    map.RemoveAll();
+
+    for (int i = 0; i < numKeys; i++)
+    {
+        delete elements[i];
+    }
+}
+
+//-----------------------------------------------------------------------------
+static double ElapsedNano(std::chrono::steady_clock::time_point start, long count)
+//-----------------------------------------------------------------------------
+{
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / count;
+}
+
+//-----------------------------------------------------------------------------
+static void RunTimings(long numElements)
+//-----------------------------------------------------------------------------
+{
+    std::vector<Element*> elements;
+    for (long i = 0; i < numElements; i++)
+    {
+        elements.push_back(new Element((int)i));
+    }
+
+    const long numQueries = 1000000;
+    std::vector<long> queries(numQueries);
+    srand(2);
+    for (long i = 0; i < numQueries; i++)
+    {
+        queries[i] = ((long)rand() * RAND_MAX + rand()) % numElements;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Map<Element> map;
+    map.BuildFromSorted(&elements[0], numElements);
+    double buildNano = ElapsedNano(start, numElements);
+
+    long sum = 0;
+    start = std::chrono::steady_clock::now();
+    for (long i = 0; i < numQueries; i++)
+    {
+        sum += map[queries[i]]->mKey;
+    }
+    double selectNano = ElapsedNano(start, numQueries);
+
+    start = std::chrono::steady_clock::now();
+    for (long i = 0; i < numQueries; i++)
+    {
+        sum += map.GetIndex(elements[queries[i]]);
+    }
+    double rankNano = ElapsedNano(start, numQueries);
+
+    // The linear walk is O(n) a query, so only time enough of them to get a figure
+    long numWalks = 100000000 / numElements;
+    numWalks = (numWalks < 10) ? 10 : numWalks;
+    start = std::chrono::steady_clock::now();
+    for (long i = 0; i < numWalks; i++)
+    {
+        Element* pElement = map.First();
+        for (long step = queries[i % numQueries]; step > 0; step--)
+        {
+            pElement = pElement->Next();
+        }
+        sum += pElement->mKey;
+    }
+    double walkNano = ElapsedNano(start, numWalks);
+
+    printf("%8ld elements: build %6.1fns/element, select %6.1fns, rank %6.1fns, walk %10.1fns (%ld)\n",
+           numElements, buildNano, selectNano, rankNano, walkNano, sum & 1);
+
+    map.RemoveAll();
+    for (long i = 0; i < numElements; i++)
+    {
+        delete elements[i];
+    }
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+//-----------------------------------------------------------------------------
+{
+    long maxElements = (argc > 1) ? atol(argv[1]) : 1000000;
+    if (maxElements < 1000)
+    {
+        printf("usage: bench_map [maxElements >= 1000]\n");
+        return 1;
+    }
+
+    static const int checkSizes[] = { 1, 2, 7, 100, 20000 };
+    for (size_t i = 0; i < sizeof(checkSizes) / sizeof(checkSizes[0]); i++)
+    {
+        RunChecks(checkSizes[i]);
+    }
+
+    for (long numElements = 1000; numElements <= maxElements; numElements *= 10)
+    {
+        RunTimings(numElements);
+    }
+
+    if (gFailures != 0)
+    {
+        printf("%d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,218 @@
+//=============================================================================
+// FILE: bench_meshopt.cpp
+//
+//                  Copyright (c) 2016 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+// Runs the svrMeshOptimizer.h passes in the order the importers do (vertex
+// cache, overdraw, vertex fetch) on a grid wrapped into a tube, its triangles
+// shuffled, with a few vertices no triangle uses.  Each pass has to keep the
+// same triangles, winding included (after the fetch pass by vertex contents,
+// as it renumbers them), and none may leave ACMR worse than the shuffled input.
+// The cache pass also has to give the same result in place.
+//
+//  usage: bench_meshopt [gridSize]
+//=============================================================================
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "svrMeshOptimizer.h"
+
+using namespace Svr;
+
+// Position and texcoord
+#define VERTEX_FLOATS   5
+
+// Vertices appended after the grid that no triangle uses
+#define NUM_UNUSED      7
+
+// One triangle by the contents of its vertices, rotated so the smallest comes first
+struct Triangle
+{
+    float   corners[3][VERTEX_FLOATS];
+
+    bool operator<(const Triangle& other) const
+    {
+        return memcmp(corners, other.corners, sizeof(corners)) < 0;
+    }
+    bool operator==(const Triangle& other) const
+    {
+        return memcmp(corners, other.corners, sizeof(corners)) == 0;
+    }
+};
+
+static int gFailures = 0;
+
+//-----------------------------------------------------------------------------
+static void Check(bool condition, const char* pWhat)
+//-----------------------------------------------------------------------------
+{
+    if (!condition)
+    {
+        printf("FAIL %s\n", pWhat);
+        gFailures++;
+    }
+}
+
+//-----------------------------------------------------------------------------
+static double ElapsedMilli(std::chrono::steady_clock::time_point start)
+//-----------------------------------------------------------------------------
+{
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// Sorted triangles of an index list, comparable across vertex renumbering
+//-----------------------------------------------------------------------------
+static std::vector<Triangle> GetTriangles(const std::vector<uint32_t>& indices, const std::vector<float>& vertices)
+//-----------------------------------------------------------------------------
+{
+    std::vector<Triangle> triangles(indices.size() / 3);
+    for (size_t t = 0; t < triangles.size(); t++)
+    {
+        const float* pCorners[3];
+        for (int k = 0; k < 3; k++)
+        {
+            pCorners[k] = &vertices[indices[t * 3 + k] * VERTEX_FLOATS];
+        }
+
+        int first = 0;
+        for (int k = 1; k < 3; k++)
+        {
+            if (memcmp(pCorners[k], pCorners[first], VERTEX_FLOATS * sizeof(float)) < 0)
+            {
+                first = k;
+            }
+        }
+        for (int k = 0; k < 3; k++)
+        {
+            memcpy(triangles[t].corners[k], pCorners[(first + k) % 3], VERTEX_FLOATS * sizeof(float));
+        }
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+//-----------------------------------------------------------------------------
+{
+    int gridSize = (argc > 1) ? atoi(argv[1]) : 300;
+    if (gridSize < 2)
+    {
+        printf("usage: bench_meshopt [gridSize]\n");
+        return 1;
+    }
+
+    // Every vertex distinct, so triangles compare by contents alone
+    std::vector<float> vertices;
+    for (int y = 0; y <= gridSize; y++)
+    {
+        for (int x = 0; x <= gridSize; x++)
+        {
+            float u = (float)x / gridSize;
+            float v = (float)y / gridSize;
+            float vertex[VERTEX_FLOATS] = { cosf(u * 6.0f), sinf(u * 6.0f), v, u, v };
+            vertices.insert(vertices.end(), vertex, vertex + VERTEX_FLOATS);
+        }
+    }
+    for (int i = 0; i < NUM_UNUSED; i++)
+    {
+        float vertex[VERTEX_FLOATS] = { 10.0f + i, 0.0f, 0.0f, 0.0f, 0.0f };
+        vertices.insert(vertices.end(), vertex, vertex + VERTEX_FLOATS);
+    }
+    size_t numVertices = vertices.size() / VERTEX_FLOATS;
+    size_t numUsed = numVertices - NUM_UNUSED;
+
+    std::vector<uint32_t> shuffled;
+    for (int y = 0; y < gridSize; y++)
+    {
+        for (int x = 0; x < gridSize; x++)
+        {
+            uint32_t a = y * (gridSize + 1) + x;
+            uint32_t c = a + gridSize + 1;
+            uint32_t quad[6] = { a, c, a + 1, a + 1, c, c + 1 };
+            shuffled.insert(shuffled.end(), quad, quad + 6);
+        }
+    }
+
+    srand(3);
+    size_t numTriangles = shuffled.size() / 3;
+    for (size_t i = numTriangles - 1; i > 0; i--)
+    {
+        size_t j = ((size_t)rand() * RAND_MAX + rand()) % (i + 1);
+        for (int k = 0; k < 3; k++)
+        {
+            std::swap(shuffled[i * 3 + k], shuffled[j * 3 + k]);
+        }
+    }
+
+    size_t numIndices = shuffled.size();
+    std::vector<Triangle> reference = GetTriangles(shuffled, vertices);
+    float shuffledAcmr = SvrAnalyzeVertexCache(&shuffled[0], numIndices, numVertices).acmr;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<uint32_t> cache(numIndices);
+    SvrOptimizeVertexCache(&cache[0], &shuffled[0], numIndices, numVertices);
+    double cacheMilli = ElapsedMilli(start);
+    float cacheAcmr = SvrAnalyzeVertexCache(&cache[0], numIndices, numVertices).acmr;
+    Check(GetTriangles(cache, vertices) == reference, "the cache pass keeps the triangles");
+    Check(cacheAcmr <= shuffledAcmr, "the cache pass does not raise ACMR");
+
+    std::vector<uint32_t> inPlace = shuffled;
+    SvrOptimizeVertexCache(&inPlace[0], &inPlace[0], numIndices, numVertices);
+    Check(inPlace == cache, "the cache pass gives the same order in place");
+
+    start = std::chrono::steady_clock::now();
+    std::vector<uint32_t> overdraw(numIndices);
+    SvrOptimizeOverdraw(&overdraw[0], &cache[0], numIndices, &vertices[0], numVertices, VERTEX_FLOATS * sizeof(float));
+    double overdrawMilli = ElapsedMilli(start);
+    float overdrawAcmr = SvrAnalyzeVertexCache(&overdraw[0], numIndices, numVertices).acmr;
+    Check(GetTriangles(overdraw, vertices) == reference, "the overdraw pass keeps the triangles");
+    Check(overdrawAcmr <= shuffledAcmr, "the overdraw pass does not raise ACMR over the input");
+    Check(overdrawAcmr <= cacheAcmr * SVR_OVERDRAW_THRESHOLD, "the overdraw pass stays within its threshold");
+
+    start = std::chrono::steady_clock::now();
+    std::vector<uint32_t> fetch = overdraw;
+    std::vector<float> fetchVertices(vertices.size());
+    size_t numFetched = SvrOptimizeVertexFetch(&fetchVertices[0], &fetch[0], numIndices, &vertices[0], numVertices,
+                                               VERTEX_FLOATS * sizeof(float));
+    double fetchMilli = ElapsedMilli(start);
+    fetchVertices.resize(numFetched * VERTEX_FLOATS);
+    Check(numFetched == numUsed, "the fetch pass drops exactly the unused vertices");
+
+    uint32_t nextNew = 0;
+    bool firstUseOrder = true;
+    for (size_t i = 0; i < numIndices; i++)
+    {
+        firstUseOrder &= (fetch[i] <= nextNew);
+        if (fetch[i] == nextNew)
+        {
+            nextNew++;
+        }
+    }
+    Check(firstUseOrder, "the fetch pass numbers vertices in order of first use");
+    Check(GetTriangles(fetch, fetchVertices) == reference, "the fetch pass keeps the triangles");
+
+    float fetchAcmr = SvrAnalyzeVertexCache(&fetch[0], numIndices, numFetched).acmr;
+    Check(fetchAcmr == overdrawAcmr, "the fetch pass leaves ACMR alone");
+
+    printf("%zu triangles, ACMR shuffled %.3f, cache %.3f (%.1fms), overdraw %.3f (%.1fms), "
+           "fetch %.3f with %zu of %zu vertices (%.1fms)\n",
+           numTriangles, shuffledAcmr, cacheAcmr, cacheMilli, overdrawAcmr, overdrawMilli,
+           fetchAcmr, numFetched, numVertices, fetchMilli);
+
+    if (gFailures != 0)
+    {
+        printf("%d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
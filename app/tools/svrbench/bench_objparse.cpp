@@ -0,0 +1,356 @@
+//=============================================================================
+// FILE: bench_objparse.cpp
+//
+//                  Copyright (c) 2016 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+// Checks SvrParseObjFloat against strtof bit for bit on random floats printed
+// the ways exporters write them, and SvrParseObj with forced small chunks
+// against a single chunk: the parsed pools and groups have to hash the same.
+//
+// Then times the parse of a generated OBJ of the given size on 1 to maxThreads
+// threads.  The job pool sizes itself to the device, so for the scaling each
+// thread parses its own slice of the file with SvrParseObj (the file is made of
+// blocks that only index their own vertices, so any block aligned slice is an
+// OBJ of its own), which leaves out only the concatenation.  The pool's own
+// SvrParseObj time is printed after.
+//
+//  usage: bench_objparse [megabytes] [maxThreads] [floats]
+//=============================================================================
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "svrJobs.h"
+#include "svrObjImport.h"
+
+using namespace Svr;
+
+// Quads per block, a block is a strip of vertices and the faces between them
+#define BLOCK_QUADS     64
+
+// Blocks per group, groups run across chunk boundaries
+#define GROUP_BLOCKS    16
+
+// OBJ parsed with forced chunks down to a byte
+#define CHUNK_TEST_SIZE (256 * 1024)
+
+static int gFailures = 0;
+
+//-----------------------------------------------------------------------------
+static void Check(bool condition, const char* pWhat)
+//-----------------------------------------------------------------------------
+{
+    if (!condition)
+    {
+        printf("FAIL %s\n", pWhat);
+        gFailures++;
+    }
+}
+
+//-----------------------------------------------------------------------------
+static float Random(float low, float high)
+//-----------------------------------------------------------------------------
+{
+    return low + (high - low) * (float)rand() / (float)RAND_MAX;
+}
+
+//-----------------------------------------------------------------------------
+static double ElapsedMilli(std::chrono::steady_clock::time_point start)
+//-----------------------------------------------------------------------------
+{
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// Any finite float, every exponent equally likely
+//-----------------------------------------------------------------------------
+static float RandomBits()
+//-----------------------------------------------------------------------------
+{
+    uint32_t bits;
+    do
+    {
+        bits = ((uint32_t)rand() << 16) ^ (uint32_t)rand() ^ ((uint32_t)rand() << 31);
+    } while ((bits & 0x7f800000) == 0x7f800000);
+
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+//-----------------------------------------------------------------------------
+static void TestFloats(int numValues)
+//-----------------------------------------------------------------------------
+{
+    // Fixed point as most exporters write, shortest round trip, C defaults, exponents
+    static const char* formats[] = { "%.6f", "%.9g", "%g", "%.4e", "%+.7f", "%.17g", "%.0f", "%.12f" };
+    const int numFormats = sizeof(formats) / sizeof(formats[0]);
+
+    int numMismatches = 0;
+    int numBadEnds = 0;
+    char text[512];
+    for (int i = 0; i < numValues; i++)
+    {
+        // Half anywhere in range, half the sizes meshes have
+        float value = (i & 1) ? RandomBits() : Random(-1000.0f, 1000.0f);
+        const char* pFormat = formats[i % numFormats];
+        snprintf(text, sizeof(text) - 2, pFormat, (double)value);
+
+        // Must stop at the space, the newline after it is the next line's
+        strcat(text, " \n");
+        const char* pText = text;
+        float parsed = SvrParseObjFloat(pText);
+
+        char* pEnd;
+        float reference = strtof(text, &pEnd);
+        if (memcmp(&parsed, &reference, sizeof(float)) != 0)
+        {
+            if (numMismatches < 5)
+            {
+                printf("  %s parsed as %.9g, strtof %.9g\n", text, parsed, reference);
+            }
+            numMismatches++;
+        }
+        numBadEnds += (pText != pEnd) ? 1 : 0;
+    }
+
+    static const char* specials[] = { "0", "-0", "+0.0", "1", "-1.5e3", "1E-3", "2.5e+2", ".5", "-.25", "5.",
+                                       "3.4028235e38", "1.17549435e-38", "1.4e-45", "1e-50", "1e50",
+                                       "0.1000000000000000000000000001", "123456789012345678901234567890" };
+    for (size_t i = 0; i < sizeof(specials) / sizeof(specials[0]); i++)
+    {
+        const char* pText = specials[i];
+        float parsed = SvrParseObjFloat(pText);
+        float reference = strtof(specials[i], NULL);
+        if (memcmp(&parsed, &reference, sizeof(float)) != 0)
+        {
+            printf("  %s parsed as %.9g, strtof %.9g\n", specials[i], parsed, reference);
+            numMismatches++;
+        }
+        numBadEnds += (*pText != '\0') ? 1 : 0;
+    }
+
+    Check(numMismatches == 0, "SvrParseObjFloat matches strtof bit for bit");
+    Check(numBadEnds == 0, "SvrParseObjFloat stops where strtof does");
+    printf("%d floats in %d formats: %d differ from strtof\n", numValues, numFormats, numMismatches);
+}
+
+// Blocks of BLOCK_QUADS quads, every face indexing its own block with negative
+// indices.  Corners mix v, v/vt, v//vn and v/vt/vn, some faces are quads.
+//-----------------------------------------------------------------------------
+static void BuildObj(size_t minSize, std::string& text, std::vector<size_t>& blockStarts)
+//-----------------------------------------------------------------------------
+{
+    srand(42);
+    char line[256];
+    for (int block = 0; text.size() < minSize; block++)
+    {
+        blockStarts.push_back(text.size());
+        if (block % GROUP_BLOCKS == 0)
+        {
+            snprintf(line, sizeof(line), "g part%d\n# strip of %d quads\n\n", block / GROUP_BLOCKS, BLOCK_QUADS);
+            text += line;
+        }
+
+        const int numVertices = 2 * (BLOCK_QUADS + 1);
+        for (int v = 0; v < numVertices; v++)
+        {
+            snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvt %.5f %.5f\nvn %.4f %.4f %.4f\n",
+                     Random(-100.0f, 100.0f), Random(-100.0f, 100.0f), Random(-100.0f, 100.0f),
+                     Random(0.0f, 1.0f), Random(0.0f, 1.0f), Random(-1.0f, 1.0f), Random(-1.0f, 1.0f), Random(-1.0f, 1.0f));
+            text += line;
+        }
+
+        for (int q = 0; q < BLOCK_QUADS; q++)
+        {
+            int a = -numVertices + 2 * q;
+            int corners[4] = { a, a + 1, a + 3, a + 2 };
+            switch (q % 4)
+            {
+            case 0:
+                snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n",
+                         corners[0], corners[0], corners[0], corners[1], corners[1], corners[1],
+                         corners[2], corners[2], corners[2], corners[3], corners[3], corners[3]);
+                break;
+            case 1:
+                snprintf(line, sizeof(line), "f %d//%d %d//%d %d//%d\nf %d//%d %d//%d %d//%d\n",
+                         corners[0], corners[0], corners[1], corners[1], corners[2], corners[2],
+                         corners[0], corners[0], corners[2], corners[2], corners[3], corners[3]);
+                break;
+            case 2:
+                snprintf(line, sizeof(line), "f %d/%d %d/%d %d/%d %d/%d\n",
+                         corners[0], corners[0], corners[1], corners[1], corners[2], corners[2], corners[3], corners[3]);
+                break;
+            default:
+                snprintf(line, sizeof(line), "f %d %d %d\nf %d %d %d\n",
+                         corners[0], corners[1], corners[2], corners[0], corners[2], corners[3]);
+                break;
+            }
+            text += line;
+        }
+    }
+    blockStarts.push_back(text.size());
+}
+
+//-----------------------------------------------------------------------------
+static uint64_t HashBytes(uint64_t hash, const void* pData, size_t size)
+//-----------------------------------------------------------------------------
+{
+    const unsigned char* p = (const unsigned char*)pData;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ p[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+//-----------------------------------------------------------------------------
+static uint64_t HashObj(const SvrObjData& obj)
+//-----------------------------------------------------------------------------
+{
+    uint64_t hash = 14695981039346656037ull;
+    hash = HashBytes(hash, obj.positions.data(), obj.positions.size() * sizeof(float));
+    hash = HashBytes(hash, obj.texcoords.data(), obj.texcoords.size() * sizeof(float));
+    hash = HashBytes(hash, obj.normals.data(), obj.normals.size() * sizeof(float));
+    for (size_t g = 0; g < obj.groups.size(); g++)
+    {
+        const SvrObjGroup& group = obj.groups[g];
+        hash = HashBytes(hash, group.name.c_str(), group.name.size() + 1);
+        hash = HashBytes(hash, group.corners.data(), group.corners.size() * sizeof(SvrObjCorner));
+    }
+    return hash;
+}
+
+//-----------------------------------------------------------------------------
+static void TestChunks(const std::string& text)
+//-----------------------------------------------------------------------------
+{
+    SvrObjData single;
+    bool parsed = SvrParseObj(text.data(), text.size(), single, text.size() + 1);
+    Check(parsed, "the generated OBJ parses");
+    uint64_t reference = HashObj(single);
+
+    // Down to chunks shorter than a line, which end up empty
+    static const size_t chunkSizes[] = { 0, 65536, 4099, 256, 17, 1 };
+    for (size_t i = 0; i < sizeof(chunkSizes) / sizeof(chunkSizes[0]); i++)
+    {
+        SvrObjData chunked;
+        bool chunkedParsed = SvrParseObj(text.data(), text.size(), chunked, chunkSizes[i]);
+        Check(chunkedParsed && HashObj(chunked) == reference, "chunked parses hash the same as a single chunk");
+    }
+    printf("%zu bytes, %zu groups, %zu positions: single chunk hash %016llx\n", text.size(), single.groups.size(),
+           single.positions.size() / 3, (unsigned long long)reference);
+}
+
+struct Slice
+{
+    const char*     pBegin;
+    size_t          size;
+    bool            parsed;
+};
+
+//-----------------------------------------------------------------------------
+static void ParseSlice(Slice* pSlice)
+//-----------------------------------------------------------------------------
+{
+    SvrObjData obj;
+    pSlice->parsed = SvrParseObj(pSlice->pBegin, pSlice->size, obj, pSlice->size + 1);
+}
+
+//-----------------------------------------------------------------------------
+static void RunScaling(const std::string& text, const std::vector<size_t>& blockStarts, int maxThreads)
+//-----------------------------------------------------------------------------
+{
+    size_t numBlocks = blockStarts.size() - 1;
+    double oneThreadMilli = 0.0;
+    for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+    {
+        std::vector<Slice> slices(numThreads);
+        for (int t = 0; t < numThreads; t++)
+        {
+            size_t first = blockStarts[numBlocks * t / numThreads];
+            size_t last = blockStarts[numBlocks * (t + 1) / numThreads];
+            slices[t].pBegin = text.data() + first;
+            slices[t].size = last - first;
+            slices[t].parsed = false;
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int t = 1; t < numThreads; t++)
+        {
+            threads.push_back(std::thread(ParseSlice, &slices[t]));
+        }
+        ParseSlice(&slices[0]);
+        for (size_t t = 0; t < threads.size(); t++)
+        {
+            threads[t].join();
+        }
+        double milli = ElapsedMilli(start);
+
+        bool allParsed = true;
+        for (int t = 0; t < numThreads; t++)
+        {
+            allParsed &= slices[t].parsed;
+        }
+        Check(allParsed, "every block aligned slice parses");
+
+        if (numThreads == 1)
+        {
+            oneThreadMilli = milli;
+        }
+        printf("%d thread%s: %7.1fms, %6.1f MB/s, %4.2fx\n", numThreads, (numThreads == 1) ? " " : "s", milli,
+               text.size() / (milli * 1000.0), oneThreadMilli / milli);
+    }
+
+    SvrObjData obj;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    SvrParseObj(text.data(), text.size(), obj);
+    double poolMilli = ElapsedMilli(start);
+    printf("SvrParseObj on the job pool of %d: %7.1fms, %6.1f MB/s\n", SvrGetJobThreadCount(), poolMilli,
+           text.size() / (poolMilli * 1000.0));
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+//-----------------------------------------------------------------------------
+{
+    double megabytes = (argc > 1) ? atof(argv[1]) : 64.0;
+    int maxThreads = (argc > 2) ? atoi(argv[2]) : 8;
+    int numFloats = (argc > 3) ? atoi(argv[3]) : 1000000;
+    if (megabytes <= 0.0 || maxThreads < 1 || numFloats < 0)
+    {
+        printf("usage: bench_objparse [megabytes] [maxThreads] [floats]\n");
+        return 1;
+    }
+
+    srand(1);
+    TestFloats(numFloats);
+
+    // Chunks of a byte or two cost more than their text, so they get a small file
+    std::string text;
+    std::vector<size_t> blockStarts;
+    BuildObj(CHUNK_TEST_SIZE, text, blockStarts);
+    TestChunks(text);
+
+    text.clear();
+    blockStarts.clear();
+    BuildObj((size_t)(megabytes * 1e6), text, blockStarts);
+    RunScaling(text, blockStarts, maxThreads);
+
+    SvrShutdownJobs();
+
+    if (gFailures != 0)
+    {
+        printf("%d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
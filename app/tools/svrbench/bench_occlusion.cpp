@@ -0,0 +1,288 @@
+//=============================================================================
+// FILE: bench_occlusion.cpp
+//
+//                  Copyright (c) 2016 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+// Indoor scene for SvrOcclusionBuffer: 10x10 rooms of 10m with a door gap in
+// every wall, the 440 wall boxes as occluders, and objects scattered through
+// the rooms.  From a corner room the view turns a full circle in 36 steps,
+// each frame frustum culls the objects then filters them through the buffer.
+//
+// Culling has to be conservative: every culled object gets 64 random points of
+// its box tested against the walls with a segment from the eye, and a single
+// point in view that no wall hides is a failure.  Reports the share of the
+// frustum survivors occlusion removes and the setup, raster and test times.
+//
+//  usage: bench_occlusion [numObjects] [parallel]
+//=============================================================================
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "svrJobs.h"
+#include "svrOcclusion.h"
+
+using namespace Svr;
+
+#define NUM_ROOMS           10
+#define ROOM_SIZE           10.0f
+#define WALL_HEIGHT         3.0f
+#define WALL_THICKNESS      0.2f
+#define DOOR_BEGIN          4.0f
+#define DOOR_END            5.5f
+
+#define NUM_VIEWS           36
+#define NUM_SAMPLES         64
+
+struct Box
+{
+    glm::vec3   boxMin;
+    glm::vec3   boxMax;
+};
+
+static int gFailures = 0;
+
+//-----------------------------------------------------------------------------
+static void Check(bool condition, const char* pWhat)
+//-----------------------------------------------------------------------------
+{
+    if (!condition)
+    {
+        printf("FAIL %s\n", pWhat);
+        gFailures++;
+    }
+}
+
+//-----------------------------------------------------------------------------
+static float Random(float low, float high)
+//-----------------------------------------------------------------------------
+{
+    return low + (high - low) * (float)rand() / (float)RAND_MAX;
+}
+
+// Two boxes per wall, either side of the door
+//-----------------------------------------------------------------------------
+static void BuildWalls(std::vector<Box>& walls)
+//-----------------------------------------------------------------------------
+{
+    float halfThickness = 0.5f * WALL_THICKNESS;
+    float origin = -0.5f * NUM_ROOMS * ROOM_SIZE;
+    for (int line = 0; line <= NUM_ROOMS; line++)
+    {
+        for (int room = 0; room < NUM_ROOMS; room++)
+        {
+            float across = origin + line * ROOM_SIZE;
+            float along = origin + room * ROOM_SIZE;
+
+            Box north = { glm::vec3(across - halfThickness, 0.0f, along),
+                          glm::vec3(across + halfThickness, WALL_HEIGHT, along + DOOR_BEGIN) };
+            Box south = { glm::vec3(across - halfThickness, 0.0f, along + DOOR_END),
+                          glm::vec3(across + halfThickness, WALL_HEIGHT, along + ROOM_SIZE) };
+            Box west = { glm::vec3(along, 0.0f, across - halfThickness),
+                         glm::vec3(along + DOOR_BEGIN, WALL_HEIGHT, across + halfThickness) };
+            Box east = { glm::vec3(along + DOOR_END, 0.0f, across - halfThickness),
+                         glm::vec3(along + ROOM_SIZE, WALL_HEIGHT, across + halfThickness) };
+            walls.push_back(north);
+            walls.push_back(south);
+            walls.push_back(west);
+            walls.push_back(east);
+        }
+    }
+}
+
+// Whether the segment from start to end passes through the box before it reaches end
+//-----------------------------------------------------------------------------
+static bool SegmentHitsBox(const glm::vec3& start, const glm::vec3& end, const Box& box)
+//-----------------------------------------------------------------------------
+{
+    glm::vec3 direction = end - start;
+    float enter = 0.0f;
+    float leave = 1.0f;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (fabsf(direction[axis]) < 1e-9f)
+        {
+            if (start[axis] < box.boxMin[axis] || start[axis] > box.boxMax[axis])
+            {
+                return false;
+            }
+            continue;
+        }
+        float near = (box.boxMin[axis] - start[axis]) / direction[axis];
+        float far = (box.boxMax[axis] - start[axis]) / direction[axis];
+        if (near > far)
+        {
+            std::swap(near, far);
+        }
+        enter = std::max(enter, near);
+        leave = std::min(leave, far);
+        if (enter > leave)
+        {
+            return false;
+        }
+    }
+    return enter < 0.999f;
+}
+
+// Returns the number of culled objects with a point in view that no wall hides
+//-----------------------------------------------------------------------------
+static int CountFalseCulls(const std::vector<Box>& objects, const std::vector<Box>& walls, const glm::vec3& eye,
+                           const glm::mat4& viewProjection, const uint32_t* pCulled, int numCulled)
+//-----------------------------------------------------------------------------
+{
+    int numFalse = 0;
+    for (int i = 0; i < numCulled; i++)
+    {
+        const Box& object = objects[pCulled[i]];
+        for (int sample = 0; sample < NUM_SAMPLES; sample++)
+        {
+            glm::vec3 point(Random(object.boxMin.x, object.boxMax.x),
+                            Random(object.boxMin.y, object.boxMax.y),
+                            Random(object.boxMin.z, object.boxMax.z));
+            glm::vec4 clip = viewProjection * glm::vec4(point, 1.0f);
+            if (clip.w <= 0.0f || fabsf(clip.x) > clip.w || fabsf(clip.y) > clip.w)
+            {
+                continue;
+            }
+
+            bool hidden = false;
+            for (size_t w = 0; w < walls.size() && !hidden; w++)
+            {
+                hidden = SegmentHitsBox(eye, point, walls[w]);
+            }
+            if (!hidden)
+            {
+                numFalse++;
+                break;
+            }
+        }
+    }
+    return numFalse;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+//-----------------------------------------------------------------------------
+{
+    int numObjects = (argc > 1) ? atoi(argv[1]) : 20000;
+    bool parallel = (argc > 2) && atoi(argv[2]) != 0;
+    if (numObjects < 1)
+    {
+        printf("usage: bench_occlusion [numObjects] [parallel]\n");
+        return 1;
+    }
+
+    // Closed unit cube, scaled onto each wall
+    float cubeVertices[8 * 3];
+    for (int i = 0; i < 8; i++)
+    {
+        cubeVertices[i * 3 + 0] = (i & 1) ? 1.0f : 0.0f;
+        cubeVertices[i * 3 + 1] = (i & 2) ? 1.0f : 0.0f;
+        cubeVertices[i * 3 + 2] = (i & 4) ? 1.0f : 0.0f;
+    }
+    static const uint32_t cubeIndices[36] =
+    {
+        0, 2, 1, 1, 2, 3,   4, 5, 6, 5, 7, 6,   0, 1, 4, 1, 5, 4,
+        2, 6, 3, 3, 6, 7,   0, 4, 2, 2, 4, 6,   1, 3, 5, 3, 7, 5,
+    };
+
+    std::vector<Box> walls;
+    BuildWalls(walls);
+
+    std::vector<glm::mat4> wallMatrices(walls.size());
+    for (size_t w = 0; w < walls.size(); w++)
+    {
+        wallMatrices[w] = glm::scale(glm::translate(glm::mat4(1.0f), walls[w].boxMin), walls[w].boxMax - walls[w].boxMin);
+    }
+
+    srand(7);
+    float extent = 0.5f * NUM_ROOMS * ROOM_SIZE;
+    SvrCullScene scene;
+    std::vector<Box> objects(numObjects);
+    for (int i = 0; i < numObjects; i++)
+    {
+        glm::vec3 center(Random(-extent, extent), Random(0.2f, 2.5f), Random(-extent, extent));
+        float halfSize = Random(0.1f, 0.5f);
+        objects[i].boxMin = center - halfSize;
+        objects[i].boxMax = center + halfSize;
+        scene.AddObject(objects[i].boxMin, objects[i].boxMax, sqrtf(3.0f) * halfSize);
+    }
+
+    glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 200.0f);
+    glm::vec3 eye(6.0f - extent, 1.7f, 5.5f - extent);
+
+    SvrOcclusionBuffer occlusion;
+    occlusion.Initialize();
+
+    std::vector<uint32_t> inFrustum(numObjects);
+    std::vector<uint32_t> visible(numObjects);
+    std::vector<uint32_t> culled(numObjects);
+    uint64_t numInFrustum = 0;
+    uint64_t numVisible = 0;
+    int numFalse = 0;
+    float setupMs = 0.0f;
+    float rasterMs = 0.0f;
+    float testMs = 0.0f;
+    for (int view = 0; view < NUM_VIEWS; view++)
+    {
+        float angle = view * 2.0f * (float)M_PI / NUM_VIEWS;
+        glm::mat4 viewMatrix = glm::lookAt(eye, eye + glm::vec3(cosf(angle), 0.0f, sinf(angle)), glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::mat4 viewProjection = projection * viewMatrix;
+
+        SvrFrustum frustum;
+        SvrExtractFrustum(viewProjection, frustum);
+        int numFrustum = scene.Cull(frustum, &inFrustum[0]);
+
+        occlusion.Begin(viewProjection);
+        for (size_t w = 0; w < walls.size(); w++)
+        {
+            occlusion.AddOccluder(cubeVertices, 3 * sizeof(float), 8, cubeIndices, 36, wallMatrices[w]);
+        }
+        occlusion.Rasterize(parallel);
+
+        std::copy(inFrustum.begin(), inFrustum.begin() + numFrustum, visible.begin());
+        int numKept = occlusion.FilterVisible(scene, &visible[0], numFrustum);
+
+        const SvrOcclusionStats& stats = occlusion.GetStats();
+        setupMs += stats.setupMs;
+        rasterMs += stats.rasterMs;
+        testMs += stats.testMs;
+        Check(stats.numTested == (unsigned int)numFrustum && stats.numOccluded == (unsigned int)(numFrustum - numKept),
+              "stats count every object tested and occluded");
+
+        // Kept objects come out in order, and everything else is what was culled
+        Check(std::is_sorted(visible.begin(), visible.begin() + numKept), "FilterVisible keeps the order");
+        int numCulled = (int)(std::set_difference(inFrustum.begin(), inFrustum.begin() + numFrustum,
+                                                  visible.begin(), visible.begin() + numKept, culled.begin()) - culled.begin());
+        Check(numCulled == numFrustum - numKept, "FilterVisible only keeps objects it was given");
+
+        numFalse += CountFalseCulls(objects, walls, eye, viewProjection, &culled[0], numCulled);
+        numInFrustum += numFrustum;
+        numVisible += numKept;
+    }
+    Check(numFalse == 0, "no culled object has a point in view");
+    Check(numVisible * 5 < numInFrustum, "walls hide most of what the frustum keeps");
+
+    printf("%d objects, %zu wall occluders, %d views: %.0f per view in the frustum, %.0f after occlusion "
+           "(%.1f%% culled), %d false culls; setup %.3fms, raster %.3fms%s, test %.3fms per view\n",
+           numObjects, walls.size(), NUM_VIEWS, (double)numInFrustum / NUM_VIEWS, (double)numVisible / NUM_VIEWS,
+           100.0 * (numInFrustum - numVisible) / numInFrustum, numFalse,
+           setupMs / NUM_VIEWS, rasterMs / NUM_VIEWS, parallel ? " on the job pool" : "", testMs / NUM_VIEWS);
+
+    occlusion.Destroy();
+    SvrShutdownJobs();
+
+    if (gFailures != 0)
+    {
+        printf("%d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
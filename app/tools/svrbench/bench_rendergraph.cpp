@@ -0,0 +1,267 @@
+//=============================================================================
+// FILE: bench_rendergraph.cpp
+//
+//                  Copyright (c) 2016 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+// Checks what SvrRenderGraph plans for a stereo VR frame and times declaring
+// and compiling it, then compiling a long chain of post effects with dead
+// branches.  GL is stubbed out (host/glstub.cpp), so Execute only counts the
+// clears and invalidations it would issue.
+//
+//  usage: bench_rendergraph [numFrames] [chainLength] [-dump]
+//
+// -dump prints the compiled VR frame.
+//=============================================================================
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+
+#include <GLES3/gl3.h>
+
+#include "glstub.h"
+#include "svrRenderGraph.h"
+
+using namespace Svr;
+
+static int gFailures = 0;
+static int gPassesRun = 0;
+
+//-----------------------------------------------------------------------------
+static void Check(bool condition, const char* pWhat)
+//-----------------------------------------------------------------------------
+{
+    if (!condition)
+    {
+        printf("FAIL %s\n", pWhat);
+        gFailures++;
+    }
+}
+
+//-----------------------------------------------------------------------------
+static void RunPass(SvrRenderGraph&, void*)
+//-----------------------------------------------------------------------------
+{
+    gPassesRun++;
+}
+
+//-----------------------------------------------------------------------------
+static double ElapsedMicro(std::chrono::steady_clock::time_point start)
+//-----------------------------------------------------------------------------
+{
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// Per eye an MSAA scene drawn opaque then transparent, resolved, and post processed
+// into the eye buffer, then the overlay EGL image, a debug HUD nothing shows, and the
+// blit of both eyes to the window
+//-----------------------------------------------------------------------------
+static void DeclareVrFrame(SvrRenderGraph& graph)
+//-----------------------------------------------------------------------------
+{
+    static const char* eyeNames[2][6] =
+    {
+        { "sceneL", "resolvedL", "eyeL", "Opaque L", "Transparent L", "Post L" },
+        { "sceneR", "resolvedR", "eyeR", "Opaque R", "Transparent R", "Post R" },
+    };
+
+    SvrRenderTargetDesc sceneDesc = { 1024, 1024, 4, GL_RGBA8, true };
+    SvrRenderTargetDesc resolvedDesc = { 1024, 1024, 1, GL_RGBA8, false };
+    SvrRenderTargetDesc debugDesc = { 256, 256, 1, GL_RGBA8, false };
+
+    SvrGraphResource window = graph.ImportTarget("window", 0, 2560, 1440, false);
+    SvrGraphResource overlay = graph.ImportTarget("overlay", 7, 1280, 1440, false);
+
+    SvrGraphResource eyes[2];
+    for (int e = 0; e < 2; e++)
+    {
+        SvrGraphResource scene = graph.CreateTarget(eyeNames[e][0], sceneDesc);
+        SvrGraphResource resolved = graph.CreateTarget(eyeNames[e][1], resolvedDesc);
+        eyes[e] = graph.ImportTarget(eyeNames[e][2], 10 + e, 1024, 1024, false);
+
+        int pass = graph.AddPass(eyeNames[e][3], RunPass, NULL);
+        graph.Write(pass, scene, kAttachmentAll, kAttachmentAll);
+
+        pass = graph.AddPass(eyeNames[e][4], RunPass, NULL);
+        graph.Write(pass, scene, kAttachmentAll);
+
+        pass = graph.AddPass("Resolve", RunPass, NULL);
+        graph.Read(pass, scene);
+        graph.Write(pass, resolved, kAttachmentColor);
+
+        pass = graph.AddPass(eyeNames[e][5], RunPass, NULL);
+        graph.Read(pass, resolved);
+        graph.Write(pass, eyes[e], kAttachmentColor, kAttachmentColor);
+    }
+
+    SvrGraphResource debug = graph.CreateTarget("debug", debugDesc);
+    int pass = graph.AddPass("Debug HUD", RunPass, NULL);
+    graph.Write(pass, debug, kAttachmentColor, kAttachmentColor);
+
+    pass = graph.AddPass("UpdateEglImage", RunPass, NULL);
+    graph.Write(pass, overlay, kAttachmentColor, kAttachmentColor);
+    graph.SetClearValues(pass, glm::vec4(0.45f, 0.2f, 0.45f, 0.5f));
+
+    pass = graph.AddPass("Blit", RunPass, NULL);
+    graph.Read(pass, eyes[0]);
+    graph.Read(pass, eyes[1]);
+    graph.Write(pass, window, kAttachmentColor);
+}
+
+// Effects each reading the one before, with every third one also feeding a pass
+// whose output nothing reads
+//-----------------------------------------------------------------------------
+static void DeclareChain(SvrRenderGraph& graph, int chainLength)
+//-----------------------------------------------------------------------------
+{
+    SvrRenderTargetDesc desc = { 1024, 1024, 1, GL_RGBA16F, false };
+
+    SvrGraphResource window = graph.ImportTarget("window", 0, 2560, 1440, false);
+    SvrGraphResource previous = -1;
+    for (int k = 0; k < chainLength; k++)
+    {
+        SvrGraphResource resource = graph.CreateTarget("post", desc);
+        int pass = graph.AddPass("Post", RunPass, NULL);
+        if (previous >= 0)
+        {
+            graph.Read(pass, previous);
+        }
+        graph.Write(pass, resource, kAttachmentColor, kAttachmentColor);
+        previous = resource;
+
+        if (k % 3 == 2)
+        {
+            int unused = graph.AddPass("Unused", RunPass, NULL);
+            graph.Read(unused, resource);
+            graph.Write(unused, graph.CreateTarget("dead", desc), kAttachmentColor);
+        }
+    }
+
+    int pass = graph.AddPass("Final", RunPass, NULL);
+    graph.Read(pass, previous);
+    graph.Write(pass, window, kAttachmentColor);
+}
+
+//-----------------------------------------------------------------------------
+static void RunVrFrame(SvrRenderTargetPool& pool, SvrRenderGraph& graph, int numFrames, bool dump)
+//-----------------------------------------------------------------------------
+{
+    // The first frame fills the pool, the ones after have to reuse it
+    for (int f = 0; f < 3; f++)
+    {
+        pool.BeginFrame();
+        graph.Reset();
+        DeclareVrFrame(graph);
+        Check(graph.Compile(), "VR frame compiles");
+
+        memset(&gGlStubCounts, 0, sizeof(gGlStubCounts));
+        gPassesRun = 0;
+        graph.Execute();
+    }
+
+    const SvrRenderGraphStats& stats = graph.GetStats();
+    Check(stats.numPasses == 11 && stats.numCulled == 1 && gPassesRun == 10, "only the debug HUD is culled");
+    Check(stats.numTargets == 2, "both eyes share the scene and resolve targets");
+    // Transparent continues the opaque render pass, only the window keeps last frame
+    Check(stats.numLoads == 1, "only the blit loads its target");
+    Check(pool.GetStats().numCreated == 0, "a steady frame creates no targets");
+    Check(gGlStubCounts.numClears > 0 && gGlStubCounts.numInvalidated > 0, "execute clears and invalidates");
+
+    char buffer[8192];
+    int length = graph.Dump(buffer, sizeof(buffer));
+    Check(length > 0 && strstr(buffer, "Debug HUD") != NULL, "dump lists the passes");
+    if (dump)
+    {
+        printf("%s", buffer);
+    }
+
+    double declareMicro = 0.0;
+    double compileMicro = 0.0;
+    for (int f = 0; f < numFrames; f++)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        graph.Reset();
+        DeclareVrFrame(graph);
+        std::chrono::steady_clock::time_point declared = std::chrono::steady_clock::now();
+        graph.Compile();
+        compileMicro += ElapsedMicro(declared);
+        declareMicro += std::chrono::duration<double, std::micro>(declared - start).count();
+    }
+
+    printf("VR frame, %u passes, %u culled, %u resources on %u targets: declare %.2fus, compile %.2fus, "
+           "%d clears, %d invalidated\n", stats.numPasses, stats.numCulled, stats.numResources, stats.numTargets,
+           declareMicro / numFrames, compileMicro / numFrames, gGlStubCounts.numClears, gGlStubCounts.numInvalidated);
+}
+
+//-----------------------------------------------------------------------------
+static void RunChain(SvrRenderGraph& graph, int chainLength, int numFrames)
+//-----------------------------------------------------------------------------
+{
+    double compileMicro = 0.0;
+    for (int f = 0; f < numFrames; f++)
+    {
+        graph.Reset();
+        DeclareChain(graph, chainLength);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Check(graph.Compile(), "chain compiles");
+        compileMicro += ElapsedMicro(start);
+    }
+
+    // Each effect lives from its own pass to the next, so two targets alternate
+    const SvrRenderGraphStats& stats = graph.GetStats();
+    Check(stats.numCulled == (unsigned int)(chainLength / 3), "every dead branch is culled");
+    Check(stats.numTargets == (chainLength > 1 ? 2u : 1u), "the chain ping-pongs between two targets");
+
+    printf("chain, %u passes, %u culled, %u resources on %u targets: compile %.1fus\n", stats.numPasses,
+           stats.numCulled, stats.numResources, stats.numTargets, compileMicro / numFrames);
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+//-----------------------------------------------------------------------------
+{
+    bool dump = (argc > 1 && strcmp(argv[argc - 1], "-dump") == 0);
+    if (dump)
+    {
+        argc--;
+    }
+
+    int numFrames = (argc > 1) ? atoi(argv[1]) : 20000;
+    int chainLength = (argc > 2) ? atoi(argv[2]) : 256;
+    if (numFrames < 1 || chainLength < 1)
+    {
+        printf("usage: bench_rendergraph [numFrames] [chainLength] [-dump]\n");
+        return 1;
+    }
+
+    SvrRenderTargetPool pool;
+    pool.Initialize();
+    SvrRenderGraph graph;
+    graph.Initialize(&pool);
+
+    RunVrFrame(pool, graph, numFrames, dump);
+    RunChain(graph, chainLength, numFrames / 10 + 1);
+
+    // Sampling a target no pass has drawn is an error, not a silent empty read
+    graph.Reset();
+    SvrRenderTargetDesc desc = { 64, 64, 1, GL_RGBA8, false };
+    SvrGraphResource never = graph.CreateTarget("never", desc);
+    int pass = graph.AddPass("Reads early", RunPass, NULL);
+    graph.Read(pass, never);
+    graph.Write(pass, graph.ImportTarget("window", 0, 64, 64, false), kAttachmentColor);
+    Check(!graph.Compile(), "reading an unwritten target fails to compile");
+
+    graph.Destroy();
+    pool.Destroy();
+
+    if (gFailures != 0)
+    {
+        printf("%d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
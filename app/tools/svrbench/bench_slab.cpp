@@ -0,0 +1,273 @@
+//=============================================================================
+// FILE: bench_slab.cpp
+//
+//                  Copyright (c) 2016 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+// Compares the slab allocator in svrSlab.h with malloc in two ways:
+//  - alloc/free throughput at a few small sizes, on one thread and several
+//  - lookups and iteration of a Map whose nodes were allocated while the heap
+//    was being fragmented by other allocations, which is what packing nodes
+//    into slabs is meant to help
+//
+//  usage: bench_slab [numNodes] [threads]
+//=============================================================================
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "svrContainers.h"
+#include "svrSlab.h"
+
+struct SlabNode : public MapElement<SlabNode>
+{
+    typedef long KeyType;
+
+    long mKey;
+    long mPayload[2];
+
+    const long& GetKey() const
+    {
+        return mKey;
+    }
+};
+
+// Same node with MapElementBase's slab operators replaced by malloc
+struct HeapNode : public MapElement<HeapNode>
+{
+    typedef long KeyType;
+
+    long mKey;
+    long mPayload[2];
+
+    const long& GetKey() const
+    {
+        return mKey;
+    }
+
+    static void* operator new(size_t size)
+    {
+        return malloc(size);
+    }
+
+    static void operator delete(void* pBlock, size_t)
+    {
+        free(pBlock);
+    }
+};
+
+struct MallocAllocator
+{
+    static void* Alloc(size_t size)
+    {
+        return malloc(size);
+    }
+
+    static void Free(void* pBlock, size_t)
+    {
+        free(pBlock);
+    }
+};
+
+struct SlabAllocator
+{
+    static void* Alloc(size_t size)
+    {
+        return Svr::SlabAlloc(size);
+    }
+
+    static void Free(void* pBlock, size_t size)
+    {
+        Svr::SlabFree(pBlock, size);
+    }
+};
+
+static int gFailures = 0;
+
+//-----------------------------------------------------------------------------
+static void Check(bool condition, const char* pWhat)
+//-----------------------------------------------------------------------------
+{
+    if (!condition)
+    {
+        printf("FAIL %s\n", pWhat);
+        gFailures++;
+    }
+}
+
+//-----------------------------------------------------------------------------
+static double NowNano()
+//-----------------------------------------------------------------------------
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//-----------------------------------------------------------------------------
+static void RunChecks()
+//-----------------------------------------------------------------------------
+{
+    static const size_t sizes[] = { 1, 8, 24, 40, 64, 100, 256, 257, 1000 };
+    const int numBlocks = 5000;
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        size_t size = sizes[s];
+        std::vector<unsigned char*> blocks;
+        for (int i = 0; i < numBlocks; i++)
+        {
+            unsigned char* pBlock = (unsigned char*)Svr::SlabAlloc(size);
+            Check(pBlock != NULL && ((size_t)pBlock & (sizeof(void*) - 1)) == 0, "blocks are pointer aligned");
+            memset(pBlock, i & 0xFF, size);
+            blocks.push_back(pBlock);
+        }
+
+        // Any overlap would have overwritten a neighbour's fill
+        bool intact = true;
+        for (int i = 0; i < numBlocks; i++)
+        {
+            for (size_t b = 0; b < size; b++)
+                intact &= (blocks[i][b] == (i & 0xFF));
+        }
+        Check(intact, "blocks do not overlap");
+
+        for (int i = 0; i < numBlocks; i++)
+            Svr::SlabFree(blocks[i], size);
+    }
+
+    struct Item
+    {
+        long values[3];
+    };
+    Svr::SlabPool<Item> pool;
+    Item* pNode = pool.New();
+    Check(pNode != NULL && pool.GetLiveCount() == 1, "pool counts live blocks");
+    pool.Delete(pNode);
+    Check(pool.GetLiveCount() == 0 && pool.New() == pNode, "freed blocks are reused");
+}
+
+//-----------------------------------------------------------------------------
+template <class Allocator>
+static void ChurnThread(size_t size, int numBlocks, int numRounds)
+//-----------------------------------------------------------------------------
+{
+    std::vector<void*> blocks(numBlocks);
+    for (int r = 0; r < numRounds; r++)
+    {
+        for (int i = 0; i < numBlocks; i++)
+            blocks[i] = Allocator::Alloc(size);
+
+        // Free in a different order than allocated, as node lifetimes do
+        for (int i = 0; i < numBlocks; i++)
+            Allocator::Free(blocks[(i * 7) % numBlocks], size);
+    }
+}
+
+//-----------------------------------------------------------------------------
+template <class Allocator>
+static double TimeChurn(size_t size, int numThreads)
+//-----------------------------------------------------------------------------
+{
+    const int numBlocks = 1000;
+    const int numRounds = 200;
+
+    double start = NowNano();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; t++)
+        threads.push_back(std::thread(ChurnThread<Allocator>, size, numBlocks, numRounds));
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+
+    return (NowNano() - start) / ((double)numBlocks * numRounds * numThreads);
+}
+
+//-----------------------------------------------------------------------------
+template <class Node>
+static void TimeMap(const char* pName, long numNodes)
+//-----------------------------------------------------------------------------
+{
+    std::vector<long> keys(numNodes);
+    for (long i = 0; i < numNodes; i++)
+        keys[i] = i * 7;
+
+    srand(1);
+    for (long i = numNodes - 1; i > 0; i--)
+        std::swap(keys[i], keys[rand() % (i + 1)]);
+
+    // Interleave other allocations and free half of them, as a running app would
+    Map<Node> map;
+    std::vector<void*> noise;
+    for (long i = 0; i < numNodes; i++)
+    {
+        Node* pNode = new Node;
+        pNode->mKey = keys[i];
+        map.Insert(pNode);
+        noise.push_back(malloc(16 + rand() % 200));
+    }
+    for (size_t i = 0; i < noise.size(); i += 2)
+        free(noise[i]);
+
+    const int numPasses = 4;
+    long found = 0;
+    double start = NowNano();
+    for (int r = 0; r < numPasses; r++)
+    {
+        for (long i = 0; i < numNodes; i++)
+            found += (map.Find(keys[(i * 40503) % numNodes]) != NULL) ? 1 : 0;
+    }
+    double lookupNano = (NowNano() - start) / (numPasses * numNodes);
+
+    long sum = 0;
+    start = NowNano();
+    for (int r = 0; r < numPasses; r++)
+    {
+        for (Node* pNode = map.First(); pNode != NULL; pNode = pNode->Next())
+            sum += pNode->mKey;
+    }
+    double iterateNano = (NowNano() - start) / (numPasses * numNodes);
+
+    Check(found == numPasses * numNodes, "map finds every node");
+    printf("%-6s %8ld nodes: lookup %6.1fns, iterate %5.1fns/node (%ld)\n", pName, numNodes, lookupNano, iterateNano,
+           sum & 1);
+
+    map.Purge();
+    for (size_t i = 1; i < noise.size(); i += 2)
+        free(noise[i]);
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+//-----------------------------------------------------------------------------
+{
+    long numNodes = (argc > 1) ? atol(argv[1]) : 200000;
+    int numThreads = (argc > 2) ? atoi(argv[2]) : 4;
+    if (numNodes < 1 || numThreads < 1)
+    {
+        printf("usage: bench_slab [numNodes] [threads]\n");
+        return 1;
+    }
+
+    RunChecks();
+
+    static const size_t sizes[] = { 32, 64, 128 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        printf("%3zu bytes alloc+free: malloc %5.1fns, slab %5.1fns, %d threads: malloc %5.1fns, slab %5.1fns\n",
+               sizes[s], TimeChurn<MallocAllocator>(sizes[s], 1), TimeChurn<SlabAllocator>(sizes[s], 1), numThreads,
+               TimeChurn<MallocAllocator>(sizes[s], numThreads), TimeChurn<SlabAllocator>(sizes[s], numThreads));
+    }
+
+    TimeMap<HeapNode>("malloc", numNodes);
+    TimeMap<SlabNode>("slab", numNodes);
+
+    if (gFailures != 0)
+    {
+        printf("%d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,184 @@
+//=============================================================================
+// FILE: bench_sort.cpp
+//
+//                  Copyright (c) 2016 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+// Checks SvrRadixSort64 against std::stable_sort and times the two on the
+// render queue's sort entries.  Keys are random 64 bit values, keys laid out like
+// SvrMakeSortKey's with a handful of shaders, materials and meshes and a random
+// depth, or all equal, where every pass is skipped.
+//
+//  usage: bench_sort [maxEntries]
+//=============================================================================
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "svrRenderQueue.h"
+
+using namespace Svr;
+
+// Same shape as SvrRenderQueue::SortEntry
+struct Entry
+{
+    uint64_t    key;
+    uint32_t    packet;
+};
+
+enum KeyMode
+{
+    kKeysRandom,
+    kKeysScene,
+    kKeysEqual,
+    kNumKeyModes
+};
+
+static const char* gKeyModeNames[kNumKeyModes] = { "random", "scene", "equal" };
+
+static int gFailures = 0;
+
+//-----------------------------------------------------------------------------
+static bool KeyLess(const Entry& a, const Entry& b)
+//-----------------------------------------------------------------------------
+{
+    return a.key < b.key;
+}
+
+//-----------------------------------------------------------------------------
+static uint64_t Random64()
+//-----------------------------------------------------------------------------
+{
+    return ((uint64_t)rand() << 42) ^ ((uint64_t)rand() << 21) ^ (uint64_t)rand();
+}
+
+//-----------------------------------------------------------------------------
+static std::vector<Entry> MakeEntries(size_t count, KeyMode mode)
+//-----------------------------------------------------------------------------
+{
+    const int depthShift = 0;
+    const int geometryShift = depthShift + SVR_SORT_KEY_DEPTH_BITS;
+    const int materialShift = geometryShift + SVR_SORT_KEY_GEOMETRY_BITS;
+    const int shaderShift = materialShift + SVR_SORT_KEY_MATERIAL_BITS;
+    const int passShift = shaderShift + SVR_SORT_KEY_SHADER_BITS;
+
+    std::vector<Entry> entries(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t key = 42;
+        if (mode == kKeysRandom)
+        {
+            key = Random64();
+        }
+        else if (mode == kKeysScene)
+        {
+            key = ((uint64_t)(rand() % 2) << passShift) |
+                  ((uint64_t)(rand() % 8) << shaderShift) |
+                  ((uint64_t)(rand() % 32) << materialShift) |
+                  ((uint64_t)(rand() % 64) << geometryShift) |
+                  ((uint64_t)(rand() & ((1 << SVR_SORT_KEY_DEPTH_BITS) - 1)) << depthShift);
+        }
+        entries[i].key = key;
+        entries[i].packet = (uint32_t)i;
+    }
+    return entries;
+}
+
+//-----------------------------------------------------------------------------
+static void CheckSort(size_t count, KeyMode mode)
+//-----------------------------------------------------------------------------
+{
+    std::vector<Entry> entries = MakeEntries(count, mode);
+    std::vector<Entry> scratch(count);
+    std::vector<Entry> reference = entries;
+    std::stable_sort(reference.begin(), reference.end(), KeyLess);
+
+    Entry* pSorted = SvrRadixSort64(entries.empty() ? NULL : &entries[0], scratch.empty() ? NULL : &scratch[0], count);
+
+    // Equal keys have to keep their order, so compare the packets too
+    bool matches = true;
+    for (size_t i = 0; i < count; i++)
+    {
+        matches &= (pSorted[i].key == reference[i].key && pSorted[i].packet == reference[i].packet);
+    }
+
+    if (!matches)
+    {
+        printf("FAIL radix sort matches stable_sort: %zu %s keys\n", count, gKeyModeNames[mode]);
+        gFailures++;
+    }
+}
+
+//-----------------------------------------------------------------------------
+static void TimeSort(size_t count, KeyMode mode)
+//-----------------------------------------------------------------------------
+{
+    std::vector<Entry> entries = MakeEntries(count, mode);
+    std::vector<Entry> work(count);
+    std::vector<Entry> scratch(count);
+
+    // Enough repeats that small counts still take measurable time
+    int numRuns = (int)(2000000 / count) + 1;
+    double radixNano = 0.0;
+    double stableNano = 0.0;
+    uint32_t sum = 0;
+
+    for (int r = 0; r < numRuns; r++)
+    {
+        work = entries;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Entry* pSorted = SvrRadixSort64(&work[0], &scratch[0], count);
+        radixNano += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        sum += pSorted[count / 2].packet;
+
+        work = entries;
+        start = std::chrono::steady_clock::now();
+        std::stable_sort(work.begin(), work.end(), KeyLess);
+        stableNano += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        sum += work[count / 2].packet;
+    }
+
+    printf("%7zu %-6s keys: radix %7.1fus, stable_sort %7.1fus (%u)\n", count, gKeyModeNames[mode],
+           radixNano / numRuns * 1e-3, stableNano / numRuns * 1e-3, sum & 1);
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+//-----------------------------------------------------------------------------
+{
+    long maxEntries = (argc > 1) ? atol(argv[1]) : 100000;
+    if (maxEntries < 100)
+    {
+        printf("usage: bench_sort [maxEntries >= 100]\n");
+        return 1;
+    }
+
+    srand(3);
+    static const size_t checkCounts[] = { 0, 1, 2, 7, 256, 1000, 20000 };
+    for (size_t c = 0; c < sizeof(checkCounts) / sizeof(checkCounts[0]); c++)
+    {
+        for (int mode = 0; mode < kNumKeyModes; mode++)
+        {
+            CheckSort(checkCounts[c], (KeyMode)mode);
+        }
+    }
+
+    for (size_t count = 100; count <= (size_t)maxEntries; count *= 10)
+    {
+        for (int mode = 0; mode < kNumKeyModes; mode++)
+        {
+            TimeSort(count, (KeyMode)mode);
+        }
+    }
+
+    if (gFailures != 0)
+    {
+        printf("%d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
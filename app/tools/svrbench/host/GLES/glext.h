@@ -0,0 +1,13 @@
+//=============================================================================
+// FILE: glext.h
+//
+// Host stand-in for the NDK's GLES/glext.h.  Desktop Mesa's copy expects
+// GLES/gl.h to have declared GLclampx already, the NDK's does not.
+//=============================================================================
+#pragma once
+
+#include <KHR/khrplatform.h>
+
+typedef khronos_int32_t GLclampx;
+
+#include_next <GLES/glext.h>
@@ -0,0 +1,19 @@
+//=============================================================================
+// FILE: log.h
+//
+// Host stand-in for the NDK log header so framework code that logs through
+// svrUtil.h builds off-device.  Messages go to stdout.
+//=============================================================================
+#pragma once
+
+#include <stdio.h>
+
+enum
+{
+    ANDROID_LOG_VERBOSE = 2,
+    ANDROID_LOG_INFO = 4,
+    ANDROID_LOG_WARN = 5,
+    ANDROID_LOG_ERROR = 6,
+};
+
+#define __android_log_print(prio, tag, ...) (printf(__VA_ARGS__), printf("\n"))
@@ -0,0 +1,67 @@
+//=============================================================================
+// FILE: glstub.cpp
+//
+// GLES and EGL entry points the render target, render graph and geometry code calls,
+// see glstub.h.  Every object name is new and every framebuffer complete.
+//=============================================================================
+#include <EGL/egl.h>
+#include <GLES3/gl3.h>
+
+#include "glstub.h"
+
+GlStubCounts gGlStubCounts;
+
+static GLuint gNextName = 1;
+
+static void GenNames(GLsizei n, GLuint* pNames)
+{
+    for (GLsizei i = 0; i < n; i++)
+        pNames[i] = gNextName++;
+}
+
+extern "C"
+{
+void glGenTextures(GLsizei n, GLuint* pNames) { GenNames(n, pNames); }
+void glGenRenderbuffers(GLsizei n, GLuint* pNames) { GenNames(n, pNames); }
+void glGenFramebuffers(GLsizei n, GLuint* pNames) { GenNames(n, pNames); }
+void glDeleteTextures(GLsizei, const GLuint*) {}
+void glDeleteRenderbuffers(GLsizei, const GLuint*) {}
+void glDeleteFramebuffers(GLsizei, const GLuint*) {}
+void glGenBuffers(GLsizei n, GLuint* pNames) { GenNames(n, pNames); }
+void glGenVertexArrays(GLsizei n, GLuint* pNames) { GenNames(n, pNames); }
+void glDeleteBuffers(GLsizei, const GLuint*) {}
+void glDeleteVertexArrays(GLsizei, const GLuint*) {}
+
+void glBindBuffer(GLenum, GLuint) {}
+void glBufferData(GLenum, GLsizeiptr, const void*, GLenum) {}
+void glBindVertexArray(GLuint) {}
+void glEnableVertexAttribArray(GLuint) {}
+void glVertexAttribPointer(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*) {}
+void glVertexAttribDivisor(GLuint, GLuint) {}
+void glDrawElements(GLenum, GLsizei, GLenum, const void*) {}
+
+void glBindTexture(GLenum, GLuint) {}
+void glTexImage2D(GLenum, GLint, GLint, GLsizei, GLsizei, GLint, GLenum, GLenum, const void*) {}
+void glTexParameteri(GLenum, GLenum, GLint) {}
+void glBindRenderbuffer(GLenum, GLuint) {}
+void glRenderbufferStorageMultisample(GLenum, GLsizei, GLenum, GLsizei, GLsizei) {}
+
+void glBindFramebuffer(GLenum, GLuint) { gGlStubCounts.numFramebufferBinds++; }
+void glFramebufferTexture2D(GLenum, GLenum, GLenum, GLuint, GLint) {}
+void glFramebufferRenderbuffer(GLenum, GLenum, GLenum, GLuint) {}
+GLenum glCheckFramebufferStatus(GLenum) { return GL_FRAMEBUFFER_COMPLETE; }
+void glInvalidateFramebuffer(GLenum, GLsizei n, const GLenum*) { gGlStubCounts.numInvalidated += n; }
+
+void glViewport(GLint, GLint, GLsizei, GLsizei) {}
+void glScissor(GLint, GLint, GLsizei, GLsizei) {}
+void glColorMask(GLboolean, GLboolean, GLboolean, GLboolean) {}
+void glDepthMask(GLboolean) {}
+void glStencilMask(GLuint) {}
+void glClearColor(GLfloat, GLfloat, GLfloat, GLfloat) {}
+void glClearDepthf(GLfloat) {}
+void glClearStencil(GLint) {}
+void glClear(GLbitfield) { gGlStubCounts.numClears++; }
+
+GLenum glGetError() { return GL_NO_ERROR; }
+EGLint eglGetError() { return EGL_SUCCESS; }
+}
@@ -0,0 +1,17 @@
+//=============================================================================
+// FILE: glstub.h
+//
+// Host stand-in for the GLES driver under the render target and render graph
+// code.  Calls do nothing beyond handing out names and counting what a bench
+// checks.
+//=============================================================================
+#pragma once
+
+struct GlStubCounts
+{
+    int numClears;              // glClear calls
+    int numInvalidated;         // Attachments passed to glInvalidateFramebuffer
+    int numFramebufferBinds;
+};
+
+extern GlStubCounts gGlStubCounts;
@@ -0,0 +1,14 @@
+//=============================================================================
+// FILE: jni.h
+//
+// Host stand-in for the JNI types svrApi.h names.  Nothing here is called.
+//=============================================================================
+#pragma once
+
+struct _JavaVM;
+struct _JNIEnv;
+struct _jobject;
+
+typedef _JavaVM JavaVM;
+typedef _JNIEnv JNIEnv;
+typedef _jobject* jobject;
@@ -0,0 +1,223 @@
+//=============================================================================
+// FILE: test_beamrace.cpp
+//
+//                  Copyright (c) 2016 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+// Runs svrBuildBeamRaceSchedule against a simulated raster.  The line pointer
+// interrupt is walked down the display to each slice's trigger line, each
+// interrupt releases the next slice to a simulated warp that renders slices one
+// after another, and every slice has to be done by its deadline.
+//
+//  usage: test_beamrace [frames]
+//
+// Each panel and slice count is run twice: with a per slice warp cost just inside
+// the tightest release to deadline window, where nothing may be missed, and just
+// outside it, where the misses have to be seen.
+//=============================================================================
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "private/svrApiBeamRaceSchedule.h"
+
+// Time from the interrupt to the warp thread running, and the spread of interrupt times
+#define WAKE_LATENCY_NANO       50000
+#define INTERRUPT_JITTER_NANO   20000
+
+struct Panel
+{
+    const char* pName;
+    uint32_t    numLines;
+    double      refreshHz;
+    double      scanoutPct;
+};
+
+struct SimResult
+{
+    int         slicesRendered;
+    int         slicesMissed;
+    int64_t     worstSlackNano;     // Deadline minus finish, negative when missed
+    double      meanPoseAgeNano;    // Render start to the slice's pose time
+};
+
+static int gFailures = 0;
+
+//-----------------------------------------------------------------------------
+static void Check(bool condition, const char* pWhat, const Panel& panel, int numSlices)
+//-----------------------------------------------------------------------------
+{
+    if (!condition)
+    {
+        printf("FAIL %s: %s, %d slices\n", pWhat, panel.pName, numSlices);
+        gFailures++;
+    }
+}
+
+//-----------------------------------------------------------------------------
+static void CheckLayout(const svrBeamRaceSchedule& schedule, const Panel& panel, int numSlices)
+//-----------------------------------------------------------------------------
+{
+    const double lineNano = schedule.framePeriodNano * panel.scanoutPct / schedule.numLines;
+
+    Check(schedule.numSlices == numSlices, "slice count", panel, numSlices);
+    Check(schedule.slices[0].firstLine == 1, "first line", panel, numSlices);
+    Check(schedule.slices[numSlices - 1].lastLine == panel.numLines, "last line", panel, numSlices);
+
+    for (int i = 0; i < numSlices; i++)
+    {
+        const svrBeamRaceSlice& slice = schedule.slices[i];
+        const svrBeamRaceSlice& prev = schedule.slices[(i + numSlices - 1) % numSlices];
+
+        if (i > 0)
+        {
+            Check(slice.firstLine == prev.lastLine + 1, "slices contiguous", panel, numSlices);
+
+            // When the raster really reaches the trigger line
+            uint64_t rasterNano = schedule.vsyncTimeNano + (uint64_t)((slice.triggerLine - 1) * lineNano);
+            Check(slice.triggerTimeNano == rasterNano, "trigger time on the raster", panel, numSlices);
+        }
+        Check(slice.firstLine <= slice.lastLine, "slice not empty", panel, numSlices);
+        Check(slice.triggerLine == prev.firstLine, "released by the previous slice", panel, numSlices);
+        Check(slice.triggerTimeNano < slice.deadlineNano, "released before the deadline", panel, numSlices);
+        Check(slice.poseTimeNano >= slice.scanoutStartNano && slice.poseTimeNano <= slice.scanoutEndNano,
+              "pose time inside the scanout", panel, numSlices);
+    }
+}
+
+// The tightest window between a slice's release and its deadline, less what the
+// simulation takes away from it
+//-----------------------------------------------------------------------------
+static int64_t MinWindowNano(const svrBeamRaceSchedule& schedule)
+//-----------------------------------------------------------------------------
+{
+    int64_t minWindow = INT64_MAX;
+    for (int i = 0; i < schedule.numSlices; i++)
+    {
+        const svrBeamRaceSlice& slice = schedule.slices[i];
+        int64_t window = (int64_t)slice.deadlineNano - (int64_t)slice.triggerTimeNano;
+        minWindow = (window < minWindow) ? window : minWindow;
+    }
+    return minWindow - WAKE_LATENCY_NANO - INTERRUPT_JITTER_NANO;
+}
+
+//-----------------------------------------------------------------------------
+static SimResult Simulate(const Panel& panel, int numSlices, uint64_t marginNano, int64_t sliceCostNano, int numFrames)
+//-----------------------------------------------------------------------------
+{
+    const double framePeriodNano = 1e9 / panel.refreshHz;
+    const uint64_t firstVsyncNano = 1000000000ull;
+
+    // The interrupt lines, as svrBeamRaceBegin programs them
+    svrBeamRaceSchedule layout;
+    svrBuildBeamRaceSchedule(0, framePeriodNano, panel.scanoutPct, panel.numLines, numSlices, marginNano, &layout);
+    const double lineNano = framePeriodNano * panel.scanoutPct / panel.numLines;
+
+    SimResult result = { 0, 0, INT64_MAX, 0.0 };
+    uint64_t gpuFreeNano = 0;
+    double poseAgeSum = 0.0;
+
+    srand(7);
+    int programmedIndex = 0;
+    for (int frame = 0; frame < numFrames; frame++)
+    {
+        uint64_t vsyncNano = firstVsyncNano + (uint64_t)(frame * framePeriodNano);
+
+        for (int interrupt = 0; interrupt < numSlices; interrupt++)
+        {
+            // The interrupt armed at this slice's first line fires as the raster gets there
+            uint32_t line = layout.slices[programmedIndex].firstLine;
+            uint64_t fireNano = vsyncNano + (uint64_t)((line - 1) * lineNano) + rand() % INTERRUPT_JITTER_NANO;
+
+            // Releases the next slice, slice 0 belonging to the next frame
+            int slice = (programmedIndex + 1) % numSlices;
+            uint64_t releaseVsyncNano = vsyncNano;
+            if (slice == 0)
+            {
+                releaseVsyncNano += (uint64_t)framePeriodNano;
+            }
+            programmedIndex = slice;
+
+            // What svrBeamRaceWaitForSlice hands the warp
+            svrBeamRaceSchedule schedule;
+            svrBuildBeamRaceSchedule(releaseVsyncNano, framePeriodNano, panel.scanoutPct, panel.numLines, numSlices,
+                                     marginNano, &schedule);
+
+            uint64_t startNano = fireNano + WAKE_LATENCY_NANO;
+            startNano = (startNano > gpuFreeNano) ? startNano : gpuFreeNano;
+            uint64_t finishNano = startNano + sliceCostNano;
+            gpuFreeNano = finishNano;
+
+            const svrBeamRaceSlice& s = schedule.slices[slice];
+            int64_t slack = (int64_t)s.deadlineNano - (int64_t)finishNano;
+            result.worstSlackNano = (slack < result.worstSlackNano) ? slack : result.worstSlackNano;
+            result.slicesRendered++;
+            result.slicesMissed += (slack < 0) ? 1 : 0;
+            poseAgeSum += (double)s.poseTimeNano - (double)startNano;
+        }
+    }
+
+    result.meanPoseAgeNano = poseAgeSum / result.slicesRendered;
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+//-----------------------------------------------------------------------------
+{
+    int numFrames = (argc > 1) ? atoi(argv[1]) : 600;
+    if (numFrames < 1)
+    {
+        printf("usage: test_beamrace [frames]\n");
+        return 1;
+    }
+
+    static const Panel panels[] =
+    {
+        { "1440 lines 60Hz", 1440, 60.0, 1.0 },
+        { "1440 lines 60Hz 10% blanking", 1440, 60.0, 0.9 },
+        { "1080 lines 72Hz", 1080, 72.0, 1.0 },
+        { "2560 lines 90Hz", 2560, 90.0, 0.95 },
+    };
+    static const int sliceCounts[] = { 2, 4, 8, 16 };
+    const uint64_t marginNano = 500000;
+
+    for (size_t p = 0; p < sizeof(panels) / sizeof(panels[0]); p++)
+    {
+        const Panel& panel = panels[p];
+        for (size_t c = 0; c < sizeof(sliceCounts) / sizeof(sliceCounts[0]); c++)
+        {
+            int numSlices = sliceCounts[c];
+
+            svrBeamRaceSchedule schedule;
+            svrBuildBeamRaceSchedule(5000000000ull, 1e9 / panel.refreshHz, panel.scanoutPct, panel.numLines,
+                                     numSlices, marginNano, &schedule);
+            CheckLayout(schedule, panel, numSlices);
+
+            int64_t windowNano = MinWindowNano(schedule);
+            if (windowNano <= 0)
+            {
+                printf("%-30s %2d slices: no render time left with a %0.2fms margin\n", panel.pName, numSlices,
+                       marginNano * 1e-6);
+                continue;
+            }
+
+            SimResult fits = Simulate(panel, numSlices, marginNano, windowNano * 9 / 10, numFrames);
+            SimResult late = Simulate(panel, numSlices, marginNano, windowNano * 11 / 10, numFrames);
+            Check(fits.slicesMissed == 0, "deadlines met within the window", panel, numSlices);
+            Check(late.slicesMissed > 0, "misses seen past the window", panel, numSlices);
+
+            printf("%-30s %2d slices: %0.3fms per slice, worst slack %0.3fms, pose %0.2fms ahead of render, "
+                   "%d/%d missed past the window\n",
+                   panel.pName, numSlices, windowNano * 0.9e-6, fits.worstSlackNano * 1e-6, fits.meanPoseAgeNano * 1e-6,
+                   late.slicesMissed, late.slicesRendered);
+        }
+    }
+
+    if (gFailures != 0)
+    {
+        printf("%d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
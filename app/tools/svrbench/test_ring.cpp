@@ -0,0 +1,436 @@
+//=============================================================================
+// FILE: test_ring.cpp
+//
+//                  Copyright (c) 2016 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+// Stress test for the rings in svrRingBuffer.h.  Every side mixes single,
+// batch and claim/commit calls on a small ring, so it is full or empty most of
+// the time and the multi-threaded side is always contended.
+//
+//  usage: test_ring [itemsPerThread] [threads]
+//
+// SpscRing and MpscRing check that each producer's items arrive in order,
+// SpmcRing that every item is popped exactly once and in order per consumer.
+// Throughput is printed per ring; build with -fsanitize=thread for race checks.
+//
+// Latency is measured per ring type by ping-pong: one thread pushes an item on
+// one ring, a second pops it and pushes it back on another, and the first times
+// the round trip.  Median and 99th percentile are printed.
+//=============================================================================
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "svrRingBuffer.h"
+
+using namespace Svr;
+
+// Small enough that producers and consumers keep running into each other
+#define RING_SIZE   64
+
+// Items carry their producer in the top bits
+#define PRODUCER_SHIFT  40
+#define SEQUENCE_MASK   ((1ull << PRODUCER_SHIFT) - 1)
+
+// Round trips timed per ring type, at most
+#define LATENCY_ROUNDS  100000
+
+typedef unsigned long long Item;
+
+static SpscRing<Item, RING_SIZE> gSpsc;
+static MpscRing<Item, RING_SIZE> gMpsc;
+static SpmcRing<Item, RING_SIZE> gSpmc;
+
+static SpscRing<Item, RING_SIZE> gSpscPong;
+static MpscRing<Item, RING_SIZE> gMpscPong;
+static SpmcRing<Item, RING_SIZE> gSpmcPong;
+
+static int gFailures = 0;
+
+//-----------------------------------------------------------------------------
+static void Check(bool condition, const char* pWhat)
+//-----------------------------------------------------------------------------
+{
+    if (!condition)
+    {
+        printf("FAIL %s\n", pWhat);
+        gFailures++;
+    }
+}
+
+//-----------------------------------------------------------------------------
+static double MillionsPerSecond(std::chrono::steady_clock::time_point start, Item count)
+//-----------------------------------------------------------------------------
+{
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return count / elapsed.count();
+}
+
+//-----------------------------------------------------------------------------
+static void SpscProducer(Item numItems)
+//-----------------------------------------------------------------------------
+{
+    for (Item i = 0; i < numItems; )
+    {
+        unsigned int pushed = 0;
+        unsigned int remaining = (numItems - i < 7) ? (unsigned int)(numItems - i) : 7;
+        switch (i % 3)
+        {
+        case 0:
+        {
+            Item batch[7];
+            for (unsigned int k = 0; k < remaining; k++)
+                batch[k] = i + k;
+            pushed = gSpsc.PushBatch(batch, remaining);
+            break;
+        }
+        case 1:
+        {
+            unsigned int count;
+            Item* pSlots = gSpsc.Claim(remaining, &count);
+            for (unsigned int k = 0; k < count; k++)
+                pSlots[k] = i + k;
+            gSpsc.Commit(count);
+            pushed = count;
+            break;
+        }
+        default:
+            pushed = gSpsc.Push(i) ? 1 : 0;
+            break;
+        }
+
+        i += pushed;
+        if (pushed == 0)
+            std::this_thread::yield();
+    }
+}
+
+//-----------------------------------------------------------------------------
+static void TestSpsc(Item numItems)
+//-----------------------------------------------------------------------------
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::thread producer(SpscProducer, numItems);
+
+    Item expected = 0;
+    bool inOrder = true;
+    while (expected < numItems)
+    {
+        unsigned int count;
+        switch (expected % 3)
+        {
+        case 0:
+        {
+            Item batch[16];
+            count = gSpsc.PopBatch(batch, 16);
+            for (unsigned int k = 0; k < count; k++)
+                inOrder &= (batch[k] == expected++);
+            break;
+        }
+        case 1:
+        {
+            const Item* pSlots = gSpsc.ClaimRead(9, &count);
+            for (unsigned int k = 0; k < count; k++)
+                inOrder &= (pSlots[k] == expected++);
+            gSpsc.CommitRead(count);
+            break;
+        }
+        default:
+        {
+            Item item;
+            count = gSpsc.Pop(&item) ? 1 : 0;
+            if (count != 0)
+                inOrder &= (item == expected++);
+            break;
+        }
+        }
+
+        if (count == 0)
+            std::this_thread::yield();
+    }
+    producer.join();
+
+    Check(inOrder, "spsc items arrive in order");
+    Check(gSpsc.Empty(), "spsc drained");
+    printf("SpscRing: 1 producer, 1 consumer, %0.1f M items/s\n", MillionsPerSecond(start, numItems));
+}
+
+//-----------------------------------------------------------------------------
+static void MpscProducer(Item producer, Item numItems)
+//-----------------------------------------------------------------------------
+{
+    const Item tag = producer << PRODUCER_SHIFT;
+    for (Item i = 0; i < numItems; )
+    {
+        unsigned int pushed = 0;
+        unsigned int remaining = (numItems - i < 3) ? (unsigned int)(numItems - i) : 3;
+        switch (i % 3)
+        {
+        case 0:
+        {
+            Item batch[3] = { tag | i, tag | (i + 1), tag | (i + 2) };
+            pushed = gMpsc.PushBatch(batch, remaining);
+            break;
+        }
+        case 1:
+        {
+            unsigned int count;
+            unsigned int pos = gMpsc.Claim(remaining, &count);
+            for (unsigned int k = 0; k < count; k++)
+                gMpsc.Slot(pos + k) = tag | (i + k);
+            gMpsc.Commit(pos, count);
+            pushed = count;
+            break;
+        }
+        default:
+            pushed = gMpsc.Push(tag | i) ? 1 : 0;
+            break;
+        }
+
+        i += pushed;
+        if (pushed == 0)
+            std::this_thread::yield();
+    }
+}
+
+//-----------------------------------------------------------------------------
+static void TestMpsc(Item numItems, int numThreads)
+//-----------------------------------------------------------------------------
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<std::thread> producers;
+    for (int t = 0; t < numThreads; t++)
+        producers.push_back(std::thread(MpscProducer, (Item)t, numItems));
+
+    std::vector<Item> expected(numThreads, 0);
+    Item total = numItems * numThreads;
+    Item received = 0;
+    bool inOrder = true;
+    while (received < total)
+    {
+        unsigned int count;
+        Item batch[8];
+        if (received & 1)
+        {
+            count = gMpsc.PopBatch(batch, 8);
+        }
+        else
+        {
+            unsigned int pos = gMpsc.ClaimRead(8, &count);
+            for (unsigned int k = 0; k < count; k++)
+                batch[k] = gMpsc.Slot(pos + k);
+            gMpsc.CommitRead(pos, count);
+        }
+
+        for (unsigned int k = 0; k < count; k++)
+        {
+            Item producer = batch[k] >> PRODUCER_SHIFT;
+            if (producer >= (Item)numThreads)
+            {
+                inOrder = false;
+                continue;
+            }
+            inOrder &= ((batch[k] & SEQUENCE_MASK) == expected[producer]++);
+        }
+
+        received += count;
+        if (count == 0)
+            std::this_thread::yield();
+    }
+
+    for (size_t t = 0; t < producers.size(); t++)
+        producers[t].join();
+
+    Check(inOrder, "mpsc items arrive in order per producer");
+    Check(gMpsc.Empty(), "mpsc drained");
+    printf("MpscRing: %d producers, 1 consumer, %0.1f M items/s\n", numThreads, MillionsPerSecond(start, total));
+}
+
+//-----------------------------------------------------------------------------
+static void SpmcConsumer(int consumer, Item total, std::atomic<Item>* pReceived,
+                         std::vector<std::atomic<unsigned char> >* pSeen, bool* pInOrder)
+//-----------------------------------------------------------------------------
+{
+    Item last = 0;
+    bool first = true;
+    bool inOrder = true;
+    unsigned int call = consumer;
+
+    while (pReceived->load(std::memory_order_relaxed) < total)
+    {
+        unsigned int count;
+        Item batch[4];
+        switch (call++ % 3)
+        {
+        case 0:
+            count = gSpmc.PopBatch(batch, 4);
+            break;
+        case 1:
+        {
+            unsigned int pos = gSpmc.ClaimRead(4, &count);
+            for (unsigned int k = 0; k < count; k++)
+                batch[k] = gSpmc.Slot(pos + k);
+            gSpmc.CommitRead(pos, count);
+            break;
+        }
+        default:
+            count = gSpmc.Pop(&batch[0]) ? 1 : 0;
+            break;
+        }
+
+        for (unsigned int k = 0; k < count; k++)
+        {
+            // One producer, so anything a single consumer pops has to be increasing
+            inOrder &= (first || batch[k] > last);
+            first = false;
+            last = batch[k];
+            if (batch[k] < total)
+                (*pSeen)[batch[k]].fetch_add(1, std::memory_order_relaxed);
+            else
+                inOrder = false;
+        }
+
+        if (count != 0)
+            pReceived->fetch_add(count, std::memory_order_relaxed);
+        else
+            std::this_thread::yield();
+    }
+
+    *pInOrder = inOrder;
+}
+
+//-----------------------------------------------------------------------------
+static void TestSpmc(Item numItems, int numThreads)
+//-----------------------------------------------------------------------------
+{
+    Item total = numItems * numThreads;
+    std::atomic<Item> received(0);
+    std::vector<std::atomic<unsigned char> > seen(total);
+    for (Item i = 0; i < total; i++)
+        seen[i].store(0, std::memory_order_relaxed);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<std::thread> consumers;
+    bool inOrder[64];
+    for (int t = 0; t < numThreads; t++)
+        consumers.push_back(std::thread(SpmcConsumer, t, total, &received, &seen, &inOrder[t]));
+
+    for (Item i = 0; i < total; )
+    {
+        unsigned int pushed;
+        if (i & 1)
+        {
+            Item batch[5] = { i, i + 1, i + 2, i + 3, i + 4 };
+            pushed = gSpmc.PushBatch(batch, (total - i < 5) ? (unsigned int)(total - i) : 5);
+        }
+        else
+        {
+            pushed = gSpmc.Push(i) ? 1 : 0;
+        }
+
+        i += pushed;
+        if (pushed == 0)
+            std::this_thread::yield();
+    }
+
+    for (size_t t = 0; t < consumers.size(); t++)
+        consumers[t].join();
+
+    bool allInOrder = true;
+    for (int t = 0; t < numThreads; t++)
+        allInOrder &= inOrder[t];
+
+    bool exactlyOnce = true;
+    for (Item i = 0; i < total; i++)
+        exactlyOnce &= (seen[i].load(std::memory_order_relaxed) == 1);
+
+    Check(allInOrder, "spmc items arrive in order per consumer");
+    Check(exactlyOnce, "spmc every item popped exactly once");
+    Check(gSpmc.Empty(), "spmc drained");
+    printf("SpmcRing: 1 producer, %d consumers, %0.1f M items/s\n", numThreads, MillionsPerSecond(start, total));
+}
+
+// Pops every item off ping and pushes it back on pong
+//-----------------------------------------------------------------------------
+template <typename Ring>
+static void LatencyEcho(Ring* pPing, Ring* pPong, Item numRounds)
+//-----------------------------------------------------------------------------
+{
+    for (Item i = 0; i < numRounds; i++)
+    {
+        Item item;
+        while (!pPing->Pop(&item))
+            std::this_thread::yield();
+        while (!pPong->Push(item))
+            std::this_thread::yield();
+    }
+}
+
+//-----------------------------------------------------------------------------
+template <typename Ring>
+static void TestLatency(const char* pName, Ring& ping, Ring& pong, Item numRounds)
+//-----------------------------------------------------------------------------
+{
+    std::thread echo(LatencyEcho<Ring>, &ping, &pong, numRounds);
+
+    std::vector<double> roundTrips(numRounds);
+    bool inOrder = true;
+    for (Item i = 0; i < numRounds; i++)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        while (!ping.Push(i))
+            std::this_thread::yield();
+
+        Item item;
+        while (!pong.Pop(&item))
+            std::this_thread::yield();
+
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        roundTrips[i] = elapsed.count();
+        inOrder &= (item == i);
+    }
+    echo.join();
+
+    Check(inOrder, "latency items come back in order");
+    Check(ping.Empty() && pong.Empty(), "latency rings drained");
+
+    std::sort(roundTrips.begin(), roundTrips.end());
+    printf("%s: round trip over %llu items, median %0.0f ns, p99 %0.0f ns\n", pName, numRounds,
+           roundTrips[numRounds / 2], roundTrips[numRounds * 99 / 100]);
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+//-----------------------------------------------------------------------------
+{
+    long numItems = (argc > 1) ? atol(argv[1]) : 1000000;
+    int numThreads = (argc > 2) ? atoi(argv[2]) : 4;
+    if (numItems < 1 || numThreads < 1 || numThreads > 64)
+    {
+        printf("usage: test_ring [itemsPerThread] [threads 1-64]\n");
+        return 1;
+    }
+
+    TestSpsc(numItems);
+    TestMpsc(numItems, numThreads);
+    TestSpmc(numItems, numThreads);
+
+    Item numRounds = (numItems < LATENCY_ROUNDS) ? numItems : LATENCY_ROUNDS;
+    TestLatency("SpscRing", gSpsc, gSpscPong, numRounds);
+    TestLatency("MpscRing", gMpsc, gMpscPong, numRounds);
+    TestLatency("SpmcRing", gSpmc, gSpmcPong, numRounds);
+
+    if (gFailures != 0)
+    {
+        printf("%d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
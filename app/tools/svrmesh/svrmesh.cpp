@@ -0,0 +1,736 @@
+//=============================================================================
+// FILE: svrmesh.cpp
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+// Compiles a Wavefront OBJ into the binary mesh format loaded by
+// SvrGeometry::CreateFromMeshFile (see svrMeshFormat.h).
+//
+//  usage: svrmesh [-p float|half|snorm16] [-n float|oct] [-t float|half|unorm16] [-r]
+//                 [-l levels] input.obj output.svrm
+//
+// Each object, group or material change starts a new sub-mesh.  Polygons are
+// fanned into triangles, vertices shared between faces are merged, and missing
+// normals are generated by averaging the normals of the faces around a position.
+// Parsing is shared with SvrGeometry::CreateFromObjFile (svrObjImport.h) and runs
+// on all cores, as does the optimization of the sub-meshes.
+//
+// -p, -n and -t pick how positions, normals and texcoords are stored, float by
+// default.  The smallest layout (snorm16, oct, half or unorm16) is 16 bytes per
+// vertex instead of 32.  Indices are 16 bit whenever the vertex count allows.
+//
+// Triangles of each sub-mesh are reordered for the post-transform cache and then
+// clustered outside-in against overdraw, after which vertices are renumbered in
+// order of first use.  -r keeps the order of the OBJ instead.
+//
+// Each sub-mesh gets -l levels of detail in all (4 by default, 1 for none), each
+// simplified to about half the triangles of the one before (svrMeshSimplify.h).
+//=============================================================================
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <GLES3/gl3.h>
+
+#include "svrJobs.h"
+#include "svrMeshFormat.h"
+#include "svrMeshOptimizer.h"
+#include "svrMeshSimplify.h"
+#include "svrObjImport.h"
+
+using namespace Svr;
+
+// SvrAttributeLocation values, svrShader.h pulls in more than a host tool has
+#define LOCATION_POSITION   0
+#define LOCATION_NORMAL     1
+#define LOCATION_TEXCOORD0  3
+
+enum PositionEncoding
+{
+    kPositionFloat,
+    kPositionHalf,          // Remapped into [-1, 1] over the bounds
+    kPositionSnorm16        // Remapped into [-1, 1] over the bounds
+};
+
+enum NormalEncoding
+{
+    kNormalFloat,
+    kNormalOct16            // Octahedral, two snorm16
+};
+
+enum TexcoordEncoding
+{
+    kTexcoordFloat,
+    kTexcoordHalf,
+    kTexcoordUnorm16        // Texcoords must lie in [0, 1]
+};
+
+struct VertexLayout
+{
+    PositionEncoding    position;
+    NormalEncoding      normal;
+    TexcoordEncoding    texcoord;
+    uint32_t            stride;
+    SvrMeshAttribute    attributes[3];
+};
+
+struct MeshVertex
+{
+    float   position[3];
+    float   normal[3];
+    float   texcoord[2];
+};
+
+struct VertexKey
+{
+    int     position;
+    int     texcoord;
+    int     normal;
+    bool operator==(const VertexKey& other) const
+    {
+        return position == other.position && texcoord == other.texcoord && normal == other.normal;
+    }
+};
+
+struct VertexKeyHash
+{
+    size_t operator()(const VertexKey& key) const
+    {
+        return (size_t)key.position * 73856093u ^ (size_t)key.texcoord * 19349663u ^ (size_t)key.normal * 83492791u;
+    }
+};
+
+//-----------------------------------------------------------------------------
+static bool ReadFile(const char* pPath, std::vector<char>& data)
+//-----------------------------------------------------------------------------
+{
+    FILE* pFile = fopen(pPath, "rb");
+    if (pFile == NULL)
+    {
+        return false;
+    }
+
+    fseek(pFile, 0, SEEK_END);
+    long size = ftell(pFile);
+    fseek(pFile, 0, SEEK_SET);
+
+    data.resize(size > 0 ? size : 0);
+    bool result = size >= 0 && (size == 0 || fread(&data[0], 1, size, pFile) == (size_t)size);
+    fclose(pFile);
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+static void ExpandBounds(float* pMin, float* pMax, const float* pPosition)
+//-----------------------------------------------------------------------------
+{
+    for (int c = 0; c < 3; c++)
+    {
+        pMin[c] = (pPosition[c] < pMin[c]) ? pPosition[c] : pMin[c];
+        pMax[c] = (pPosition[c] > pMax[c]) ? pPosition[c] : pMax[c];
+    }
+}
+
+//-----------------------------------------------------------------------------
+static uint16_t FloatToHalf(float value)
+//-----------------------------------------------------------------------------
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t mantissa = bits & 0x7FFFFF;
+    int exponent = (int)((bits >> 23) & 0xFF) - 112;
+
+    if (exponent >= 31)
+    {
+        return (uint16_t)(sign | 0x7C00);
+    }
+
+    // Round to nearest even, into the denormal range if need be
+    int shift = 13;
+    if (exponent <= 0)
+    {
+        if (exponent < -10)
+        {
+            return (uint16_t)sign;
+        }
+        mantissa |= 0x800000;
+        shift = 14 - exponent;
+        exponent = 0;
+    }
+
+    uint32_t half = (exponent << 10) | (mantissa >> shift);
+    uint32_t remainder = mantissa & ((1u << shift) - 1);
+    uint32_t midpoint = 1u << (shift - 1);
+    if (remainder > midpoint || (remainder == midpoint && (half & 1)))
+    {
+        half++;
+    }
+    return (uint16_t)(sign | half);
+}
+
+//-----------------------------------------------------------------------------
+static float HalfToFloat(uint16_t half)
+//-----------------------------------------------------------------------------
+{
+    float magnitude;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+    if (exponent == 0)
+        magnitude = ldexpf((float)mantissa, -24);
+    else if (exponent == 31)
+        magnitude = HUGE_VALF;
+    else
+        magnitude = ldexpf((float)(mantissa | 0x400), (int)exponent - 25);
+    return (half & 0x8000) ? -magnitude : magnitude;
+}
+
+//-----------------------------------------------------------------------------
+static int16_t FloatToSnorm16(float value)
+//-----------------------------------------------------------------------------
+{
+    value = (value < -1.0f) ? -1.0f : ((value > 1.0f) ? 1.0f : value);
+    return (int16_t)lrintf(value * 32767.0f);
+}
+
+//-----------------------------------------------------------------------------
+static float Snorm16ToFloat(int16_t value)
+//-----------------------------------------------------------------------------
+{
+    float result = value / 32767.0f;
+    return (result < -1.0f) ? -1.0f : result;
+}
+
+//-----------------------------------------------------------------------------
+static uint16_t FloatToUnorm16(float value)
+//-----------------------------------------------------------------------------
+{
+    value = (value < 0.0f) ? 0.0f : ((value > 1.0f) ? 1.0f : value);
+    return (uint16_t)lrintf(value * 65535.0f);
+}
+
+//-----------------------------------------------------------------------------
+static void DecodeOctahedral(const int16_t* pEncoded, float* pNormal)
+//-----------------------------------------------------------------------------
+{
+    // Same as SvrDecodeNormal in SVR_MESH_GLSL_DECODE
+    float x = Snorm16ToFloat(pEncoded[0]);
+    float y = Snorm16ToFloat(pEncoded[1]);
+    float z = 1.0f - fabsf(x) - fabsf(y);
+    float t = (-z > 0.0f) ? -z : 0.0f;
+    x += (x >= 0.0f) ? -t : t;
+    y += (y >= 0.0f) ? -t : t;
+
+    float length = sqrtf(x * x + y * y + z * z);
+    pNormal[0] = x / length;
+    pNormal[1] = y / length;
+    pNormal[2] = z / length;
+}
+
+//-----------------------------------------------------------------------------
+static void EncodeOctahedral(const float* pNormal, int16_t* pEncoded)
+//-----------------------------------------------------------------------------
+{
+    // Project onto the octahedron and fold the lower half over the upper one
+    float sum = fabsf(pNormal[0]) + fabsf(pNormal[1]) + fabsf(pNormal[2]);
+    float x = (sum > 0.0f) ? pNormal[0] / sum : 0.0f;
+    float y = (sum > 0.0f) ? pNormal[1] / sum : 0.0f;
+    if (pNormal[2] < 0.0f)
+    {
+        float foldedX = (1.0f - fabsf(y)) * ((x >= 0.0f) ? 1.0f : -1.0f);
+        float foldedY = (1.0f - fabsf(x)) * ((y >= 0.0f) ? 1.0f : -1.0f);
+        x = foldedX;
+        y = foldedY;
+    }
+
+    // Rounding each axis on its own is not the closest direction, try the neighbours
+    float baseX = floorf(x * 32767.0f);
+    float baseY = floorf(y * 32767.0f);
+    float bestDot = -2.0f;
+    for (int i = 0; i < 4; i++)
+    {
+        int16_t candidate[2] = { FloatToSnorm16((baseX + (i & 1)) / 32767.0f), FloatToSnorm16((baseY + (i >> 1)) / 32767.0f) };
+        float decoded[3];
+        DecodeOctahedral(candidate, decoded);
+        float dot = decoded[0] * pNormal[0] + decoded[1] * pNormal[1] + decoded[2] * pNormal[2];
+        if (dot > bestDot)
+        {
+            bestDot = dot;
+            pEncoded[0] = candidate[0];
+            pEncoded[1] = candidate[1];
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+static void BuildLayout(VertexLayout& layout)
+//-----------------------------------------------------------------------------
+{
+    // Components are packed to 4 byte boundaries, which is what GPUs fetch best
+    uint32_t offset = 0;
+
+    SvrMeshAttribute& position = layout.attributes[0];
+    position.location = LOCATION_POSITION;
+    position.size = 3;
+    position.offset = offset;
+    position.type = (layout.position == kPositionFloat) ? GL_FLOAT : ((layout.position == kPositionHalf) ? GL_HALF_FLOAT : GL_SHORT);
+    position.normalized = (layout.position == kPositionSnorm16);
+    offset += (layout.position == kPositionFloat) ? 12 : 8;
+
+    SvrMeshAttribute& normal = layout.attributes[1];
+    normal.location = LOCATION_NORMAL;
+    normal.size = (layout.normal == kNormalFloat) ? 3 : 2;
+    normal.offset = offset;
+    normal.type = (layout.normal == kNormalFloat) ? GL_FLOAT : GL_SHORT;
+    normal.normalized = (layout.normal == kNormalOct16);
+    offset += (layout.normal == kNormalFloat) ? 12 : 4;
+
+    SvrMeshAttribute& texcoord = layout.attributes[2];
+    texcoord.location = LOCATION_TEXCOORD0;
+    texcoord.size = 2;
+    texcoord.offset = offset;
+    texcoord.type = (layout.texcoord == kTexcoordFloat) ? GL_FLOAT : ((layout.texcoord == kTexcoordHalf) ? GL_HALF_FLOAT : GL_UNSIGNED_SHORT);
+    texcoord.normalized = (layout.texcoord == kTexcoordUnorm16);
+    offset += (layout.texcoord == kTexcoordFloat) ? 8 : 4;
+
+    layout.stride = offset;
+}
+
+struct QuantizationError
+{
+    float   position;       // Largest distance in model units
+    float   normal;         // Largest angle in degrees
+    float   texcoord;
+};
+
+//-----------------------------------------------------------------------------
+static void EncodeVertex(const VertexLayout& layout, const MeshVertex& vertex, const float* pScale, const float* pBias,
+                         unsigned char* pOut, QuantizationError& error)
+//-----------------------------------------------------------------------------
+{
+    memset(pOut, 0, layout.stride);
+
+    unsigned char* pPosition = pOut + layout.attributes[0].offset;
+    float decoded[3];
+    for (int c = 0; c < 3; c++)
+    {
+        float remapped = (vertex.position[c] - pBias[c]) / pScale[c];
+        if (layout.position == kPositionFloat)
+        {
+            memcpy(pPosition + 4 * c, &vertex.position[c], 4);
+            decoded[c] = vertex.position[c];
+        }
+        else if (layout.position == kPositionHalf)
+        {
+            uint16_t half = FloatToHalf(remapped);
+            memcpy(pPosition + 2 * c, &half, 2);
+            decoded[c] = HalfToFloat(half) * pScale[c] + pBias[c];
+        }
+        else
+        {
+            int16_t snorm = FloatToSnorm16(remapped);
+            memcpy(pPosition + 2 * c, &snorm, 2);
+            decoded[c] = Snorm16ToFloat(snorm) * pScale[c] + pBias[c];
+        }
+    }
+    float dx = decoded[0] - vertex.position[0], dy = decoded[1] - vertex.position[1], dz = decoded[2] - vertex.position[2];
+    error.position = fmaxf(error.position, sqrtf(dx * dx + dy * dy + dz * dz));
+
+    unsigned char* pNormal = pOut + layout.attributes[1].offset;
+    if (layout.normal == kNormalFloat)
+    {
+        memcpy(pNormal, vertex.normal, 12);
+    }
+    else
+    {
+        int16_t encoded[2];
+        EncodeOctahedral(vertex.normal, encoded);
+        memcpy(pNormal, encoded, 4);
+
+        float length = sqrtf(vertex.normal[0] * vertex.normal[0] + vertex.normal[1] * vertex.normal[1] + vertex.normal[2] * vertex.normal[2]);
+        if (length > 0.0f)
+        {
+            DecodeOctahedral(encoded, decoded);
+            float dot = (decoded[0] * vertex.normal[0] + decoded[1] * vertex.normal[1] + decoded[2] * vertex.normal[2]) / length;
+            dot = (dot > 1.0f) ? 1.0f : dot;
+            error.normal = fmaxf(error.normal, acosf(dot) * (180.0f / (float)M_PI));
+        }
+    }
+
+    unsigned char* pTexcoord = pOut + layout.attributes[2].offset;
+    for (int c = 0; c < 2; c++)
+    {
+        float value = vertex.texcoord[c];
+        float stored = value;
+        if (layout.texcoord == kTexcoordFloat)
+        {
+            memcpy(pTexcoord + 4 * c, &value, 4);
+        }
+        else if (layout.texcoord == kTexcoordHalf)
+        {
+            uint16_t half = FloatToHalf(value);
+            memcpy(pTexcoord + 2 * c, &half, 2);
+            stored = HalfToFloat(half);
+        }
+        else
+        {
+            uint16_t unorm = FloatToUnorm16(value);
+            memcpy(pTexcoord + 2 * c, &unorm, 2);
+            stored = unorm / 65535.0f;
+        }
+        error.texcoord = fmaxf(error.texcoord, fabsf(stored - value));
+    }
+}
+
+struct OptimizeJob
+{
+    uint32_t*               pIndices;
+    const SvrMeshSubMesh*   pSubMeshes;
+    const MeshVertex*       pVertices;
+    size_t                  numVertices;
+};
+
+//-----------------------------------------------------------------------------
+static void OptimizeSubMeshes(void* pContext, int begin, int end)
+//-----------------------------------------------------------------------------
+{
+    const OptimizeJob& job = *(const OptimizeJob*)pContext;
+    for (int s = begin; s < end; s++)
+    {
+        uint32_t* pRange = job.pIndices + job.pSubMeshes[s].firstIndex;
+        size_t count = job.pSubMeshes[s].numIndices;
+        std::vector<uint32_t> reordered(count);
+        SvrOptimizeVertexCache(pRange, pRange, count, job.numVertices);
+        SvrOptimizeOverdraw(&reordered[0], pRange, count, job.pVertices, job.numVertices, sizeof(MeshVertex));
+        memcpy(pRange, &reordered[0], count * sizeof(uint32_t));
+    }
+}
+
+struct LodJob
+{
+    const uint32_t*                 pIndices;
+    const SvrMeshSubMesh*           pSubMeshes;
+    const MeshVertex*               pVertices;
+    size_t                          numVertices;
+    int                             numLods;
+    std::vector<uint32_t>*          pLodIndices;    // Per sub-mesh, its own range followed by its levels
+    SvrMeshLod*                     pLods;          // Relative to pLodIndices until merged
+};
+
+//-----------------------------------------------------------------------------
+static void BuildSubMeshLods(void* pContext, int begin, int end)
+//-----------------------------------------------------------------------------
+{
+    const LodJob& job = *(const LodJob*)pContext;
+    for (int s = begin; s < end; s++)
+    {
+        const SvrMeshSubMesh& subMesh = job.pSubMeshes[s];
+        std::vector<uint32_t>& levels = job.pLodIndices[s];
+        levels.assign(job.pIndices + subMesh.firstIndex, job.pIndices + subMesh.firstIndex + subMesh.numIndices);
+
+        SvrMeshLod* pLods = job.pLods + s * job.numLods;
+        int numBuilt = SvrBuildLodChain(levels, 0, subMesh.numIndices, job.pVertices, job.numVertices, sizeof(MeshVertex),
+                                        job.numLods, pLods);
+        for (int level = numBuilt; level < job.numLods; level++)
+        {
+            pLods[level] = pLods[numBuilt - 1];
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+static void WritePadding(FILE* pFile, long alignment)
+//-----------------------------------------------------------------------------
+{
+    static const char zeros[SVR_MESH_DATA_ALIGN] = { 0 };
+    long position = ftell(pFile);
+    long padding = (alignment - position % alignment) % alignment;
+    fwrite(zeros, 1, padding, pFile);
+}
+
+//-----------------------------------------------------------------------------
+static void Usage()
+//-----------------------------------------------------------------------------
+{
+    fprintf(stderr, "usage: svrmesh [-p float|half|snorm16] [-n float|oct] [-t float|half|unorm16] [-r] [-l levels] input.obj output.svrm\n");
+    exit(1);
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+//-----------------------------------------------------------------------------
+{
+    VertexLayout layout;
+    memset(&layout, 0, sizeof(layout));
+    bool optimize = true;
+    int numLods = SVR_LOD_DEFAULT_COUNT;
+
+    int arg = 1;
+    while (arg < argc && argv[arg][0] == '-')
+    {
+        if (strcmp(argv[arg], "-r") == 0)
+        {
+            optimize = false;
+            arg++;
+            continue;
+        }
+        if (arg + 1 >= argc)
+            Usage();
+
+        const char* pValue = argv[arg + 1];
+        if (strcmp(argv[arg], "-p") == 0)
+        {
+            if (strcmp(pValue, "float") == 0)           layout.position = kPositionFloat;
+            else if (strcmp(pValue, "half") == 0)       layout.position = kPositionHalf;
+            else if (strcmp(pValue, "snorm16") == 0)    layout.position = kPositionSnorm16;
+            else Usage();
+        }
+        else if (strcmp(argv[arg], "-n") == 0)
+        {
+            if (strcmp(pValue, "float") == 0)           layout.normal = kNormalFloat;
+            else if (strcmp(pValue, "oct") == 0)        layout.normal = kNormalOct16;
+            else Usage();
+        }
+        else if (strcmp(argv[arg], "-t") == 0)
+        {
+            if (strcmp(pValue, "float") == 0)           layout.texcoord = kTexcoordFloat;
+            else if (strcmp(pValue, "half") == 0)       layout.texcoord = kTexcoordHalf;
+            else if (strcmp(pValue, "unorm16") == 0)    layout.texcoord = kTexcoordUnorm16;
+            else Usage();
+        }
+        else if (strcmp(argv[arg], "-l") == 0)
+        {
+            numLods = atoi(pValue);
+            if (numLods < 1 || numLods > SVR_MESH_MAX_LODS)
+                Usage();
+        }
+        else
+        {
+            Usage();
+        }
+        arg += 2;
+    }
+    if (argc - arg != 2)
+    {
+        Usage();
+    }
+    const char* pInputPath = argv[arg];
+    const char* pOutputPath = argv[arg + 1];
+
+    std::vector<char> text;
+    if (!ReadFile(pInputPath, text))
+    {
+        fprintf(stderr, "svrmesh: Unable to read %s\n", pInputPath);
+        return 1;
+    }
+
+    SvrObjData obj;
+    if (!SvrParseObj(text.empty() ? NULL : &text[0], text.size(), obj))
+    {
+        fprintf(stderr, "svrmesh: %s could not be parsed\n", pInputPath);
+        return 1;
+    }
+    if (obj.groups.empty())
+    {
+        fprintf(stderr, "svrmesh: %s has no faces\n", pInputPath);
+        return 1;
+    }
+
+    std::vector<float> generatedNormals;
+    SvrGenerateObjNormals(obj, generatedNormals);
+
+    // Merge corners into unique vertices, shared across sub-meshes
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<SvrMeshSubMesh> subMeshes;
+    std::unordered_map<VertexKey, uint32_t, VertexKeyHash> vertexMap;
+
+    SvrMeshHeader header;
+    memset(&header, 0, sizeof(header));
+    for (int c = 0; c < 3; c++)
+    {
+        header.boundsMin[c] = HUGE_VALF;
+        header.boundsMax[c] = -HUGE_VALF;
+    }
+
+    for (size_t g = 0; g < obj.groups.size(); g++)
+    {
+        const SvrObjGroup& group = obj.groups[g];
+
+        SvrMeshSubMesh subMesh;
+        memset(&subMesh, 0, sizeof(subMesh));
+        subMesh.firstIndex = (uint32_t)indices.size();
+        subMesh.numIndices = (uint32_t)group.corners.size();
+        strncpy(subMesh.name, group.name.c_str(), SVR_MESH_NAME_LENGTH - 1);
+        for (int c = 0; c < 3; c++)
+        {
+            subMesh.boundsMin[c] = HUGE_VALF;
+            subMesh.boundsMax[c] = -HUGE_VALF;
+        }
+
+        for (size_t i = 0; i < group.corners.size(); i++)
+        {
+            const SvrObjCorner& corner = group.corners[i];
+            VertexKey key = { corner.position, corner.texcoord, corner.normal };
+
+            std::pair<std::unordered_map<VertexKey, uint32_t, VertexKeyHash>::iterator, bool> inserted =
+                vertexMap.insert(std::make_pair(key, (uint32_t)vertices.size()));
+            if (inserted.second)
+            {
+                MeshVertex vertex;
+                memcpy(vertex.position, &obj.positions[3 * corner.position], sizeof(vertex.position));
+                const float* pNormal = (corner.normal >= 0) ? &obj.normals[3 * corner.normal] : &generatedNormals[3 * corner.position];
+                memcpy(vertex.normal, pNormal, sizeof(vertex.normal));
+                vertex.texcoord[0] = (corner.texcoord >= 0) ? obj.texcoords[2 * corner.texcoord + 0] : 0.0f;
+                vertex.texcoord[1] = (corner.texcoord >= 0) ? obj.texcoords[2 * corner.texcoord + 1] : 0.0f;
+                vertices.push_back(vertex);
+            }
+
+            indices.push_back(inserted.first->second);
+            ExpandBounds(subMesh.boundsMin, subMesh.boundsMax, obj.positions.data() + 3 * corner.position);
+        }
+
+        ExpandBounds(header.boundsMin, header.boundsMax, subMesh.boundsMin);
+        ExpandBounds(header.boundsMin, header.boundsMax, subMesh.boundsMax);
+        subMeshes.push_back(subMesh);
+    }
+
+    SvrVertexCacheStats before = SvrAnalyzeVertexCache(&indices[0], indices.size(), vertices.size());
+    if (optimize)
+    {
+        // Each sub-mesh keeps its index range, only the order within it changes
+        OptimizeJob job = { &indices[0], &subMeshes[0], &vertices[0], vertices.size() };
+        SvrParallelFor((int)subMeshes.size(), 1, OptimizeSubMeshes, &job);
+
+        std::vector<MeshVertex> fetchOrder(vertices.size());
+        size_t numUsed = SvrOptimizeVertexFetch(&fetchOrder[0], &indices[0], indices.size(), &vertices[0], vertices.size(), sizeof(MeshVertex));
+        fetchOrder.resize(numUsed);
+        vertices.swap(fetchOrder);
+    }
+    SvrVertexCacheStats after = SvrAnalyzeVertexCache(&indices[0], indices.size(), vertices.size());
+
+    // Coarser levels follow all the full detail ranges.  Sub-mesh i's levels are
+    // lods[i * numLods + level], padded with the last level where simplification stopped.
+    std::vector<SvrMeshLod> lods(subMeshes.size() * numLods);
+    std::vector<std::vector<uint32_t> > lodIndices(subMeshes.size());
+    LodJob lodJob = { &indices[0], &subMeshes[0], &vertices[0], vertices.size(), numLods, &lodIndices[0], &lods[0] };
+    SvrParallelFor((int)subMeshes.size(), 1, BuildSubMeshLods, &lodJob);
+
+    std::vector<uint32_t> levelTriangles(numLods, 0);
+    for (size_t s = 0; s < subMeshes.size(); s++)
+    {
+        uint32_t numIndices = subMeshes[s].numIndices;
+        uint32_t offset = (uint32_t)indices.size() - numIndices;
+        indices.insert(indices.end(), lodIndices[s].begin() + numIndices, lodIndices[s].end());
+        for (int level = 0; level < numLods; level++)
+        {
+            SvrMeshLod& lod = lods[s * numLods + level];
+            lod.firstIndex = (lod.firstIndex < numIndices) ? subMeshes[s].firstIndex : lod.firstIndex + offset;
+            levelTriangles[level] += lod.numIndices / 3;
+        }
+    }
+
+    // Quantized positions span [-1, 1] over the bounds on each axis
+    for (int c = 0; c < 3; c++)
+    {
+        bool quantized = (layout.position != kPositionFloat);
+        float extent = 0.5f * (header.boundsMax[c] - header.boundsMin[c]);
+        header.positionScale[c] = (quantized && extent > 0.0f) ? extent : 1.0f;
+        header.positionBias[c] = quantized ? 0.5f * (header.boundsMax[c] + header.boundsMin[c]) : 0.0f;
+    }
+
+    BuildLayout(layout);
+    std::vector<unsigned char> vertexData(vertices.size() * layout.stride);
+    QuantizationError error = { 0.0f, 0.0f, 0.0f };
+    bool texcoordsClamped = false;
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        const float* pTexcoord = vertices[i].texcoord;
+        texcoordsClamped |= (pTexcoord[0] < 0.0f || pTexcoord[0] > 1.0f || pTexcoord[1] < 0.0f || pTexcoord[1] > 1.0f);
+        EncodeVertex(layout, vertices[i], header.positionScale, header.positionBias, &vertexData[i * layout.stride], error);
+    }
+    if (layout.texcoord == kTexcoordUnorm16 && texcoordsClamped)
+    {
+        fprintf(stderr, "svrmesh: %s has texcoords outside [0, 1], use -t half or float\n", pInputPath);
+        return 1;
+    }
+
+    // Index 0xFFFF is left alone so primitive restart can never trigger by accident
+    bool shortIndices = vertices.size() <= 0xFFFF;
+    std::vector<uint16_t> shortIndexData;
+    if (shortIndices)
+    {
+        shortIndexData.assign(indices.begin(), indices.end());
+    }
+    size_t indexSize = shortIndices ? sizeof(uint16_t) : sizeof(uint32_t);
+    const void* pIndexData = shortIndices ? (const void*)&shortIndexData[0] : (const void*)&indices[0];
+
+    uint64_t tablesSize = sizeof(header) + sizeof(layout.attributes) + subMeshes.size() * sizeof(SvrMeshSubMesh) +
+                          lods.size() * sizeof(SvrMeshLod);
+
+    header.magic = SVR_MESH_MAGIC;
+    header.version = SVR_MESH_VERSION;
+    header.numAttributes = 3;
+    header.numSubMeshes = (uint32_t)subMeshes.size();
+    header.numVertices = (uint32_t)vertices.size();
+    header.vertexStride = layout.stride;
+    header.numIndices = (uint32_t)indices.size();
+    header.indexType = shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    header.numLods = numLods;
+    header.vertexDataOffset = (tablesSize + SVR_MESH_DATA_ALIGN - 1) & ~(uint64_t)(SVR_MESH_DATA_ALIGN - 1);
+    header.vertexDataSize = vertexData.size();
+    header.indexDataOffset = (header.vertexDataOffset + header.vertexDataSize + SVR_MESH_DATA_ALIGN - 1) & ~(uint64_t)(SVR_MESH_DATA_ALIGN - 1);
+    header.indexDataSize = indices.size() * indexSize;
+
+    FILE* pOutput = fopen(pOutputPath, "wb");
+    if (pOutput == NULL)
+    {
+        fprintf(stderr, "svrmesh: Unable to create %s\n", pOutputPath);
+        return 1;
+    }
+
+    fwrite(&header, sizeof(header), 1, pOutput);
+    fwrite(layout.attributes, sizeof(layout.attributes), 1, pOutput);
+    fwrite(&subMeshes[0], sizeof(SvrMeshSubMesh), subMeshes.size(), pOutput);
+    fwrite(&lods[0], sizeof(SvrMeshLod), lods.size(), pOutput);
+    WritePadding(pOutput, SVR_MESH_DATA_ALIGN);
+    fwrite(&vertexData[0], 1, vertexData.size(), pOutput);
+    WritePadding(pOutput, SVR_MESH_DATA_ALIGN);
+    fwrite(pIndexData, indexSize, indices.size(), pOutput);
+
+    bool failed = ferror(pOutput) != 0;
+    failed |= fclose(pOutput) != 0;
+    if (failed)
+    {
+        fprintf(stderr, "svrmesh: Unable to write %s\n", pOutputPath);
+        return 1;
+    }
+
+    // What the GPU has to fetch, against the unquantized 32 byte layout with 32 bit indices
+    // of the full detail levels
+    uint64_t fullIndices = (uint64_t)levelTriangles[0] * 3;
+    uint64_t fetchBytes = header.vertexDataSize + fullIndices * indexSize;
+    uint64_t floatBytes = (uint64_t)vertices.size() * sizeof(MeshVertex) + fullIndices * sizeof(uint32_t);
+    printf("svrmesh: %s, %u sub-meshes, %u vertices, %u triangles\n", pOutputPath,
+           header.numSubMeshes, header.numVertices, levelTriangles[0]);
+    printf("svrmesh: %u bytes per vertex, %u bit indices, %llu bytes to fetch (%.0f%% of float)\n",
+           layout.stride, (unsigned)indexSize * 8, (unsigned long long)fetchBytes, 100.0 * fetchBytes / floatBytes);
+    printf("svrmesh: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (%u entry FIFO)\n",
+           before.acmr, after.acmr, before.atvr, after.atvr, SVR_VERTEX_CACHE_SIZE);
+    printf("svrmesh: Largest error: position %g, normal %.4f degrees, texcoord %g\n",
+           error.position, error.normal, error.texcoord);
+    printf("svrmesh: %d levels, triangles:", numLods);
+    for (int level = 0; level < numLods; level++)
+    {
+        printf(" %u", levelTriangles[level]);
+    }
+    printf("\n");
+    return 0;
+}
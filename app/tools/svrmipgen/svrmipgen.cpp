@@ -0,0 +1,180 @@
+//=============================================================================
+// FILE: svrmipgen.cpp
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+// Fills in the mip chain of a KTX file offline, with the same filters used by
+// KtxTexture::GenerateMips at load time.
+//
+//  usage: svrmipgen [-f box|kaiser|lanczos] input.ktx output.ktx
+//
+// Only uncompressed 2D textures are handled.  Levels already in the input are
+// replaced by ones filtered from the base level.
+//=============================================================================
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "svrJobs.h"
+#include "svrKtxLoader.h"
+#include "svrMipGen.h"
+
+using namespace Svr;
+
+//-----------------------------------------------------------------------------
+static bool ReadFile(const char* pPath, std::vector<unsigned char>& data)
+//-----------------------------------------------------------------------------
+{
+    FILE* pFile = fopen(pPath, "rb");
+    if (pFile == NULL)
+    {
+        return false;
+    }
+
+    fseek(pFile, 0, SEEK_END);
+    long size = ftell(pFile);
+    fseek(pFile, 0, SEEK_SET);
+
+    data.resize(size > 0 ? size : 0);
+    bool result = size > 0 && fread(&data[0], 1, size, pFile) == (size_t)size;
+    fclose(pFile);
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+static void Usage()
+//-----------------------------------------------------------------------------
+{
+    fprintf(stderr, "usage: svrmipgen [-f box|kaiser|lanczos] input.ktx output.ktx\n");
+    exit(1);
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+//-----------------------------------------------------------------------------
+{
+    SvrMipFilter filter = kMipFilterKaiser;
+
+    int arg = 1;
+    while (arg < argc && argv[arg][0] == '-')
+    {
+        if (strcmp(argv[arg], "-f") == 0 && arg + 1 < argc)
+        {
+            const char* pName = argv[arg + 1];
+            if (strcmp(pName, "box") == 0)
+                filter = kMipFilterBox;
+            else if (strcmp(pName, "kaiser") == 0)
+                filter = kMipFilterKaiser;
+            else if (strcmp(pName, "lanczos") == 0)
+                filter = kMipFilterLanczos;
+            else
+                Usage();
+            arg += 2;
+        }
+        else
+        {
+            Usage();
+        }
+    }
+    if (argc - arg != 2)
+    {
+        Usage();
+    }
+    const char* pInputPath = argv[arg];
+    const char* pOutputPath = argv[arg + 1];
+
+    std::vector<unsigned char> input;
+    if (!ReadFile(pInputPath, input) || input.size() < sizeof(TKTXHeader))
+    {
+        fprintf(stderr, "svrmipgen: Unable to read %s\n", pInputPath);
+        return 1;
+    }
+
+    TKTXHeader header;
+    memcpy(&header, &input[0], sizeof(header));
+
+    const unsigned char identifier[12] = KTX_IDENTIFIER_REF;
+    if (memcmp(header.identifier, identifier, sizeof(identifier)) != 0 || header.endianness != KTX_ENDIAN_REF)
+    {
+        fprintf(stderr, "svrmipgen: %s is not a little endian KTX file\n", pInputPath);
+        return 1;
+    }
+
+    SvrMipFormat format;
+    if (header.glType == 0 || header.pixelDepth > 1 || header.numberOfArrayElements != 0 || header.numberOfFaces != 1 ||
+        header.pixelHeight == 0 || !SvrGetMipFormat(header.glInternalFormat, header.glType, &format))
+    {
+        fprintf(stderr, "svrmipgen: %s is not an uncompressed 2D texture in a supported format (0x%X, 0x%X)\n",
+                pInputPath, header.glInternalFormat, header.glType);
+        return 1;
+    }
+
+    size_t baseOffset = sizeof(header) + header.bytesOfKeyValueData;
+    uint32_t rowPitch = SvrGetMipRowPitch(format, header.pixelWidth);
+    size_t baseSize = (size_t)rowPitch * header.pixelHeight;
+
+    uint32_t imageSize = 0;
+    if (baseOffset + sizeof(imageSize) <= input.size())
+    {
+        memcpy(&imageSize, &input[baseOffset], sizeof(imageSize));
+    }
+    if (imageSize < baseSize || baseOffset + sizeof(imageSize) + baseSize > input.size())
+    {
+        fprintf(stderr, "svrmipgen: %s is truncated\n", pInputPath);
+        return 1;
+    }
+
+    SvrMipImage base;
+    base.pData = &input[baseOffset + sizeof(imageSize)];
+    base.width = header.pixelWidth;
+    base.height = header.pixelHeight;
+    base.rowPitch = rowPitch;
+
+    uint32_t numLevels = SvrGetMipLevelCount(base.width, base.height);
+    std::vector<unsigned char> chain(SvrGetMipChainSize(format, base.width, base.height, numLevels) + 1);
+    std::vector<SvrMipImage> levels(numLevels);
+    SvrGenerateMipChain(format, filter, base, numLevels, &chain[0], &levels[0]);
+
+    FILE* pOutput = fopen(pOutputPath, "wb");
+    if (pOutput == NULL)
+    {
+        fprintf(stderr, "svrmipgen: Unable to create %s\n", pOutputPath);
+        return 1;
+    }
+
+    // Header and key/value data go through unchanged apart from the level count.
+    // Every level is a multiple of 4 bytes already, so no mip padding is needed.
+    header.numberOfMipmapLevels = numLevels;
+    fwrite(&header, sizeof(header), 1, pOutput);
+    if (header.bytesOfKeyValueData != 0)
+    {
+        fwrite(&input[sizeof(header)], header.bytesOfKeyValueData, 1, pOutput);
+    }
+
+    imageSize = (uint32_t)baseSize;
+    fwrite(&imageSize, sizeof(imageSize), 1, pOutput);
+    fwrite(base.pData, baseSize, 1, pOutput);
+
+    for (uint32_t level = 1; level < numLevels; level++)
+    {
+        const SvrMipImage& image = levels[level - 1];
+        imageSize = image.rowPitch * image.height;
+        fwrite(&imageSize, sizeof(imageSize), 1, pOutput);
+        fwrite(image.pData, imageSize, 1, pOutput);
+    }
+
+    bool failed = ferror(pOutput) != 0;
+    failed |= fclose(pOutput) != 0;
+    if (failed)
+    {
+        fprintf(stderr, "svrmipgen: Unable to write %s\n", pOutputPath);
+        return 1;
+    }
+
+    printf("svrmipgen: %s, %u x %u, %u levels\n", pOutputPath, header.pixelWidth, header.pixelHeight, numLevels);
+    SvrShutdownJobs();
+    return 0;
+}
@@ -0,0 +1,254 @@
+//=============================================================================
+// FILE: svrpack.cpp
+//
+//                  Copyright (c) 2015 QUALCOMM Technologies Inc.
+//                              All Rights Reserved.
+//
+// Packs a directory tree (or a list of files) into an asset archive read by
+// Svr::SvrArchive at runtime.
+//
+//  usage: svrpack [-a alignment] [-C root] output.svra input...
+//
+// Inputs that are directories are added recursively.  Entry names are paths
+// relative to the root directory (-C, default: the current directory).
+//=============================================================================
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "svrArchiveFormat.h"
+
+using namespace Svr;
+
+struct PackInput
+{
+    std::string     name;       // Entry name inside the archive
+    std::string     path;       // Where to read it from
+    uint64_t        size;
+    uint32_t        hash;
+};
+
+//-----------------------------------------------------------------------------
+static bool SortByHash(const PackInput& a, const PackInput& b)
+//-----------------------------------------------------------------------------
+{
+    if (a.hash != b.hash)
+        return a.hash < b.hash;
+    return a.name < b.name;
+}
+
+//-----------------------------------------------------------------------------
+static void AddInput(const std::string& root, const std::string& name, std::vector<PackInput>& inputs)
+//-----------------------------------------------------------------------------
+{
+    std::string path = root.empty() ? name : root + "/" + name;
+
+    struct stat fileStat;
+    if (stat(path.c_str(), &fileStat) != 0)
+    {
+        fprintf(stderr, "svrpack: Unable to stat %s\n", path.c_str());
+        exit(1);
+    }
+
+    if (S_ISDIR(fileStat.st_mode))
+    {
+        DIR* pDir = opendir(path.c_str());
+        if (pDir == NULL)
+        {
+            fprintf(stderr, "svrpack: Unable to open directory %s\n", path.c_str());
+            exit(1);
+        }
+
+        struct dirent* pEntry;
+        while ((pEntry = readdir(pDir)) != NULL)
+        {
+            if (strcmp(pEntry->d_name, ".") == 0 || strcmp(pEntry->d_name, "..") == 0)
+                continue;
+
+            AddInput(root, (name == ".") ? std::string(pEntry->d_name) : name + "/" + pEntry->d_name, inputs);
+        }
+        closedir(pDir);
+        return;
+    }
+
+    if (!S_ISREG(fileStat.st_mode))
+        return;
+
+    PackInput input;
+    input.name = name;
+    input.path = path;
+    input.size = fileStat.st_size;
+    input.hash = SvrArchiveHash(name.c_str(), name.size());
+    inputs.push_back(input);
+}
+
+//-----------------------------------------------------------------------------
+static bool WritePadding(FILE* fp, uint64_t* pOffset, uint32_t alignment)
+//-----------------------------------------------------------------------------
+{
+    static const char zeros[4096] = { 0 };
+
+    uint64_t aligned = (*pOffset + alignment - 1) / alignment * alignment;
+    while (*pOffset < aligned)
+    {
+        size_t chunk = (size_t)std::min<uint64_t>(aligned - *pOffset, sizeof(zeros));
+        if (fwrite(zeros, 1, chunk, fp) != chunk)
+            return false;
+        *pOffset += chunk;
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+static bool CopyFile(FILE* fpOut, const PackInput& input)
+//-----------------------------------------------------------------------------
+{
+    FILE* fpIn = fopen(input.path.c_str(), "rb");
+    if (fpIn == NULL)
+    {
+        fprintf(stderr, "svrpack: Unable to open %s\n", input.path.c_str());
+        return false;
+    }
+
+    char buffer[64 * 1024];
+    uint64_t remaining = input.size;
+    while (remaining > 0)
+    {
+        size_t chunk = (size_t)std::min<uint64_t>(remaining, sizeof(buffer));
+        if (fread(buffer, 1, chunk, fpIn) != chunk || fwrite(buffer, 1, chunk, fpOut) != chunk)
+        {
+            fprintf(stderr, "svrpack: Error copying %s\n", input.path.c_str());
+            fclose(fpIn);
+            return false;
+        }
+        remaining -= chunk;
+    }
+
+    fclose(fpIn);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+static void Usage()
+//-----------------------------------------------------------------------------
+{
+    fprintf(stderr, "usage: svrpack [-a alignment] [-C root] output.svra input...\n");
+    exit(1);
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+//-----------------------------------------------------------------------------
+{
+    uint32_t alignment = SVR_ARCHIVE_DEFAULT_ALIGN;
+    std::string root;
+
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if (strcmp(argv[arg], "-a") == 0 && arg + 1 < argc)
+        {
+            alignment = (uint32_t)atoi(argv[++arg]);
+            if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+            {
+                fprintf(stderr, "svrpack: Alignment must be a power of two\n");
+                return 1;
+            }
+        }
+        else if (strcmp(argv[arg], "-C") == 0 && arg + 1 < argc)
+        {
+            root = argv[++arg];
+        }
+        else
+        {
+            Usage();
+        }
+    }
+
+    if (argc - arg < 2)
+        Usage();
+
+    const char* pOutputPath = argv[arg++];
+
+    std::vector<PackInput> inputs;
+    for (; arg < argc; arg++)
+    {
+        AddInput(root, argv[arg], inputs);
+    }
+
+    std::sort(inputs.begin(), inputs.end(), SortByHash);
+    for (size_t i = 1; i < inputs.size(); i++)
+    {
+        if (inputs[i].name == inputs[i - 1].name)
+        {
+            fprintf(stderr, "svrpack: %s added twice\n", inputs[i].name.c_str());
+            return 1;
+        }
+    }
+
+    // Names follow the table so that the whole index is one contiguous read
+    std::vector<SvrArchiveEntry> entries(inputs.size());
+    std::string names;
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        entries[i].nameHash = inputs[i].hash;
+        entries[i].nameOffset = (uint32_t)names.size();
+        entries[i].nameLength = (uint32_t)inputs[i].name.size();
+        entries[i].flags = 0;
+        entries[i].size = inputs[i].size;
+        names += inputs[i].name;
+        names += '\0';
+    }
+
+    SvrArchiveHeader header;
+    header.magic = SVR_ARCHIVE_MAGIC;
+    header.version = SVR_ARCHIVE_VERSION;
+    header.numEntries = (uint32_t)entries.size();
+    header.dataAlignment = alignment;
+    header.namesOffset = sizeof(SvrArchiveHeader) + entries.size() * sizeof(SvrArchiveEntry);
+    header.namesSize = names.size();
+
+    uint64_t offset = header.namesOffset + header.namesSize;
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        offset = (offset + alignment - 1) / alignment * alignment;
+        entries[i].dataOffset = offset;
+        offset += entries[i].size;
+    }
+
+    FILE* fp = fopen(pOutputPath, "wb");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "svrpack: Unable to create %s\n", pOutputPath);
+        return 1;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    if (ok && !entries.empty())
+        ok = fwrite(&entries[0], sizeof(SvrArchiveEntry), entries.size(), fp) == entries.size();
+    if (ok)
+        ok = fwrite(names.data(), 1, names.size(), fp) == names.size();
+
+    offset = header.namesOffset + header.namesSize;
+    for (size_t i = 0; ok && i < inputs.size(); i++)
+    {
+        ok = WritePadding(fp, &offset, alignment) && CopyFile(fp, inputs[i]);
+        offset += inputs[i].size;
+    }
+
+    if (fclose(fp) != 0 || !ok)
+    {
+        fprintf(stderr, "svrpack: Failed writing %s\n", pOutputPath);
+        remove(pOutputPath);
+        return 1;
+    }
+
+    printf("svrpack: Wrote %u entries (%llu bytes) to %s\n", header.numEntries, (unsigned long long)offset, pOutputPath);
+    return 0;
+}